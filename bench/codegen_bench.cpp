@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmarks for each stage of the code generation pipeline: DWARF and Clang
+ * parsing, every type graph pass, code emission, compilation and relocation.
+ *
+ * Each stage is run over every root type in the generated corpus (see
+ * gen_corpus.py). The input to a stage is rebuilt outside of the timed region
+ * on every iteration, so only the stage itself is measured.
+ */
+#include <benchmark/benchmark.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendAction.h>
+#include <clang/Sema/Sema.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+#include <glog/logging.h>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_corpus_roots.h"
+#include "oi/CodeGen.h"
+#include "oi/Config.h"
+#include "oi/OICompiler.h"
+#include "oi/OIParser.h"
+#include "oi/SymbolService.h"
+#include "oi/type_graph/ClangTypeParser.h"
+#include "oi/type_graph/DrgnParser.h"
+#include "oi/type_graph/NodeTracker.h"
+#include "oi/type_graph/PassManager.h"
+#include "oi/type_graph/TypeGraph.h"
+
+using namespace oi::detail;
+using namespace oi::detail::type_graph;
+
+namespace {
+
+/*
+ * State shared by every benchmark: the corpus' symbols and the configuration
+ * OIL would use to generate code for it.
+ */
+struct Pipeline {
+  std::shared_ptr<SymbolService> symbols;
+  OICompiler::Config compilerConfig;
+  OICodeGen::Config generatorConfig;
+
+  Pipeline() : symbols{std::make_shared<SymbolService>(CORPUS_EXE_PATH)} {
+    std::map<Feature, bool> features = {
+        {Feature::TypeGraph, true},     {Feature::TreeBuilderV2, true},
+        {Feature::Library, true},       {Feature::PackStructs, true},
+        {Feature::PruneTypeGraph, true},
+    };
+    std::vector<std::filesystem::path> configFiles{CONFIG_FILE_PATH};
+    auto featureSet = config::processConfigFiles(
+        configFiles, std::move(features), compilerConfig, generatorConfig);
+    if (!featureSet)
+      throw std::runtime_error("failed to process configuration");
+    compilerConfig.features = *featureSet;
+    generatorConfig.features = *featureSet;
+  }
+
+  drgn_type* getRoot(std::string_view root) {
+    irequest req{"entry", "bench_" + std::string{root}, "arg0"};
+    auto rootInfo = symbols->getRootType(req);
+    if (!rootInfo)
+      throw std::runtime_error("failed to find root type: " +
+                               std::string{root});
+    return rootInfo->type.type;
+  }
+
+  CodeGen makeCodeGen() {
+    CodeGen codegen{generatorConfig, *symbols};
+    if (!codegen.registerContainers())
+      throw std::runtime_error("failed to register containers");
+    return codegen;
+  }
+
+  std::string generateCode(drgn_type* root) {
+    auto codegen = makeCodeGen();
+    std::string code;
+    if (!codegen.codegenFromDrgn(root, code))
+      throw std::runtime_error("code generation failed");
+    return code;
+  }
+};
+
+Pipeline& pipeline() {
+  static Pipeline p;
+  return p;
+}
+
+void BM_DrgnParse(benchmark::State& state, std::string_view root) {
+  auto* drgnRoot = pipeline().getRoot(root);
+  auto options = pipeline().makeCodeGen().drgnParserOptions();
+  size_t nodes = 0;
+  for (auto _ : state) {
+    TypeGraph typeGraph;
+    DrgnParser drgnParser{typeGraph, options};
+    benchmark::DoNotOptimize(&drgnParser.parse(drgnRoot));
+    nodes = typeGraph.size();
+  }
+  state.counters["nodes"] = nodes;
+}
+
+/*
+ * ClangTooling drives parsing through an ASTConsumer, so time the
+ * ClangTypeParser inside the consumer and report it as manual time.
+ */
+class ClangParseContext {
+ public:
+  std::string fullyQualifiedName;
+  std::vector<std::unique_ptr<ContainerInfo>> containerInfos;
+  std::chrono::duration<double> elapsed{};
+  size_t nodes = 0;
+  clang::Sema* sema = nullptr;
+};
+
+class ClangParseConsumer : public clang::ASTConsumer {
+ public:
+  ClangParseConsumer(ClangParseContext& ctx) : ctx_{ctx} {
+  }
+
+  void HandleTranslationUnit(clang::ASTContext& context) override {
+    const clang::Type* type = nullptr;
+    for (const clang::Type* ty : context.getTypes()) {
+      if (ty->getTypeClass() != clang::Type::Record)
+        continue;
+      if (llvm::cast<const clang::RecordType>(ty)
+              ->getDecl()
+              ->getQualifiedNameAsString() == ctx_.fullyQualifiedName) {
+        type = ty;
+        break;
+      }
+    }
+    if (type == nullptr)
+      throw std::runtime_error("failed to find type in corpus: " +
+                               ctx_.fullyQualifiedName);
+
+    auto start = std::chrono::steady_clock::now();
+    TypeGraph typeGraph;
+    ClangTypeParser parser{typeGraph, ctx_.containerInfos, {}};
+    benchmark::DoNotOptimize(&parser.parse(context, *ctx_.sema, *type));
+    ctx_.elapsed = std::chrono::steady_clock::now() - start;
+    ctx_.nodes = typeGraph.size();
+  }
+
+ private:
+  ClangParseContext& ctx_;
+};
+
+class ClangParseAction : public clang::ASTFrontendAction {
+ public:
+  ClangParseAction(ClangParseContext& ctx) : ctx_{ctx} {
+  }
+
+  void ExecuteAction() override {
+    clang::CompilerInstance& CI = getCompilerInstance();
+    if (!CI.hasSema())
+      CI.createSema(clang::TU_Complete, nullptr);
+    ctx_.sema = &CI.getSema();
+    clang::ASTFrontendAction::ExecuteAction();
+  }
+
+  std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+      clang::CompilerInstance&, clang::StringRef) override {
+    return std::make_unique<ClangParseConsumer>(ctx_);
+  }
+
+ private:
+  ClangParseContext& ctx_;
+};
+
+class ClangParseActionFactory : public clang::tooling::FrontendActionFactory {
+ public:
+  ClangParseActionFactory(ClangParseContext& ctx) : ctx_{ctx} {
+  }
+
+  std::unique_ptr<clang::FrontendAction> create() override {
+    return std::make_unique<ClangParseAction>(ctx_);
+  }
+
+ private:
+  ClangParseContext& ctx_;
+};
+
+void BM_ClangParse(benchmark::State& state, std::string_view root) {
+  std::string err;
+  auto db = clang::tooling::CompilationDatabase::loadFromDirectory(BUILD_DIR,
+                                                                   err);
+  if (!db) {
+    state.SkipWithError("failed to load compilation database");
+    return;
+  }
+
+  ClangParseContext ctx;
+  ctx.fullyQualifiedName = "corpus::" + std::string{root};
+  ClangParseActionFactory factory{ctx};
+  std::vector<std::string> sourcePaths{CORPUS_CPP_PATH};
+
+  for (auto _ : state) {
+    clang::tooling::ClangTool tool{*db, sourcePaths};
+    if (tool.run(&factory) != 0) {
+      state.SkipWithError("clang type parsing failed");
+      return;
+    }
+    state.SetIterationTime(ctx.elapsed.count());
+  }
+  state.counters["nodes"] = ctx.nodes;
+}
+
+void BM_Pass(benchmark::State& state, std::string_view root, size_t passIdx) {
+  auto& p = pipeline();
+  auto* drgnRoot = p.getRoot(root);
+  size_t nodesBefore = 0;
+  size_t nodesAfter = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto codegen = p.makeCodeGen();
+    TypeGraph typeGraph;
+    codegen.addDrgnRoot(drgnRoot, typeGraph);
+    DrgnParser drgnParser{typeGraph, codegen.drgnParserOptions()};
+    PassManager pm;
+    codegen.addTransformPasses(pm, drgnParser);
+    NodeTracker tracker;
+    for (auto& pass : pm.passes().first(passIdx))
+      pass.run(typeGraph, tracker);
+    nodesBefore = typeGraph.size();
+    state.ResumeTiming();
+
+    pm.passes()[passIdx].run(typeGraph, tracker);
+
+    state.PauseTiming();
+    nodesAfter = typeGraph.size();
+    state.ResumeTiming();
+  }
+  state.counters["nodes_before"] = nodesBefore;
+  state.counters["nodes_after"] = nodesAfter;
+}
+
+void BM_Generate(benchmark::State& state, std::string_view root) {
+  auto& p = pipeline();
+  auto* drgnRoot = p.getRoot(root);
+  size_t codeBytes = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto codegen = p.makeCodeGen();
+    TypeGraph typeGraph;
+    codegen.addDrgnRoot(drgnRoot, typeGraph);
+    codegen.transform(typeGraph);
+    std::string code;
+    state.ResumeTiming();
+
+    codegen.generate(
+        typeGraph, code,
+        CodeGen::HashedComponent{SymbolService::getTypeName(drgnRoot)});
+    codeBytes = code.size();
+  }
+  state.counters["code_bytes"] = codeBytes;
+}
+
+void BM_Compile(benchmark::State& state, std::string_view root) {
+  auto& p = pipeline();
+  auto code = p.generateCode(p.getRoot(root));
+  auto objectPath = std::filesystem::temp_directory_path() /
+                    ("codegen_bench_" + std::string{root} + ".o");
+
+  OICompiler compiler{p.symbols, p.compilerConfig};
+  for (auto _ : state) {
+    if (!compiler.compile(code, "bench_jit.cpp", objectPath)) {
+      state.SkipWithError("compilation failed");
+      return;
+    }
+  }
+  state.counters["code_bytes"] = code.size();
+  state.counters["object_bytes"] = std::filesystem::file_size(objectPath);
+  std::filesystem::remove(objectPath);
+}
+
+void BM_Relocate(benchmark::State& state, std::string_view root) {
+  auto& p = pipeline();
+  auto code = p.generateCode(p.getRoot(root));
+  auto objectPath = std::filesystem::temp_directory_path() /
+                    ("codegen_bench_reloc_" + std::string{root} + ".o");
+
+  OICompiler compiler{p.symbols, p.compilerConfig};
+  if (!compiler.compile(code, "bench_jit.cpp", objectPath)) {
+    state.SkipWithError("compilation failed");
+    return;
+  }
+
+  // Relocate against a slab the size of OIL's text segment
+  std::vector<uint8_t> slab(1u << 22);
+  for (auto _ : state) {
+    auto relocRes = compiler.applyRelocs(
+        reinterpret_cast<uintptr_t>(slab.data()), {objectPath}, {});
+    if (!relocRes) {
+      state.SkipWithError("relocation failed");
+      return;
+    }
+    benchmark::DoNotOptimize(relocRes->symbols.size());
+  }
+  std::filesystem::remove(objectPath);
+}
+
+void registerBenchmarks() {
+  // Enumerate the pass names once, the pass list doesn't depend on the root
+  auto& p = pipeline();
+  auto codegen = p.makeCodeGen();
+  TypeGraph typeGraph;
+  DrgnParser drgnParser{typeGraph, codegen.drgnParserOptions()};
+  PassManager pm;
+  codegen.addTransformPasses(pm, drgnParser);
+
+  for (std::string_view root : corpusRoots) {
+    std::string suffix = "/" + std::string{root};
+    benchmark::RegisterBenchmark(("DrgnParse" + suffix).c_str(), BM_DrgnParse,
+                                 root);
+    benchmark::RegisterBenchmark(("ClangParse" + suffix).c_str(),
+                                 BM_ClangParse, root)
+        ->UseManualTime();
+    for (size_t i = 0; i < pm.passes().size(); i++) {
+      auto name = "Pass" + suffix + "/" + std::to_string(i) + "_" +
+                  pm.passes()[i].name();
+      benchmark::RegisterBenchmark(name.c_str(), BM_Pass, root, i);
+    }
+    benchmark::RegisterBenchmark(("Generate" + suffix).c_str(), BM_Generate,
+                                 root);
+    benchmark::RegisterBenchmark(("Compile" + suffix).c_str(), BM_Compile,
+                                 root)
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("Relocate" + suffix).c_str(), BM_Relocate,
+                                 root)
+        ->Unit(benchmark::kMillisecond);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_minloglevel = google::WARNING;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+
+  registerBenchmarks();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
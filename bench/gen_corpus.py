@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Generate the type corpus used by the codegen benchmarks.
+
+Writes a C++ source file defining a set of representative root types, each
+exposed as the first argument of a `bench_<name>` function so it can be looked
+up with an `entry:bench_<name>:arg0` request, and a header listing the roots.
+"""
+
+import sys
+
+PRIMITIVES = ["int8_t", "int16_t", "int32_t", "int64_t", "float", "double"]
+MEMBER_TYPES = PRIMITIVES + [
+    "std::string",
+    "std::vector<int32_t>",
+    "std::optional<int64_t>",
+    "std::map<int32_t, std::string>",
+]
+
+
+def gen_wide(f, width):
+    name = f"Wide{width}"
+    f.write(f"struct {name} {{\n")
+    for i in range(width):
+        f.write(f"  {MEMBER_TYPES[i % len(MEMBER_TYPES)]} m{i};\n")
+    f.write("};\n\n")
+    return name
+
+
+def gen_deep(f, depth):
+    prefix = f"Deep{depth}_"
+    f.write(f"struct {prefix}0 {{\n  int32_t leaf;\n}};\n")
+    for i in range(1, depth):
+        f.write(f"struct {prefix}{i} {{\n")
+        f.write(f"  {prefix}{i - 1} child;\n")
+        f.write(f"  std::vector<{prefix}{i - 1}> children;\n")
+        f.write(f"  int64_t value{i};\n")
+        f.write("};\n")
+    f.write("\n")
+    return f"{prefix}{depth - 1}"
+
+
+def gen_templates(f, count):
+    name = f"Templates{count}"
+    f.write(
+        f"""template <int N, typename T>
+struct Templ{count} {{
+  std::array<std::pair<T, std::string>, N % 4 + 1> a;
+  std::vector<std::optional<T>> b;
+  std::unordered_map<T, std::vector<std::pair<int, T>>> c;
+}};
+
+struct {name} {{
+  std::map<std::string, std::vector<std::pair<int, std::unordered_map<int, std::string>>>> nested;
+  std::variant<int, std::string, std::vector<double>, std::map<int, int>> variant;
+  std::tuple<int, std::string, std::set<std::string>, std::deque<int>> tuple;
+"""
+    )
+    for i in range(count):
+        t = ["int32_t", "int64_t", "double", "uint16_t"][i % 4]
+        f.write(f"  Templ{count}<{i}, {t}> t{i};\n")
+    f.write("};\n\n")
+    return name
+
+
+def gen_hierarchy(f, depth, breadth):
+    prefix = f"Hier{depth}x{breadth}_"
+    for b in range(breadth):
+        f.write(f"struct {prefix}B{b}_0 {{\n  int32_t base{b};\n}};\n")
+        for d in range(1, depth):
+            parents = [f"{prefix}B{b}_{d - 1}"]
+            # Add multiple inheritance from the neighbouring chain
+            if b > 0 and d % 4 == 0:
+                parents.append(f"{prefix}Mixin{b}_{d}")
+                f.write(
+                    f"struct {prefix}Mixin{b}_{d} {{\n"
+                    f"  std::string mixin{d};\n}};\n"
+                )
+            f.write(f"struct {prefix}B{b}_{d} : {', '.join('public ' + p for p in parents)} {{\n")
+            f.write(f"  {MEMBER_TYPES[(b + d) % len(MEMBER_TYPES)]} m{d};\n")
+            f.write("};\n")
+    name = f"Hierarchy{depth}x{breadth}"
+    f.write(f"struct {name} {{\n")
+    for b in range(breadth):
+        f.write(f"  {prefix}B{b}_{depth - 1} leaf{b};\n")
+    f.write("};\n\n")
+    return name
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(f"Usage: {sys.argv[0]} OUTPUT_CPP OUTPUT_HEADER")
+        sys.exit(1)
+    output_cpp, output_header = sys.argv[1:]
+
+    roots = []
+    with open(output_cpp, "w") as f:
+        f.write(
+            """// @generated by bench/gen_corpus.py
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace corpus {
+
+"""
+        )
+        roots.append(gen_wide(f, 64))
+        roots.append(gen_wide(f, 1024))
+        roots.append(gen_deep(f, 16))
+        roots.append(gen_deep(f, 128))
+        roots.append(gen_templates(f, 16))
+        roots.append(gen_templates(f, 128))
+        roots.append(gen_hierarchy(f, 8, 4))
+        roots.append(gen_hierarchy(f, 32, 16))
+
+        f.write("}  // namespace corpus\n\n")
+        for root in roots:
+            f.write(
+                f"void __attribute__((noinline)) bench_{root}(corpus::{root}& arg0) {{\n"
+                f"  asm volatile(\"\" : : \"r\"(&arg0) : \"memory\");\n"
+                f"}}\n"
+            )
+        f.write("\nint main() {\n")
+        for root in roots:
+            f.write(f"  {{\n    static corpus::{root} v;\n    bench_{root}(v);\n  }}\n")
+        f.write("}\n")
+
+    with open(output_header, "w") as f:
+        f.write("// @generated by bench/gen_corpus.py\n#pragma once\n\n")
+        f.write("#include <array>\n#include <string_view>\n\n")
+        f.write(f"constexpr std::array<std::string_view, {len(roots)}> corpusRoots{{\n")
+        for root in roots:
+            f.write(f'    "{root}",\n')
+        f.write("};\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput of the pointer set shared by parallel traversals, at 1 to 64
+ * threads. Each benchmark iteration is a single add():
+ *  - Unique: every thread adds its own pointers, so every add inserts
+ *  - Shared: every thread adds the same pointers, so most adds find a
+ *            duplicate that another thread inserted
+ * A mutex-guarded std::unordered_set is measured alongside for comparison.
+ */
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+#include "oi/ConcurrentPointerSet.h"
+
+using oi::detail::ConcurrentPointerSet;
+
+namespace {
+
+constexpr int kMaxThreads = 64;
+constexpr size_t kAddsPerThread = 1 << 18;
+
+class LockedSet {
+ public:
+  bool add(uintptr_t p) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return set.insert(p).second;
+  }
+
+ private:
+  std::mutex mutex;
+  std::unordered_set<uintptr_t> set;
+};
+
+std::unique_ptr<ConcurrentPointerSet> concurrentSet;
+std::unique_ptr<LockedSet> lockedSet;
+
+void setUp(const benchmark::State&) {
+  // Large enough for every add of the largest thread count
+  concurrentSet = std::make_unique<ConcurrentPointerSet>(1 << 20, 10);
+  lockedSet = std::make_unique<LockedSet>();
+}
+
+void tearDown(const benchmark::State&) {
+  concurrentSet.reset();
+  lockedSet.reset();
+}
+
+uintptr_t uniquePointer(const benchmark::State& state, size_t i) {
+  return (state.thread_index() * kAddsPerThread + i + 1) * 16;
+}
+
+uintptr_t sharedPointer(const benchmark::State&, size_t i) {
+  return (i + 1) * 16;
+}
+
+template <typename Set, uintptr_t (*Pointer)(const benchmark::State&, size_t)>
+void BM_Add(benchmark::State& state, std::unique_ptr<Set>& set) {
+  size_t i = 0;
+  size_t inserted = 0;
+  for (auto _ : state) {
+    inserted += set->add(Pointer(state, i++));
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["inserted"] = benchmark::Counter(inserted);
+}
+
+void registerBenchmarks() {
+  auto configure = [](benchmark::internal::Benchmark* b) {
+    b->Setup(setUp)
+        ->Teardown(tearDown)
+        ->Iterations(kAddsPerThread)
+        ->ThreadRange(1, kMaxThreads)
+        ->UseRealTime();
+  };
+
+  configure(benchmark::RegisterBenchmark(
+      "Unique/ConcurrentPointerSet",
+      BM_Add<ConcurrentPointerSet, uniquePointer>,
+      std::ref(concurrentSet)));
+  configure(benchmark::RegisterBenchmark(
+      "Shared/ConcurrentPointerSet",
+      BM_Add<ConcurrentPointerSet, sharedPointer>,
+      std::ref(concurrentSet)));
+  configure(benchmark::RegisterBenchmark("Unique/LockedSet",
+                                         BM_Add<LockedSet, uniquePointer>,
+                                         std::ref(lockedSet)));
+  configure(benchmark::RegisterBenchmark("Shared/LockedSet",
+                                         BM_Add<LockedSet, sharedPointer>,
+                                         std::ref(lockedSet)));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+
+  registerBenchmarks();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
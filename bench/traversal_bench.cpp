@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput benchmarks for the generated traversal code of each container
+ * handler in types/*.toml.
+ *
+ * Every container is JIT compiled once through OIL and then introspected at a
+ * range of sizes. Each benchmark reports:
+ *  - per_element: traversal time per top level element
+ *  - bytes_per_element: size of the encoded result per top level element
+ * The matching Iterate benchmark reports the cost of walking the
+ * IntrospectionResult per element.
+ *
+ * The largest size defaults to 1e6 elements. Set OI_BENCH_MAX_ELEMENTS to go
+ * up to 1e8, memory permitting.
+ */
+#include <benchmark/benchmark.h>
+#include <folly/FBString.h>
+#include <folly/container/F14Map.h>
+#include <folly/container/F14Set.h>
+#include <folly/small_vector.h>
+#include <folly/sorted_vector_types.h>
+#ifdef OI_BENCH_IOBUF
+#include <folly/io/IOBuf.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "oi/oi-jit.h"
+
+namespace {
+
+constexpr int64_t kMinElements = 100;
+constexpr int64_t kDefaultMaxElements = 1'000'000;
+constexpr int64_t kMaxElements = 100'000'000;
+
+// Number of elements in each inner container of the nested benchmarks
+constexpr size_t kInnerElements = 8;
+
+/*
+ * Mirrors CodegenHandler's atomic hole so that the raw encoded buffer is
+ * available to the benchmarks, rather than only the IntrospectionResult.
+ */
+template <typename T>
+using IntrospectFunc =
+    void (*)(const T&, std::vector<uint8_t>&, const oi::Budget&);
+
+template <typename T>
+__attribute__((noinline)) std::atomic<IntrospectFunc<T>>& introspectFunc() {
+  static std::atomic<IntrospectFunc<T>> func = nullptr;
+  return func;
+}
+
+template <typename T>
+struct Jit {
+  IntrospectFunc<T> func;
+  const oi::exporters::inst::Inst* inst;
+};
+
+template <typename T>
+const Jit<T>& getJit() {
+  static const Jit<T> jit = [] {
+    oi::GeneratorOptions opts{.configFilePaths = {CONFIG_FILE_PATH}};
+    oi::OILibrary lib{reinterpret_cast<void*>(&introspectFunc<T>), {}, opts};
+    auto [vfp, inst] = lib.init();
+    return Jit<T>{reinterpret_cast<IntrospectFunc<T>>(vfp), &inst};
+  }();
+  return jit;
+}
+
+template <typename T, typename Make>
+void BM_Traverse(benchmark::State& state, Make make) {
+  const auto& jit = getJit<T>();
+  size_t n = state.range(0);
+  T obj = make(n);
+
+  size_t bytes = 0;
+  for (auto _ : state) {
+    std::vector<uint8_t> buf;
+    jit.func(obj, buf, oi::Budget{});
+    bytes = buf.size();
+    benchmark::DoNotOptimize(buf.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * n);
+  state.counters["per_element"] = benchmark::Counter(
+      n,
+      benchmark::Counter::kIsIterationInvariantRate |
+          benchmark::Counter::kInvert);
+  state.counters["bytes_per_element"] =
+      static_cast<double>(bytes) / static_cast<double>(n);
+}
+
+template <typename T, typename Make>
+void BM_Iterate(benchmark::State& state, Make make) {
+  const auto& jit = getJit<T>();
+  size_t n = state.range(0);
+  std::vector<uint8_t> buf;
+  {
+    T obj = make(n);
+    jit.func(obj, buf, oi::Budget{});
+  }
+
+  size_t elements = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    oi::IntrospectionResult res{buf, *jit.inst};
+    state.ResumeTiming();
+
+    elements = 0;
+    for (const auto& el : res) {
+      benchmark::DoNotOptimize(&el);
+      elements++;
+    }
+  }
+
+  state.counters["per_element"] = benchmark::Counter(
+      n,
+      benchmark::Counter::kIsIterationInvariantRate |
+          benchmark::Counter::kInvert);
+  state.counters["result_elements"] = elements;
+}
+
+std::string makeString(size_t i) {
+  // Long enough to defeat the small string optimisation
+  return "element-" + std::to_string(i) + "-xxxxxxxxxxxxxxxxxxxxxxxx";
+}
+
+template <typename C>
+C fillSeq(size_t n) {
+  C c;
+  for (size_t i = 0; i < n; i++)
+    c.insert(c.end(), static_cast<typename C::value_type>(i));
+  return c;
+}
+
+template <typename C>
+C fillMap(size_t n) {
+  C c;
+  for (size_t i = 0; i < n; i++)
+    c.insert(typename C::value_type(static_cast<typename C::key_type>(i),
+                                    static_cast<typename C::mapped_type>(i)));
+  return c;
+}
+
+template <typename C>
+C fillNested(size_t n) {
+  C c;
+  for (size_t i = 0; i < n; i++) {
+    typename C::value_type inner;
+    for (size_t j = 0; j < kInnerElements; j++)
+      inner.push_back(static_cast<int>(i + j));
+    c.push_back(std::move(inner));
+  }
+  return c;
+}
+
+template <typename C>
+C fillStringMap(size_t n) {
+  C c;
+  for (size_t i = 0; i < n; i++) {
+    typename C::mapped_type inner(kInnerElements, static_cast<int>(i));
+    c.emplace(makeString(i), std::move(inner));
+  }
+  return c;
+}
+
+#ifdef OI_BENCH_IOBUF
+std::unique_ptr<folly::IOBuf> makeIOBufChain(size_t n) {
+  auto head = folly::IOBuf::create(64);
+  head->append(64);
+  for (size_t i = 1; i < n; i++) {
+    auto buf = folly::IOBuf::create(64);
+    buf->append(64);
+    head->prependChain(std::move(buf));
+  }
+  return head;
+}
+#endif
+
+int64_t maxElements() {
+  if (const char* env = std::getenv("OI_BENCH_MAX_ELEMENTS"))
+    return std::clamp<int64_t>(std::atoll(env), kMinElements, kMaxElements);
+  return kDefaultMaxElements;
+}
+
+template <typename T, typename Make>
+void registerContainer(const std::string& name, Make make) {
+  int64_t max = maxElements();
+  benchmark::RegisterBenchmark(("Traverse/" + name).c_str(),
+                               BM_Traverse<T, Make>,
+                               make)
+      ->RangeMultiplier(10)
+      ->Range(kMinElements, max);
+  benchmark::RegisterBenchmark(("Iterate/" + name).c_str(),
+                               BM_Iterate<T, Make>,
+                               make)
+      ->RangeMultiplier(10)
+      ->Range(kMinElements, max);
+}
+
+void registerBenchmarks() {
+  // Sequences
+  registerContainer<std::vector<int>>("std::vector<int>",
+                                      fillSeq<std::vector<int>>);
+  registerContainer<std::deque<int>>("std::deque<int>",
+                                     fillSeq<std::deque<int>>);
+  registerContainer<std::list<int>>("std::list<int>", fillSeq<std::list<int>>);
+  registerContainer<std::string>("std::string", [](size_t n) {
+    return std::string(n, 'x');
+  });
+  registerContainer<folly::fbstring>("folly::fbstring", [](size_t n) {
+    return folly::fbstring(n, 'x');
+  });
+  registerContainer<folly::small_vector<int, 8>>(
+      "folly::small_vector<int,8>", fillSeq<folly::small_vector<int, 8>>);
+
+  // Ordered associative
+  registerContainer<std::set<int>>("std::set<int>", fillSeq<std::set<int>>);
+  registerContainer<std::multiset<int>>("std::multiset<int>",
+                                        fillSeq<std::multiset<int>>);
+  registerContainer<std::map<int, int>>("std::map<int,int>",
+                                        fillMap<std::map<int, int>>);
+  registerContainer<std::multimap<int, int>>(
+      "std::multimap<int,int>", fillMap<std::multimap<int, int>>);
+  registerContainer<folly::sorted_vector_set<int>>(
+      "folly::sorted_vector_set<int>", fillSeq<folly::sorted_vector_set<int>>);
+  registerContainer<folly::sorted_vector_map<int, int>>(
+      "folly::sorted_vector_map<int,int>",
+      fillMap<folly::sorted_vector_map<int, int>>);
+
+  // Unordered associative
+  registerContainer<std::unordered_set<int>>(
+      "std::unordered_set<int>", fillSeq<std::unordered_set<int>>);
+  registerContainer<std::unordered_multiset<int>>(
+      "std::unordered_multiset<int>", fillSeq<std::unordered_multiset<int>>);
+  registerContainer<std::unordered_map<int, int>>(
+      "std::unordered_map<int,int>", fillMap<std::unordered_map<int, int>>);
+  registerContainer<std::unordered_multimap<int, int>>(
+      "std::unordered_multimap<int,int>",
+      fillMap<std::unordered_multimap<int, int>>);
+  registerContainer<folly::F14FastSet<int>>("folly::F14FastSet<int>",
+                                            fillSeq<folly::F14FastSet<int>>);
+  registerContainer<folly::F14NodeSet<int>>("folly::F14NodeSet<int>",
+                                            fillSeq<folly::F14NodeSet<int>>);
+  registerContainer<folly::F14ValueSet<int>>("folly::F14ValueSet<int>",
+                                             fillSeq<folly::F14ValueSet<int>>);
+  registerContainer<folly::F14VectorSet<int>>(
+      "folly::F14VectorSet<int>", fillSeq<folly::F14VectorSet<int>>);
+  registerContainer<folly::F14FastMap<int, int>>(
+      "folly::F14FastMap<int,int>", fillMap<folly::F14FastMap<int, int>>);
+  registerContainer<folly::F14NodeMap<int, int>>(
+      "folly::F14NodeMap<int,int>", fillMap<folly::F14NodeMap<int, int>>);
+  registerContainer<folly::F14ValueMap<int, int>>(
+      "folly::F14ValueMap<int,int>", fillMap<folly::F14ValueMap<int, int>>);
+  registerContainer<folly::F14VectorMap<int, int>>(
+      "folly::F14VectorMap<int,int>", fillMap<folly::F14VectorMap<int, int>>);
+
+#ifdef OI_BENCH_IOBUF
+  registerContainer<std::unique_ptr<folly::IOBuf>>("folly::IOBuf chain",
+                                                   makeIOBufChain);
+#endif
+
+  // Nested element types
+  registerContainer<std::vector<std::string>>(
+      "std::vector<std::string>", [](size_t n) {
+        std::vector<std::string> v;
+        v.reserve(n);
+        for (size_t i = 0; i < n; i++)
+          v.push_back(makeString(i));
+        return v;
+      });
+  registerContainer<std::vector<std::vector<int>>>(
+      "std::vector<std::vector<int>>",
+      fillNested<std::vector<std::vector<int>>>);
+  registerContainer<std::map<std::string, std::vector<int>>>(
+      "std::map<std::string,std::vector<int>>",
+      fillStringMap<std::map<std::string, std::vector<int>>>);
+  registerContainer<folly::F14FastMap<std::string, std::vector<int>>>(
+      "folly::F14FastMap<std::string,std::vector<int>>",
+      fillStringMap<folly::F14FastMap<std::string, std::vector<int>>>);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+
+  registerBenchmarks();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
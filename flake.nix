@@ -75,6 +75,7 @@
                 flex
                 folly
                 folly.fmt
+                gbenchmark
                 gflags
                 glog
                 gtest
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDED_OI_BUDGET_H
+#define INCLUDED_OI_BUDGET_H 1
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace oi {
+
+/*
+ * JitProfile
+ *
+ * The cycles spent traversing each type during one introspection, filled in by
+ * code compiled with Feature::JitProfiling. Entries are sorted by the cycles
+ * spent in the type itself, excluding the types nested within it.
+ */
+struct JitProfile {
+  struct Entry {
+    std::string name;
+    uint64_t exclusiveCycles;
+    uint64_t inclusiveCycles;
+    uint64_t calls;
+  };
+  std::vector<Entry> entries;
+};
+
+/*
+ * Budget
+ *
+ * Bounds the work done by a single introspection. A limit of zero is
+ * unlimited. The limits are checked before each object is traversed, so the
+ * last object traversed may overshoot them.
+ *
+ * Once any limit is reached the traversal stops and the result is truncated:
+ * iterating it yields the elements visited so far, the last of which has
+ * `is_truncated` set.
+ */
+struct Budget {
+  // Wall time spent traversing
+  std::chrono::nanoseconds maxTime{0};
+  // Bytes of encoded result
+  size_t maxBytes = 0;
+  // Objects traversed, excluding primitives
+  size_t maxElements = 0;
+  // Threads traversing at once with Feature::ParallelTraversal
+  size_t maxThreads = 0;
+  // Receives the profile with Feature::JitProfiling, if set. Not filled in by
+  // introspectSnapshot, whose traversal runs in another process.
+  JitProfile* profile = nullptr;
+};
+
+}  // namespace oi
+
+#endif
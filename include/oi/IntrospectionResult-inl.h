@@ -34,18 +34,20 @@ inline IntrospectionResult::IntrospectionResult(std::vector<uint8_t> buf,
 }
 
 inline IntrospectionResult::const_iterator::const_iterator(
-    std::vector<uint8_t>::const_iterator data, exporters::inst::Inst type)
-    : data_(data), stack_({type}) {
+    std::vector<uint8_t>::const_iterator data,
+    std::vector<uint8_t>::const_iterator end,
+    exporters::inst::Inst type)
+    : data_(data), end_(end), stack_({type}) {
 }
 inline IntrospectionResult::const_iterator::const_iterator(
     std::vector<uint8_t>::const_iterator data)
-    : data_(data) {
+    : data_(data), end_(data) {
 }
 inline IntrospectionResult::const_iterator IntrospectionResult::begin() const {
   return cbegin();
 }
 inline IntrospectionResult::const_iterator IntrospectionResult::cbegin() const {
-  auto it = const_iterator{buf_.cbegin(), inst_};
+  auto it = const_iterator{buf_.cbegin(), buf_.cend(), inst_};
   ++it;
   return it;
 }
@@ -58,10 +58,17 @@ class IntrospectionResult {
         std::stack<exporters::inst::Inst, std::vector<exporters::inst::Inst>>;
 
     const_iterator(std::vector<uint8_t>::const_iterator data,
+                   std::vector<uint8_t>::const_iterator end,
                    exporters::inst::Inst type);
     const_iterator(std::vector<uint8_t>::const_iterator data);
 
     std::vector<uint8_t>::const_iterator data_;
+    // A budgeted traversal may stop before writing all of its data. Reaching
+    // the end of the buffer with data left to parse marks the result as
+    // truncated.
+    std::vector<uint8_t>::const_iterator end_;
+    // The previous pointer parsed, to decode delta encoded pointers
+    uintptr_t last_pointer_ = 0;
     stack_t stack_;
     std::optional<result::Element> next_;
 
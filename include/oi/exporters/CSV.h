@@ -49,6 +49,7 @@ class CSV {
                                                   "length",
                                                   "capacity",
                                                   "is_set",
+                                                  "is_truncated",
                                                   "parent_id"};
 
   size_t id_ = 0;
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDED_OI_EXPORTERS_COLUMNAR_H
+#define INCLUDED_OI_EXPORTERS_COLUMNAR_H 1
+
+#include <oi/IntrospectionResult.h>
+#include <oi/exporters/ColumnarFormat.h>
+
+#include <deque>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace oi::exporters {
+
+/*
+ * Binary exporter holding the same columns as CSV. Numbers are written as
+ * fixed width columns and every name, type path and list of type names is
+ * written once and referred to by id after that. See ColumnarFormat.h for the
+ * layout and ColumnarReader to read it back.
+ */
+class Columnar {
+ public:
+  Columnar(std::ostream& out,
+           columnar::Compression compression = columnar::Compression::None);
+
+  void print(const IntrospectionResult&);
+  void print(IntrospectionResult::const_iterator& begin,
+             IntrospectionResult::const_iterator end);
+
+ private:
+  struct TypeNamesHash {
+    size_t operator()(const std::vector<uint32_t>&) const;
+  };
+
+  std::ostream& out_;
+  columnar::Compression compression_;
+  bool headerWritten_ = false;
+
+  size_t id_ = 0;
+  std::vector<size_t> parentIdStack_ = {0};
+  std::vector<uint32_t> pathIdStack_ = {0};
+
+  std::vector<columnar::Row> rows_;
+
+  // Strings are views of strings_, whose elements never move
+  std::deque<std::string> strings_;
+  std::unordered_map<std::string_view, uint32_t> stringIds_;
+  size_t stringsWritten_ = 0;
+
+  // Keyed by the parent path id in the high half and the string id in the low
+  std::unordered_map<uint64_t, uint32_t> pathIds_;
+  std::vector<std::pair<uint32_t, uint32_t>> newPaths_;
+
+  std::unordered_map<std::vector<uint32_t>, uint32_t, TypeNamesHash>
+      typeNamesIds_;
+  std::vector<uint32_t> typeNamesScratch_;
+  std::vector<uint32_t> newTypeNames_;
+  uint32_t newTypeNamesCount_ = 0;
+
+  std::vector<char> payload_;
+  std::vector<char> compressed_;
+
+  uint32_t internString(std::string_view);
+  uint32_t internPath(uint32_t parent, std::string_view name);
+  uint32_t internTypeNames(std::span<const std::string_view>);
+
+  void writeBlock();
+};
+
+}  // namespace oi::exporters
+
+#endif
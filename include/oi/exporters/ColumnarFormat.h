@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDED_OI_EXPORTERS_COLUMNARFORMAT_H
+#define INCLUDED_OI_EXPORTERS_COLUMNARFORMAT_H 1
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+/*
+ * On-disk layout shared by the Columnar exporter and ColumnarReader.
+ *
+ * A file is a FileHeader followed by blocks. Each block is a BlockHeader and
+ * a payload of `storedSize` bytes, compressed with the block's codec. All
+ * integers are little endian. Once decompressed the payload holds:
+ *
+ *   - the strings first used in this block: u32 count, then for each a u32
+ *     length and the bytes. Strings are numbered from 0 in file order.
+ *   - the type paths first used in this block: u32 count, then for each the
+ *     u32 id of the path it extends and the u32 id of its last string. Path 0
+ *     is the empty path, the rest are numbered from 1 in file order.
+ *   - the type name lists first used in this block: u32 count, then for each a
+ *     u32 length and that many u32 string ids. Lists are numbered from 0.
+ *   - one column per field of Row, each `rows` values wide, in Row's order.
+ *
+ * Element ids are implicit: the first row of the file has id 1 and each row
+ * after it the next id. A parent id of 0 marks a root.
+ */
+namespace oi::exporters::columnar {
+
+static_assert(std::endian::native == std::endian::little,
+              "the columnar format is written in host byte order");
+
+constexpr std::array<char, 8> kMagic = {'O', 'I', 'C', 'O', 'L', 'S', '\0',
+                                        '\0'};
+constexpr uint32_t kVersion = 1;
+
+// Rows buffered before a block is written out
+constexpr uint32_t kBlockRows = 1 << 16;
+
+enum class Compression : uint32_t {
+  None = 0,
+  Zstd = 1,
+};
+
+struct FileHeader {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t reserved;
+};
+
+struct BlockHeader {
+  uint32_t rows;
+  Compression codec;
+  uint64_t rawSize;
+  uint64_t storedSize;
+};
+
+// Bits of the flags column
+enum Flags : uint8_t {
+  kHasPointer = 1 << 0,
+  kHasContainerStats = 1 << 1,
+  kHasIsSet = 1 << 2,
+  kIsSet = 1 << 3,
+  kIsTruncated = 1 << 4,
+  kIsPrimitive = 1 << 5,
+};
+
+/*
+ * One element, as the columns store it. Pointer, length and capacity are 0
+ * where the flags say the element has none.
+ */
+struct Row {
+  uint64_t parentId;
+  uint32_t name;
+  uint32_t typePath;
+  uint32_t typeNames;
+  uint64_t staticSize;
+  uint64_t exclusiveSize;
+  uint64_t pointer;
+  uint64_t length;
+  uint64_t capacity;
+  uint8_t flags;
+};
+
+}  // namespace oi::exporters::columnar
+
+#endif
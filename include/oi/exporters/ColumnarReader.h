@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDED_OI_EXPORTERS_COLUMNARREADER_H
+#define INCLUDED_OI_EXPORTERS_COLUMNARREADER_H 1
+
+#include <oi/exporters/ColumnarFormat.h>
+
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace oi::exporters {
+
+/*
+ * Reads a file written by the Columnar exporter one block at a time, so a
+ * result larger than memory can still be scanned. Names, type paths and type
+ * name lists are kept for the whole file, as later blocks refer back to them.
+ *
+ * Throws std::runtime_error on a malformed file.
+ */
+class ColumnarReader {
+ public:
+  explicit ColumnarReader(std::istream& in);
+
+  /*
+   * Replaces `rows` with the next block's rows. Returns false once the file
+   * has no blocks left.
+   */
+  bool next(std::vector<columnar::Row>& rows);
+
+  // The element id of the first row returned by the last call to next()
+  uint64_t firstId() const {
+    return firstId_;
+  }
+
+  std::string_view string(uint32_t id) const;
+  std::vector<std::string_view> typePath(uint32_t id) const;
+  std::vector<std::string_view> typeNames(uint32_t id) const;
+
+ private:
+  std::istream& in_;
+
+  uint64_t firstId_ = 1;
+  uint64_t nextId_ = 1;
+
+  // Views are handed out, so the strings must never move
+  std::deque<std::string> strings_;
+  // (parent path, last string) for each path, path 0 being the empty path
+  std::vector<std::pair<uint32_t, uint32_t>> paths_ = {{0, 0}};
+  // Type name lists are stored back to back, with an offset into
+  // typeNamesData_ for each list and one past the last
+  std::vector<uint32_t> typeNamesOffsets_ = {0};
+  std::vector<uint32_t> typeNamesData_;
+
+  std::vector<char> stored_;
+  std::vector<char> payload_;
+};
+
+}  // namespace oi::exporters
+
+#endif
@@ -19,11 +19,24 @@
 #include <oi/IntrospectionResult.h>
 #include <oi/result/SizedResult.h>
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <memory>
 #include <ostream>
 #include <string_view>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace oi::exporters {
 
+/*
+ * Output is collected in a fixed size buffer and written to the stream in
+ * large chunks. Each call to print() flushes the buffer before returning.
+ */
 class Json {
  public:
   Json(std::ostream& out);
@@ -41,38 +54,49 @@ class Json {
     pretty_ = pretty;
   }
 
+  // An element's type path is its parent's plus its own name, so it can be
+  // left out of the output and rebuilt from the nesting.
+  void setTypePaths(bool typePaths) {
+    typePaths_ = typePaths;
+  }
+
  private:
+  static constexpr size_t kBufferSize = 64 * 1024;
+
   std::string_view tab() const;
   std::string_view space() const;
   std::string_view endl() const;
-  static std::string makeIndent(size_t depth);
+  void indent(size_t depth);
+
+  void write(char c);
+  void write(std::string_view str);
+  void writeUnsigned(uint64_t value, int base = 10);
+  void writeEscaped(std::string_view str);
+  void flush();
 
   void printStringField(std::string_view name,
                         std::string_view value,
-                        std::string_view indent);
-  void printBoolField(std::string_view name,
-                      bool value,
-                      std::string_view indent);
-  void printUnsignedField(std::string_view name,
-                          uint64_t value,
-                          std::string_view indent);
-  void printPointerField(std::string_view name,
-                         uintptr_t value,
-                         std::string_view indent);
+                        size_t depth);
+  void printBoolField(std::string_view name, bool value, size_t depth);
+  void printUnsignedField(std::string_view name, uint64_t value, size_t depth);
+  void printPointerField(std::string_view name, uintptr_t value, size_t depth);
   template <typename Rng>
-  void printListField(std::string_view name,
-                      const Rng& range,
-                      std::string_view indent);
+  void printListField(std::string_view name, const Rng& range, size_t depth);
 
-  void printFields(const result::Element&, std::string_view indent);
+  void printFields(const result::Element&, size_t depth);
   template <typename El>
-  void printFields(const result::SizedElement<El>&, std::string_view indent);
+  void printFields(const result::SizedElement<El>&, size_t depth);
 
   bool pretty_ = false;
+  bool typePaths_ = true;
   std::ostream& out_;
+
+  std::unique_ptr<char[]> buf_;
+  size_t len_ = 0;
 };
 
-inline Json::Json(std::ostream& out) : out_(out) {
+inline Json::Json(std::ostream& out)
+    : out_(out), buf_(std::make_unique<char[]>(kBufferSize)) {
 }
 
 inline std::string_view Json::tab() const {
@@ -84,116 +108,307 @@ inline std::string_view Json::space() const {
 inline std::string_view Json::endl() const {
   return pretty_ ? "\n" : "";
 }
-inline std::string Json::makeIndent(size_t depth) {
-  depth = std::max(depth, 1UL);
-  return std::string((depth - 1) * 4, ' ');
+inline void Json::indent(size_t depth) {
+  if (!pretty_)
+    return;
+
+  size_t width = (std::max(depth, 1UL) - 1) * 4;
+  while (width > 0) {
+    if (len_ == kBufferSize)
+      flush();
+    size_t n = std::min(width, kBufferSize - len_);
+    std::memset(buf_.get() + len_, ' ', n);
+    len_ += n;
+    width -= n;
+  }
+}
+
+inline void Json::write(char c) {
+  if (len_ == kBufferSize)
+    flush();
+  buf_[len_++] = c;
+}
+inline void Json::write(std::string_view str) {
+  if (str.size() > kBufferSize - len_) {
+    flush();
+    if (str.size() > kBufferSize) {
+      out_.write(str.data(), static_cast<std::streamsize>(str.size()));
+      return;
+    }
+  }
+  std::memcpy(buf_.get() + len_, str.data(), str.size());
+  len_ += str.size();
+}
+inline void Json::writeUnsigned(uint64_t value, int base) {
+  constexpr size_t kMaxDigits = 20;
+  if (kBufferSize - len_ < kMaxDigits)
+    flush();
+  auto res = std::to_chars(
+      buf_.get() + len_, buf_.get() + kBufferSize, value, base);
+  len_ = res.ptr - buf_.get();
+}
+inline void Json::writeEscaped(std::string_view str) {
+  auto escape = [this](char c) {
+    switch (c) {
+      case '"':
+        return write("\\\"");
+      case '\\':
+        return write("\\\\");
+      case '\b':
+        return write("\\b");
+      case '\f':
+        return write("\\f");
+      case '\n':
+        return write("\\n");
+      case '\r':
+        return write("\\r");
+      case '\t':
+        return write("\\t");
+      default:
+        write("\\u00");
+        write("0123456789abcdef"[(c >> 4) & 0xf]);
+        write("0123456789abcdef"[c & 0xf]);
+    }
+  };
+  auto needsEscape = [](char c) {
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+  };
+
+  const char* p = str.data();
+  const char* end = p + str.size();
+#ifdef __SSE2__
+  // Copy 16 bytes at a time up to the next character that needs escaping
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1f);
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i special =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                  _mm_cmpeq_epi8(chunk, backslash)),
+                     _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+    auto mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+    if (mask == 0) {
+      write(std::string_view(p, 16));
+      p += 16;
+      continue;
+    }
+
+    auto clean = static_cast<size_t>(__builtin_ctz(mask));
+    write(std::string_view(p, clean));
+    escape(p[clean]);
+    p += clean + 1;
+  }
+#endif
+  while (p != end) {
+    const char* next = std::find_if(p, end, needsEscape);
+    write(std::string_view(p, next - p));
+    if (next == end)
+      break;
+    escape(*next);
+    p = next + 1;
+  }
+}
+inline void Json::flush() {
+  out_.write(buf_.get(), static_cast<std::streamsize>(len_));
+  len_ = 0;
 }
 
 inline void Json::printStringField(std::string_view name,
                                    std::string_view value,
-                                   std::string_view indent) {
-  out_ << tab() << '"' << name << '"' << ':' << space() << "\"" << value
-       << "\"," << endl() << indent;
+                                   size_t depth) {
+  write(tab());
+  write('"');
+  write(name);
+  write("\":");
+  write(space());
+  write('"');
+  writeEscaped(value);
+  write("\",");
+  write(endl());
+  indent(depth);
 }
 inline void Json::printBoolField(std::string_view name,
                                  bool value,
-                                 std::string_view indent) {
-  out_ << tab() << '"' << name << "\":" << space() << (value ? "true" : "false")
-       << ',' << endl() << indent;
+                                 size_t depth) {
+  write(tab());
+  write('"');
+  write(name);
+  write("\":");
+  write(space());
+  write(value ? "true" : "false");
+  write(',');
+  write(endl());
+  indent(depth);
 }
 inline void Json::printUnsignedField(std::string_view name,
                                      uint64_t value,
-                                     std::string_view indent) {
-  out_ << tab() << '"' << name << "\":" << space() << value << ',' << endl()
-       << indent;
+                                     size_t depth) {
+  write(tab());
+  write('"');
+  write(name);
+  write("\":");
+  write(space());
+  writeUnsigned(value);
+  write(',');
+  write(endl());
+  indent(depth);
 }
 inline void Json::printPointerField(std::string_view name,
                                     uintptr_t value,
-                                    std::string_view indent) {
-  out_ << tab() << '"' << name << "\":" << space() << "\"0x" << std::hex
-       << value << std::dec << "\"," << endl() << indent;
+                                    size_t depth) {
+  write(tab());
+  write('"');
+  write(name);
+  write("\":");
+  write(space());
+  write("\"0x");
+  writeUnsigned(value, 16);
+  write("\",");
+  write(endl());
+  indent(depth);
 }
 template <typename Rng>
 void Json::printListField(std::string_view name,
                           const Rng& range,
-                          std::string_view indent) {
-  out_ << tab() << '"' << name << '"' << ':' << space() << '[';
+                          size_t depth) {
+  write(tab());
+  write('"');
+  write(name);
+  write("\":");
+  write(space());
+  write('[');
   bool first = true;
   for (const auto& el : range) {
-    if (!std::exchange(first, false))
-      out_ << ',' << space();
-    out_ << '"' << el << '"';
+    if (!std::exchange(first, false)) {
+      write(',');
+      write(space());
+    }
+    write('"');
+    writeEscaped(el);
+    write('"');
   }
-  out_ << "]," << endl() << indent;
+  write("],");
+  write(endl());
+  indent(depth);
 }
 
 template <typename El>
-void Json::printFields(const result::SizedElement<El>& el,
-                       std::string_view indent) {
-  printUnsignedField("size", el.size, indent);
+void Json::printFields(const result::SizedElement<El>& el, size_t depth) {
+  printUnsignedField("size", el.size, depth);
 
-  printFields(el.inner(), indent);
+  printFields(el.inner(), depth);
 }
 
-inline void Json::printFields(const result::Element& el,
-                              std::string_view indent) {
-  printStringField("name", el.name, indent);
-  printListField("typePath", el.type_path, indent);
-  printListField("typeNames", el.type_names, indent);
-  printUnsignedField("staticSize", el.static_size, indent);
-  printUnsignedField("exclusiveSize", el.exclusive_size, indent);
+inline void Json::printFields(const result::Element& el, size_t depth) {
+  printStringField("name", el.name, depth);
+  if (typePaths_)
+    printListField("typePath", el.type_path, depth);
+  printListField("typeNames", el.type_names, depth);
+  printUnsignedField("staticSize", el.static_size, depth);
+  printUnsignedField("exclusiveSize", el.exclusive_size, depth);
   if (el.pointer.has_value())
-    printUnsignedField("pointer", *el.pointer, indent);
+    printUnsignedField("pointer", *el.pointer, depth);
 
   if (const auto* s = std::get_if<result::Element::Scalar>(&el.data)) {
-    printUnsignedField("data", s->n, indent);
+    printUnsignedField("data", s->n, depth);
   } else if (const auto* p = std::get_if<result::Element::Pointer>(&el.data)) {
-    printPointerField("data", p->p, indent);
+    printPointerField("data", p->p, depth);
   } else if (const auto* str = std::get_if<std::string>(&el.data)) {
-    printStringField("data", *str, indent);
+    printStringField("data", *str, depth);
   }
 
   if (el.container_stats.has_value()) {
-    printUnsignedField("length", el.container_stats->length, indent);
-    printUnsignedField("capacity", el.container_stats->capacity, indent);
+    printUnsignedField("length", el.container_stats->length, depth);
+    printUnsignedField("capacity", el.container_stats->capacity, depth);
   }
   if (el.is_set_stats.has_value())
-    printBoolField("is_set", el.is_set_stats->is_set, indent);
-  printBoolField("is_primitive", el.is_primitive, indent);
+    printBoolField("is_set", el.is_set_stats->is_set, depth);
+  printBoolField("is_primitive", el.is_primitive, depth);
+  if (el.is_truncated)
+    printBoolField("is_truncated", true, depth);
 }
 
+/*
+ * Elements arrive in pre-order with their depth given by the length of their
+ * type path. Each element deeper than the last opens a "members" array, and
+ * the arrays of every level deeper than the next element are closed. The open
+ * arrays are kept on an explicit stack so that very deep results can't
+ * overflow the call stack.
+ */
 template <typename It>
 void Json::print(It& it, const It& end) {
-  const auto depth = it->type_path.size();
-
-  const auto thisIndent = pretty_ ? makeIndent(depth) : "";
-  const auto lastIndent = pretty_ ? makeIndent(depth - 1) : "";
+  if (it == end) {
+    write('[');
+    write(endl());
+    write(']');
+    write(endl());
+    flush();
+    return;
+  }
 
-  out_ << '[' << endl() << thisIndent;
+  std::vector<size_t> depths{it->type_path.size()};
+  write('[');
+  write(endl());
+  indent(depths.back());
 
   bool first = true;
-  while (it != end && it->type_path.size() >= depth) {
-    if (!std::exchange(first, false))
-      out_ << ',' << endl() << thisIndent;
+  while (!depths.empty()) {
+    const auto depth = depths.back();
+    if (!std::exchange(first, false)) {
+      write(',');
+      write(endl());
+      indent(depth);
+    }
 
-    out_ << '{' << endl() << thisIndent;
+    write('{');
+    write(endl());
+    indent(depth);
 
-    printFields(*it, thisIndent);
+    printFields(*it, depth);
 
-    out_ << tab() << "\"members\":" << space();
+    write(tab());
+    write("\"members\":");
+    write(space());
     if (++it != end && it->type_path.size() > depth) {
-      print(it, end);
-    } else {
-      out_ << "[]" << endl();
+      depths.push_back(it->type_path.size());
+      write('[');
+      write(endl());
+      indent(depths.back());
+      first = true;
+      continue;
     }
 
-    out_ << thisIndent << "}";
-  }
-  if (depth == 1) {
-    out_ << endl() << ']' << endl();
-  } else {
-    out_ << endl() << lastIndent << tab() << ']' << endl();
+    write("[]");
+    write(endl());
+    indent(depth);
+    write('}');
+
+    // Close the arrays of every level the next element isn't part of, along
+    // with the element that owns each one.
+    while (it == end || it->type_path.size() < depths.back()) {
+      const auto closed = depths.back();
+      depths.pop_back();
+      if (closed == 1) {
+        write(endl());
+        write(']');
+        write(endl());
+      } else {
+        write(endl());
+        indent(closed - 1);
+        write(tab());
+        write(']');
+        write(endl());
+      }
+
+      if (depths.empty())
+        break;
+      indent(depths.back());
+      write('}');
+    }
   }
+
+  flush();
 }
 
 }  // namespace oi::exporters
@@ -28,16 +28,19 @@ namespace oi::exporters {
 struct ParsedData {
   class Lazy {
    public:
-    Lazy(std::vector<uint8_t>::const_iterator& it, types::dy::Dynamic ty)
-        : it_(it), ty_(ty) {
+    Lazy(std::vector<uint8_t>::const_iterator& it,
+         uintptr_t& lastPointer,
+         types::dy::Dynamic ty)
+        : it_(it), lastPointer_(lastPointer), ty_(ty) {
     }
 
     ParsedData operator()() {
-      return ParsedData::parse(it_, ty_);
+      return ParsedData::parse(it_, lastPointer_, ty_);
     }
 
    private:
     std::vector<uint8_t>::const_iterator& it_;
+    uintptr_t& lastPointer_;
     types::dy::Dynamic ty_;
   };
 
@@ -58,7 +61,14 @@ struct ParsedData {
     Lazy value;
   };
 
+  /*
+   * Parses one value of type `ty` at `it`. `lastPointer` holds the previous
+   * pointer parsed from the same buffer, starting from 0, and is used to decode
+   * delta encoded Pointers. Pointers are returned as a VarInt holding the
+   * decoded pointer whatever their encoding.
+   */
   static ParsedData parse(std::vector<uint8_t>::const_iterator& it,
+                          uintptr_t& lastPointer,
                           types::dy::Dynamic ty);
 
   ParsedData(Unit&& val_) : val(val_) {
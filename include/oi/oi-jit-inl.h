@@ -21,6 +21,7 @@ static_assert(
 #endif
 #define INCLUDED_OI_OI_JIT_INL_H 1
 
+#include <chrono>
 #include <stdexcept>
 
 #include "oi-jit.h"
@@ -37,15 +38,111 @@ inline std::optional<IntrospectionResult> setupAndIntrospect(
 }
 
 template <typename T, Feature... Fs>
-inline std::atomic<bool>& CodegenHandler<T, Fs...>::getIsCritical() {
-  static std::atomic<bool> isCritical = false;
-  return isCritical;
+inline std::shared_future<void> prepare(const GeneratorOptions& opts) {
+  return CodegenHandler<T, Fs...>::prepare(opts);
+}
+
+namespace detail {
+
+/*
+ * Claims every handler that nobody has started compiling, then compiles all of
+ * their types in one OILibrary. The outcome is published to the claimed
+ * handlers through a shared future.
+ */
+template <typename... Handlers>
+class Batch {
+ public:
+  explicit Batch(const GeneratorOptions& opts) : opts_(opts) {
+    std::vector<std::unordered_set<Feature>> features{Handlers::features()...};
+    for (const auto& fs : features) {
+      if (fs != features.front())
+        throw std::invalid_argument(
+            "batched handlers must all request the same features");
+    }
+    if (!features.empty())
+      features_ = features.front();
+
+    future_ = promise_.get_future().share();
+    (claim<Handlers>(), ...);
+  }
+
+  void run() {
+    if (claimed_.empty()) {
+      promise_.set_value();
+      return;
+    }
+
+    try {
+      std::vector<void*> holes;
+      holes.reserve(claimed_.size());
+      for (const auto& c : claimed_)
+        holes.push_back(c.atomicHole);
+
+      auto lib = OILibrary(std::move(holes), features_, opts_);
+      auto entries = lib.initBatch();
+      for (size_t i = 0; i < claimed_.size(); i++)
+        claimed_[i].store(entries[i].first, entries[i].second);
+      promise_.set_value();
+    } catch (...) {
+      // Let later calls retry, while waiters on this batch see the failure
+      for (const auto& c : claimed_)
+        c.release(std::current_exception());
+      promise_.set_exception(std::current_exception());
+    }
+  }
+
+  const std::shared_future<void>& future() const {
+    return future_;
+  }
+
+ private:
+  struct Claimed {
+    void* atomicHole;
+    void (*store)(void*, const exporters::inst::Inst&);
+    void (*release)(std::exception_ptr);
+  };
+
+  template <typename Handler>
+  void claim() {
+    if (!Handler::isReady() && Handler::claim(future_))
+      claimed_.push_back(
+          {Handler::atomicHole(), &Handler::store, &Handler::release});
+  }
+
+  GeneratorOptions opts_;
+  std::unordered_set<Feature> features_;
+  std::promise<void> promise_;
+  std::shared_future<void> future_;
+  std::vector<Claimed> claimed_;
+};
+
+}  // namespace detail
+
+template <typename... Handlers>
+inline void initBatch(const GeneratorOptions& opts) {
+  detail::Batch<Handlers...> batch{opts};
+  batch.run();
+  batch.future().get();  // rethrows any compilation failure
+}
+
+template <typename... Handlers>
+inline std::shared_future<void> prepareBatch(const GeneratorOptions& opts) {
+  auto batch = std::make_shared<detail::Batch<Handlers...>>(opts);
+  detail::submitPrepareTask([batch] { batch->run(); });
+  return batch->future();
 }
 
 template <typename T, Feature... Fs>
-inline std::atomic<void (*)(const T&, std::vector<uint8_t>&)>&
+inline typename CodegenHandler<T, Fs...>::PrepareState&
+CodegenHandler<T, Fs...>::getPrepareState() {
+  static PrepareState state;
+  return state;
+}
+
+template <typename T, Feature... Fs>
+inline std::atomic<typename CodegenHandler<T, Fs...>::func_type>&
 CodegenHandler<T, Fs...>::getIntrospectionFunc() {
-  static std::atomic<void (*)(const T&, std::vector<uint8_t>&)> func = nullptr;
+  static std::atomic<func_type> func = nullptr;
   return func;
 }
 
@@ -56,36 +153,176 @@ CodegenHandler<T, Fs...>::getTreeBuilderInstructions() {
   return ty;
 }
 
+template <typename T, Feature... Fs>
+inline void CodegenHandler<T, Fs...>::compile(const GeneratorOptions& opts) {
+  try {
+    auto lib = OILibrary(atomicHole(), features(), opts);
+    auto [vfp, ty] = lib.init();
+    store(vfp, ty);
+  } catch (...) {
+    // Let later calls retry, while waiters on this attempt see the failure
+    release(std::current_exception());
+    throw;
+  }
+}
+
+template <typename T, Feature... Fs>
+inline std::unordered_set<Feature> CodegenHandler<T, Fs...>::features() {
+  return {Fs...};
+}
+
+template <typename T, Feature... Fs>
+inline void* CodegenHandler<T, Fs...>::atomicHole() {
+  return reinterpret_cast<void*>(&getIntrospectionFunc);
+}
+
+template <typename T, Feature... Fs>
+inline void CodegenHandler<T, Fs...>::store(void* fp,
+                                            const exporters::inst::Inst& ty) {
+  getIntrospectionFunc().store(reinterpret_cast<func_type>(fp));
+  getTreeBuilderInstructions().store(&ty);
+}
+
+template <typename T, Feature... Fs>
+inline bool CodegenHandler<T, Fs...>::claim(
+    const std::shared_future<void>& future) {
+  auto& state = getPrepareState();
+  std::lock_guard<std::mutex> guard{state.mutex};
+  if (state.future.valid())
+    return false;
+  state.future = future;
+  state.failure = nullptr;
+  return true;
+}
+
+template <typename T, Feature... Fs>
+inline void CodegenHandler<T, Fs...>::release(std::exception_ptr failure) {
+  auto& state = getPrepareState();
+  std::lock_guard<std::mutex> guard{state.mutex};
+  state.future = {};
+  state.failure = std::move(failure);
+}
+
+template <typename T, Feature... Fs>
+inline std::shared_future<void> CodegenHandler<T, Fs...>::getFuture() {
+  auto& state = getPrepareState();
+  std::lock_guard<std::mutex> guard{state.mutex};
+  return state.future;
+}
+
+template <typename T, Feature... Fs>
+inline void CodegenHandler<T, Fs...>::rethrowFailure() {
+  std::exception_ptr failure;
+  {
+    auto& state = getPrepareState();
+    std::lock_guard<std::mutex> guard{state.mutex};
+    failure = state.failure;
+  }
+  if (failure)
+    std::rethrow_exception(failure);
+}
+
+template <typename T, Feature... Fs>
+inline bool CodegenHandler<T, Fs...>::isReady() {
+  return getIntrospectionFunc().load() != nullptr &&
+         getTreeBuilderInstructions().load() != nullptr;
+}
+
 template <typename T, Feature... Fs>
 inline bool CodegenHandler<T, Fs...>::init(const GeneratorOptions& opts) {
-  if (getIntrospectionFunc().load() != nullptr &&
-      getTreeBuilderInstructions().load() != nullptr)
+  if (isReady())
     return true;  // already initialised
-  if (getIsCritical().exchange(true))
-    return false;  // other thread is initialising/has failed
 
-  auto lib =
-      OILibrary(reinterpret_cast<void*>(&getIntrospectionFunc), {Fs...}, opts);
-  auto [vfp, ty] = lib.init();
+  std::packaged_task<void()> task{[&opts] { compile(opts); }};
+  std::shared_future<void> future = task.get_future().share();
+  {
+    auto& state = getPrepareState();
+    std::lock_guard<std::mutex> guard{state.mutex};
+    if (state.future.valid())
+      return false;  // other thread is initialising
+    state.future = future;
+    state.failure = nullptr;
+  }
 
-  getIntrospectionFunc().store(reinterpret_cast<func_type>(vfp));
-  getTreeBuilderInstructions().store(&ty);
+  task();
+  future.get();  // rethrows any compilation failure
   return true;
 }
 
+template <typename T, Feature... Fs>
+inline std::shared_future<void> CodegenHandler<T, Fs...>::prepare(
+    const GeneratorOptions& opts) {
+  auto& state = getPrepareState();
+  std::lock_guard<std::mutex> guard{state.mutex};
+  if (!state.future.valid()) {
+    state.future =
+        detail::submitPrepareTask([opts] { compile(opts); }).share();
+    state.failure = nullptr;
+  }
+  return state.future;
+}
+
 template <typename T, Feature... Fs>
 inline IntrospectionResult CodegenHandler<T, Fs...>::introspect(
     const T& objectAddr) {
+  return introspect(objectAddr, Budget{});
+}
+
+template <typename T, Feature... Fs>
+inline IntrospectionResult CodegenHandler<T, Fs...>::introspect(
+    const T& objectAddr, const Budget& budget) {
   func_type func = getIntrospectionFunc().load();
   const exporters::inst::Inst* ty = getTreeBuilderInstructions().load();
 
-  if (func == nullptr || ty == nullptr)
+  if (func == nullptr || ty == nullptr) {
+    rethrowFailure();
     throw std::logic_error("introspect(const T&) called when uninitialised");
+  }
 
   std::vector<uint8_t> buf;
   static_assert(sizeof(std::vector<uint8_t>) == 24);
-  func(objectAddr, buf);
+  func(objectAddr, buf, budget);
   return IntrospectionResult{std::move(buf), *ty};
 }
 
+template <typename T, Feature... Fs>
+inline std::future<IntrospectionResult>
+CodegenHandler<T, Fs...>::introspectSnapshot(const T& objectAddr,
+                                             const Budget& budget) {
+  func_type func = getIntrospectionFunc().load();
+  const exporters::inst::Inst* ty = getTreeBuilderInstructions().load();
+
+  if (func == nullptr || ty == nullptr)
+    throw std::logic_error(
+        "introspectSnapshot(const T&) called when uninitialised");
+
+  // The child only has the forking thread, and threads started in it could
+  // block on locks held by the parent's other threads. The profile would only
+  // be written to the child's copy of it.
+  Budget childBudget = budget;
+  childBudget.maxThreads = 1;
+  childBudget.profile = nullptr;
+  return detail::introspectInSnapshot(
+      [&](std::vector<uint8_t>& buf) { func(objectAddr, buf, childBudget); },
+      *ty);
+}
+
+template <typename T, Feature... Fs>
+inline std::optional<IntrospectionResult> CodegenHandler<T, Fs...>::introspect(
+    const T& objectAddr, WaitPolicy policy, const Budget& budget) {
+  if (!isReady()) {
+    std::shared_future<void> future = getFuture();
+    if (!future.valid()) {
+      rethrowFailure();
+      throw std::logic_error("introspect(const T&) called before prepare");
+    }
+    if (policy == WaitPolicy::Skip &&
+        future.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+      return std::nullopt;
+    future.get();  // rethrows any compilation failure
+  }
+
+  return introspect(objectAddr, budget);
+}
+
 }  // namespace oi
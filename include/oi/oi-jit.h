@@ -17,19 +17,43 @@
 #define INCLUDED_OI_OI_JIT_H 1
 
 #include <atomic>
+#include <exception>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "oi/Budget.h"
 #include "oi/exporters/inst.h"
 #include "oi/oi.h"
 
 namespace oi::detail {
 class OILibraryImpl;
-}
+
+/*
+ * Runs the task on the thread pool shared by every oi::prepare call, so that
+ * several types can be compiled at once.
+ */
+std::future<void> submitPrepareTask(std::function<void()> task);
+
+/*
+ * Forks the process and runs `traverse` in the child, against a copy-on-write
+ * snapshot of the parent's memory. Returns as soon as the child is forked: the
+ * future gets the result read back from the child, or an exception if it
+ * failed. Like any std::async future, destroying it waits for the child.
+ */
+std::future<IntrospectionResult> introspectInSnapshot(
+    const std::function<void(std::vector<uint8_t>&)>& traverse,
+    const exporters::inst::Inst& ty);
+
+template <typename... Handlers>
+class Batch;
+}  // namespace oi::detail
 
 namespace oi {
 
@@ -37,6 +61,8 @@ struct GeneratorOptions {
   std::vector<std::filesystem::path> configFilePaths;
   std::filesystem::path sourceFileDumpPath;
   int debugLevel = 0;
+  // Reuse type graphs from earlier runs of the same binary, if set
+  std::filesystem::path typeGraphCacheDir;
 };
 
 class OILibrary {
@@ -44,8 +70,12 @@ class OILibrary {
   OILibrary(void* atomicHome,
             std::unordered_set<Feature>,
             GeneratorOptions opts);
+  OILibrary(std::vector<void*> atomicHoles,
+            std::unordered_set<Feature>,
+            GeneratorOptions opts);
   ~OILibrary();
   std::pair<void*, const exporters::inst::Inst&> init();
+  std::vector<std::pair<void*, const exporters::inst::Inst&>> initBatch();
 
  private:
   std::unique_ptr<detail::OILibraryImpl> pimpl_;
@@ -61,16 +91,106 @@ template <typename T, Feature... Fs>
 std::optional<IntrospectionResult> setupAndIntrospect(
     const T& objectAddr, const GeneratorOptions& opts);
 
+/*
+ * What introspecting a prepared type does if its compilation is still running.
+ */
+enum class WaitPolicy {
+  Block,  // wait for compilation to finish
+  Skip,   // return std::nullopt immediately
+};
+
+/*
+ * prepare
+ *
+ * Start JIT compilation for the given type in the background and return
+ * without waiting for it. The future becomes ready once the type can be
+ * introspected, or holds the exception if compilation failed. Poll it, wait on
+ * it, or pass a WaitPolicy to CodegenHandler::introspect.
+ *
+ * Each type is only compiled once: later calls to prepare or init for the same
+ * type and features share the first compilation. If it fails, callers already
+ * holding its future see the failure and the next call compiles again. Until
+ * then, introspecting the type rethrows the failure.
+ */
+template <typename T, Feature... Fs>
+std::shared_future<void> prepare(const GeneratorOptions& opts);
+
+/*
+ * initBatch
+ *
+ * JIT compile several CodegenHandlers together, e.g.
+ *   initBatch<CodegenHandler<Foo>, CodegenHandler<Bar>>(opts);
+ * Their types share one type graph and compilation, so the cost barely grows
+ * with the number of types. Types sharing most of their code are generated in
+ * one translation unit, otherwise they may be split between units compiled in
+ * parallel. Every handler must request the
+ * same features. Handlers that have already been initialised or prepared are
+ * left out. Throws on error.
+ */
+template <typename... Handlers>
+void initBatch(const GeneratorOptions& opts);
+
+/*
+ * prepareBatch
+ *
+ * As initBatch, but compiles in the background like prepare. The returned
+ * future covers the handlers compiled by this batch.
+ */
+template <typename... Handlers>
+std::shared_future<void> prepareBatch(const GeneratorOptions& opts);
+
 template <typename T, Feature... Fs>
 class CodegenHandler {
  public:
   static bool init(const GeneratorOptions& opts);
+  static std::shared_future<void> prepare(const GeneratorOptions& opts);
+  static bool isReady();
   static IntrospectionResult introspect(const T& objectAddr);
+  static IntrospectionResult introspect(const T& objectAddr,
+                                        const Budget& budget);
+  static std::optional<IntrospectionResult> introspect(
+      const T& objectAddr, WaitPolicy policy, const Budget& budget = {});
+
+  /*
+   * Introspects a snapshot of the object taken by forking the process. The
+   * caller only pauses for the fork and the object may be modified as soon as
+   * this returns, while a child process traverses it. Mind that the child only
+   * has the forking thread, so locks held by other threads stay held in it, and
+   * it doesn't split containers between threads even with ParallelTraversal.
+   * The child must be left for the future to reap: this throws if SIGCHLD is
+   * ignored. Destroying the future waits for the child.
+   */
+  static std::future<IntrospectionResult> introspectSnapshot(
+      const T& objectAddr, const Budget& budget = {});
 
  private:
-  using func_type = void (*)(const T&, std::vector<uint8_t>&);
+  using func_type = void (*)(const T&, std::vector<uint8_t>&, const Budget&);
+
+  struct PrepareState {
+    std::mutex mutex;
+    // Valid once compilation has been started by init or prepare, and reset
+    // if it fails
+    std::shared_future<void> future;
+    // Why the last compilation failed, until another one is started
+    std::exception_ptr failure;
+  };
+
+  static void compile(const GeneratorOptions& opts);
+  static std::shared_future<void> getFuture();
+  // Rethrows the last compilation failure, if any
+  static void rethrowFailure();
+  static PrepareState& getPrepareState();
 
-  static std::atomic<bool>& getIsCritical();
+  // Used to compile several handlers together by initBatch and prepareBatch
+  template <typename... Handlers>
+  friend class detail::Batch;
+  static std::unordered_set<Feature> features();
+  static bool claim(const std::shared_future<void>& future);
+  // Forgets a failed compilation so that the next init or prepare retries,
+  // keeping its failure for introspect to report
+  static void release(std::exception_ptr failure);
+  static void* atomicHole();
+  static void store(void* fp, const exporters::inst::Inst& ty);
   static std::atomic<func_type>& getIntrospectionFunc();
   static std::atomic<const exporters::inst::Inst*>&
   getTreeBuilderInstructions();
@@ -30,6 +30,8 @@ enum class Feature {
   ChaseRawPointers,
   CaptureThriftIsset,
   GenJitDebug,
+  ParallelTraversal,
+  DeltaPointers,
 };
 
 #ifdef OIL_AOT_COMPILATION
@@ -52,6 +52,8 @@ struct Element {
   std::optional<ContainerStats> container_stats;
   std::optional<IsSetStats> is_set_stats;
   bool is_primitive;
+  // Set on the last element of a result cut short by an oi::Budget
+  bool is_truncated = false;
 };
 
 }  // namespace oi::result
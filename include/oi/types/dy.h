@@ -47,6 +47,7 @@ namespace oi::types::dy {
 
 struct Unit;
 struct VarInt;
+struct Pointer;
 struct Pair;
 struct Sum;
 struct List;
@@ -59,12 +60,14 @@ struct List;
  */
 using Dynamic = std::variant<std::reference_wrapper<const Unit>,
                              std::reference_wrapper<const VarInt>,
+                             std::reference_wrapper<const Pointer>,
                              std::reference_wrapper<const Pair>,
                              std::reference_wrapper<const Sum>,
                              std::reference_wrapper<const List> >;
 
 struct Unit {};
 struct VarInt {};
+struct Pointer {};
 
 struct Pair {
   constexpr Pair(Dynamic first_, Dynamic second_)
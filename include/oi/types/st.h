@@ -27,7 +27,9 @@
  * which writes a given byte to the buffer; and, `size_t offset()`, which
  * returns the number of bytes written. Each Static Type holds a DataBuffer
  * which describes where to write data, and has no other fields. DataBuffers
- * should remain pointer sized enabling trivial copies.
+ * should remain pointer sized enabling trivial copies. A DataBuffer may also
+ * provide `uintptr_t& last_pointer()`, in which case Pointers written to it are
+ * delta encoded.
  *
  * Writing to an object of a given static type returns a different type which
  * has had that part written. When there is no more to write, the type will
@@ -144,6 +146,51 @@ class VarInt {
   DataBuffer _buf;
 };
 
+/*
+ * Pointer
+ *
+ * Represents a pointer value. If the DataBuffer provides `last_pointer()`, the
+ * pointer is written as the zigzag encoded difference from the previous Pointer
+ * written to the buffer, which takes a byte or two instead of six or seven for
+ * nearby addresses. Otherwise it is written as a plain VarInt and described as
+ * one. The stream must then be read back in the order it was written.
+ */
+template <typename DataBuffer>
+class Pointer {
+ public:
+  static constexpr bool delta =
+      requires(DataBuffer& db) { db.last_pointer(); };
+
+  Pointer(DataBuffer db) : _buf(db) {
+  }
+
+  Unit<DataBuffer> write(uintptr_t val) {
+    if constexpr (delta) {
+      uintptr_t& last = _buf.last_pointer();
+      auto diff = static_cast<int64_t>(val - last);
+      last = val;
+      uint64_t zigzag = (static_cast<uint64_t>(diff) << 1) ^
+                        static_cast<uint64_t>(diff >> 63);
+      return VarInt<DataBuffer>(_buf).write(zigzag);
+    } else {
+      return VarInt<DataBuffer>(_buf).write(val);
+    }
+  }
+
+  template <typename F>
+  Unit<DataBuffer> consume(F const& cb) {
+    return cb(*this);
+  }
+
+#ifdef DEFINE_DESCRIBE
+  static constexpr std::
+      conditional_t<delta, types::dy::Pointer, types::dy::VarInt> describe{};
+#endif
+
+ private:
+  DataBuffer _buf;
+};
+
 /*
  * Pair<T1,T2>
  *
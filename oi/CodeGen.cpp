@@ -17,14 +17,21 @@
 
 #include <glog/logging.h>
 
+#include <unistd.h>
+
+#include <algorithm>
 #include <boost/format.hpp>
+#include <fstream>
+#include <future>
 #include <iostream>
 #include <numeric>
 #include <set>
 #include <string_view>
+#include <thread>
 
 #include "oi/FuncGen.h"
 #include "oi/Headers.h"
+#include "oi/Metrics.h"
 #include "oi/SymbolService.h"
 #include "type_graph/AddChildren.h"
 #include "type_graph/AddPadding.h"
@@ -40,6 +47,7 @@
 #include "type_graph/RemoveMembers.h"
 #include "type_graph/RemoveTopLevelPointer.h"
 #include "type_graph/TopoSorter.h"
+#include "type_graph/TypeGraphSerializer.h"
 #include "type_graph/TypeIdentifier.h"
 #include "type_graph/Types.h"
 
@@ -95,6 +103,45 @@ std::vector<std::string_view> enumerateTypeNames(Type& type) {
   return names;
 }
 
+/*
+ * Calls `emit` for each of `types` in order, appending to `code`. Large
+ * graphs are split into contiguous chunks which are emitted into buffers of
+ * their own on separate threads and stitched back together in order, so
+ * `emit` must only read shared state.
+ */
+template <typename F>
+void emitTypes(std::span<const ref<Type>> types,
+               const CodeGen::EmitOptions& options,
+               std::string& code,
+               const F& emit) {
+  size_t chunks =
+      std::min(options.maxThreads,
+               types.size() / std::max<size_t>(options.minTypesPerThread, 1));
+  if (chunks < 2) {
+    for (const Type& t : types)
+      emit(t, code);
+    return;
+  }
+
+  size_t perChunk = (types.size() + chunks - 1) / chunks;
+  std::vector<std::future<std::string>> rest;
+  for (size_t first = perChunk; first < types.size(); first += perChunk) {
+    auto chunk = types.subspan(first, std::min(perChunk, types.size() - first));
+    rest.push_back(std::async(std::launch::async, [chunk, &emit] {
+      std::string out;
+      for (const Type& t : chunk)
+        emit(t, out);
+      return out;
+    }));
+  }
+
+  // The first chunk goes straight into `code` while the others run
+  for (const Type& t : types.first(perChunk))
+    emit(t, code);
+  for (auto& chunk : rest)
+    code += chunk.get();
+}
+
 void defineMacros(std::string& code) {
   if (true /* TODO: config.useDataSegment*/) {
     code += R"(
@@ -131,6 +178,8 @@ void addIncludes(const TypeGraph& typeGraph,
     code += "#define DEFINE_DESCRIBE 1\n";  // added before all includes
 
     includes.emplace("functional");
+    includes.emplace("iterator");
+    includes.emplace("oi/Budget.h");
     includes.emplace("oi/exporters/inst.h");
     includes.emplace("oi/types/dy.h");
     includes.emplace("oi/types/st.h");
@@ -143,6 +192,20 @@ void addIncludes(const TypeGraph& typeGraph,
   if (features[Feature::JitTiming]) {
     includes.emplace("chrono");
   }
+  if (features[Feature::ParallelTraversal]) {
+    includes.emplace("algorithm");
+    includes.emplace("oi/ConcurrentPointerSet.h");
+    includes.emplace("thread");
+    includes.emplace("vector");
+  }
+  if (features[Feature::JitProfiling]) {
+    includes.emplace("array");
+    includes.emplace("string_view");
+    if (features[Feature::Library]) {
+      includes.emplace("algorithm");
+      includes.emplace("string");
+    }
+  }
   for (const Type& t : typeGraph.finalTypes) {
     if (const auto* c = dynamic_cast<const Container*>(&t)) {
       includes.emplace(c->containerInfo_.header);
@@ -186,14 +249,17 @@ void genDeclsEnum(const Enum& e, std::string& code) {
   code += " {};\n";
 }
 
-void genDecls(const TypeGraph& typeGraph, std::string& code) {
-  for (const Type& t : typeGraph.finalTypes) {
+void genDecls(const TypeGraph& typeGraph,
+              const CodeGen::EmitOptions& options,
+              std::string& code) {
+  auto emit = [](const Type& t, std::string& out) {
     if (const auto* c = dynamic_cast<const Class*>(&t)) {
-      genDeclsClass(*c, code);
+      genDeclsClass(*c, out);
     } else if (const auto* e = dynamic_cast<const Enum*>(&t)) {
-      genDeclsEnum(*e, code);
+      genDeclsEnum(*e, out);
     }
-  }
+  };
+  emitTypes(typeGraph.finalTypes, options, code, emit);
 }
 
 namespace {
@@ -217,7 +283,9 @@ size_t calculateExclusiveSize(const Type& t) {
 
 }  // namespace
 
-void genNames(const TypeGraph& typeGraph, std::string& code) {
+void genNames(const TypeGraph& typeGraph,
+              const CodeGen::EmitOptions& options,
+              std::string& code) {
   code += R"(
 template <typename T>
 struct NameProvider;
@@ -232,21 +300,27 @@ struct NameProvider<DummySizedOperator<N, align, Id>> {
 
   // TODO: stop types being duplicated at this point and remove this check
   std::unordered_set<std::string_view> emittedTypes;
-  for (const Type& t : typeGraph.finalTypes) {
+  std::vector<ref<Type>> types;
+  for (Type& t : typeGraph.finalTypes) {
     if (dynamic_cast<const Typedef*>(&t))
       continue;
-    if (!emittedTypes.emplace(t.name()).second)
-      continue;
-
-    code += "template <> struct NameProvider<";
-    code += t.name();
-    code += "> { static constexpr std::array<std::string_view, 1> names = {\"";
-    code += t.inputName();
-    code += "\"}; };\n";
+    if (emittedTypes.emplace(t.name()).second)
+      types.push_back(t);
   }
+
+  auto emit = [](const Type& t, std::string& out) {
+    out += "template <> struct NameProvider<";
+    out += t.name();
+    out += "> { static constexpr std::array<std::string_view, 1> names = {\"";
+    out += t.inputName();
+    out += "\"}; };\n";
+  };
+  emitTypes(types, options, code, emit);
 }
 
-void genExclusiveSizes(const TypeGraph& typeGraph, std::string& code) {
+void genExclusiveSizes(const TypeGraph& typeGraph,
+                       const CodeGen::EmitOptions& options,
+                       std::string& code) {
   code += R"(
 template <typename T>
 struct ExclusiveSizeProvider {
@@ -254,19 +328,20 @@ struct ExclusiveSizeProvider {
 };
 )";
 
-  for (const Type& t : typeGraph.finalTypes) {
+  auto emit = [](const Type& t, std::string& out) {
     if (dynamic_cast<const Typedef*>(&t))
-      continue;
+      return;
 
     size_t exclusiveSize = calculateExclusiveSize(t);
     if (exclusiveSize != t.size()) {
-      code += "template <> struct ExclusiveSizeProvider<";
-      code += t.name();
-      code += "> { static constexpr size_t size = ";
-      code += std::to_string(exclusiveSize);
-      code += "; };\n";
+      out += "template <> struct ExclusiveSizeProvider<";
+      out += t.name();
+      out += "> { static constexpr size_t size = ";
+      out += std::to_string(exclusiveSize);
+      out += "; };\n";
     }
-  }
+  };
+  emitTypes(typeGraph.finalTypes, options, code, emit);
 }
 
 /*
@@ -279,14 +354,16 @@ struct ExclusiveSizeProvider {
  *   struct Foo;
  *   }  // namespace nsA::nsB
  */
-void declareFullyQualifiedStruct(const std::string& name, std::string& code) {
+void declareFullyQualifiedStruct(std::string_view name, std::string& code) {
   if (auto pos = name.rfind("::"); pos != name.npos) {
     auto ns = name.substr(0, pos);
     auto structName = name.substr(pos + 2);
     code += "namespace ";
     code += ns;
     code += " {\n";
-    code += "struct " + structName + ";\n";
+    code += "struct ";
+    code += structName;
+    code += ";\n";
     code += "} // namespace ";
     code += ns;
     code += "\n";
@@ -300,7 +377,9 @@ void declareFullyQualifiedStruct(const std::string& name, std::string& code) {
 void genDefsThriftClass(const Class& c, std::string& code) {
   declareFullyQualifiedStruct(c.fqName(), code);
   code += "namespace apache { namespace thrift {\n";
-  code += "template <> struct TStructDataStorage<" + c.fqName() + "> {\n";
+  code += "template <> struct TStructDataStorage<";
+  code += c.fqName();
+  code += "> {\n";
   code +=
       "  static constexpr const std::size_t fields_size = 1; // Invalid, do "
       "not use\n";
@@ -371,11 +450,16 @@ void genDefsClass(const Class& c, std::string& code) {
     code += "alignas(" + std::to_string(c.align()) + ") ";
   }
 
-  code += c.name() + " {\n";
+  code += c.name();
+  code += " {\n";
   for (const auto& mem : c.members) {
-    code += "  " + mem.type().name() + " " + mem.name;
+    code += "  ";
+    code += mem.type().name();
+    code += ' ';
+    code += mem.name;
     if (mem.bitsize) {
-      code += " : " + std::to_string(mem.bitsize);
+      code += " : ";
+      code += std::to_string(mem.bitsize);
     }
     code += ";\n";
   }
@@ -386,45 +470,64 @@ void genDefsTypedef(const Typedef& td, std::string& code) {
   code += "using " + td.name() + " = " + td.underlyingType().name() + ";\n";
 }
 
-void genDefs(const TypeGraph& typeGraph, std::string& code) {
-  for (const Type& t : typeGraph.finalTypes) {
+void genDefs(const TypeGraph& typeGraph,
+             const CodeGen::EmitOptions& options,
+             std::string& code) {
+  auto emit = [](const Type& t, std::string& out) {
     if (const auto* c = dynamic_cast<const Class*>(&t)) {
-      genDefsClass(*c, code);
+      genDefsClass(*c, out);
     } else if (const auto* td = dynamic_cast<const Typedef*>(&t)) {
-      genDefsTypedef(*td, code);
+      genDefsTypedef(*td, out);
     }
-  }
+  };
+  emitTypes(typeGraph.finalTypes, options, code, emit);
+}
+
+void genStaticAssertSize(const Type& t, std::string& code) {
+  code += "static_assert(validate_size<";
+  code += t.name();
+  code += ", ";
+  code += std::to_string(t.size());
+  code += ">::value);\n";
 }
 
 void genStaticAssertsClass(const Class& c, std::string& code) {
-  code += "static_assert(validate_size<" + c.name() + ", " +
-          std::to_string(c.size()) + ">::value);\n";
+  genStaticAssertSize(c, code);
   for (const auto& member : c.members) {
     if (member.bitsize > 0)
       continue;
 
-    code += "static_assert(validate_offset<offsetof(" + c.name() + ", " +
-            member.name + "), " + std::to_string(member.bitOffset / 8) +
-            ">::value, \"Unexpected offset of " + c.name() +
-            "::" + member.name + "\");\n";
+    code += "static_assert(validate_offset<offsetof(";
+    code += c.name();
+    code += ", ";
+    code += member.name;
+    code += "), ";
+    code += std::to_string(member.bitOffset / 8);
+    code += ">::value, \"Unexpected offset of ";
+    code += c.name();
+    code += "::";
+    code += member.name;
+    code += "\");\n";
   }
   code.push_back('\n');
 }
 
 void genStaticAssertsContainer(const Container& c, std::string& code) {
-  code += "static_assert(validate_size<" + c.name() + ", " +
-          std::to_string(c.size()) + ">::value);\n";
+  genStaticAssertSize(c, code);
   code.push_back('\n');
 }
 
-void genStaticAsserts(const TypeGraph& typeGraph, std::string& code) {
-  for (const Type& t : typeGraph.finalTypes) {
+void genStaticAsserts(const TypeGraph& typeGraph,
+                      const CodeGen::EmitOptions& options,
+                      std::string& code) {
+  auto emit = [](const Type& t, std::string& out) {
     if (const auto* c = dynamic_cast<const Class*>(&t)) {
-      genStaticAssertsClass(*c, code);
+      genStaticAssertsClass(*c, out);
     } else if (const auto* con = dynamic_cast<const Container*>(&t)) {
-      genStaticAssertsContainer(*con, code);
+      genStaticAssertsContainer(*con, out);
     }
-  }
+  };
+  emitTypes(typeGraph.finalTypes, options, code, emit);
 }
 
 void addStandardGetSizeFuncDecls(std::string& code) {
@@ -465,8 +568,10 @@ void addStandardGetSizeFuncDefs(std::string& code) {
         JLOG("ptr val @");
         JLOGPTR(s_ptr);
         StoreData((uintptr_t)(s_ptr), returnArg);
-        if (s_ptr && ctx.pointers.add((uintptr_t)s_ptr)) {
+        if (s_ptr && !ctx.budget.exhausted(returnArg) &&
+            ctx.pointers.add((uintptr_t)s_ptr)) {
           StoreData(1, returnArg);
+          JPROFILE(T);
           getSizeType(*(s_ptr), returnArg);
         } else {
           StoreData(0, returnArg);
@@ -481,8 +586,11 @@ void addStandardGetSizeFuncDefs(std::string& code) {
       SAVE_SIZE(sizeof(container));
 
       for (size_t i=0; i<N; i++) {
+          if (ctx.budget.exhausted(container.vals[i], returnArg))
+            break;
           // undo the static size that has already been added per-element
           SAVE_SIZE(-sizeof(container.vals[i]));
+          JPROFILE(T);
           getSizeType(container.vals[i], returnArg);
       }
     }
@@ -512,8 +620,9 @@ void CodeGen::getClassSizeFuncConcrete(std::string_view funcName,
   }
 
   if (thriftIssetMember) {
-    code += "  using thrift_data = apache::thrift::TStructDataStorage<" +
-            c.fqName() + ">;\n";
+    code += "  using thrift_data = apache::thrift::TStructDataStorage<";
+    code += c.fqName();
+    code += ">;\n";
   }
 
   size_t thriftFieldIdx = 0;
@@ -521,6 +630,7 @@ void CodeGen::getClassSizeFuncConcrete(std::string_view funcName,
     const auto& member = c.members[i];
     if (member.name.starts_with(AddPadding::MemberPrefix))
       continue;
+    std::string memberName{member.name};
 
     if (thriftIssetMember && thriftIssetMember != &member) {
       // Capture Thrift's isset value for each field, except for __isset
@@ -529,17 +639,25 @@ void CodeGen::getClassSizeFuncConcrete(std::string_view funcName,
                                 std::to_string(thriftFieldIdx++) + "]";
       code += "  if (&thrift_data::isset_indexes != nullptr && " + issetIdxStr +
               " != -1) {\n";
-      code += "    SAVE_DATA(t." + thriftIssetMember->name + ".get(" +
-              issetIdxStr + "));\n";
+      code += "    SAVE_DATA(t." + std::string{thriftIssetMember->name} +
+              ".get(" + issetIdxStr + "));\n";
       code += "  } else {\n";
       code += "    SAVE_DATA(-1);\n";
       code += "  }\n";
     }
 
-    code += "  JLOG(\"" + member.name + " @\");\n";
+    code += "  JLOG(\"" + memberName + " @\");\n";
     if (member.bitsize == 0)
-      code += "  JLOGPTR(&t." + member.name + ");\n";
-    code += "  getSizeType(t." + member.name + ", returnArg);\n";
+      code += "  JLOGPTR(&t." + memberName + ");\n";
+    if (config_.features[Feature::JitProfiling]) {
+      // Attribute the time spent on this member to the member's type
+      code += "  {\n";
+      code += "    JPROFILE(decltype(t." + memberName + "));\n";
+      code += "    getSizeType(t." + memberName + ", returnArg);\n";
+      code += "  }\n";
+    } else {
+      code += "  getSizeType(t." + memberName + ", returnArg);\n";
+    }
   }
   code += "}\n";
 }
@@ -676,7 +794,8 @@ size_t getLastNonPaddingMemberIndex(const std::vector<Member>& members) {
 // `delegate()` form to handle each field except for the last. The last field
 // instead uses `consume()` as we must not accidentally handle the first half
 // of a pair as the last field.
-void CodeGen::genClassTraversalFunction(const Class& c, std::string& code) {
+void CodeGen::genClassTraversalFunction(const Class& c,
+                                        std::string& code) const {
   std::string funcName = "getSizeType";
 
   code += "  static types::st::Unit<DB> ";
@@ -737,7 +856,7 @@ void CodeGen::genClassTraversalFunction(const Class& c, std::string& code) {
 //   Pair<TypeHandler<int>::type,
 //     TypeHandler<int>::type
 // >>
-void CodeGen::genClassStaticType(const Class& c, std::string& code) {
+void CodeGen::genClassStaticType(const Class& c, std::string& code) const {
   const Member* thriftIssetMember = nullptr;
   if (const auto it = thriftIssetMembers_.find(&c);
       it != thriftIssetMembers_.end()) {
@@ -770,10 +889,11 @@ void CodeGen::genClassStaticType(const Class& c, std::string& code) {
       }
     }
 
-    code +=
-        (boost::format("typename TypeHandler<Ctx, decltype(%1%::%2%)>::type") %
-         c.name() % member.name)
-            .str();
+    code += "typename TypeHandler<Ctx, decltype(";
+    code += c.name();
+    code += "::";
+    code += member.name;
+    code += ")>::type";
 
     if (i != lastNonPaddingElement) {
       code += ", ";
@@ -787,7 +907,7 @@ void CodeGen::genClassStaticType(const Class& c, std::string& code) {
 }
 
 void CodeGen::genClassTreeBuilderInstructions(const Class& c,
-                                              std::string& code) {
+                                              std::string& code) const {
   const Member* thriftIssetMember = nullptr;
   if (const auto it = thriftIssetMembers_.find(&c);
       it != thriftIssetMembers_.end()) {
@@ -827,7 +947,7 @@ void CodeGen::genClassTreeBuilderInstructions(const Class& c,
     ++index;
     if (m.name.starts_with(AddPadding::MemberPrefix))
       continue;
-    std::string fullName = c.name() + "::" + m.name;
+    std::string fullName = c.name() + "::" + std::string{m.name};
     bool isbitField = m.bitsize;
     bool isPrimitive = dynamic_cast<const Primitive*>(&m.type());
 
@@ -867,27 +987,28 @@ void CodeGen::genClassTreeBuilderInstructions(const Class& c,
       "processors{};\n";
 }
 
-void CodeGen::genClassTypeHandler(const Class& c, std::string& code) {
+void CodeGen::genClassTypeHandler(const Class& c, std::string& code) const {
   std::string helpers;
 
   if (const auto it = thriftIssetMembers_.find(&c);
       it != thriftIssetMembers_.end()) {
     const Member& thriftIssetMember = *it->second;
 
-    helpers += (boost::format(R"(
-  static int getThriftIsset(const %1%& t, size_t i) {
-    using thrift_data = apache::thrift::TStructDataStorage<%2%>;
+    helpers += "\n  static int getThriftIsset(const ";
+    helpers += c.name();
+    helpers += "& t, size_t i) {\n";
+    helpers += "    using thrift_data = apache::thrift::TStructDataStorage<";
+    helpers += c.fqName();
+    helpers += R"(>;
 
     if (&thrift_data::isset_indexes == nullptr) return 2;
 
     auto idx = thrift_data::isset_indexes[i];
     if (idx == -1) return 2;
 
-    return t.%3%.get(idx);
-  }
-)") % c.name() % c.fqName() %
-                thriftIssetMember.name)
-                   .str();
+    return t.)";
+    helpers += thriftIssetMember.name;
+    helpers += ".get(idx);\n  }\n";
   }
 
   code += "template <typename Ctx>\n";
@@ -907,13 +1028,9 @@ void CodeGen::genClassTypeHandler(const Class& c, std::string& code) {
 
 namespace {
 
-void genContainerTypeHandler(std::unordered_set<const ContainerInfo*>& used,
-                             const ContainerInfo& c,
+void genContainerTypeHandler(const ContainerInfo& c,
                              std::span<const TemplateParam> templateParams,
                              std::string& code) {
-  if (!used.insert(&c).second)
-    return;
-
   code += c.codegen.extra;
 
   // TODO: Move this check into the ContainerInfo parsing once always enabled.
@@ -1056,7 +1173,7 @@ void addCaptureKeySupport(std::string& code) {
     class CaptureKeyHandler {
       using DB = typename Ctx::DataBuffer;
      public:
-      using type = types::st::Sum<DB, types::st::VarInt<DB>, types::st::VarInt<DB>>;
+      using type = types::st::Sum<DB, types::st::VarInt<DB>, types::st::Pointer<DB>>;
 
       static auto captureKey(const T& key, auto returnArg) {
         // Save scalars keys directly, otherwise save pointers for complex types
@@ -1154,74 +1271,260 @@ void addStandardTypeHandlers(TypeGraph& typeGraph,
     getSizeType(Ctx& ctx, const T &t, typename TypeHandler<Ctx, T>::type returnArg) {
       JLOG("obj @");
       JLOGPTR(&t);
+      JPROFILE(T);
+      // Types which write no data aren't counted against the budget
+      using DB = typename Ctx::DataBuffer;
+      using Ret = typename TypeHandler<Ctx, T>::type;
+      if constexpr (!std::is_same_v<Ret, types::st::Unit<DB>>) {
+        if (__builtin_expect(ctx.budget.exhausted(ctx.out.size()), 0))
+          return types::st::Unit<DB>{DB{ctx.out}};
+      }
       return TypeHandler<Ctx, T>::getSizeType(ctx, t, returnArg);
     }
 )";
 
-  // TODO: bit of a hack - making ContainerInfo a node in the type graph and
-  // traversing for it would remove the need for this set altogether.
-  std::unordered_set<const ContainerInfo*> used{};
   std::vector<TemplateParam> arrayParams{
       TemplateParam{typeGraph.makeType<Primitive>(Primitive::Kind::UInt64)},
       TemplateParam{typeGraph.makeType<Primitive>(Primitive::Kind::UInt64),
                     "0"},
   };
   genContainerTypeHandler(
-      used, FuncGen::GetOiArrayContainerInfo(), arrayParams, code);
+      FuncGen::GetOiArrayContainerInfo(), arrayParams, code);
 }
 
 }  // namespace
 
 void CodeGen::addTypeHandlers(const TypeGraph& typeGraph, std::string& code) {
-  for (const Type& t : typeGraph.finalTypes) {
+  // TODO: bit of a hack - making ContainerInfo a node in the type graph and
+  // traversing for it would remove the need for this set altogether.
+  //
+  // Only the first type using each ContainerInfo defines its handler. Pick
+  // those out up front, the handlers themselves are emitted in parallel.
+  std::vector<ref<Type>> types;
+  for (Type& t : typeGraph.finalTypes) {
+    const ContainerInfo* info = nullptr;
+    if (const auto* con = dynamic_cast<const Container*>(&t)) {
+      info = &con->containerInfo_;
+    } else if (const auto* cap = dynamic_cast<const CaptureKeys*>(&t)) {
+      info = &cap->containerInfo();
+    } else if (!dynamic_cast<const Class*>(&t)) {
+      continue;
+    }
+
+    if (info == nullptr || definedContainers_.insert(info).second)
+      types.push_back(t);
+  }
+
+  auto emit = [this](const Type& t, std::string& out) {
     if (const auto* c = dynamic_cast<const Class*>(&t)) {
-      genClassTypeHandler(*c, code);
+      genClassTypeHandler(*c, out);
     } else if (const auto* con = dynamic_cast<const Container*>(&t)) {
-      genContainerTypeHandler(
-          definedContainers_, con->containerInfo_, con->templateParams, code);
+      genContainerTypeHandler(con->containerInfo_, con->templateParams, out);
     } else if (const auto* cap = dynamic_cast<const CaptureKeys*>(&t)) {
       auto* container =
           dynamic_cast<Container*>(&(stripTypedefs(cap->underlyingType())));
       if (!container)
         throw std::runtime_error("KaptureKeys requires a container");
 
-      genContainerTypeHandler(definedContainers_,
-                              cap->containerInfo(),
-                              container->templateParams,
-                              code);
+      genContainerTypeHandler(
+          cap->containerInfo(), container->templateParams, out);
     }
-  }
+  };
+  emitTypes(types, emitOptions_, code, emit);
 }
 
 bool CodeGen::codegenFromDrgn(struct drgn_type* drgnType,
                               std::string linkageName,
                               std::string& code) {
-  return codegenFromDrgn(drgnType, code, ExactName{std::move(linkageName)});
+  return codegenFromDrgn(
+      {&drgnType, 1}, code, {ExactName{std::move(linkageName)}});
 }
 
 bool CodeGen::codegenFromDrgn(struct drgn_type* drgnType, std::string& code) {
-  return codegenFromDrgn(
-      drgnType, code, HashedComponent{SymbolService::getTypeName(drgnType)});
+  return codegenFromDrgn({&drgnType, 1}, code);
 }
 
-bool CodeGen::codegenFromDrgn(struct drgn_type* drgnType,
+bool CodeGen::codegenFromDrgn(std::span<struct drgn_type* const> drgnTypes,
+                              std::string& code) {
+  std::vector<RootFunctionName> names;
+  names.reserve(drgnTypes.size());
+  for (auto* drgnType : drgnTypes)
+    names.emplace_back(HashedComponent{SymbolService::getTypeName(drgnType)});
+  return codegenFromDrgn(drgnTypes, code, std::move(names));
+}
+
+bool CodeGen::codegenFromDrgn(std::span<struct drgn_type* const> drgnTypes,
+                              std::vector<RootFunctionName> names,
+                              size_t maxUnits,
+                              std::vector<std::string>& units) {
+  if (!buildTypeGraph(drgnTypes))
+    return false;
+
+  generateUnits(typeGraph_, units, std::move(names), maxUnits);
+  return true;
+}
+
+bool CodeGen::codegenFromDrgn(std::span<struct drgn_type* const> drgnTypes,
                               std::string& code,
-                              RootFunctionName name) {
+                              std::vector<RootFunctionName> names) {
+  if (!buildTypeGraph(drgnTypes))
+    return false;
+
+  generate(typeGraph_, code, std::move(names));
+  return true;
+}
+
+bool CodeGen::buildTypeGraph(std::span<struct drgn_type* const> drgnTypes) {
   if (!registerContainers())
     return false;
 
+  std::optional<std::string> cacheKey;
+  if (!typeGraphCacheDir_.empty())
+    cacheKey = typeGraphCacheKey(drgnTypes);
+  if (cacheKey && loadTypeGraph(*cacheKey))
+    return true;
+
   try {
-    addDrgnRoot(drgnType, typeGraph_);
+    addDrgnRoots(drgnTypes, typeGraph_);
   } catch (const type_graph::DrgnParserError& err) {
     LOG(ERROR) << "Error parsing DWARF: " << err.what();
     return false;
   }
 
   transform(typeGraph_);
-  generate(typeGraph_, code, std::move(name));
+  if (cacheKey)
+    storeTypeGraph(*cacheKey);
   return true;
 }
 
+std::optional<std::string> CodeGen::typeGraphCacheKey(
+    std::span<struct drgn_type* const> drgnTypes) const {
+  if (symbols_ == nullptr)
+    return std::nullopt;
+  auto buildID = symbols_->locateBuildID();
+  if (!buildID) {
+    LOG(WARNING) << "Failed to locate build ID, not caching the type graph";
+    return std::nullopt;
+  }
+
+  // Everything the passes depend on besides the DWARF itself
+  std::string key = *buildID + "\n" + config_.toString() + "\n";
+  for (const auto& path : config_.containerConfigPaths) {
+    std::error_code ec;
+    auto mtime = fs::last_write_time(path, ec);
+    key += path.string() + "@" +
+           std::to_string(mtime.time_since_epoch().count()) + ";";
+  }
+  key += "\n";
+  for (const auto& info : config_.passThroughTypes)
+    key += info.typeName + ";";
+  key += "\n";
+  for (const auto& k : config_.keysToCapture) {
+    key += k.type.value_or("") + "::" + k.member.value_or("") +
+           (k.topLevel ? "(top)" : "") + ";";
+  }
+  key += "\n";
+  for (auto* drgnType : drgnTypes)
+    key += SymbolService::getTypeName(drgnType) + ";";
+  return key;
+}
+
+fs::path CodeGen::typeGraphCachePath(const std::string& key) const {
+  return typeGraphCacheDir_ /
+         (std::to_string(std::hash<std::string>{}(key)) + ".tg");
+}
+
+bool CodeGen::loadTypeGraph(const std::string& key) {
+  metrics::Tracing _("type_graph_cache_load");
+  auto path = typeGraphCachePath(key);
+  std::ifstream in{path, std::ios::binary};
+  if (!in)
+    return false;
+
+  try {
+    // The full key guards against hash collisions
+    std::string cachedKey(key.size(), '\0');
+    if (!in.read(cachedKey.data(), static_cast<std::streamsize>(key.size())) ||
+        cachedKey != key || in.get() != '\0') {
+      LOG(INFO) << "Ignoring type graph cache " << path << " for another key";
+      return false;
+    }
+
+    TypeGraph typeGraph;
+    type_graph::deserialize(
+        in, typeGraph, [this](const std::string& typeName, bool captureKeys) {
+          return findContainerInfo(typeName, captureKeys);
+        });
+    typeGraph_ = std::move(typeGraph);
+  } catch (const type_graph::TypeGraphSerializerError& err) {
+    LOG(WARNING) << "Failed to load type graph cache " << path << ": "
+                 << err.what();
+    return false;
+  }
+
+  LOG(INFO) << "Loaded type graph from cache " << path;
+  return true;
+}
+
+void CodeGen::storeTypeGraph(const std::string& key) const {
+  metrics::Tracing _("type_graph_cache_store");
+  auto path = typeGraphCachePath(key);
+
+  // Write to a temporary file first so concurrent runs never read a partial
+  // graph
+  auto tmpPath = path;
+  tmpPath += ".tmp" + std::to_string(getpid());
+  std::error_code ec;
+  fs::create_directories(typeGraphCacheDir_, ec);
+  {
+    std::ofstream out{tmpPath, std::ios::binary | std::ios::trunc};
+    out.write(key.data(), static_cast<std::streamsize>(key.size()));
+    out.put('\0');
+    type_graph::serialize(typeGraph_, out);
+    if (!out) {
+      LOG(WARNING) << "Failed to write type graph cache " << tmpPath;
+      return;
+    }
+  }
+
+  fs::rename(tmpPath, path, ec);
+  if (ec) {
+    LOG(WARNING) << "Failed to store type graph cache " << path << ": "
+                 << ec.message();
+    fs::remove(tmpPath, ec);
+    return;
+  }
+  LOG(INFO) << "Stored type graph cache " << path;
+}
+
+const ContainerInfo* CodeGen::findContainerInfo(const std::string& typeName,
+                                                bool captureKeys) {
+  const ContainerInfo* found = nullptr;
+  for (const auto& info : containerInfos_) {
+    if (info->typeName == typeName && !info->captureKeys) {
+      found = info.get();
+      break;
+    }
+  }
+  if (!found) {
+    for (const auto& info : config_.passThroughTypes) {
+      if (info.typeName == typeName) {
+        found = &info;
+        break;
+      }
+    }
+  }
+  if (!found || !captureKeys)
+    return found;
+
+  // KeyCapture gives every captured container its own copy of the info, see
+  // KeyCapture::captureKey()
+  auto info = found->clone();
+  info.captureKeys = true;
+  containerInfos_.emplace_back(std::make_unique<ContainerInfo>(std::move(info)));
+  return containerInfos_.back().get();
+}
+
 void CodeGen::exportDrgnTypes(TypeHierarchy& th,
                               std::list<drgn_type>& drgnTypes,
                               drgn_type** rootType) const {
@@ -1261,17 +1564,29 @@ void CodeGen::registerContainer(const fs::path& path) {
 }
 
 void CodeGen::addDrgnRoot(struct drgn_type* drgnType, TypeGraph& typeGraph) {
-  DrgnParserOptions options{
+  addDrgnRoots({&drgnType, 1}, typeGraph);
+}
+
+DrgnParserOptions CodeGen::drgnParserOptions() const {
+  return DrgnParserOptions{
       .chaseRawPointers = config_.features[Feature::ChaseRawPointers],
   };
-  DrgnParser drgnParser{typeGraph, options};
-  Type& parsedRoot = drgnParser.parse(drgnType);
-  typeGraph.addRoot(parsedRoot);
 }
 
-void CodeGen::transform(TypeGraph& typeGraph) {
-  type_graph::PassManager pm;
+void CodeGen::addDrgnRoots(std::span<struct drgn_type* const> drgnTypes,
+                           TypeGraph& typeGraph) {
+  metrics::Tracing _("drgn_parse");
+  // Share one parser so that types reachable from several roots are only
+  // parsed once
+  DrgnParser drgnParser{typeGraph, drgnParserOptions()};
+  for (auto* drgnType : drgnTypes) {
+    Type& parsedRoot = drgnParser.parse(drgnType);
+    typeGraph.addRoot(parsedRoot);
+  }
+}
 
+void CodeGen::addTransformPasses(type_graph::PassManager& pm,
+                                 DrgnParser& drgnParser) {
   // Simplify the type graph first so there is less work for later passes
   pm.addPass(RemoveTopLevelPointer::createPass());
   pm.addPass(IdentifyContainers::createPass(containerInfos_));
@@ -1283,19 +1598,16 @@ void CodeGen::transform(TypeGraph& typeGraph) {
 
   if (config_.features[Feature::PolymorphicInheritance]) {
     // Parse new children nodes
-    DrgnParserOptions options{
-        .chaseRawPointers = config_.features[Feature::ChaseRawPointers],
-    };
-    DrgnParser drgnParser{typeGraph, options};
+    pm.addCheckpoint();
     pm.addPass(AddChildren::createPass(drgnParser, *symbols_));
 
-    // Re-run passes over newly added children
-    pm.addPass(IdentifyContainers::createPass(containerInfos_));
-    pm.addPass(Flattener::createPass());
-    pm.addPass(AlignmentCalc::createPass());
-    pm.addPass(TypeIdentifier::createPass(config_.passThroughTypes));
+    // Re-run passes over newly added children only
+    pm.addIncrementalPass(IdentifyContainers::createPass(containerInfos_));
+    pm.addIncrementalPass(Flattener::createPass());
+    pm.addIncrementalPass(AlignmentCalc::createPass());
+    pm.addIncrementalPass(TypeIdentifier::createPass(config_.passThroughTypes));
     if (config_.features[Feature::PruneTypeGraph])
-      pm.addPass(Prune::createPass());
+      pm.addIncrementalPass(Prune::createPass());
   }
 
   pm.addPass(RemoveMembers::createPass(config_.membersToStub));
@@ -1311,6 +1623,15 @@ void CodeGen::transform(TypeGraph& typeGraph) {
 
   pm.addPass(NameGen::createPass());
   pm.addPass(TopoSorter::createPass());
+}
+
+void CodeGen::transform(TypeGraph& typeGraph) {
+  metrics::Tracing _("transform");
+  type_graph::PassManager pm;
+
+  // Only used by AddChildren to parse new children nodes
+  DrgnParser drgnParser{typeGraph, drgnParserOptions()};
+  addTransformPasses(pm, drgnParser);
 
   pm.run(typeGraph);
 
@@ -1323,6 +1644,14 @@ void CodeGen::transform(TypeGraph& typeGraph) {
 void CodeGen::generate(TypeGraph& typeGraph,
                        std::string& code,
                        RootFunctionName rootName) {
+  generate(typeGraph, code, std::vector<RootFunctionName>{std::move(rootName)});
+}
+
+void CodeGen::generate(TypeGraph& typeGraph,
+                       std::string& code,
+                       std::vector<RootFunctionName> rootNames) {
+  metrics::Tracing _("generate");
+  assert(typeGraph.rootTypes().size() == rootNames.size());
   code = headers::oi_OITraceCode_cpp;
   if (!config_.features[Feature::Library]) {
     FuncGen::DeclareExterns(code);
@@ -1333,10 +1662,11 @@ void CodeGen::generate(TypeGraph& typeGraph,
   addIncludes(typeGraph, config_.features, code);
   defineInternalTypes(code);
   FuncGen::DefineJitLog(code, config_.features);
+  FuncGen::DefineJitProfiling(code, config_.features);
 
   if (config_.features[Feature::TreeBuilderV2]) {
     if (config_.features[Feature::Library]) {
-      FuncGen::DefineBackInserterDataBuffer(code);
+      FuncGen::DefineBackInserterDataBuffer(code, config_.features);
     } else {
       FuncGen::DefineDataSegmentDataBuffer(code);
     }
@@ -1353,6 +1683,9 @@ void CodeGen::generate(TypeGraph& typeGraph,
     code += "namespace {\n";
     code += "static struct Context {\n";
     code += "  PointerHashSet<> pointers;\n";
+    code += "  TraversalBudget budget;\n";
+    if (config_.features[Feature::JitProfiling])
+      code += "  OIInternal::ProfileState profile;\n";
     code += "} ctx;\n";
     code += "} // namespace\n";
   }
@@ -1374,58 +1707,97 @@ void CodeGen::generate(TypeGraph& typeGraph,
   }
   FuncGen::DeclareGetContainer(code);
 
-  genDecls(typeGraph, code);
-  genDefs(typeGraph, code);
-  genStaticAsserts(typeGraph, code);
+  // Bytes of code generated for each type in the graph, by section
+  std::vector<std::pair<std::string_view, size_t>> sectionBytes;
+  auto section = [&](std::string_view name, const auto& gen) {
+    size_t before = code.size();
+    gen();
+    sectionBytes.emplace_back(name, code.size() - before);
+  };
+
+  section("decls", [&] { genDecls(typeGraph, emitOptions_, code); });
+  section("defs", [&] { genDefs(typeGraph, emitOptions_, code); });
+  section("static_asserts",
+          [&] { genStaticAsserts(typeGraph, emitOptions_, code); });
   if (config_.features[Feature::TreeBuilderV2]) {
-    genNames(typeGraph, code);
-    genExclusiveSizes(typeGraph, code);
+    section("names", [&] { genNames(typeGraph, emitOptions_, code); });
+    section("exclusive_sizes",
+            [&] { genExclusiveSizes(typeGraph, emitOptions_, code); });
   }
 
   if (config_.features[Feature::TreeBuilderV2]) {
     FuncGen::DefineBasicTypeHandlers(code);
+    FuncGen::DefineDelegateElements(code, config_.features);
     addStandardTypeHandlers(typeGraph, config_.features, code);
-    addTypeHandlers(typeGraph, code);
+    section("type_handlers", [&] { addTypeHandlers(typeGraph, code); });
   } else {
     addStandardGetSizeFuncDecls(code);
-    addGetSizeFuncDecls(typeGraph, code);
+    section("get_size_decls", [&] { addGetSizeFuncDecls(typeGraph, code); });
 
     addStandardGetSizeFuncDefs(code);
-    addGetSizeFuncDefs(typeGraph, code);
+    section("get_size_defs", [&] { addGetSizeFuncDefs(typeGraph, code); });
   }
 
-  assert(typeGraph.rootTypes().size() == 1);
-  Type& rootType = typeGraph.rootTypes()[0];
-  code += "\nusing __ROOT_TYPE__ = " + rootType.name() + ";\n";
-  code += "} // namespace\n} // namespace OIInternal\n";
-
-  const auto& typeToHash = std::visit(
-      [](const auto& v) -> const std::string& {
-        using T = std::decay_t<decltype(v)>;
-        if constexpr (std::is_same_v<ExactName, T> ||
-                      std::is_same_v<HashedComponent, T>) {
-          return v.name;
-        } else {
-          static_assert(always_false_v<T>, "missing visit");
-        }
-      },
-      rootName);
+  auto typeToHash = [](const RootFunctionName& rootName) -> const std::string& {
+    return std::visit(
+        [](const auto& v) -> const std::string& {
+          using T = std::decay_t<decltype(v)>;
+          if constexpr (std::is_same_v<ExactName, T> ||
+                        std::is_same_v<HashedComponent, T>) {
+            return v.name;
+          } else {
+            static_assert(always_false_v<T>, "missing visit");
+          }
+        },
+        rootName);
+  };
 
+  code += "\n";
   if (config_.features[Feature::TreeBuilderV2]) {
-    FuncGen::DefineTopLevelIntrospect(code, typeToHash);
+    // Each entry point refers to its root through an alias of its own
+    for (size_t i = 0; i < rootNames.size(); i++) {
+      code += (boost::format("using __ROOT_TYPE_%1$016x__ = %2%;\n") %
+               std::hash<std::string>{}(typeToHash(rootNames[i])) %
+               typeGraph.rootTypes()[i].get().name())
+                  .str();
+    }
   } else {
-    FuncGen::DefineTopLevelGetSizeRef(code, typeToHash, config_.features);
+    assert(typeGraph.rootTypes().size() == 1);
+    code += "using __ROOT_TYPE__ = " + typeGraph.rootTypes()[0].get().name() +
+            ";\n";
   }
+  code += "} // namespace\n} // namespace OIInternal\n";
 
-  if (config_.features[Feature::TreeBuilderV2]) {
-    FuncGen::DefineTreeBuilderInstructions(code,
-                                           typeToHash,
-                                           calculateExclusiveSize(rootType),
-                                           enumerateTypeNames(rootType));
+  for (size_t i = 0; i < rootNames.size(); i++) {
+    const auto& rootName = rootNames[i];
+    Type& rootType = typeGraph.rootTypes()[i];
+
+    if (config_.features[Feature::TreeBuilderV2]) {
+      FuncGen::DefineTopLevelIntrospect(
+          code, typeToHash(rootName), config_.features);
+    } else {
+      FuncGen::DefineTopLevelGetSizeRef(
+          code, typeToHash(rootName), config_.features);
+    }
+
+    if (config_.features[Feature::TreeBuilderV2]) {
+      FuncGen::DefineTreeBuilderInstructions(code,
+                                             typeToHash(rootName),
+                                             calculateExclusiveSize(rootType),
+                                             enumerateTypeNames(rootType));
+    }
+
+    if (auto* n = std::get_if<ExactName>(&rootName))
+      FuncGen::DefineTopLevelIntrospectNamed(
+          code, typeToHash(rootName), n->name);
   }
 
-  if (auto* n = std::get_if<ExactName>(&rootName))
-    FuncGen::DefineTopLevelIntrospectNamed(code, typeToHash, n->name);
+  metrics::Tracing::counter("generated_code_bytes", code.size());
+  for (const auto& [name, bytes] : sectionBytes) {
+    metrics::Tracing::counter("generated_code_bytes_" + std::string{name},
+                              bytes);
+    VLOG(1) << "Generated " << bytes << " bytes of " << name;
+  }
 
   if (VLOG_IS_ON(3)) {
     VLOG(3) << "Generated trace code:\n";
@@ -1434,4 +1806,103 @@ void CodeGen::generate(TypeGraph& typeGraph,
   }
 }
 
+void CodeGen::generateUnits(TypeGraph& typeGraph,
+                            std::vector<std::string>& units,
+                            std::vector<RootFunctionName> rootNames,
+                            size_t maxUnits) {
+  auto& roots = typeGraph.rootTypes();
+  assert(roots.size() == rootNames.size());
+
+  // Every unit parses the whole prelude again, so only add one per
+  // minTypesPerUnit distinct types
+  size_t numTypes = typeGraph.finalTypes.size();
+  size_t minTypes = std::max<size_t>(emitOptions_.minTypesPerUnit, 1);
+  size_t numUnits = std::min({maxUnits, roots.size(), numTypes / minTypes});
+  auto generateOne = [&] {
+    units.resize(1);
+    generate(typeGraph, units[0], std::move(rootNames));
+  };
+  if (numUnits <= 1) {
+    generateOne();
+    return;
+  }
+
+  metrics::Tracing _("generate_units");
+
+  // Hand out the largest roots first. Each goes to the unit where it costs the
+  // least, counting both the unit's size and the types the root adds to it, so
+  // that roots sharing types tend to end up together.
+  std::vector<std::vector<ref<Type>>> rootTypes;
+  rootTypes.reserve(roots.size());
+  for (Type& root : roots) {
+    TopoSorter sorter;
+    sorter.sort({root});
+    rootTypes.push_back(sorter.sortedTypes());
+  }
+  std::vector<size_t> order(roots.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+    return rootTypes[l].size() > rootTypes[r].size();
+  });
+
+  std::vector<std::unordered_set<const Type*>> unitTypes(numUnits);
+  std::vector<std::vector<size_t>> unitRoots(numUnits);
+  for (size_t root : order) {
+    size_t best = 0;
+    size_t bestCost = SIZE_MAX;
+    for (size_t unit = 0; unit < numUnits; unit++) {
+      size_t added = 0;
+      for (const Type& t : rootTypes[root])
+        added += unitTypes[unit].count(&t) == 0;
+      size_t cost = unitTypes[unit].size() + 2 * added;
+      if (cost < bestCost) {
+        best = unit;
+        bestCost = cost;
+      }
+    }
+    for (const Type& t : rootTypes[root])
+      unitTypes[best].insert(&t);
+    unitRoots[best].push_back(root);
+  }
+  std::erase_if(unitRoots, [](const auto& r) { return r.empty(); });
+  numUnits = unitRoots.size();
+
+  // Types shared between units are generated in each of them. Don't split if
+  // the roots overlap so much that it would mostly repeat the same work.
+  size_t splitTypes = 0;
+  for (const auto& types : unitTypes)
+    splitTypes += types.size();
+  if (numUnits <= 1 || splitTypes * 2 > numTypes * 3) {
+    generateOne();
+    return;
+  }
+
+  // generate() works on the whole graph, so point it at each unit's roots and
+  // the types they reach in turn. Types shared between units are generated
+  // in each of them with internal linkage, only the entry points are global.
+  auto allRoots = std::move(roots);
+  auto allTypes = std::move(typeGraph.finalTypes);
+  units.assign(numUnits, {});
+  for (size_t unit = 0; unit < numUnits; unit++) {
+    std::sort(unitRoots[unit].begin(), unitRoots[unit].end());
+    std::vector<ref<Type>> unitRootTypes;
+    std::vector<RootFunctionName> unitNames;
+    for (size_t root : unitRoots[unit]) {
+      unitRootTypes.push_back(allRoots[root]);
+      unitNames.push_back(rootNames[root]);
+    }
+
+    TopoSorter sorter;
+    sorter.sort(unitRootTypes);
+    typeGraph.rootTypes() = std::move(unitRootTypes);
+    typeGraph.finalTypes = sorter.sortedTypes();
+
+    // Each unit defines the handlers of the containers it uses
+    definedContainers_.clear();
+    generate(typeGraph, units[unit], std::move(unitNames));
+  }
+  typeGraph.rootTypes() = std::move(allRoots);
+  typeGraph.finalTypes = std::move(allTypes);
+}
+
 }  // namespace oi::detail
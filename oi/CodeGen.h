@@ -19,7 +19,10 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -34,7 +37,10 @@ class SymbolService;
 }
 namespace oi::detail::type_graph {
 class Class;
+class DrgnParser;
+struct DrgnParserOptions;
 class Member;
+class PassManager;
 }  // namespace oi::detail::type_graph
 
 namespace oi::detail {
@@ -62,6 +68,45 @@ class CodeGen {
   bool codegenFromDrgn(struct drgn_type* drgnType,
                        std::string linkageName,
                        std::string& code);
+  /*
+   * Generates a single translation unit with an entry point for each of the
+   * given types. Types shared between the roots are only generated once.
+   */
+  bool codegenFromDrgn(std::span<struct drgn_type* const> drgnTypes,
+                       std::string& code);
+  /*
+   * Like the above, but splits the roots between up to `maxUnits` translation
+   * units which can be compiled concurrently and relocated together. Each root
+   * is named by the matching element of `names`, which must be unique. The
+   * split is by root only: a single root is always generated as one unit.
+   */
+  bool codegenFromDrgn(std::span<struct drgn_type* const> drgnTypes,
+                       std::vector<RootFunctionName> names,
+                       size_t maxUnits,
+                       std::vector<std::string>& units);
+  /*
+   * Caches transformed type graphs in `dir`, keyed by the target's build ID,
+   * the root types and the config. codegenFromDrgn() loads a cached graph
+   * rather than parsing DWARF and running the passes again.
+   */
+  void setTypeGraphCacheDir(std::filesystem::path dir) {
+    typeGraphCacheDir_ = std::move(dir);
+  }
+
+  /*
+   * generate() emits the code for each type on up to `maxThreads` threads,
+   * giving each at least `minTypesPerThread` types. Smaller graphs are emitted
+   * on the calling thread. generateUnits() adds a translation unit for at
+   * most every `minTypesPerUnit` types.
+   */
+  struct EmitOptions {
+    size_t maxThreads = std::thread::hardware_concurrency();
+    size_t minTypesPerThread = 512;
+    size_t minTypesPerUnit = 256;
+  };
+  void setEmitOptions(EmitOptions options) {
+    emitOptions_ = options;
+  }
   void exportDrgnTypes(TypeHierarchy& th,
                        std::list<drgn_type>& drgnTypes,
                        drgn_type** rootType) const;
@@ -69,12 +114,45 @@ class CodeGen {
   bool registerContainers();
   void registerContainer(std::unique_ptr<ContainerInfo> containerInfo);
   void registerContainer(const std::filesystem::path& path);
+  /*
+   * The options the type graph is parsed with, derived from the config.
+   */
+  type_graph::DrgnParserOptions drgnParserOptions() const;
   void addDrgnRoot(struct drgn_type* drgnType,
                    type_graph::TypeGraph& typeGraph);
+  void addDrgnRoots(std::span<struct drgn_type* const> drgnTypes,
+                    type_graph::TypeGraph& typeGraph);
+  /*
+   * Adds the passes run by transform() to the given PassManager. Exposed so
+   * that the passes can be driven individually, e.g. for benchmarking.
+   */
+  void addTransformPasses(type_graph::PassManager& pm,
+                          type_graph::DrgnParser& drgnParser);
   void transform(type_graph::TypeGraph& typeGraph);
   void generate(type_graph::TypeGraph& typeGraph,
                 std::string& code,
                 RootFunctionName rootName);
+  /*
+   * Generates an entry point for each root type in the type graph, named by
+   * the matching element of rootNames.
+   */
+  void generate(type_graph::TypeGraph& typeGraph,
+                std::string& code,
+                std::vector<RootFunctionName> rootNames);
+  /*
+   * Splits the roots between up to `maxUnits` translation units of similar
+   * size, so that they can be compiled concurrently. A root's handlers are
+   * never split between units, so a graph with one root is always generated
+   * as a single unit however large it is. Each unit is generated as
+   * by generate(), from only the types reachable from its own roots, so types
+   * shared between units are generated in each. Roots sharing types are kept
+   * together, and a single unit is generated if the graph is too small to be
+   * worth splitting or if its roots overlap too much.
+   */
+  void generateUnits(type_graph::TypeGraph& typeGraph,
+                     std::vector<std::string>& units,
+                     std::vector<RootFunctionName> rootNames,
+                     size_t maxUnits);
 
  private:
   type_graph::TypeGraph typeGraph_;
@@ -84,10 +162,22 @@ class CodeGen {
   std::unordered_set<const ContainerInfo*> definedContainers_;
   std::unordered_map<const type_graph::Class*, const type_graph::Member*>
       thriftIssetMembers_;
+  std::filesystem::path typeGraphCacheDir_;
+  EmitOptions emitOptions_;
 
-  bool codegenFromDrgn(struct drgn_type* drgnType,
+  bool codegenFromDrgn(std::span<struct drgn_type* const> drgnTypes,
                        std::string& code,
-                       RootFunctionName name);
+                       std::vector<RootFunctionName> names);
+  /* Parses and transforms the roots into typeGraph_, or loads it from cache */
+  bool buildTypeGraph(std::span<struct drgn_type* const> drgnTypes);
+
+  std::optional<std::string> typeGraphCacheKey(
+      std::span<struct drgn_type* const> drgnTypes) const;
+  std::filesystem::path typeGraphCachePath(const std::string& key) const;
+  bool loadTypeGraph(const std::string& key);
+  void storeTypeGraph(const std::string& key) const;
+  const ContainerInfo* findContainerInfo(const std::string& typeName,
+                                         bool captureKeys);
 
   void genDefsThrift(const type_graph::TypeGraph& typeGraph, std::string& code);
   void addGetSizeFuncDefs(const type_graph::TypeGraph& typeGraph,
@@ -99,11 +189,14 @@ class CodeGen {
   void addTypeHandlers(const type_graph::TypeGraph& typeGraph,
                        std::string& code);
 
-  void genClassTypeHandler(const type_graph::Class& c, std::string& code);
-  void genClassStaticType(const type_graph::Class& c, std::string& code);
-  void genClassTraversalFunction(const type_graph::Class& c, std::string& code);
+  // Called for many types at once by addTypeHandlers(), must not modify
+  // any state.
+  void genClassTypeHandler(const type_graph::Class& c, std::string& code) const;
+  void genClassStaticType(const type_graph::Class& c, std::string& code) const;
+  void genClassTraversalFunction(const type_graph::Class& c,
+                                 std::string& code) const;
   void genClassTreeBuilderInstructions(const type_graph::Class& c,
-                                       std::string& code);
+                                       std::string& code) const;
 };
 
 }  // namespace oi::detail
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDED_OI_CONCURRENTPOINTERSET_H
+#define INCLUDED_OI_CONCURRENTPOINTERSET_H 1
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace oi::detail {
+
+/*
+ * ConcurrentPointerSet
+ *
+ * An insert-only set of pointers which many threads may add to at once
+ * without locking. It has the same contract as PointerHashSet: `add()` returns
+ * `true` only if the pointer was newly added, and `false` if it was already
+ * present, was null or if there is no room left.
+ *
+ * The set is a sequence of open addressing tables, "levels", each twice the
+ * size of the last. A pointer belongs to the first level whose probe window,
+ * the kProbeWindow slots starting at its hash, holds it or has an empty slot.
+ * Slots only ever go from empty to full, by CAS, and a full window stays full.
+ * Every thread probing for a pointer therefore agrees on where it belongs, and
+ * spilling into the next level needs no coordination with other writers.
+ *
+ * Each level is mapped by the first thread to spill into it. Threads racing to
+ * map the same level publish theirs by CAS and the losers unmap their own, so
+ * a set that stays small only maps its first level.
+ * This header is included by the JIT code so must stay self contained.
+ */
+class ConcurrentPointerSet {
+ public:
+  // 1 MiB of pointers in the first level
+  static constexpr size_t kDefaultInitialSlots = (1 << 20) / sizeof(uintptr_t);
+  static constexpr size_t kDefaultLevels = 8;
+  static constexpr size_t kMaxLevels = 32;
+
+  explicit ConcurrentPointerSet(size_t initialSlots = kDefaultInitialSlots,
+                                size_t levels = kDefaultLevels) noexcept
+      : initialSlots(roundUpPow2(initialSlots < kProbeWindow ? kProbeWindow
+                                                             : initialSlots)),
+        levels(levels < kMaxLevels ? levels : kMaxLevels),
+        totalSlots(this->initialSlots * ((size_t{1} << this->levels) - 1)) {
+    for (auto& level : levelSlots)
+      level.store(nullptr, std::memory_order_relaxed);
+    for (auto& c : counts)
+      c.n.store(0, std::memory_order_relaxed);
+    // Map the first level up front, as every traversal needs it
+    if (this->levels != 0 && getLevel(0) == nullptr) {
+      totalSlots = 0;
+      this->levels = 0;
+    }
+  }
+
+  ~ConcurrentPointerSet() {
+    for (size_t l = 0; l < levels; l++) {
+      if (Slot* level = levelSlots[l].load(std::memory_order_relaxed))
+        munmap(level, levelBytes(l));
+    }
+  }
+
+  ConcurrentPointerSet(const ConcurrentPointerSet&) = delete;
+  ConcurrentPointerSet& operator=(const ConcurrentPointerSet&) = delete;
+
+  /*
+   * Empties the set. Must not run concurrently with `add()`.
+   */
+  void initialize() noexcept {
+    // Dropping the pages of a private anonymous mapping zeroes them
+    for (size_t l = 0; l < levels; l++) {
+      if (Slot* level = levelSlots[l].load(std::memory_order_relaxed))
+        madvise(level, levelBytes(l), MADV_DONTNEED);
+    }
+    for (auto& c : counts)
+      c.n.store(0, std::memory_order_relaxed);
+  }
+
+  bool add(uintptr_t pointer) noexcept {
+    if (pointer == 0) {
+      return false;
+    }
+
+    uint64_t hash = twang_mix64(pointer);
+    for (size_t l = 0; l < levels; l++) {
+      Slot* level = getLevel(l);
+      if (level == nullptr) {
+        return false;
+      }
+      size_t mask = (initialSlots << l) - 1;
+      for (size_t i = 0; i < kProbeWindow; i++) {
+        Slot& slot = level[(hash + i) & mask];
+        uintptr_t entry = slot.load(std::memory_order_acquire);
+        if (entry == 0) {
+          if (slot.compare_exchange_strong(entry,
+                                           pointer,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+            counts[hash % kCountStripes].n.fetch_add(
+                1, std::memory_order_relaxed);
+            return true;
+          }
+          // Lost the race for this slot, `entry` now holds the winner
+        }
+        if (entry == pointer) {
+          return false;
+        }
+      }
+    }
+    return false;
+  }
+
+  bool add(const auto* p) noexcept {
+    return add((uintptr_t)p);
+  }
+
+  size_t size() const noexcept {
+    size_t n = 0;
+    for (const auto& c : counts)
+      n += c.n.load(std::memory_order_relaxed);
+    return n;
+  }
+
+  size_t capacity() const noexcept {
+    return totalSlots;
+  }
+
+  /*
+   * The slots of the levels mapped so far.
+   */
+  size_t mappedSlots() const noexcept {
+    size_t n = 0;
+    for (size_t l = 0; l < levels; l++) {
+      if (levelSlots[l].load(std::memory_order_relaxed) != nullptr)
+        n += initialSlots << l;
+    }
+    return n;
+  }
+
+ private:
+  using Slot = std::atomic<uintptr_t>;
+
+  static constexpr size_t kProbeWindow = 16;
+  // Spread the element count over cache lines to avoid contention on it
+  static constexpr size_t kCountStripes = 64;
+
+  struct alignas(64) Counter {
+    std::atomic<size_t> n;
+  };
+
+  /*
+   * twang_mix64 hash function, taken from Folly where it is used as the
+   * default hash function for 64-bit integers.
+   */
+  static constexpr uint64_t twang_mix64(uint64_t key) noexcept {
+    key = (~key) + (key << 21);  // key *= (1 << 21) - 1; key -= 1;
+    key = key ^ (key >> 24);
+    key = key + (key << 3) + (key << 8);  // key *= 1 + (1 << 3) + (1 << 8)
+    key = key ^ (key >> 14);
+    key = key + (key << 2) + (key << 4);  // key *= 1 + (1 << 2) + (1 << 4)
+    key = key ^ (key >> 28);
+    key = key + (key << 31);  // key *= 1 + (1 << 31)
+    return key;
+  }
+
+  static constexpr size_t roundUpPow2(size_t n) noexcept {
+    size_t p = 1;
+    while (p < n)
+      p <<= 1;
+    return p;
+  }
+
+  size_t levelBytes(size_t l) const noexcept {
+    return (initialSlots << l) * sizeof(Slot);
+  }
+
+  /*
+   * Returns level `l`, mapping it if no thread has yet. Returns nullptr if it
+   * can't be mapped.
+   */
+  Slot* getLevel(size_t l) noexcept {
+    Slot* level = levelSlots[l].load(std::memory_order_acquire);
+    if (level != nullptr) {
+      return level;
+    }
+
+    void* mem = mmap(nullptr,
+                     levelBytes(l),
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                     -1,
+                     0);
+    if (mem == MAP_FAILED) {
+      return nullptr;
+    }
+    if (!levelSlots[l].compare_exchange_strong(level,
+                                               static_cast<Slot*>(mem),
+                                               std::memory_order_acq_rel,
+                                               std::memory_order_acquire)) {
+      // Another thread mapped it first, `level` now holds theirs
+      munmap(mem, levelBytes(l));
+      return level;
+    }
+    return static_cast<Slot*>(mem);
+  }
+
+  std::atomic<Slot*> levelSlots[kMaxLevels];
+  size_t initialSlots;
+  size_t levels;
+  size_t totalSlots;
+  Counter counts[kCountStripes];
+};
+
+}  // namespace oi::detail
+
+#endif
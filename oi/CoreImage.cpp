@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "oi/CoreImage.h"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <boost/scope_exit.hpp>
+#include <cerrno>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+namespace oi::detail {
+namespace {
+
+template <typename T>
+bool readAt(int fd, T* out, size_t count, off_t offset) {
+  auto len = static_cast<ssize_t>(count * sizeof(T));
+  return pread(fd, out, len, offset) == len;
+}
+
+struct FileMapping {
+  uintptr_t start;
+  uintptr_t end;
+  off_t offset;
+  std::string name;
+};
+
+/*
+ * The NT_FILE note holds a count and a page size, then a (start, end, offset in
+ * pages) triple per mapped file, then the files' NUL terminated names.
+ */
+std::vector<FileMapping> parseFileNote(const char* desc, size_t size) {
+  constexpr size_t wordSize = sizeof(uint64_t);
+  if (size < 2 * wordSize) {
+    return {};
+  }
+
+  uint64_t count = 0;
+  uint64_t pageSize = 0;
+  memcpy(&count, desc, wordSize);
+  memcpy(&pageSize, desc + wordSize, wordSize);
+
+  const char* entries = desc + 2 * wordSize;
+  const char* end = desc + size;
+  if (count > static_cast<size_t>(end - entries) / (3 * wordSize)) {
+    return {};
+  }
+
+  std::vector<FileMapping> files;
+  files.reserve(count);
+  const char* name = entries + count * 3 * wordSize;
+  for (uint64_t i = 0; i < count; i++) {
+    uint64_t entry[3];
+    memcpy(entry, entries + i * sizeof(entry), sizeof(entry));
+
+    const auto* nameEnd =
+        static_cast<const char*>(memchr(name, '\0', end - name));
+    if (nameEnd == nullptr) {
+      return {};
+    }
+
+    files.push_back({entry[0],
+                     entry[1],
+                     static_cast<off_t>(entry[2] * pageSize),
+                     std::string(name, nameEnd)});
+    name = nameEnd + 1;
+  }
+
+  return files;
+}
+
+int segmentProt(const Elf64_Phdr& phdr) {
+  return ((phdr.p_flags & PF_R) ? PROT_READ : 0) |
+         ((phdr.p_flags & PF_W) ? PROT_WRITE : 0) |
+         ((phdr.p_flags & PF_X) ? PROT_EXEC : 0);
+}
+
+/*
+ * User space ends below this on every supported architecture, even with 5-level
+ * paging. Segments above it, e.g. x86-64's vsyscall page, are the kernel's.
+ */
+constexpr uintptr_t userSpaceEnd = uintptr_t{1} << 56;
+
+/* Maps [addr, addr + len) from `fd`, or zeros if `fd` is -1 */
+bool mapFixed(uintptr_t addr, size_t len, int prot, int fd, off_t offset) {
+  int flags = MAP_PRIVATE | MAP_FIXED_NOREPLACE;
+  if (fd == -1) {
+    flags |= MAP_ANONYMOUS;
+    offset = 0;
+  }
+
+  void* res = mmap(reinterpret_cast<void*>(addr), len, prot, flags, fd, offset);
+  if (res == MAP_FAILED) {
+    int err = errno;
+    PLOG(ERROR) << "Failed to map core segment at " << (void*)addr;
+    errno = err;
+    return false;
+  }
+
+  if (res != reinterpret_cast<void*>(addr)) {
+    // Kernels before 4.17 take MAP_FIXED_NOREPLACE as a hint
+    munmap(res, len);
+    LOG(ERROR) << "Core segment at " << (void*)addr
+               << " overlaps an existing mapping";
+    errno = EEXIST;
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Maps [addr, addr + len) read only, holding `count` bytes of `fd` from
+ * `offset` followed by zeros, or only zeros if `fd` is -1. mmap() needs a page
+ * aligned offset, which cores don't promise, so contents at other offsets are
+ * read into an anonymous mapping instead.
+ */
+bool mapContents(
+    uintptr_t addr, size_t len, int fd, off_t offset, size_t count) {
+  if (fd == -1 || offset % getpagesize() == 0) {
+    return mapFixed(addr, len, PROT_READ, fd, offset);
+  }
+
+  if (!mapFixed(addr, len, PROT_READ | PROT_WRITE, -1, 0)) {
+    return false;
+  }
+
+  auto* dst = reinterpret_cast<char*>(addr);
+  count = std::min(count, len);
+  size_t done = 0;
+  while (done < count) {
+    ssize_t n = pread(fd, dst + done, count - done, offset + done);
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n == -1) {
+      PLOG(ERROR) << "Failed to read core segment at " << (void*)addr;
+      return false;
+    }
+    if (n == 0) {
+      break;  // The file is truncated, the rest reads as zeros
+    }
+    done += n;
+  }
+
+  if (mprotect(dst, len, PROT_READ) == -1) {
+    PLOG(ERROR) << "Failed to protect core segment at " << (void*)addr;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::optional<CoreImage> CoreImage::open(const fs::path& corePath) {
+  int fd = ::open(corePath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    PLOG(ERROR) << "Failed to open core " << corePath;
+    return std::nullopt;
+  }
+  BOOST_SCOPE_EXIT_ALL(&) {
+    close(fd);
+  };
+
+  Elf64_Ehdr ehdr;
+  if (!readAt(fd, &ehdr, 1, 0) || memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 ||
+      ehdr.e_ident[EI_CLASS] != ELFCLASS64 || ehdr.e_type != ET_CORE) {
+    LOG(ERROR) << corePath << " isn't a 64-bit ELF core dump";
+    return std::nullopt;
+  }
+
+  size_t phnum = ehdr.e_phnum;
+  if (phnum == PN_XNUM) {
+    // Too many segments for e_phnum, the first section header has the count
+    Elf64_Shdr shdr;
+    if (!readAt(fd, &shdr, 1, ehdr.e_shoff)) {
+      LOG(ERROR) << "Failed to read the segment count of " << corePath;
+      return std::nullopt;
+    }
+    phnum = shdr.sh_info;
+  }
+
+  std::vector<Elf64_Phdr> phdrs(phnum);
+  if (!readAt(fd, phdrs.data(), phnum, ehdr.e_phoff)) {
+    LOG(ERROR) << "Failed to read the program headers of " << corePath;
+    return std::nullopt;
+  }
+
+  std::vector<FileMapping> files;
+  for (const auto& phdr : phdrs) {
+    if (phdr.p_type != PT_NOTE) {
+      continue;
+    }
+
+    std::vector<char> notes(phdr.p_filesz);
+    if (!readAt(fd, notes.data(), notes.size(), phdr.p_offset)) {
+      LOG(ERROR) << "Failed to read the notes of " << corePath;
+      return std::nullopt;
+    }
+
+    // Names and descriptions are padded to 4 bytes
+    auto align = [](size_t n) { return (n + 3) & ~size_t{3}; };
+    size_t off = 0;
+    while (off + sizeof(Elf64_Nhdr) <= notes.size()) {
+      Elf64_Nhdr nhdr;
+      memcpy(&nhdr, notes.data() + off, sizeof(nhdr));
+      off += sizeof(nhdr) + align(nhdr.n_namesz);
+      size_t descOff = off;
+      off += align(nhdr.n_descsz);
+      if (off > notes.size()) {
+        break;
+      }
+
+      if (nhdr.n_type == NT_FILE) {
+        files = parseFileNote(notes.data() + descOff, nhdr.n_descsz);
+      }
+    }
+  }
+
+  CoreImage image{corePath};
+  for (const auto& phdr : phdrs) {
+    if (phdr.p_type != PT_LOAD || phdr.p_memsz == 0) {
+      continue;
+    }
+
+    Segment seg{
+        .start = phdr.p_vaddr,
+        .size = phdr.p_memsz,
+        .prot = segmentProt(phdr),
+        .coreSize = phdr.p_filesz,
+        .coreOffset = static_cast<off_t>(phdr.p_offset),
+        .file = {},
+        .fileOffset = 0,
+    };
+
+    auto file = std::find_if(files.begin(), files.end(), [&](const auto& f) {
+      return f.start <= seg.start && seg.start < f.end;
+    });
+    if (file != files.end()) {
+      seg.file = file->name;
+      seg.fileOffset = file->offset + static_cast<off_t>(seg.start - file->start);
+    }
+
+    image.segments_.push_back(std::move(seg));
+  }
+
+  VLOG(1) << "Core " << corePath << " has " << image.segments_.size()
+          << " segments and " << files.size() << " mapped files";
+  return image;
+}
+
+bool CoreImage::map() const {
+  int coreFd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (coreFd == -1) {
+    PLOG(ERROR) << "Failed to open core " << path_;
+    return false;
+  }
+  BOOST_SCOPE_EXIT_ALL(&) {
+    close(coreFd);
+  };
+
+  size_t pageSize = getpagesize();
+  for (const auto& seg : segments_) {
+    if (seg.prot == PROT_NONE) {
+      continue;  // Guard pages, nothing can be read there
+    }
+    if (seg.start >= userSpaceEnd || seg.size > userSpaceEnd - seg.start) {
+      VLOG(1) << "Skipping core segment at " << (void*)seg.start
+              << " outside of user space";
+      continue;
+    }
+
+    size_t saved = (seg.coreSize + pageSize - 1) & ~(pageSize - 1);
+    saved = std::min(saved, seg.size);
+    if (saved > 0 &&
+        !mapContents(
+            seg.start, saved, coreFd, seg.coreOffset, seg.coreSize)) {
+      return false;
+    }
+    if (saved == seg.size) {
+      continue;
+    }
+
+    // The core left this part out, map it from its file or make it zeros
+    int fileFd = -1;
+    if (!seg.file.empty()) {
+      fileFd = ::open(seg.file.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fileFd == -1) {
+        PLOG(WARNING) << "Failed to open " << seg.file
+                      << ", its mapping will read as zeros";
+      }
+    }
+
+    bool mapped = mapContents(seg.start + saved,
+                              seg.size - saved,
+                              fileFd,
+                              seg.fileOffset + saved,
+                              seg.size - saved);
+    if (fileFd != -1) {
+      close(fileFd);
+    }
+    if (!mapped) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace oi::detail
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace oi::detail {
+
+/*
+ * The address space of a process as saved in a core dump, e.g. by gcore.
+ *
+ * Each PT_LOAD segment of the core becomes a Segment. Cores usually leave out
+ * the contents of read-only file mappings, such as the executable's text. The
+ * core's NT_FILE note tells which file was mapped there, so the missing part
+ * can be mapped from the file instead, if it still exists.
+ */
+class CoreImage {
+ public:
+  struct Segment {
+    uintptr_t start;
+    size_t size;
+    int prot;  // PROT_* flags of the mapping in the dumped process
+
+    /* Length and offset in the core of the segment's saved contents */
+    size_t coreSize;
+    off_t coreOffset;
+
+    /* The file mapped at the segment, if the core names one */
+    std::string file;
+    off_t fileOffset;
+  };
+
+  static std::optional<CoreImage> open(const std::filesystem::path& corePath);
+
+  const std::filesystem::path& path() const {
+    return path_;
+  }
+  const std::vector<Segment>& segments() const {
+    return segments_;
+  }
+
+  /*
+   * Maps every segment at its address in the calling process, read only. This
+   * is meant for oid_sandbox, which runs code against the image: it fails
+   * rather than replace any existing mapping, with errno set to EEXIST when a
+   * segment overlaps one. Segments outside of user space, such as the vsyscall
+   * page, are left out.
+   */
+  bool map() const;
+
+ private:
+  explicit CoreImage(std::filesystem::path path) : path_{std::move(path)} {
+  }
+
+  std::filesystem::path path_;
+  std::vector<Segment> segments_;
+};
+
+}  // namespace oi::detail
@@ -52,6 +52,15 @@ std::optional<std::string_view> featureHelp(Feature f) {
       return "Follow polymorphic inheritance hierarchies in the probed object.";
     case Feature::JitTiming:
       return "Instrument the JIT code with timing for performance testing.";
+    case Feature::JitProfiling:
+      return "Profile the cycles spent traversing each type in the JIT code.";
+    case Feature::ParallelTraversal:
+      return std::nullopt;  // OIL only
+    case Feature::DeltaPointers:
+      return std::nullopt;  // OIL only
+    case Feature::Agent:
+      return "Run global probes from an agent thread in the target process, "
+             "without stopping it.";
 
     case Feature::UnknownFeature:
       throw std::runtime_error("should not ask for help for UnknownFeature!");
@@ -66,6 +75,15 @@ std::span<const Feature> requirements(Feature f) {
     case Feature::Library:
       static constexpr std::array lib = {Feature::TreeBuilderV2};
       return lib;
+    case Feature::JitProfiling:
+      static constexpr std::array prof = {Feature::TypeGraph};
+      return prof;
+    case Feature::ParallelTraversal:
+      static constexpr std::array par = {Feature::Library};
+      return par;
+    case Feature::DeltaPointers:
+      static constexpr std::array delta = {Feature::Library};
+      return delta;
     default:
       return {};
   }
@@ -77,6 +95,14 @@ std::span<const Feature> conflicts(Feature f) {
       static constexpr std::array lib = {Feature::JitLogging,
                                          Feature::JitTiming};
       return lib;
+    case Feature::DeltaPointers:
+      // Each worker would start its deltas from scratch in its own buffer
+      static constexpr std::array delta = {Feature::ParallelTraversal};
+      return delta;
+    case Feature::Agent:
+      // The agent runs probes without oid attached to collect the logs
+      static constexpr std::array agent = {Feature::JitLogging};
+      return agent;
     default:
       return {};
   }
@@ -22,19 +22,23 @@
 
 #include "oi/EnumBitset.h"
 
-#define OI_FEATURE_LIST                         \
-  X(ChaseRawPointers, "chase-raw-pointers")     \
-  X(PackStructs, "pack-structs")                \
-  X(GenPaddingStats, "gen-padding-stats")       \
-  X(CaptureThriftIsset, "capture-thrift-isset") \
-  X(TypeGraph, "type-graph")                    \
-  X(PruneTypeGraph, "prune-type-graph")         \
-  X(Library, "library")                         \
-  X(TreeBuilderV2, "tree-builder-v2")           \
-  X(GenJitDebug, "gen-jit-debug")               \
-  X(JitLogging, "jit-logging")                  \
-  X(JitTiming, "jit-timing")                    \
-  X(PolymorphicInheritance, "polymorphic-inheritance")
+#define OI_FEATURE_LIST                                \
+  X(ChaseRawPointers, "chase-raw-pointers")            \
+  X(PackStructs, "pack-structs")                       \
+  X(GenPaddingStats, "gen-padding-stats")              \
+  X(CaptureThriftIsset, "capture-thrift-isset")        \
+  X(TypeGraph, "type-graph")                           \
+  X(PruneTypeGraph, "prune-type-graph")                \
+  X(Library, "library")                                \
+  X(TreeBuilderV2, "tree-builder-v2")                  \
+  X(GenJitDebug, "gen-jit-debug")                      \
+  X(JitLogging, "jit-logging")                         \
+  X(JitTiming, "jit-timing")                           \
+  X(JitProfiling, "jit-profiling")                     \
+  X(ParallelTraversal, "parallel-traversal")           \
+  X(DeltaPointers, "delta-pointers")                   \
+  X(PolymorphicInheritance, "polymorphic-inheritance") \
+  X(Agent, "agent")
 
 namespace oi::detail {
 
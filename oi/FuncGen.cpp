@@ -147,6 +147,9 @@ void FuncGen::DeclareExterns(std::string& code) {
 extern uint8_t* dataBase;
 extern size_t dataSize;
 extern uintptr_t cookieValue;
+extern uint64_t budgetTimeNs;
+extern size_t budgetBytes;
+extern size_t budgetElements;
   )";
   code.append(vars);
 }
@@ -193,6 +196,192 @@ void __jlogptr(uintptr_t ptr) {
   }
 }
 
+/*
+ * DefineJitProfiling
+ *
+ * Defines JPROFILE(T), which accumulates the cycles spent until the end of the
+ * enclosing scope into a per-type table. Both the inclusive cycles and the
+ * exclusive cycles, i.e. not spent in a nested JPROFILE scope, are recorded.
+ *
+ * The table is a ProfileState reached through `ctx.profile`, so concurrent
+ * traversals and the workers of a parallel traversal each record into their
+ * own table. Worker tables are merged into their parent's once they finish.
+ * Types are keyed by the address of a per-type tag and only types that were
+ * actually reached have entries. A zeroed ProfileState is empty and the table
+ * never allocates, as OID's static context is never constructed.
+ *
+ * OIL copies the table into the caller's oi::Budget::profile, if any, and OID
+ * appends it to the data segment. Neither prints it from the JIT code.
+ */
+void FuncGen::DefineJitProfiling(std::string& code, FeatureSet features) {
+  if (!features[Feature::JitProfiling]) {
+    code += "#define JPROFILE(T)\n";
+    return;
+  }
+
+  code += R"(
+namespace OIInternal {
+namespace {
+
+struct ProfileEntry {
+  const void* tag;
+  std::string_view name;
+  uint64_t exclusiveCycles;
+  uint64_t inclusiveCycles;
+  uint64_t calls;
+};
+
+struct ProfileState {
+  static constexpr size_t kCapacityBits = 12;
+  static constexpr size_t kCapacity = 1 << kCapacityBits;
+
+  std::array<ProfileEntry, kCapacity> entries;
+  // Types beyond the table's capacity are counted together
+  ProfileEntry overflow;
+  uint64_t childCycles;
+
+  ProfileEntry& find(const void* tag, std::string_view name) {
+    size_t index = (reinterpret_cast<uintptr_t>(tag) * 0x9E3779B97F4A7C15ull) >>
+                   (64 - kCapacityBits);
+    for (size_t probes = 0; probes < kCapacity; probes++) {
+      auto& entry = entries[index];
+      if (entry.tag == tag)
+        return entry;
+      if (entry.tag == nullptr) {
+        entry.tag = tag;
+        entry.name = name;
+        return entry;
+      }
+      index = (index + 1) % kCapacity;
+    }
+    overflow.name = "<other types>";
+    return overflow;
+  }
+
+  template <typename F>
+  void forEach(const F& f) const {
+    for (const auto& entry : entries) {
+      if (entry.calls != 0)
+        f(entry);
+    }
+    if (overflow.calls != 0)
+      f(overflow);
+  }
+
+  void merge(const ProfileState& other) {
+    other.forEach([this](const ProfileEntry& from) {
+      auto& to = from.tag == nullptr ? overflow : find(from.tag, from.name);
+      to.name = from.name;
+      to.exclusiveCycles += from.exclusiveCycles;
+      to.inclusiveCycles += from.inclusiveCycles;
+      to.calls += from.calls;
+    });
+  }
+
+  void reset() {
+    entries.fill(ProfileEntry{});
+    overflow = ProfileEntry{};
+    childCycles = 0;
+  }
+};
+
+template <typename T>
+constexpr std::string_view profileTypeName() {
+  std::string_view name = __PRETTY_FUNCTION__;
+  name.remove_prefix(name.find("[T = ") + 5);
+  name.remove_suffix(1);
+  return name;
+}
+
+// Only the address is used, as a key unique to each type
+template <typename T>
+constexpr char profileTag = 0;
+
+class ProfileScope {
+ public:
+  ProfileScope(ProfileState& state, const void* tag, std::string_view name)
+      : state_(state), tag_(tag), name_(name), savedChildCycles_(state.childCycles) {
+    state_.childCycles = 0;
+    start_ = __builtin_ia32_rdtsc();
+  }
+
+  ~ProfileScope() {
+    uint64_t cycles = __builtin_ia32_rdtsc() - start_;
+    // Looked up at the end, as the scope may outlive other lookups
+    auto& entry = state_.find(tag_, name_);
+    entry.calls++;
+    entry.inclusiveCycles += cycles;
+    entry.exclusiveCycles += cycles - state_.childCycles;
+    state_.childCycles = savedChildCycles_ + cycles;
+  }
+
+ private:
+  ProfileState& state_;
+  const void* tag_;
+  std::string_view name_;
+  uint64_t savedChildCycles_;
+  uint64_t start_;
+};
+)";
+
+  if (features[Feature::Library]) {
+    // OIL hands the profile back to the caller rather than printing it
+    code += R"(
+void exportProfile(const ProfileState& profile, oi::JitProfile& out) {
+  out.entries.clear();
+  profile.forEach([&](const ProfileEntry& entry) {
+    out.entries.push_back(oi::JitProfile::Entry{
+        .name = std::string{entry.name},
+        .exclusiveCycles = entry.exclusiveCycles,
+        .inclusiveCycles = entry.inclusiveCycles,
+        .calls = entry.calls,
+    });
+  });
+  std::sort(out.entries.begin(), out.entries.end(), [](auto& a, auto& b) {
+    return a.exclusiveCycles > b.exclusiveCycles;
+  });
+}
+)";
+  }
+
+  code += R"(
+} // namespace
+} // namespace OIInternal
+
+#define JPROFILE(T) \
+  OIInternal::ProfileScope __oi_profile_scope{ \
+      ctx.profile, &OIInternal::profileTag<T>, OIInternal::profileTypeName<T>()}
+)";
+}
+
+namespace {
+
+/*
+ * Writes the JIT profile after the end of the data, as a count followed by the
+ * name, exclusive cycles, inclusive cycles and calls of each type. Every value,
+ * including each character of the name, is written with StoreData.
+ */
+void storeProfile(std::string& func) {
+  func += R"(
+      {
+        size_t profileCount = 0;
+        ctx.profile.forEach([&](const auto&) { profileCount++; });
+        OIInternal::StoreData(profileCount, dataSegOffset);
+        ctx.profile.forEach([&](const auto& e) {
+          OIInternal::StoreData(e.name.size(), dataSegOffset);
+          for (char c : e.name)
+            OIInternal::StoreData(static_cast<uint8_t>(c), dataSegOffset);
+          OIInternal::StoreData(e.exclusiveCycles, dataSegOffset);
+          OIInternal::StoreData(e.inclusiveCycles, dataSegOffset);
+          OIInternal::StoreData(e.calls, dataSegOffset);
+        });
+        ctx.profile.reset();
+      }
+    )";
+}
+
+}  // namespace
+
 void FuncGen::DeclareStoreData(std::string& testCode) {
   testCode.append("void StoreData(uintptr_t data, size_t& dataSegOffset);\n");
 }
@@ -236,6 +425,10 @@ void FuncGen::DefineStoreData(std::string& testCode) {
   // space at the end.
   std::string func = R"(
     void StoreData(uint64_t data, size_t& dataSegOffset) {
+      // Cut the data on an object boundary once the budget is exhausted
+      if (ctx.budget.isExhausted()) {
+        return;
+      }
       size_t sz = EncodeVarintSize(data);
       if (sz + dataSegOffset < dataSize) {
         auto data_base = reinterpret_cast<uint8_t*>(dataBase);
@@ -252,36 +445,66 @@ void FuncGen::DefineStoreData(std::string& testCode) {
 }
 
 void FuncGen::DefineTopLevelIntrospect(std::string& code,
-                                       const std::string& type) {
+                                       const std::string& type,
+                                       FeatureSet features) {
   std::string func = R"(
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunknown-attributes"
 /* RawType: %1% */
 void __attribute__((used, retain)) introspect_%2$016x(
-    const OIInternal::__ROOT_TYPE__& t,
-    std::vector<uint8_t>& v)
+    const OIInternal::__ROOT_TYPE_%2$016x__& t,
+    std::vector<uint8_t>& v,
+    const oi::Budget& b)
 #pragma GCC diagnostic pop
 {
   v.clear();
   v.reserve(4096);
 
-  auto pointers = std::make_unique<PointerHashSet<>>();
+  auto pointers = std::make_unique<OIInternal::TraversalPointerSet>();
   pointers->initialize();
 
+  TraversalBudget budget;
+  budget.initialize(b.maxTime.count(), b.maxBytes, b.maxElements);
+
+  using Output = DataBuffer::Budgeted<std::vector<uint8_t>>;
+  Output out{v, budget};
+
   struct Context {
-    using DataBuffer = DataBuffer::BackInserter<std::vector<uint8_t>>;
+    using DataBuffer = DataBuffer::BackInserter<Output>;
 
-    PointerHashSet<>& pointers;
-  };
-  Context ctx{ .pointers = *pointers };
+    OIInternal::TraversalPointerSet& pointers;
+    TraversalBudget& budget;
+    Output& out;
+)";
+  std::string init = ".pointers = *pointers, .budget = budget, .out = out";
+  if (features[Feature::JitProfiling]) {
+    func += "    OIInternal::ProfileState& profile;\n";
+    init += ", .profile = *profile";
+  }
+  if (features[Feature::ParallelTraversal]) {
+    func += "    // Threads a container may be split across, 0 is unlimited\n";
+    func += "    size_t maxWorkers;\n";
+    init += ", .maxWorkers = b.maxThreads";
+  }
+  func += "  };\n";
+  if (features[Feature::JitProfiling]) {
+    // Too large for the stack
+    func += "  auto profile = std::make_unique<OIInternal::ProfileState>();\n";
+  }
+  func += "  Context ctx{ " + init + " };\n";
+  func += R"(
   ctx.pointers.add((uintptr_t)&t);
 
-  using ContentType = OIInternal::TypeHandler<Context, OIInternal::__ROOT_TYPE__>::type;
+  using ContentType = OIInternal::TypeHandler<Context, OIInternal::__ROOT_TYPE_%2$016x__>::type;
 
-  ContentType ret{Context::DataBuffer{v}};
+  ContentType ret{Context::DataBuffer{out}};
   OIInternal::getSizeType<Context>(ctx, t, ret);
-}
 )";
+  if (features[Feature::JitProfiling]) {
+    func += "  if (b.profile != nullptr)\n";
+    func += "    OIInternal::exportProfile(ctx.profile, *b.profile);\n";
+  }
+  func += "}\n";
 
   code.append(
       (boost::format(func) % type % std::hash<std::string>{}(type)).str());
@@ -298,11 +521,13 @@ void FuncGen::DefineTopLevelIntrospectNamed(std::string& code,
   code += " */\n";
   code += "extern \"C\" IntrospectionResult ";
   code += linkageName;
-  code += "(const OIInternal::__ROOT_TYPE__& t) {\n";
+  code += "(const OIInternal::__ROOT_TYPE_";
+  code += typeHash;
+  code += "__& t) {\n";
   code += "  std::vector<uint8_t> v{};\n";
   code += "  introspect_";
   code += typeHash;
-  code += "(t, v);\n";
+  code += "(t, v, oi::Budget{});\n";
   code += "  return IntrospectionResult{std::move(v), treeBuilderInstructions";
   code += typeHash;
   code += "};\n";
@@ -326,6 +551,7 @@ void FuncGen::DefineTopLevelGetSizeRef(std::string& testCode,
   func += R"(
       ctx.pointers.initialize();
       ctx.pointers.add((uintptr_t)&t);
+      ctx.budget.initialize(budgetTimeNs, budgetBytes, budgetElements);
       auto data = reinterpret_cast<uintptr_t*>(dataBase);
 
       size_t dataSegOffset = 0;
@@ -336,13 +562,27 @@ void FuncGen::DefineTopLevelGetSizeRef(std::string& testCode,
       uintptr_t& timeTakenNs = data[dataSegOffset++];
       size_t& pointersSize = data[dataSegOffset++];
       size_t& pointersCapacity = data[dataSegOffset++];
+      uintptr_t& truncated = data[dataSegOffset++];
 
       dataSegOffset *= sizeof(uintptr_t);
       JLOG("%1% @");
       JLOGPTR(&t);
-      OIInternal::getSizeType(t, dataSegOffset);
+    )";
+  if (features[Feature::JitProfiling]) {
+    func += "      {\n        JPROFILE(OIInternal::__ROOT_TYPE__);\n";
+    func += "        OIInternal::getSizeType(t, dataSegOffset);\n      }\n";
+  } else {
+    func += "      OIInternal::getSizeType(t, dataSegOffset);\n";
+  }
+  func += R"(
+      truncated = ctx.budget.finish();
       OIInternal::StoreData((uintptr_t)123456789, dataSegOffset);
       OIInternal::StoreData((uintptr_t)123456789, dataSegOffset);
+    )";
+  if (features[Feature::JitProfiling]) {
+    storeProfile(func);
+  }
+  func += R"(
       writtenSize = dataSegOffset;
       dataBase += dataSegOffset;
       pointersSize = ctx.pointers.size();
@@ -370,12 +610,15 @@ void FuncGen::DefineTreeBuilderInstructions(
     std::span<const std::string_view> typeNames) {
   std::string typeHash =
       (boost::format("%1$016x") % std::hash<std::string>{}(rawType)).str();
+  std::string rootType = "OIInternal::__ROOT_TYPE_" + typeHash + "__";
 
   code += R"(
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunknown-attributes"
 namespace {
-struct FakeContext {
+struct FakeContext)";
+  code += typeHash;
+  code += R"( {
   using DataBuffer = int;
 };
 const std::array<std::string_view, )";
@@ -391,16 +634,15 @@ const std::array<std::string_view, )";
   code += "};\n";
   code += "const exporters::inst::Field rootInstructions";
   code += typeHash;
-  code += "{sizeof(OIInternal::__ROOT_TYPE__), ";
+  code += "{sizeof(" + rootType + "), ";
   code += std::to_string(exclusiveSize);
   code += ", \"a0\", typeNames";
   code += typeHash;
-  code +=
-      ", OIInternal::TypeHandler<FakeContext, "
-      "OIInternal::__ROOT_TYPE__>::fields, "
-      "OIInternal::TypeHandler<FakeContext, "
-      "OIInternal::__ROOT_TYPE__>::processors, "
-      "std::is_fundamental_v<OIInternal::__ROOT_TYPE__>};\n";
+  std::string handler =
+      "OIInternal::TypeHandler<FakeContext" + typeHash + ", " + rootType + ">";
+  code += ", " + handler + "::fields";
+  code += ", " + handler + "::processors";
+  code += ", std::is_fundamental_v<" + rootType + ">};\n";
   code += "} // namespace\n";
   code +=
       "extern const exporters::inst::Inst __attribute__((used, retain)) "
@@ -428,6 +670,7 @@ void FuncGen::DefineTopLevelGetSizeSmartPtr(std::string& testCode,
   }
   func += R"(
       ctx.pointers.initialize();
+      ctx.budget.initialize(budgetTimeNs, budgetBytes, budgetElements);
       auto data = reinterpret_cast<uintptr_t*>(dataBase);
 
       size_t dataSegOffset = 0;
@@ -438,12 +681,26 @@ void FuncGen::DefineTopLevelGetSizeSmartPtr(std::string& testCode,
       uintptr_t& timeTakenNs = data[dataSegOffset++];
       size_t& pointersSize = data[dataSegOffset++];
       size_t& pointersCapacity = data[dataSegOffset++];
+      uintptr_t& truncated = data[dataSegOffset++];
 
       dataSegOffset *= sizeof(uintptr_t);
 
-      OIInternal::getSizeType(t, dataSegOffset);
+    )";
+  if (features[Feature::JitProfiling]) {
+    func += "      {\n        JPROFILE(OIInternal::__ROOT_TYPE__);\n";
+    func += "        OIInternal::getSizeType(t, dataSegOffset);\n      }\n";
+  } else {
+    func += "      OIInternal::getSizeType(t, dataSegOffset);\n";
+  }
+  func += R"(
+      truncated = ctx.budget.finish();
       OIInternal::StoreData((uintptr_t)123456789, dataSegOffset);
       OIInternal::StoreData((uintptr_t)123456789, dataSegOffset);
+    )";
+  if (features[Feature::JitProfiling]) {
+    storeProfile(func);
+  }
+  func += R"(
       writtenSize = dataSegOffset;
       dataBase += dataSegOffset;
       pointersSize = ctx.pointers.size();
@@ -580,29 +837,195 @@ void FuncGen::DefineDataSegmentDataBuffer(std::string& testCode) {
 /*
  * DefineBackInserterDataBuffer
  *
- * Provides a DataBuffer implementation that takes anything convertible with
- * std::back_inserter.
+ * Provides a DataBuffer implementation that appends to a container, and a
+ * container adaptor for it that drops writes once the traversal budget is
+ * exhausted. With DeltaPointers the DataBuffer also provides last_pointer(),
+ * kept by the container, so that Pointers are delta encoded.
  */
-void FuncGen::DefineBackInserterDataBuffer(std::string& code) {
-  constexpr std::string_view buf = R"(
+void FuncGen::DefineBackInserterDataBuffer(std::string& code,
+                                           FeatureSet features) {
+  code += R"(
 namespace oi::detail::DataBuffer {
 
 template <class Container>
 class BackInserter {
  public:
-  BackInserter(Container& v) : buf(v) {}
+  BackInserter(Container& v) : c(&v) {}
 
   void write_byte(uint8_t byte) {
-    *buf = byte;
+    c->push_back(byte);
+  }
+)";
+  if (features[Feature::DeltaPointers]) {
+    code += R"(
+  uintptr_t& last_pointer() {
+    return c->last_pointer();
+  }
+)";
+  }
+  code += R"(
+ private:
+  Container* c;
+};
+
+template <class Container>
+class Budgeted {
+ public:
+  using value_type = typename Container::value_type;
+
+  Budgeted(Container& c, const TraversalBudget& budget)
+      : c(c), budget(budget) {}
+
+  void push_back(value_type v) {
+    if (!budget.isExhausted())
+      c.push_back(v);
+  }
+  void append(const value_type* data, size_t n) {
+    if (!budget.isExhausted())
+      c.insert(c.end(), data, data + n);
+  }
+  size_t size() const {
+    return c.size();
+  }
+  uintptr_t& last_pointer() {
+    return lastPointer;
   }
  private:
-  std::back_insert_iterator<Container> buf;
+  Container& c;
+  const TraversalBudget& budget;
+  uintptr_t lastPointer = 0;
 };
 
 } // namespace oi::detail::DataBuffer
-  )";
+)";
+}
+
+/*
+ * DefineDelegateElements
+ *
+ * Provides delegateElements(ctx, tail, container, encode), which container
+ * type handlers use to write each of their elements to a ListContents. The
+ * elements are written in order, stopping once the budget is exhausted.
+ *
+ * With ParallelTraversal, containers of at least kParallelMinElements reached
+ * from the calling thread have their elements split into one contiguous range
+ * per hardware thread. Each worker encodes its range into its own buffer with
+ * the same static types and the buffers are spliced back in order. Containers
+ * nested within the elements are traversed sequentially by their worker, and
+ * Budget::maxThreads caps the number of workers. Each worker forks the budget
+ * and its usage is joined back in order. Byte and element limits can only be
+ * applied in traversal order, so containers are only split when the budget is
+ * limited by time alone.
+ *
+ * The workers share a lock-free pointer set, so a pointee reached from several
+ * ranges is encoded by whichever worker claims it first, not necessarily the
+ * one holding its first reference. The sizes add up as in a sequential
+ * traversal, but the pointee may be attributed to a different element. When
+ * the time limit cuts a range short, the ranges after it are dropped with the
+ * pointees their workers claimed, so a pointee also referenced from a range
+ * that was kept is missing from the result.
+ */
+void FuncGen::DefineDelegateElements(std::string& code, FeatureSet features) {
+  code += R"(
+template <typename Ctx, typename Contents, typename It, typename F>
+Contents delegateRange(Ctx& ctx, Contents tail, It first, It last, const F& encode) {
+  for (; first != last; ++first) {
+    if (ctx.budget.isExhausted())
+      break;
+    tail = tail.delegate([&ctx, &first, &encode](auto ret) {
+      return encode(ctx, *first, ret);
+    });
+  }
+  return tail;
+}
+)";
+
+  if (!features[Feature::ParallelTraversal]) {
+    code += R"(
+using TraversalPointerSet = PointerHashSet<>;
+
+template <typename Ctx, typename Contents, typename Container, typename F>
+Contents delegateElements(Ctx& ctx, Contents tail, const Container& container, const F& encode) {
+  return delegateRange(ctx, tail, std::begin(container), std::end(container), encode);
+}
+)";
+    return;
+  }
+
+  code += R"(
+using TraversalPointerSet = oi::detail::ConcurrentPointerSet;
+
+constexpr size_t kParallelMinElements = 1 << 16;
+
+template <typename Ctx, typename Contents, typename Container, typename F>
+Contents delegateElements(Ctx& ctx, Contents tail, const Container& container, const F& encode) {
+  size_t size = std::size(container);
+  size_t workers = std::min<size_t>(std::thread::hardware_concurrency(),
+                                    size / (kParallelMinElements / 4));
+  if (ctx.maxWorkers != 0)
+    workers = std::min(workers, ctx.maxWorkers);
+  if (size < kParallelMinElements || workers < 2 ||
+      ctx.budget.hasCountLimits())
+    return delegateRange(ctx, tail, std::begin(container), std::end(container), encode);
+
+  // Find the bounds of each worker's range before starting any work
+  using It = decltype(std::begin(container));
+  std::vector<It> bounds;
+  bounds.reserve(workers + 1);
+  auto it = std::begin(container);
+  for (size_t i = 0; i < workers; i++) {
+    bounds.push_back(it);
+    std::advance(it, size / workers + (i < size % workers ? 1 : 0));
+  }
+  bounds.push_back(std::end(container));
+
+  using Output = std::remove_reference_t<decltype(ctx.out)>;
+  struct Chunk {
+    std::vector<uint8_t> data;
+    TraversalBudget budget;
+)";
+  std::string workerInit =
+      ".pointers = ctx.pointers, .budget = chunk.budget, .out = out";
+  if (features[Feature::JitProfiling]) {
+    code += "    OIInternal::ProfileState profile;\n";
+    workerInit += ", .profile = chunk.profile";
+  }
+  workerInit += ", .maxWorkers = 1";
+  code += R"(  };
+  std::vector<Chunk> chunks(workers);
+  std::vector<std::thread> threads;
+  threads.reserve(workers);
+  for (size_t i = 0; i < workers; i++) {
+    chunks[i].budget = ctx.budget.fork();
+    threads.emplace_back([&ctx, &encode, &chunk = chunks[i], first = bounds[i], last = bounds[i + 1]] {
+      Output out{chunk.data, chunk.budget};
+      Ctx worker{ )";
+  code += workerInit;
+  code += R"( };
+      delegateRange(worker, Contents{typename Ctx::DataBuffer{out}}, first, last, encode);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+)";
+  if (features[Feature::JitProfiling]) {
+    code += R"(
+  for (const auto& chunk : chunks)
+    ctx.profile.merge(chunk.profile);
+)";
+  }
+  code += R"(
 
-  code.append(buf);
+  // Splice the buffers in order, stopping after the first that was cut short
+  for (auto& chunk : chunks) {
+    ctx.out.append(chunk.data.data(), chunk.data.size());
+    ctx.budget.join(chunk.budget);
+    if (chunk.budget.isExhausted())
+      break;
+  }
+  return tail;
+}
+)";
 }
 
 /*
@@ -610,9 +1033,9 @@ class BackInserter {
  *
  * Provides TypeHandler implementations for types T, T*, and void. T is of type
  * Unit type and stores nothing. It should be overridden to provide an
- * implementation. T* is of type Pair<VarInt, Sum<Unit, T::type>. It stores the
- * pointer's value always, then the value of the pointer if it is unique. void
- * is of type Unit and always stores nothing.
+ * implementation. T* is of type Pair<Pointer, Sum<Unit, T::type>. It stores
+ * the pointer's value always, then the value of the pointer if it is unique.
+ * void is of type Unit and always stores nothing.
  */
 void FuncGen::DefineBasicTypeHandlers(std::string& code) {
   code += R"(
@@ -666,7 +1089,7 @@ struct TypeHandler {
     if constexpr (std::is_pointer_v<T>) {
       return std::type_identity<types::st::Pair<
           DB,
-          types::st::VarInt<DB>,
+          types::st::Pointer<DB>,
           types::st::Sum<
               DB,
               types::st::Unit<DB>,
@@ -678,7 +1101,7 @@ struct TypeHandler {
   static constexpr auto choose_processors() {
     if constexpr (std::is_pointer_v<T>) {
       return std::array<inst::ProcessorInst, 2>{
-          exporters::inst::ProcessorInst{types::st::VarInt<DB>::describe,
+          exporters::inst::ProcessorInst{types::st::Pointer<DB>::describe,
                                          &process_pointer},
           exporters::inst::ProcessorInst{
               types::st::Sum<
@@ -744,11 +1167,9 @@ ContainerInfo FuncGen::GetOiArrayContainerInfo() {
 
   oiArray.codegen.traversalFunc = R"(
 auto tail = returnArg.write(N0);
-for (size_t i=0; i<N0; i++) {
-  tail = tail.delegate([&ctx, &container, i](auto ret) {
-      return TypeHandler<Ctx, T0>::getSizeType(ctx, container.vals[i], ret);
-  });
-}
+tail = delegateElements(ctx, tail, container.vals, [](auto& ctx, const auto& it, auto ret) {
+  return OIInternal::getSizeType<Ctx>(ctx, it, ret);
+});
 return tail.finish();
 )";
   oiArray.codegen.processors.emplace_back(ContainerInfo::Processor{
@@ -31,6 +31,7 @@ class FuncGen {
  public:
   static void DeclareExterns(std::string& code);
   static void DefineJitLog(std::string& code, FeatureSet features);
+  static void DefineJitProfiling(std::string& code, FeatureSet features);
 
   static void DeclareStoreData(std::string& testCode);
   static void DefineStoreData(std::string& testCode);
@@ -53,7 +54,8 @@ class FuncGen {
   static void DeclareGetSize(std::string& testCode, const std::string& type);
 
   static void DefineTopLevelIntrospect(std::string& code,
-                                       const std::string& type);
+                                       const std::string& type,
+                                       FeatureSet features);
   static void DefineTopLevelIntrospectNamed(std::string& code,
                                             const std::string& type,
                                             const std::string& linkageName);
@@ -75,8 +77,10 @@ class FuncGen {
                                           const std::string& ctype);
 
   static void DefineDataSegmentDataBuffer(std::string& testCode);
-  static void DefineBackInserterDataBuffer(std::string& code);
+  static void DefineBackInserterDataBuffer(std::string& code,
+                                           FeatureSet features);
   static void DefineBasicTypeHandlers(std::string& code);
+  static void DefineDelegateElements(std::string& code, FeatureSet features);
 
   static ContainerInfo GetOiArrayContainerInfo();
 };
@@ -82,7 +82,14 @@ IntrospectionResult::const_iterator::operator++() {
             });
 
             for (const auto& [dy, handler] : ty.processors) {
-              auto parsed = exporters::ParsedData::parse(data_, dy);
+              if (data_ == end_) {
+                // The traversal stopped here. Nothing further can be parsed.
+                next_->is_truncated = true;
+                stack_ = {};
+                return *this;
+              }
+              auto parsed =
+                  exporters::ParsedData::parse(data_, last_pointer_, dy);
               handler(*next_, [this](auto i) { stack_.emplace(i); }, parsed);
             }
 
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "oi/JitCodeArena.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace oi::detail {
+namespace {
+size_t pageAlign(size_t size) {
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  return (size + pageSize - 1) & ~(pageSize - 1);
+}
+}  // namespace
+
+JitCodeArena& JitCodeArena::get() {
+  static JitCodeArena arena;
+  return arena;
+}
+
+std::span<uint8_t> JitCodeArena::allocate(size_t size) {
+  size = pageAlign(size);
+
+  std::lock_guard<std::mutex> guard{mutex_};
+  if (static_cast<size_t>(end_ - next_) < size) {
+    // The rest of the current chunk is abandoned
+    size_t chunkSize = std::max(size, kChunkSize);
+    void* chunk = mmap(nullptr,
+                       chunkSize,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                       -1,
+                       0);
+    if (chunk == MAP_FAILED)
+      throw std::runtime_error(std::string("jit arena map failed: ") +
+                               std::strerror(errno));
+
+    next_ = static_cast<uint8_t*>(chunk);
+    end_ = next_ + chunkSize;
+  }
+
+  std::span<uint8_t> out{next_, size};
+  next_ += size;
+  return out;
+}
+
+void JitCodeArena::makeExecutable(std::span<uint8_t> range) {
+  if (range.empty())
+    return;
+  if (mprotect(range.data(), range.size(), PROT_READ | PROT_EXEC) != 0)
+    throw std::runtime_error(std::string("jit arena mprotect failed: ") +
+                             std::strerror(errno));
+}
+
+}  // namespace oi::detail
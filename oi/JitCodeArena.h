@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+
+namespace oi::detail {
+
+/*
+ * JitCodeArena
+ *
+ * Process wide home for the code JIT compiled by OIL. Relocated objects from
+ * every type are packed into shared chunks of address space, page aligned so
+ * that each one's permissions can be set separately. Allocations are never
+ * freed: the code lives as long as the process.
+ *
+ * Memory is handed out read-write. Once an object has been copied in, the
+ * pages holding its code and read-only data are made read-execute, so no page
+ * is ever both writable and executable.
+ */
+class JitCodeArena {
+ public:
+  static JitCodeArena& get();
+
+  /*
+   * Returns `size` bytes of page aligned, read-write memory. Throws on error.
+   */
+  std::span<uint8_t> allocate(size_t size);
+
+  /*
+   * Makes the page aligned range read-execute. Throws on error.
+   */
+  static void makeExecutable(std::span<uint8_t> range);
+
+ private:
+  // Only the pages used are committed, so chunks can be generous
+  static constexpr size_t kChunkSize = 64 << 20;
+
+  JitCodeArena() = default;
+
+  std::mutex mutex_;
+  uint8_t* next_ = nullptr;
+  uint8_t* end_ = nullptr;
+};
+
+}  // namespace oi::detail
@@ -17,8 +17,10 @@
 
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <iomanip>
 
 /*
  * NOTA BENE: Metrics are disabled by default. They are enabled by setting the
@@ -43,6 +45,14 @@
  * metrics::Tracing unused_var("name_of_your_trace");
  * ```
  *
+ * Spans opened while another span is alive on the same thread are recorded
+ * as its children, so the output forms a tree per thread.
+ *
+ * Counters can be sampled at any point with:
+ * ```
+ * metrics::Tracing::counter("generated_code_bytes", code.size());
+ * ```
+ *
  * When you want to collect the data, `::showTraces()` to print the data to
  * stdout, and `::saveTraces(file)` to save it to disk using JSON.
  */
@@ -58,10 +68,30 @@ static inline TraceFlags parseTraceFlags(const char* flags) {
   };
 }
 
+static inline OutputFormat parseOutputFormat(const char* format) {
+  if (format != nullptr && strcasecmp(format, "chrome") == 0) {
+    return OutputFormat::Chrome;
+  }
+  return OutputFormat::Json;
+}
+
+/*
+ * Span stack of the calling thread. Only Nested spans are pushed, so the back
+ * is the parent of the next span or counter sample on this thread.
+ */
+static thread_local std::vector<uint32_t> openSpans;
+
 Tracing::Static Tracing::static_{};
 
 Tracing::Static::Static() {
   traceEnabled = parseTraceFlags(std::getenv(traceEnvKey));
+  format = parseOutputFormat(std::getenv(formatEnvKey));
+  if (traceEnabled && format == OutputFormat::Chrome) {
+    // Trace events can't be placed on a timeline without timestamps
+    traceEnabled.time = true;
+  }
+  epoch = std::chrono::high_resolution_clock::now();
+  nextIndex = 0;
 
   errno = 0;
   if (auto pageSizeBytes = sysconf(_SC_PAGESIZE); pageSizeBytes > 0) {
@@ -78,11 +108,25 @@ Tracing::Static::~Static() {
 
   Tracing::saveTraces(Tracing::outputPath());
   traces.clear();
+  counters.clear();
+}
+
+void Tracing::open(Scope scope) {
+  spanScope = scope;
+  index = static_.nextIndex.fetch_add(1, std::memory_order_relaxed);
+  parentIndex = currentIndex();
+  if (scope == Scope::Nested) {
+    openSpans.push_back(index);
+  }
+}
+
+uint32_t Tracing::currentIndex() {
+  return openSpans.empty() ? noParent : openSpans.back();
 }
 
-uint32_t Tracing::getNextIndex() {
-  // NOTE: we already own the lock on static_.traces
-  return static_cast<uint32_t>(static_.traces.size());
+int32_t Tracing::threadId() {
+  static thread_local const int32_t tid = gettid();
+  return tid;
 }
 
 Tracing::TimePoint Tracing::fetchTime() {
@@ -119,54 +163,216 @@ long Tracing::fetchRssUsage() {
 
 void Tracing::stop() {
   ended = true;
-  if (!static_.traceEnabled) {
+  if (!static_.traceEnabled || index == noParent) {
     return;
   }
 
+  // Spans are usually stopped in LIFO order, but tolerate any order
+  if (auto it = std::find(openSpans.rbegin(), openSpans.rend(), index);
+      it != openSpans.rend()) {
+    openSpans.erase(std::next(it).base());
+  }
+
   using namespace std::chrono;
   auto stopTs = fetchTime();
   auto duration = duration_cast<nanoseconds>(stopTs - startTs);
+  auto startNs = static_.traceEnabled.time
+                     ? duration_cast<nanoseconds>(startTs - static_.epoch)
+                     : nanoseconds{0};
   auto rssAfterBytes = fetchRssUsage();
 
   std::lock_guard<std::mutex> guard{static_.mutex};
   // Can't use emplace_back() because of old clang++ on CI
-  static_.traces.push_back({getNextIndex(),
+  static_.traces.push_back({index,
+                            parentIndex,
+                            threadId(),
                             std::move(traceName),
+                            startNs.count(),
                             duration.count(),
                             rssBeforeBytes,
                             rssAfterBytes});
 }
 
-void Tracing::saveTraces(const std::filesystem::path& output) {
-  std::ofstream osf{output};
-  if (!osf) {
-    perror("Failed to open output file");
+void Tracing::counter(std::string_view name, int64_t value) {
+  if (!static_.traceEnabled) {
     return;
   }
 
+  using namespace std::chrono;
+  auto timestampNs =
+      static_.traceEnabled.time
+          ? duration_cast<nanoseconds>(fetchTime() - static_.epoch).count()
+          : 0;
+
+  std::lock_guard<std::mutex> guard{static_.mutex};
+  static_.counters.push_back({currentIndex(),
+                              threadId(),
+                              std::string{name},
+                              timestampNs,
+                              value});
+}
+
+namespace {
+
+void writeJsonString(std::ostream& out, std::string_view str) {
+  out << '"';
+  for (char c : str) {
+    switch (c) {
+      case '"':
+        out << "\\\"";
+        break;
+      case '\\':
+        out << "\\\\";
+        break;
+      case '\n':
+        out << "\\n";
+        break;
+      default:
+        out << c;
+    }
+  }
+  out << '"';
+}
+
+void saveJson(std::ostream& osf,
+              const TraceFlags& flags,
+              const std::vector<Span>& spans,
+              const std::vector<CounterSample>& counters) {
+  bool first = true;
   osf << "[";
-  for (const auto& span : static_.traces) {
-    if (span.index > 0) {
+  for (const auto& span : spans) {
+    if (!first) {
       osf << ",";
     }
+    first = false;
 
-    osf << "{\"name\":\"" << span.name << "\"";
+    osf << "{\"name\":";
+    writeJsonString(osf, span.name);
     osf << ",\"index\":" << span.index;
+    if (span.parentIndex != noParent) {
+      osf << ",\"parent_index\":" << span.parentIndex;
+    }
+    osf << ",\"tid\":" << span.threadId;
 
-    if (static_.traceEnabled.time) {
+    if (flags.time) {
+      osf << ",\"start_ns\":" << span.startNs;
       osf << ",\"duration_ns\":" << span.duration;
     }
 
-    if (static_.traceEnabled.rss) {
+    if (flags.rss) {
       osf << ",\"rss_before_bytes\":" << span.rssBeforeBytes;
       osf << ",\"rss_after_bytes\":" << span.rssAfterBytes;
     }
 
     osf << "}";
   }
+
+  for (const auto& counter : counters) {
+    if (!first) {
+      osf << ",";
+    }
+    first = false;
+
+    osf << "{\"counter\":";
+    writeJsonString(osf, counter.name);
+    osf << ",\"value\":" << counter.value;
+    if (counter.parentIndex != noParent) {
+      osf << ",\"parent_index\":" << counter.parentIndex;
+    }
+    osf << ",\"tid\":" << counter.threadId;
+    if (flags.time) {
+      osf << ",\"timestamp_ns\":" << counter.timestampNs;
+    }
+    osf << "}";
+  }
   osf << "]\n";
 }
 
+/*
+ * Chrome trace-event format, as documented in "Trace Event Format" and
+ * understood by Perfetto. Spans are complete ("X") events and counters are
+ * counter ("C") events. Timestamps are in microseconds.
+ */
+void saveChromeTrace(std::ostream& osf,
+                     const TraceFlags& flags,
+                     const std::vector<Span>& spans,
+                     const std::vector<CounterSample>& counters) {
+  const auto pid = getpid();
+  // Trace event times are in microseconds. Write them from the integer
+  // nanoseconds, as a double streamed at the default precision would turn
+  // real timestamps into e.g. 1.72938e+15.
+  auto micros = [&osf](int64_t ns) {
+    if (ns < 0) {
+      osf << '-';
+      ns = -ns;
+    }
+    osf << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000
+        << std::setfill(' ');
+  };
+
+  bool first = true;
+  osf << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  for (const auto& span : spans) {
+    if (!first) {
+      osf << ",";
+    }
+    first = false;
+
+    osf << "{\"ph\":\"X\",\"name\":";
+    writeJsonString(osf, span.name);
+    osf << ",\"pid\":" << pid << ",\"tid\":" << span.threadId;
+    osf << ",\"ts\":";
+    micros(span.startNs);
+    osf << ",\"dur\":";
+    micros(span.duration);
+    osf << ",\"args\":{\"index\":" << span.index;
+    if (span.parentIndex != noParent) {
+      osf << ",\"parent_index\":" << span.parentIndex;
+    }
+    if (flags.rss) {
+      osf << ",\"rss_before_bytes\":" << span.rssBeforeBytes;
+      osf << ",\"rss_after_bytes\":" << span.rssAfterBytes;
+    }
+    osf << "}}";
+  }
+
+  for (const auto& counter : counters) {
+    if (!first) {
+      osf << ",";
+    }
+    first = false;
+
+    osf << "{\"ph\":\"C\",\"name\":";
+    writeJsonString(osf, counter.name);
+    osf << ",\"pid\":" << pid << ",\"tid\":" << counter.threadId;
+    osf << ",\"ts\":";
+    micros(counter.timestampNs);
+    osf << ",\"args\":{\"value\":" << counter.value << "}}";
+  }
+  osf << "]}\n";
+}
+
+}  // namespace
+
+void Tracing::saveTraces(const std::filesystem::path& output) {
+  std::ofstream osf{output};
+  if (!osf) {
+    perror("Failed to open output file");
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard{static_.mutex};
+  switch (static_.format) {
+    case OutputFormat::Json:
+      saveJson(osf, static_.traceEnabled, static_.traces, static_.counters);
+      break;
+    case OutputFormat::Chrome:
+      saveChromeTrace(
+          osf, static_.traceEnabled, static_.traces, static_.counters);
+      break;
+  }
+}
+
 const char* Tracing::outputPath() {
   const char* output = std::getenv(outputEnvKey);
 
@@ -191,6 +397,10 @@ std::ostream& operator<<(std::ostream& out, const TraceFlags& tf) {
 
 std::ostream& operator<<(std::ostream& out, const Span& span) {
   out << "Span for: " << span.name << " (" << span.index << ")\n";
+  if (span.parentIndex != noParent) {
+    out << "  Parent: " << span.parentIndex << "\n";
+  }
+  out << "  Thread: " << span.threadId << "\n";
   out << "  Duration: " << span.duration << " ns\n";
   out << "  RSS before: " << span.rssBeforeBytes << " bytes\n";
   out << "  RSS after: " << span.rssAfterBytes << " bytes\n";
@@ -207,4 +417,9 @@ std::ostream& operator<<(std::ostream& out, const std::vector<Span>& spans) {
   return out;
 }
 
+std::ostream& operator<<(std::ostream& out, const CounterSample& counter) {
+  out << "Counter " << counter.name << ": " << counter.value << "\n";
+  return out;
+}
+
 }  // namespace oi::detail::metrics
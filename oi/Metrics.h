@@ -15,17 +15,21 @@
  */
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace oi::detail::metrics {
 
 constexpr auto traceEnvKey = "OID_METRICS_TRACE";
 constexpr auto outputEnvKey = "OID_METRICS_OUTPUT";
+constexpr auto formatEnvKey = "OID_METRICS_FORMAT";
 
 /*
  * Control which metric are collected using the environment variable
@@ -34,6 +38,10 @@ constexpr auto outputEnvKey = "OID_METRICS_OUTPUT";
  * The metrics are written to the path specified by the environment variable
  * OID_METRICS_OUTPUT. If not specified, they are written into
  * "oid_metrics.json".
+ * The output format is selected by OID_METRICS_FORMAT: "json" (the default)
+ * writes a flat list of spans and counters, "chrome" writes Chrome
+ * trace-event JSON which can be loaded in Perfetto or chrome://tracing.
+ * Selecting the "chrome" format implies "time".
  */
 struct TraceFlags {
   bool time = false;
@@ -44,14 +52,35 @@ struct TraceFlags {
   }
 };
 
+enum class OutputFormat {
+  Json,
+  Chrome,
+};
+
+/*
+ * Spans with no enclosing span on their thread have this parent index.
+ */
+constexpr uint32_t noParent = UINT32_MAX;
+
 struct Span {
   uint32_t index;
+  uint32_t parentIndex;
+  int32_t threadId;
   std::string name;
+  int64_t startNs;
   int64_t duration;
   long rssBeforeBytes;
   long rssAfterBytes;
 };
 
+struct CounterSample {
+  uint32_t parentIndex;
+  int32_t threadId;
+  std::string name;
+  int64_t timestampNs;
+  int64_t value;
+};
+
 class Tracing final {
  private:
   /*
@@ -64,7 +93,11 @@ class Tracing final {
   static struct Static {
     long pageSizeKB;
     TraceFlags traceEnabled;
+    OutputFormat format;
+    std::chrono::high_resolution_clock::time_point epoch;
+    std::atomic<uint32_t> nextIndex;
     std::vector<Span> traces;
+    std::vector<CounterSample> counters;
     std::mutex mutex;
 
     Static();
@@ -74,6 +107,17 @@ class Tracing final {
   using TimePoint = std::chrono::high_resolution_clock::time_point;
 
  public:
+  /*
+   * Spans nest: a span's parent is the innermost span still open on the same
+   * thread when it was created. A Detached span records its parent but never
+   * becomes the parent of other spans, which suits spans whose lifetime isn't
+   * tied to a scope (e.g. a trap which is stopped from another code path).
+   */
+  enum class Scope {
+    Nested,
+    Detached,
+  };
+
   /*
    *   metrics::Tracing("bad");
    *
@@ -83,31 +127,47 @@ class Tracing final {
    * results. [[nodiscard]] flags the code above with a warning, which we
    * enforce as an error in our cmake/CompilerWarnings.cmake.
    */
-  [[nodiscard]] explicit Tracing(const char* name) {
+  [[nodiscard]] explicit Tracing(const char* name,
+                                 Scope scope = Scope::Nested) {
     if (!Tracing::isEnabled()) {
       return;
     }
     traceName = name;
+    open(scope);
   }
 
-  [[nodiscard]] explicit Tracing(const std::string& name) {
+  [[nodiscard]] explicit Tracing(const std::string& name,
+                                 Scope scope = Scope::Nested) {
     if (!Tracing::isEnabled()) {
       return;
     }
     traceName = name;
+    open(scope);
   }
 
-  [[nodiscard]] explicit Tracing(std::string&& name) {
+  [[nodiscard]] explicit Tracing(std::string&& name,
+                                 Scope scope = Scope::Nested) {
     if (!Tracing::isEnabled()) {
       return;
     }
     traceName = std::move(name);
+    open(scope);
   }
 
   Tracing() = delete;
-  Tracing(const Tracing& other) : Tracing{other.traceName} {
+  // A copy is a new span under the innermost open span, with the same scope
+  Tracing(const Tracing& other) : Tracing{other.traceName, other.spanScope} {
+  }
+  Tracing(Tracing&& other) noexcept
+      : ended{other.ended},
+        spanScope{other.spanScope},
+        index{other.index},
+        parentIndex{other.parentIndex},
+        traceName{std::move(other.traceName)},
+        startTs{other.startTs},
+        rssBeforeBytes{other.rssBeforeBytes} {
+    other.ended = true;
   }
-  Tracing(Tracing&&) noexcept = default;
 
   Tracing& operator=(Tracing&) = delete;
   Tracing& operator=(Tracing&&) = delete;
@@ -149,6 +209,12 @@ class Tracing final {
 
   void stop();
 
+  /*
+   * Record a sample of a named counter (e.g. the number of bytes of generated
+   * code), attributed to the innermost span open on the calling thread.
+   */
+  static void counter(std::string_view name, int64_t value);
+
   static TraceFlags& isEnabled() {
     return static_.traceEnabled;
   }
@@ -156,11 +222,16 @@ class Tracing final {
   static void saveTraces(const std::filesystem::path&);
 
  private:
-  static uint32_t getNextIndex();
+  void open(Scope scope);
+  static uint32_t currentIndex();
+  static int32_t threadId();
   static TimePoint fetchTime();
   static long fetchRssUsage();
 
   bool ended{false};
+  Scope spanScope{Scope::Nested};
+  uint32_t index{noParent};
+  uint32_t parentIndex{noParent};
   std::string traceName{};
   TimePoint startTs{Tracing::fetchTime()};
   long rssBeforeBytes{Tracing::fetchRssUsage()};
@@ -169,5 +240,6 @@ class Tracing final {
 std::ostream& operator<<(std::ostream&, const TraceFlags&);
 std::ostream& operator<<(std::ostream&, const Span&);
 std::ostream& operator<<(std::ostream&, const std::vector<Span>&);
+std::ostream& operator<<(std::ostream&, const CounterSample&);
 
 }  // namespace oi::detail::metrics
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "oi/NodeIndex.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "rocksdb/db.h"
+#include "rocksdb/options.h"
+#include "rocksdb/write_batch.h"
+
+namespace oi::detail {
+namespace {
+
+using node_index::Entry;
+using node_index::TypeStats;
+
+void appendBigEndian(std::string& out, uint64_t value) {
+  for (int shift = 56; shift >= 0; shift -= 8)
+    out.push_back(static_cast<char>(value >> shift));
+}
+
+uint64_t readBigEndian(const char* data) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(value); i++)
+    value = (value << 8) | static_cast<uint8_t>(data[i]);
+  return value;
+}
+
+void encodeEntry(std::string& out,
+                 uint64_t id,
+                 uint64_t exclusiveSize,
+                 std::string_view typeName,
+                 std::string_view path) {
+  out.clear();
+  appendBigEndian(out, id);
+  appendBigEndian(out, exclusiveSize);
+  appendBigEndian(out, typeName.size());
+  out += typeName;
+  out += path;
+}
+
+Entry decodeEntry(const rocksdb::Slice& value) {
+  constexpr size_t headerSize = 3 * sizeof(uint64_t);
+  if (value.size() < headerSize)
+    throw std::runtime_error("Corrupt node index entry");
+
+  const char* data = value.data();
+  uint64_t typeNameSize = readBigEndian(data + 16);
+  if (typeNameSize > value.size() - headerSize)
+    throw std::runtime_error("Corrupt node index entry");
+
+  const char* typeName = data + headerSize;
+  const char* path = typeName + typeNameSize;
+  return Entry{
+      .id = readBigEndian(data),
+      .exclusiveSize = readBigEndian(data + 8),
+      .typeName = std::string(typeName, path),
+      .path = std::string(path, data + value.size()),
+  };
+}
+
+rocksdb::Slice toSlice(std::string_view str) {
+  return {str.data(), str.size()};
+}
+
+}  // namespace
+
+NodeIndexWriter::NodeIndexWriter(rocksdb::DB* db_,
+                                 rocksdb::ColumnFamilyHandle* cf_)
+    : db{db_}, cf{cf_}, batch{std::make_unique<rocksdb::WriteBatch>()} {
+}
+
+NodeIndexWriter::~NodeIndexWriter() = default;
+
+void NodeIndexWriter::add(uint64_t id,
+                          uint64_t exclusiveSize,
+                          std::string_view typeName,
+                          std::string_view path) {
+  encodeEntry(value, id, exclusiveSize, typeName, path);
+
+  // Inverted so that the largest sizes come first
+  key = "s/";
+  appendBigEndian(key, ~exclusiveSize);
+  appendBigEndian(key, id);
+  batch->Put(cf, key, value);
+
+  key = "t/";
+  key += typeName;
+  key += '\0';
+  appendBigEndian(key, id);
+  batch->Put(cf, key, value);
+
+  key = "p/";
+  key += path;
+  key += '\0';
+  appendBigEndian(key, id);
+  batch->Put(cf, key, value);
+
+  auto stats = typeStats.find(typeName);
+  if (stats == typeStats.end())
+    stats = typeStats.emplace(typeName, TypeStats{}).first;
+  stats->second.count++;
+  stats->second.exclusiveSize += exclusiveSize;
+
+  if (++batched == kBatchEntries)
+    flush();
+}
+
+void NodeIndexWriter::flush() {
+  if (batch->Count() == 0)
+    return;
+
+  rocksdb::WriteOptions options{};
+  options.disableWAL = true;
+  if (auto status = db->Write(options, batch.get()); !status.ok()) {
+    throw std::runtime_error("RocksDB error while writing node index: " +
+                             status.ToString());
+  }
+  batch->Clear();
+  batched = 0;
+}
+
+void NodeIndexWriter::finish() {
+  for (const auto& [typeName, stats] : typeStats) {
+    key = "T/";
+    key += typeName;
+    value.clear();
+    appendBigEndian(value, stats.count);
+    appendBigEndian(value, stats.exclusiveSize);
+    batch->Put(cf, key, value);
+  }
+  typeStats.clear();
+  flush();
+}
+
+NodeIndex::NodeIndex(const std::filesystem::path& dbPath) {
+  std::vector<rocksdb::ColumnFamilyDescriptor> families{
+      {rocksdb::kDefaultColumnFamilyName, {}},
+      {std::string{node_index::kColumnFamily}, {}},
+  };
+
+  if (auto status = rocksdb::DB::OpenForReadOnly(
+          rocksdb::DBOptions{}, dbPath.string(), families, &handles, &db);
+      !status.ok()) {
+    throw std::runtime_error("Failed to open the node index of " +
+                             dbPath.string() + ": " + status.ToString());
+  }
+}
+
+NodeIndex::~NodeIndex() {
+  for (auto* handle : handles)
+    db->DestroyColumnFamilyHandle(handle);
+  db->Close();
+  delete db;
+}
+
+std::vector<std::pair<std::string, TypeStats>> NodeIndex::topTypes(
+    size_t k) const {
+  std::vector<std::pair<std::string, TypeStats>> types;
+
+  constexpr std::string_view prefix = "T/";
+  std::unique_ptr<rocksdb::Iterator> it{
+      db->NewIterator(rocksdb::ReadOptions{}, handles[1])};
+  for (it->Seek(toSlice(prefix));
+       it->Valid() && it->key().starts_with(toSlice(prefix));
+       it->Next()) {
+    auto value = it->value();
+    if (value.size() != 2 * sizeof(uint64_t))
+      throw std::runtime_error("Corrupt node index type totals");
+
+    auto key = it->key();
+    key.remove_prefix(prefix.size());
+    types.emplace_back(key.ToString(),
+                       TypeStats{
+                           .count = readBigEndian(value.data()),
+                           .exclusiveSize = readBigEndian(value.data() + 8),
+                       });
+  }
+  if (!it->status().ok()) {
+    throw std::runtime_error("RocksDB error while reading node index: " +
+                             it->status().ToString());
+  }
+
+  k = std::min(k, types.size());
+  std::partial_sort(types.begin(),
+                    types.begin() + k,
+                    types.end(),
+                    [](const auto& lhs, const auto& rhs) {
+                      return lhs.second.exclusiveSize >
+                             rhs.second.exclusiveSize;
+                    });
+  types.resize(k);
+  return types;
+}
+
+void NodeIndex::largestNodes(const node_index::Visitor& visit) const {
+  scan("s/", visit);
+}
+
+void NodeIndex::nodesOfType(std::string_view typeName,
+                            const node_index::Visitor& visit) const {
+  std::string prefix = "t/";
+  prefix += typeName;
+  prefix += '\0';
+  scan(prefix, visit);
+}
+
+void NodeIndex::nodesUnder(std::string_view path,
+                           const node_index::Visitor& visit) const {
+  if (path.empty()) {
+    scan("p/", visit);
+    return;
+  }
+
+  // Keep "a/b" from matching "a/bc": the nodes at the path itself, then the
+  // ones below it.
+  std::string prefix = "p/";
+  prefix += path;
+  prefix += '\0';
+  if (!scan(prefix, visit))
+    return;
+
+  prefix.back() = '/';
+  scan(prefix, visit);
+}
+
+bool NodeIndex::scan(std::string_view prefix,
+                     const node_index::Visitor& visit) const {
+  std::unique_ptr<rocksdb::Iterator> it{
+      db->NewIterator(rocksdb::ReadOptions{}, handles[1])};
+  for (it->Seek(toSlice(prefix));
+       it->Valid() && it->key().starts_with(toSlice(prefix));
+       it->Next()) {
+    if (!visit(decodeEntry(it->value())))
+      return false;
+  }
+  if (!it->status().ok()) {
+    throw std::runtime_error("RocksDB error while reading node index: " +
+                             it->status().ToString());
+  }
+  return true;
+}
+
+}  // namespace oi::detail
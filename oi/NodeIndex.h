@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// See TreeBuilder.h, the rocksdb headers are too heavy to spread around
+namespace rocksdb {
+class ColumnFamilyHandle;
+class DB;
+class WriteBatch;
+}  // namespace rocksdb
+
+namespace oi::detail {
+
+/*
+ * Secondary indexes over the nodes TreeBuilder writes to RocksDB, so that
+ * queries don't have to unpack every node. They live in their own column
+ * family, leaving the nodes' keys untouched:
+ *
+ *   s/<~exclusiveSize><id>  every node, largest exclusive size first
+ *   t/<typeName>\0<id>      every node, grouped by type name
+ *   p/<path>\0<id>          every node, grouped by path
+ *   T/<typeName>            count and total exclusive size of each type
+ *
+ * A node's path joins the non-empty `typePath`s from its root to itself with
+ * '/'. Integers in keys are big endian, so they sort numerically. The node
+ * keys all map to the same node_index::Entry, so a query is answered from
+ * the index alone.
+ */
+namespace node_index {
+
+constexpr std::string_view kColumnFamily = "index";
+
+struct Entry {
+  uint64_t id;
+  uint64_t exclusiveSize;
+  std::string typeName;
+  std::string path;
+};
+
+struct TypeStats {
+  uint64_t count = 0;
+  uint64_t exclusiveSize = 0;
+};
+
+// Calls back with each matching node until it returns false
+using Visitor = std::function<bool(const Entry&)>;
+
+}  // namespace node_index
+
+class NodeIndexWriter {
+ public:
+  NodeIndexWriter(rocksdb::DB*, rocksdb::ColumnFamilyHandle*);
+  ~NodeIndexWriter();
+
+  void add(uint64_t id,
+           uint64_t exclusiveSize,
+           std::string_view typeName,
+           std::string_view path);
+
+  /* Writes out the nodes added so far */
+  void flush();
+  /* Writes out the type totals. Nodes can't be added after this. */
+  void finish();
+
+ private:
+  static constexpr size_t kBatchEntries = 4096;
+
+  rocksdb::DB* db;
+  rocksdb::ColumnFamilyHandle* cf;
+  std::unique_ptr<rocksdb::WriteBatch> batch;
+  size_t batched = 0;
+  std::string key;
+  std::string value;
+
+  std::map<std::string, node_index::TypeStats, std::less<>> typeStats;
+};
+
+/*
+ * Opens the index of a TreeBuilder database read only. Throws
+ * std::runtime_error if the database can't be opened or has no index.
+ */
+class NodeIndex {
+ public:
+  explicit NodeIndex(const std::filesystem::path& dbPath);
+  ~NodeIndex();
+
+  /* The `k` types with the largest total exclusive size */
+  std::vector<std::pair<std::string, node_index::TypeStats>> topTypes(
+      size_t k) const;
+
+  /* Every node, largest exclusive size first */
+  void largestNodes(const node_index::Visitor&) const;
+  void nodesOfType(std::string_view typeName,
+                   const node_index::Visitor&) const;
+  /* The nodes at `path` and every node below them */
+  void nodesUnder(std::string_view path, const node_index::Visitor&) const;
+
+ private:
+  /* Returns false if the visitor stopped the scan */
+  bool scan(std::string_view prefix, const node_index::Visitor&) const;
+
+  rocksdb::DB* db = nullptr;
+  std::vector<rocksdb::ColumnFamilyHandle*> handles;
+};
+
+}  // namespace oi::detail
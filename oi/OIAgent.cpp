@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "oi/OIAgent.h"
+
+/*
+ * The agent is written in assembly so that it's guaranteed to be position
+ * independent and free of any dependency: it runs on a thread created with a
+ * raw clone(2), which has no TLS of its own.
+ *
+ * Register use in the loop:
+ *   %r12: the ring
+ *   %r13d: sequence number of the next command to run
+ *   %rbx: the command being run
+ * All three are callee saved, so they survive calling the probe.
+ */
+// clang-format off
+asm(R"(
+  .pushsection .rodata
+  .p2align 4
+  .globl oi_agent_code_start
+  .hidden oi_agent_code_start
+oi_agent_code_start:
+
+.Loi_agent_main:
+  /* Never returns, so it can align the stack for the calls to the probes */
+  andq $-16, %rsp
+  movq %rdi, %r12
+  movl 4(%r12), %r13d
+
+.Loi_agent_wait:
+  movl (%r12), %eax
+  cmpl %eax, %r13d
+  jne .Loi_agent_run
+  /* futex(&ring->cmdSeq, FUTEX_WAIT, next, NULL) */
+  movq %r12, %rdi
+  xorl %esi, %esi
+  movl %r13d, %edx
+  xorl %r10d, %r10d
+  movl $202, %eax
+  syscall
+  jmp .Loi_agent_wait
+
+.Loi_agent_run:
+  movl %r13d, %eax
+  andl $15, %eax
+  shlq $4, %rax
+  leaq 16(%r12,%rax), %rbx
+  movq (%rbx), %rax
+  testq %rax, %rax
+  jz .Loi_agent_exit
+  movq 8(%rbx), %rdi
+  callq *%rax
+  call .Loi_agent_done
+  jmp .Loi_agent_wait
+
+.Loi_agent_exit:
+  call .Loi_agent_done
+  /* exit(0), which only ends this thread */
+  xorl %edi, %edi
+  movl $60, %eax
+  syscall
+  ud2
+
+.Loi_agent_done:
+  /* ++ring->doneSeq, then futex(&ring->doneSeq, FUTEX_WAKE, INT_MAX) */
+  incl %r13d
+  movl %r13d, 4(%r12)
+  leaq 4(%r12), %rdi
+  movl $1, %esi
+  movl $0x7fffffff, %edx
+  movl $202, %eax
+  syscall
+  ret
+
+  .p2align 4
+.Loi_agent_clone:
+  syscall
+  testq %rax, %rax
+  jz .Loi_agent_child
+  int3
+.Loi_agent_child:
+  /* rt_sigprocmask(SIG_SETMASK, &all, NULL, 8) */
+  pushq $-1
+  movl $2, %edi
+  movq %rsp, %rsi
+  xorl %edx, %edx
+  movl $8, %r10d
+  movl $14, %eax
+  syscall
+  popq %rax
+  movq %r12, %rdi
+  jmp .Loi_agent_main
+
+  .globl oi_agent_code_end
+  .hidden oi_agent_code_end
+oi_agent_code_end:
+
+  .p2align 3
+  .globl oi_agent_offsets
+  .hidden oi_agent_offsets
+oi_agent_offsets:
+  .quad .Loi_agent_main - oi_agent_code_start
+  .quad .Loi_agent_clone - oi_agent_code_start
+  .popsection
+)");
+// clang-format on
+
+extern "C" {
+extern const uint8_t oi_agent_code_start[];
+extern const uint8_t oi_agent_code_end[];
+extern const uint64_t oi_agent_offsets[2];
+}
+
+namespace oi::detail::agent {
+
+std::span<const uint8_t> code() {
+  return {oi_agent_code_start, oi_agent_code_end};
+}
+
+size_t mainOffset() {
+  return oi_agent_offsets[0];
+}
+
+size_t cloneOffset() {
+  return oi_agent_offsets[1];
+}
+
+}  // namespace oi::detail::agent
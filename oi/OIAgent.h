@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace oi::detail::agent {
+
+/*
+ * The in-target agent is a thread that oid starts once in the target process
+ * and that then runs installed JIT probes on request, without oid having to
+ * stop the target with ptrace.
+ *
+ * oid and the agent share a page, backed by a memfd created in the target, that
+ * holds a ring of commands. To submit a command, oid fills in the slot for
+ * `cmdSeq`, then increments `cmdSeq` and wakes its futex. The agent runs the
+ * commands in order, incrementing `doneSeq` and waking its futex as each one
+ * completes. A command with a null `func` makes the agent's thread exit.
+ *
+ * The agent's code is position independent and self contained, so it can be
+ * copied as is into the target's text segment. It uses no libc and no TLS.
+ *
+ * The agent's thread is made with a raw clone(2) and no CLONE_SETTLS, so it
+ * shares the thread pointer, and with it the TLS, of the thread that started
+ * it. The probes it runs must not use TLS either: no thread local variables
+ * and no calls into libc functions that use them, such as malloc. oid checks
+ * each probe with OICompiler::findThreadLocalUse before running it here.
+ */
+
+struct Command {
+  /* Called as `func(arg)` with the SysV calling convention */
+  uint64_t func;
+  uint64_t arg;
+};
+
+constexpr size_t ringSlots = 16;
+
+struct Ring {
+  std::atomic<uint32_t> cmdSeq;
+  std::atomic<uint32_t> doneSeq;
+  uint64_t reserved;
+  Command commands[ringSlots];
+};
+
+/* The agent's code hard codes this layout */
+static_assert(offsetof(Ring, cmdSeq) == 0);
+static_assert(offsetof(Ring, doneSeq) == 4);
+static_assert(offsetof(Ring, commands) == 16);
+static_assert(sizeof(Command) == 16);
+static_assert(sizeof(Ring) <= 4096);
+
+/* Machine code of the agent, to copy into the target */
+std::span<const uint8_t> code();
+
+/*
+ * Offset in `code()` of the agent's loop, which expects the ring's address in
+ * %rdi. It never returns: the thread running it exits on a null command.
+ */
+size_t mainOffset();
+
+/*
+ * Offset in `code()` of the clone trampoline. A thread made to run it with the
+ * arguments of a clone(2) syscall in place, and the ring's address in %r12,
+ * makes the syscall and then stops on an INT3 with the new thread's TID in
+ * %rax. The new thread blocks all signals and runs the agent's loop on the
+ * stack passed to clone(2).
+ */
+size_t cloneOffset();
+
+/*
+ * Flags for the clone(2) syscall starting the agent's thread. There's no
+ * CLONE_SETTLS: see above.
+ */
+constexpr uint64_t cloneFlags = 0x00000100 |  // CLONE_VM
+                                0x00000200 |  // CLONE_FS
+                                0x00000400 |  // CLONE_FILES
+                                0x00000800 |  // CLONE_SIGHAND
+                                0x00010000 |  // CLONE_THREAD
+                                0x00040000;   // CLONE_SYSVSEM
+
+}  // namespace oi::detail::agent
@@ -3063,6 +3063,7 @@ bool OICodeGen::generateJitCode(std::string& code) {
   code.append("namespace {\n");
   code.append("static struct Context {\n");
   code.append("  PointerHashSet<> pointers;\n");
+  code.append("  TraversalBudget budget;\n");
   code.append("} ctx;\n");
   code.append("} // namespace\n");
 
@@ -3284,7 +3285,8 @@ bool OICodeGen::generateJitCode(std::string& code) {
       JLOG("ptr val @");
       JLOGPTR(s_ptr);
       StoreData((uintptr_t)(s_ptr), returnArg);
-      if (s_ptr && ctx.pointers.add((uintptr_t)s_ptr)) {
+      if (s_ptr && !ctx.budget.exhausted(returnArg) &&
+          ctx.pointers.add((uintptr_t)s_ptr)) {
         StoreData(1, returnArg);
         getSizeType(*(s_ptr), returnArg);
       } else {
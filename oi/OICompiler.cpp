@@ -27,7 +27,9 @@
 #include <clang/Lex/PreprocessorOptions.h>
 #include <glog/logging.h>
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringSet.h>
 #include <llvm/ADT/Twine.h>
+#include <llvm/BinaryFormat/ELF.h>
 #include <llvm/Demangle/Demangle.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/ExecutionEngine/RTDyldMemoryManager.h>
@@ -38,6 +40,7 @@
 #include <llvm/Support/Host.h>
 #endif
 #include <llvm/Support/Memory.h>
+#include <llvm/Support/Process.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/raw_os_ostream.h>
 
@@ -50,6 +53,7 @@
 #include <array>
 #include <boost/range/combine.hpp>
 #include <boost/scope_exit.hpp>
+#include <numeric>
 
 #include "oi/Headers.h"
 #include "oi/Metrics.h"
@@ -161,10 +165,13 @@ class OIMemoryManager : public RTDyldMemoryManager {
      * The slab is divided in two segments in this order:
      * 1. The text segment, to host the executable instructions
      * 2. The data segment, to host the static variables
-     * At the minute, we make no differentiation between RW/RO data segments.
+     * By default we make no differentiation between RW/RO data segments.
      * We don't set the correct permissions on the pages allocated in the target
      * process. Adding that would require making lots of `mprotect(2)` syscalls
      * and introduce more latency.
+     * When `separateWritable` is set, RW data is instead moved to a third
+     * segment starting on a page boundary, so that everything before it can be
+     * made read-only once the slab has been copied to its final location.
      */
     static sys::MemoryBlock allocateBlock(size_t totalSize) {
       std::error_code errorCode;
@@ -189,18 +196,47 @@ class OIMemoryManager : public RTDyldMemoryManager {
     }
 
    public:
-    Slab(size_t totalSize, size_t codeSize, size_t dataSize)
-        : memBlock{allocateBlock(totalSize)},
-          /*
-           * Allow some extra space to allow for alignment needs of segments.
-           * 128 bytes should be ample and well within our "slop" allocation.
-           */
-          textSegBase{(uintptr_t)memBlock.base()},
-          textSegLimit{alignTo(textSegBase + codeSize, 128)},
-          dataSegBase{textSegLimit},
-          dataSegLimit{alignTo(dataSegBase + dataSize, 128)} {
-      assert(dataSegLimit <=
-             (uintptr_t)memBlock.base() + memBlock.allocatedSize());
+    Slab(size_t codeSize,
+         size_t roDataSize,
+         size_t rwDataSize,
+         bool separateWritable) {
+      /*
+       * Allow some extra space to allow for alignment needs of segments.
+       * 128 bytes should be ample and well within our "slop" allocation.
+       */
+      size_t textSegEnd = alignTo(codeSize, 128);
+      size_t dataSegEnd, rwDataSegStart, rwDataSegEnd;
+      if (separateWritable) {
+        dataSegEnd = alignTo(textSegEnd + roDataSize + 128, 128);
+        rwDataSegStart =
+            alignTo(dataSegEnd, sys::Process::getPageSizeEstimate());
+        rwDataSegEnd = alignTo(rwDataSegStart + rwDataSize + 128, 128);
+      } else {
+        dataSegEnd = alignTo(textSegEnd + roDataSize + rwDataSize + 128, 128);
+        rwDataSegStart = rwDataSegEnd = dataSegEnd;
+      }
+
+      /*
+       * It looks like the sizes given to us already take into account the
+       * alignment restrictions the different type of sections may have.
+       * Aligning to the next 1KB boundary just for a bit of safety-slush
+       * (paranoia really).
+       */
+      memBlock = allocateBlock(
+          separateWritable ? rwDataSegEnd
+                           : alignTo(codeSize + roDataSize + rwDataSize, 1024));
+
+      auto base = (uintptr_t)memBlock.base();
+      textSegBase = base;
+      textSegLimit = base + textSegEnd;
+      dataSegBase = textSegLimit;
+      dataSegLimit = base + dataSegEnd;
+      rwDataSegBase = base + rwDataSegStart;
+      rwDataSegLimit = base + rwDataSegEnd;
+      writableOffset = separateWritable ? rwDataSegStart : textSegEnd;
+      this->separateWritable = separateWritable;
+
+      assert(rwDataSegLimit <= base + memBlock.allocatedSize());
 
       /* Fill the slab with NOP instructions */
       memset(memBlock.base(), nopInst, memBlock.allocatedSize());
@@ -215,14 +251,29 @@ class OIMemoryManager : public RTDyldMemoryManager {
     SmallVector<sys::MemoryBlock, 8> dataSections{};
 
     uintptr_t textSegBase = 0;
-    const uintptr_t textSegLimit = 0;
+    uintptr_t textSegLimit = 0;
 
     uintptr_t dataSegBase = 0;
-    const uintptr_t dataSegLimit = 0;
-
-    uint8_t* allocate(uintptr_t Size, unsigned Alignment, bool isCode) {
-      auto* allocOffset = isCode ? &textSegBase : &dataSegBase;
-      auto allocLimit = isCode ? textSegLimit : dataSegLimit;
+    uintptr_t dataSegLimit = 0;
+
+    uintptr_t rwDataSegBase = 0;
+    uintptr_t rwDataSegLimit = 0;
+
+    /* Offset of the first byte that may need to stay writable */
+    size_t writableOffset = 0;
+    bool separateWritable = false;
+
+    uint8_t* allocate(uintptr_t Size,
+                      unsigned Alignment,
+                      bool isCode,
+                      bool isReadOnly = true) {
+      bool isRwData = !isCode && !isReadOnly && separateWritable;
+      auto* allocOffset = isCode     ? &textSegBase
+                          : isRwData ? &rwDataSegBase
+                                     : &dataSegBase;
+      auto allocLimit = isCode     ? textSegLimit
+                        : isRwData ? rwDataSegLimit
+                                   : dataSegLimit;
 
       VLOG(1) << "allocateFromSlab " << (isCode ? "Code " : "Data ") << " Size "
               << Size << " allocOffset " << std::hex << *allocOffset
@@ -251,10 +302,12 @@ class OIMemoryManager : public RTDyldMemoryManager {
 
   SmallVector<Slab, 4> Slabs{};
   OIMemoryManager(std::shared_ptr<SymbolService> ss,
-                  const std::unordered_map<std::string, uintptr_t>& synths)
+                  const std::unordered_map<std::string, uintptr_t>& synths,
+                  bool separateWritable)
       : RTDyldMemoryManager{},
         symbols{std::move(ss)},
-        syntheticSymbols{synths} {
+        syntheticSymbols{synths},
+        separateWritable{separateWritable} {
   }
 
   /* Hook to make LLVM call `reserveAllocationSpace()` for each Object file */
@@ -296,6 +349,7 @@ class OIMemoryManager : public RTDyldMemoryManager {
  private:
   std::shared_ptr<SymbolService> symbols;
   const std::unordered_map<std::string, uintptr_t>& syntheticSymbols;
+  bool separateWritable;
 
   Slab& currentSlab() {
     assert(!Slabs.empty());
@@ -314,20 +368,12 @@ void OIMemoryManager::reserveAllocationSpace(
   llvm::Align roDataAlign{roDataAlignIn};
   llvm::Align rwDataAlign{rwDataAlignIn};
 
-  /*
-   * It looks like the sizes given to us already take into account the
-   * alignment restrictions the different type of sections may have. Aligning
-   * to the next 1KB boundary just for a bit of safety-slush (paranoia really).
-   */
-  uint64_t totalSz = alignTo((codeSize + roDataSize + rwDataSize), 1024);
-
   VLOG(1) << "reserveAllocationSpace: codesize " << codeSize << " codeAlign "
           << codeAlign.value() << " roDataSize " << roDataSize
           << " roDataAlign " << roDataAlign.value() << " rwDataSize "
-          << rwDataSize << " rwDataAlign " << rwDataAlign.value()
-          << " (Total Size: " << totalSz << ")";
+          << rwDataSize << " rwDataAlign " << rwDataAlign.value();
 
-  Slabs.emplace_back(totalSz, codeSize, roDataSize + rwDataSize + 128);
+  Slabs.emplace_back(codeSize, roDataSize, rwDataSize, separateWritable);
 
   const auto& currSlab = currentSlab();
   VLOG(1) << "reserveAllocationSpace: " << std::hex << "SlabBase "
@@ -354,12 +400,13 @@ uint8_t* OIMemoryManager::allocateDataSection(
     unsigned alignment,
     [[maybe_unused]] unsigned sectionID,
     StringRef sectionName,
-    [[maybe_unused]] bool isReadOnly) {
+    bool isReadOnly) {
   VLOG(1) << "allocateDataSection(Size = " << size
           << ", Alignment = " << alignment
           << ", SectionName = " << sectionName.data() << ")";
 
-  return currentSlab().allocate(size, alignment, false /* isCode */);
+  return currentSlab().allocate(
+      size, alignment, false /* isCode */, isReadOnly);
 }
 
 /*
@@ -563,7 +610,8 @@ bool OICompiler::compile(const std::string& code,
 
   static const auto syntheticHeaders =
       std::array<std::pair<Feature, std::pair<std::string_view, std::string>>,
-                 7>{{
+                 9>{{
+          {Feature::TreeBuilderV2, {headers::oi_Budget_h, "oi/Budget.h"}},
           {Feature::TreeBuilderV2, {headers::oi_types_st_h, "oi/types/st.h"}},
           {Feature::TreeBuilderV2, {headers::oi_types_dy_h, "oi/types/dy.h"}},
           {Feature::TreeBuilderV2,
@@ -577,6 +625,8 @@ bool OICompiler::compile(const std::string& code,
           {Feature::Library,
            {headers::oi_IntrospectionResult_inl_h,
             "oi/IntrospectionResult-inl.h"}},
+          {Feature::ParallelTraversal,
+           {headers::oi_ConcurrentPointerSet_h, "oi/ConcurrentPointerSet.h"}},
       }};
   for (const auto& [k, v] : syntheticHeaders) {
     if (!config.features[k])
@@ -658,9 +708,29 @@ std::optional<OICompiler::RelocResult> OICompiler::applyRelocs(
     uintptr_t baseRelocAddress,
     const std::set<fs::path>& objectFiles,
     const std::unordered_map<std::string, uintptr_t>& syntheticSymbols) {
+  return applyRelocs(
+      [baseRelocAddress](size_t) { return baseRelocAddress; },
+      false,
+      objectFiles,
+      syntheticSymbols);
+}
+
+std::optional<OICompiler::RelocResult> OICompiler::applyRelocs(
+    const std::function<std::optional<uintptr_t>(size_t)>& allocate,
+    const std::set<fs::path>& objectFiles,
+    const std::unordered_map<std::string, uintptr_t>& syntheticSymbols) {
+  return applyRelocs(allocate, true, objectFiles, syntheticSymbols);
+}
+
+std::optional<OICompiler::RelocResult> OICompiler::applyRelocs(
+    const std::function<std::optional<uintptr_t>(size_t)>& allocate,
+    bool separateWritable,
+    const std::set<fs::path>& objectFiles,
+    const std::unordered_map<std::string, uintptr_t>& syntheticSymbols) {
   metrics::Tracing relocationTracing("relocation");
 
-  memMgr = std::make_unique<OIMemoryManager>(symbols, syntheticSymbols);
+  memMgr = std::make_unique<OIMemoryManager>(
+      symbols, syntheticSymbols, separateWritable);
   RuntimeDyld dyld(*memMgr, *memMgr);
 
   /* Load all the object files into the MemoryManager */
@@ -680,11 +750,25 @@ std::optional<OICompiler::RelocResult> OICompiler::applyRelocs(
     }
   }
 
+  /* Slabs must start on a page boundary to set their permissions separately */
+  const size_t slabAlign =
+      separateWritable ? sys::Process::getPageSizeEstimate() : 128;
+  size_t totalSize = 0;
+  for (const auto& slab : memMgr->Slabs)
+    totalSize = alignTo(totalSize + slab.memBlock.allocatedSize(), slabAlign);
+
+  auto baseRelocAddress = allocate(totalSize);
+  if (!baseRelocAddress) {
+    LOG(ERROR) << "Failed to allocate " << totalSize
+               << " bytes for the relocated objects";
+    return std::nullopt;
+  }
+
   RelocResult res;
   res.relocInfos.reserve(memMgr->Slabs.size());
 
   /* Provides mapping addresses to the MemoryManager */
-  uintptr_t currentRelocAddress = baseRelocAddress;
+  uintptr_t currentRelocAddress = *baseRelocAddress;
   for (const auto& slab : memMgr->Slabs) {
     for (const auto& funcSection : slab.functionSections) {
       auto offset =
@@ -707,9 +791,10 @@ std::optional<OICompiler::RelocResult> OICompiler::applyRelocs(
     res.relocInfos.push_back(
         RelocResult::RelocInfo{(uintptr_t)slab.memBlock.base(),
                                currentRelocAddress,
-                               slab.memBlock.allocatedSize()});
-    currentRelocAddress =
-        alignTo(currentRelocAddress + slab.memBlock.allocatedSize(), 128);
+                               slab.memBlock.allocatedSize(),
+                               slab.writableOffset});
+    currentRelocAddress = alignTo(
+        currentRelocAddress + slab.memBlock.allocatedSize(), slabAlign);
     res.newBaseRelocAddr = currentRelocAddress;
   }
 
@@ -729,6 +814,14 @@ std::optional<OICompiler::RelocResult> OICompiler::applyRelocs(
     res.symbols.emplace(symName.str(), sym.getAddress());
   }
 
+  metrics::Tracing::counter(
+      "object_bytes",
+      std::accumulate(res.relocInfos.begin(),
+                      res.relocInfos.end(),
+                      size_t{0},
+                      [](size_t acc, const auto& info) {
+                        return acc + info.Size;
+                      }));
   relocationTracing.stop();
 
   if (VLOG_IS_ON(3)) {
@@ -738,4 +831,95 @@ std::optional<OICompiler::RelocResult> OICompiler::applyRelocs(
   return res;
 }
 
+std::optional<std::string> OICompiler::findThreadLocalUse(
+    const std::set<fs::path>& objectFiles) {
+  // Called by the compiler for copies and initialisation, and free of TLS
+  static const StringSet<> tlsFreeFunctions{
+      "bcmp", "memcmp", "memcpy", "memmove", "memset", "strlen",
+  };
+
+  for (const auto& objPath : objectFiles) {
+    auto objFile = ObjectFile::createObjectFile(objPath.c_str());
+    if (!objFile) {
+      consumeError(objFile.takeError());
+      return std::nullopt;
+    }
+    const ObjectFile& obj = *objFile->getBinary();
+
+    for (const SectionRef& section : obj.sections()) {
+      // ELF keeps relocations in sections of their own
+      StringRef contents;
+      auto relocated = section.getRelocatedSection();
+      if (!relocated) {
+        consumeError(relocated.takeError());
+        continue;
+      }
+      if (*relocated != obj.section_end() && (*relocated)->isText()) {
+        auto sectionContents = (*relocated)->getContents();
+        if (!sectionContents) {
+          consumeError(sectionContents.takeError());
+          continue;
+        }
+        contents = *sectionContents;
+      }
+
+      // Whether the relocated operand is the target of a call or a jump
+      auto isBranch = [&contents](uint64_t offset) {
+        auto byte = [&](uint64_t back) -> uint8_t {
+          return offset >= back && offset - back < contents.size()
+                     ? contents[offset - back]
+                     : 0;
+        };
+        return byte(1) == 0xE8 || byte(1) == 0xE9 ||  // call/jmp rel32
+               (byte(2) == 0xFF &&  // call/jmp *sym@GOTPCREL(%rip)
+                (byte(1) == 0x15 || byte(1) == 0x25)) ||
+               (byte(2) == 0x0F && (byte(1) & 0xF0) == 0x80);  // jcc rel32
+      };
+
+      for (const RelocationRef& reloc : section.relocations()) {
+        auto sym = reloc.getSymbol();
+        if (sym == obj.symbol_end())
+          continue;
+
+        auto name = sym->getName();
+        auto flags = sym->getFlags();
+        if (!name || !flags) {
+          consumeError(name.takeError());
+          consumeError(flags.takeError());
+          continue;
+        }
+
+        switch (reloc.getType()) {
+          case ELF::R_X86_64_DTPMOD64:
+          case ELF::R_X86_64_DTPOFF64:
+          case ELF::R_X86_64_TPOFF64:
+          case ELF::R_X86_64_TLSGD:
+          case ELF::R_X86_64_TLSLD:
+          case ELF::R_X86_64_DTPOFF32:
+          case ELF::R_X86_64_GOTTPOFF:
+          case ELF::R_X86_64_TPOFF32:
+          case ELF::R_X86_64_GOTPC32_TLSDESC:
+          case ELF::R_X86_64_TLSDESC_CALL:
+          case ELF::R_X86_64_TLSDESC:
+            return name->str();
+          case ELF::R_X86_64_PC32:
+          case ELF::R_X86_64_PLT32:
+          case ELF::R_X86_64_GOTPCREL:
+          case ELF::R_X86_64_GOTPCRELX:
+          case ELF::R_X86_64_REX_GOTPCRELX:
+            // Calls to functions defined outside of the JIT code
+            if ((*flags & SymbolRef::SF_Undefined) &&
+                isBranch(reloc.getOffset()) &&
+                !tlsFreeFunctions.contains(*name))
+              return name->str();
+            break;
+          default:
+            break;
+        }
+      }
+    }
+  }
+  return std::nullopt;
+}
+
 }  // namespace oi::detail
@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <array>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <range/v3/algorithm/find_if.hpp>
@@ -69,6 +70,9 @@ class OICompiler {
      * RelocAddr contains the relocated address of the object file buffer.
      * Size is the size of the object file buffer in bytes.
      *
+     * WritableOffset is the offset of the first byte that may be written to
+     * at runtime. Everything before it is code or read-only data.
+     *
      * You typically need to copy the BaseAddr buffer to RelocAddr in order to
      * finalize the relocation.
      * Note that we don't manage separate segments for code and data. Thus, the
@@ -77,6 +81,7 @@ class OICompiler {
     struct RelocInfo {
       uintptr_t BaseAddr, RelocAddr;
       size_t Size;
+      size_t WritableOffset;
     };
 
     using RelocInfos = std::vector<RelocInfo>;
@@ -161,6 +166,34 @@ class OICompiler {
       const std::set<fs::path>&,
       const std::unordered_map<std::string, uintptr_t>&);
 
+  /**
+   * As above, but the relocation address is only chosen once the objects have
+   * been loaded and their size is known.
+   *
+   * Each Slab starts on a page boundary and its writable data is moved to
+   * pages of its own, so the pages before each Slab's WritableOffset can be
+   * made read-only and executable once copied.
+   *
+   * @param allocate called with the total size of the relocated Slabs, returns
+   * a page aligned address to relocate them to or std::nullopt on failure
+   */
+  std::optional<RelocResult> applyRelocs(
+      const std::function<std::optional<uintptr_t>(size_t)>& allocate,
+      const std::set<fs::path>&,
+      const std::unordered_map<std::string, uintptr_t>&);
+
+  /**
+   * Checks that the code in @param objectFiles can run on a thread that has
+   * no TLS of its own, such as the agent's: it may not access thread local
+   * variables, nor call external functions other than a few that are known
+   * not to use TLS.
+   *
+   * @return the first offending symbol, or std::nullopt if there is none or
+   * an object file can't be read, which applyRelocs() reports
+   */
+  static std::optional<std::string> findThreadLocalUse(
+      const std::set<fs::path>& objectFiles);
+
   /**
    * Locates all the offsets of the given @param insts opcodes
    * in the @param funcText. Typically used to find all `ret` instructions
@@ -187,6 +220,12 @@ class OICompiler {
   std::shared_ptr<SymbolService> symbols;
   Config config;
 
+  std::optional<RelocResult> applyRelocs(
+      const std::function<std::optional<uintptr_t>(size_t)>& allocate,
+      bool separateWritable,
+      const std::set<fs::path>&,
+      const std::unordered_map<std::string, uintptr_t>&);
+
   /**
    * memMgr is only used by applyReloc, but its lifetime must be larger than
    * the duration of the function. The RelocResult returned references addrs
@@ -17,17 +17,29 @@
 #include <glog/logging.h>
 
 #include <boost/scope_exit.hpp>
+#include <cctype>
+#include <chrono>
 #include <csignal>
 #include <cstdlib>
+#include <ctime>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 extern "C" {
 #include <getopt.h>
 #include <libgen.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
 }
 
 #include "oi/Config.h"
@@ -67,6 +79,7 @@ enum ExitStatus {
   ProcessingTargetDataError,
   OidObjectError,
   CacheUploadError,
+  ServerError,
 };
 }
 
@@ -135,6 +148,35 @@ constexpr static OIOpts opts{
           required_argument,
           "<seconds>",
           "How long to probe the target process for"},
+    OIOpt{'I',
+          "interval",
+          required_argument,
+          "<seconds>",
+          "Probe the target again every <seconds>, keeping the probe\n"
+          "installed in between. Runs until interrupted unless '-n' is given"},
+    OIOpt{'n',
+          "samples",
+          required_argument,
+          "<count>",
+          "Number of times to probe the target (default: 1)\n"
+          "Each sample's JSON goes to its own file, numbered from 1"},
+    OIOpt{'T',
+          "max-time",
+          required_argument,
+          "<ms>",
+          "Stop traversing an object after this long (default: unlimited)\n"
+          "Results are marked as truncated"},
+    OIOpt{'X',
+          "max-bytes",
+          required_argument,
+          "<bytes>",
+          "Stop traversing an object after writing this much data\n"
+          "Accepts multiplicative suffix: K, M, G, T, P, E"},
+    OIOpt{'N',
+          "max-elements",
+          required_argument,
+          "<count>",
+          "Stop traversing an object after visiting this many elements"},
     OIOpt{'k',
           "custom-code-file",
           required_argument,
@@ -164,6 +206,12 @@ constexpr static OIOpts opts{
           "</path/to/binary>\n"
           "Run oid on a executable with debug infos instead of a running "
           "process"},
+    OIOpt{'K',
+          "core",
+          required_argument,
+          "<path/to/core>",
+          "Probe a core dump of the '-i' executable instead of compiling only\n"
+          "Only global probes can run against a core"},
     // Optional arguments are pretty nasty - it will only work as
     // "--dump-json=PATH" and not "--dump-json PATH". Try and make this take a
     // required argument at a later point
@@ -193,6 +241,18 @@ constexpr static OIOpts opts{
           required_argument,
           "FEATURE",
           "Disable feature"},
+    OIOpt{'D',
+          "server",
+          required_argument,
+          "<socket>",
+          "Serve probe requests from 'oid --connect' on a Unix socket\n"
+          "Keeps debug info and compiled probes of each process between "
+          "requests"},
+    OIOpt{'C',
+          "connect",
+          required_argument,
+          "<socket>",
+          "Send this command line to an 'oid --server' listening on <socket>"},
 };
 
 void usage() {
@@ -289,16 +349,30 @@ std::optional<long> strunittol(const char* str) {
   return retval;
 }
 
+/* Parses a whole string as a positive decimal number */
+std::optional<long> strtolpos(const char* str) {
+  errno = 0;
+  char* strend = nullptr;
+  long retval = strtol(str, &strend, 10);
+  if (errno != 0 || strend == str || *strend != '\0' || retval <= 0) {
+    return std::nullopt;
+  }
+  return retval;
+}
+
 namespace Oid {
 
 struct Config {
   pid_t pid;
   std::string debugInfoFile;
+  fs::path coreFile;
   std::vector<fs::path> configFiles;
   fs::path cacheBasePath;
   fs::path customCodeFile;
   size_t dataSegSize;
   int timeout_s;
+  int interval_s;
+  size_t samples;
   bool cacheRemoteUpload;
   bool cacheRemoteDownload;
   bool removeMappings;
@@ -307,17 +381,168 @@ struct Config {
   bool attachToProcess = true;
   bool hardDisableDrgn = false;
   bool strict = false;
+  oi::Budget budget;
+};
+
+/* Everything taken from a single oid command line */
+struct Args {
+  Config oidConfig{};
+  std::string scriptFile;
+  std::string scriptSource;
+  std::optional<fs::path> jsonPath{std::nullopt};
+
+  std::map<Feature, bool> features = {
+      {Feature::PackStructs, true},
+      {Feature::GenPaddingStats, true},
+      {Feature::TypeGraph, true},
+      {Feature::PruneTypeGraph, true},
+  };
+
+  bool logAllStructs = true;
+  bool dumpDataSegment = false;
+
+  fs::path serverSocket;
+  fs::path connectSocket;
+};
+
+/*
+ * State that `oid --server` keeps alive between requests for one process.
+ * The drgn program and the function descriptions live in the SymbolService.
+ * Segments are found again through the segment config file, and compiled
+ * probes through the OICache.
+ */
+struct Session {
+  unsigned long long startTime;
+  std::shared_ptr<SymbolService> symbols;
 };
 
 }  // namespace Oid
 
+/*
+ * Patches the probe into the target, waits for it to fire and reads back its
+ * results. The probe must already be compiled and installed.
+ */
+static ExitStatus::ExitStatus runProbe(OIDebugger& oid,
+                                       const Oid::Config& oidConfig) {
+  // Probes run by the agent or against a core need no traps
+  bool sandboxed = oid.sandboxRunning();
+  if (sandboxed || (oid.agentEnabled() && oid.isGlobalDataProbeEnabled())) {
+    if (oidConfig.timeout_s > 0) {
+      alarm(oidConfig.timeout_s);
+    }
+
+    bool ran = sandboxed ? oid.runSandboxProbe() : oid.runAgentProbe();
+    alarm(0);
+    if (!ran) {
+      LOG(ERROR) << "Couldn't run the probe "
+                 << (sandboxed ? "against the core" : "from the agent");
+      return ExitStatus::PatchingError;
+    }
+
+    if (!oid.isInterrupted() && !oid.processTargetData()) {
+      LOG(ERROR) << "Problems processing target data";
+      return ExitStatus::ProcessingTargetDataError;
+    }
+    return ExitStatus::Success;
+  }
+
+  /*
+   * I think we might be able to just fit the global variable work entirely
+   * under patchFunctions and therefore leave the shape of the code at
+   * this level pretty much unaltered.
+   */
+  auto stopStart = time_hr::now();
+  if (!oid.stopTarget()) {
+    LOG(ERROR) << "Couldn't stop target process with PID " << oidConfig.pid;
+    return ExitStatus::StopTargetError;
+  }
+
+  if (!oid.patchFunctions()) {
+    oid.contTargetThread();
+    LOG(ERROR) << "Error patching functions";
+    return ExitStatus::PatchingError;
+  }
+
+  oid.contTargetThread(false);
+
+  auto stoppedNs = time_ns(time_hr::now() - stopStart);
+  metrics::Tracing::counter("patch_stop_ns", stoppedNs);
+  LOG(INFO) << "Target stopped for " << stoppedNs << " nsecs to insert traps";
+
+  if (oidConfig.timeout_s > 0) {
+    alarm(oidConfig.timeout_s);
+  }
+
+  while (!oid.isInterrupted()) {
+    if (oid.processTrap(oidConfig.pid) == OIDebugger::OID_DONE) {
+      break;
+    }
+  };
+
+  // Disable timeout timer
+  alarm(0);
+
+  // Cleanup all the remaining traps that were injected
+  if (!oid.removeTraps(0)) {
+    LOG(ERROR) << "Failed to remove instrumentation...";
+  }
+
+  {  // Resume stopped thread before cleanup
+    VLOG(1) << "Resuming stopped threads...";
+    metrics::Tracing __("resume_threads");
+    while (oid.processTrap(oidConfig.pid, false) == OIDebugger::OID_CONT) {
+    }
+  }
+
+  oid.restoreState();
+
+  if (!oid.isInterrupted() && !oid.processTargetData()) {
+    LOG(ERROR) << "Problems processing target data";
+    return ExitStatus::ProcessingTargetDataError;
+  }
+
+  return ExitStatus::Success;
+}
+
+/*
+ * Sleeps until `deadline` or until oid is interrupted. Returns false if
+ * interrupted.
+ */
+static bool sleepUntil(time_hr::time_point deadline, const OIDebugger& oid) {
+  while (!oid.isInterrupted()) {
+    auto left = deadline - time_hr::now();
+    if (left <= time_hr::duration::zero()) {
+      return true;
+    }
+
+    auto secs = std::chrono::duration_cast<std::chrono::seconds>(left);
+    struct timespec req {
+      .tv_sec = secs.count(),
+      .tv_nsec = time_ns(left - secs),
+    };
+    // A signal cuts the sleep short, then check if it asked us to stop
+    nanosleep(&req, nullptr);
+  }
+  return false;
+}
+
+/* Path of the JSON output of a sample: oid_out.json -> oid_out.<n>.json */
+static std::string samplePath(const fs::path& path, size_t sample) {
+  auto res = path;
+  res.replace_extension();
+  res += "." + std::to_string(sample);
+  res += path.extension();
+  return res.string();
+}
+
 static ExitStatus::ExitStatus runScript(
     const std::string& fileName,
     std::istream& script,
     const Oid::Config& oidConfig,
     const OICodeGen::Config& codeGenConfig,
     const OICompiler::Config& compilerConfig,
-    const TreeBuilder::Config& tbConfig) {
+    const TreeBuilder::Config& tbConfig,
+    std::shared_ptr<SymbolService> symbols) {
   if (!fileName.empty()) {
     VLOG(1) << "SCR FILE: " << fileName;
   }
@@ -325,9 +550,21 @@ static ExitStatus::ExitStatus runScript(
   auto progStart = time_hr::now();
 
   std::shared_ptr<OIDebugger> oid;  // share oid with the global signal handler
-  if (oidConfig.pid != 0) {
+  if (oidConfig.pid != 0 && symbols) {
+    oid = std::make_shared<OIDebugger>(oidConfig.pid,
+                                       std::move(symbols),
+                                       codeGenConfig,
+                                       compilerConfig,
+                                       tbConfig);
+  } else if (oidConfig.pid != 0) {
     oid = std::make_shared<OIDebugger>(
         oidConfig.pid, codeGenConfig, compilerConfig, tbConfig);
+  } else if (!oidConfig.coreFile.empty()) {
+    oid = std::make_shared<OIDebugger>(oidConfig.debugInfoFile,
+                                       oidConfig.coreFile,
+                                       codeGenConfig,
+                                       compilerConfig,
+                                       tbConfig);
   } else {
     oid = std::make_shared<OIDebugger>(
         oidConfig.debugInfoFile, codeGenConfig, compilerConfig, tbConfig);
@@ -346,6 +583,7 @@ static ExitStatus::ExitStatus runScript(
   oid->setCustomCodeFile(oidConfig.customCodeFile);
   oid->setHardDisableDrgn(oidConfig.hardDisableDrgn);
   oid->setStrict(oidConfig.strict);
+  oid->setBudget(oidConfig.budget);
 
   VLOG(1) << "OIDebugger constructor took " << std::dec
           << time_ns(time_hr::now() - progStart) << " nsecs";
@@ -357,7 +595,21 @@ static ExitStatus::ExitStatus runScript(
     return ExitStatus::ScriptParsingError;
   }
 
-  if (oidConfig.attachToProcess && !oid->stopTarget()) {
+  if (oidConfig.dataSegSize > 0) {
+    oid->setDataSegmentSize(oidConfig.dataSegSize);
+  }
+
+  /*
+   * Global probes run by an agent already started in the target don't need
+   * it stopped, unless its segments change.
+   */
+  bool viaAgent = oidConfig.attachToProcess && oid->agentEnabled() &&
+                  oid->isGlobalDataProbeEnabled();
+  bool stopTarget = oidConfig.attachToProcess &&
+                    (oidConfig.removeMappings || !viaAgent ||
+                     !oid->agentRunning() || oid->segmentsChanged());
+
+  if (stopTarget && !oid->stopTarget()) {
     LOG(ERROR) << "Couldn't stop target process with PID " << oidConfig.pid;
     return ExitStatus::StopTargetError;
   }
@@ -388,19 +640,36 @@ static ExitStatus::ExitStatus runScript(
       return ret;
     }
 
-    if (oidConfig.dataSegSize > 0) {
-      oid->setDataSegmentSize(oidConfig.dataSegSize);
+    if (!oid->segmentInit()) {
+      if (stopTarget) {
+        oid->contTargetThread();
+      }
+      LOG(ERROR) << "Failed to initialise segments in target process with PID "
+                 << oidConfig.pid;
+      return ExitStatus::SegmentInitError;
     }
 
-    if (!oid->segmentInit()) {
+    if (viaAgent && !oid->agentRunning() && !oid->startAgent()) {
       oid->contTargetThread();
-      LOG(ERROR) << "Failed to initialise segments in target process with PID "
+      LOG(ERROR) << "Failed to start the agent in target process with PID "
                  << oidConfig.pid;
       return ExitStatus::SegmentInitError;
     }
 
     // continue and detach main thread
-    oid->contTargetThread();
+    if (stopTarget) {
+      oid->contTargetThread();
+    }
+  } else if (!oidConfig.coreFile.empty()) {
+    if (!oid->isGlobalDataProbeEnabled()) {
+      LOG(ERROR) << "Only global probes can run against a core";
+      return ExitStatus::UsageError;
+    }
+
+    if (!oid->startSandbox()) {
+      LOG(ERROR) << "Failed to set up the core " << oidConfig.coreFile;
+      return ExitStatus::SegmentInitError;
+    }
   }
 
   VLOG(1) << "init took " << std::dec << time_ns(time_hr::now() - initStart)
@@ -438,57 +707,46 @@ static ExitStatus::ExitStatus runScript(
       oid->setMode(OIDebugger::OID_MODE_FUNC);
     }
 
-    /*
-     * I think we might be able to just fit the global variable work entirely
-     * under patchFunctions and therefore leave the shape of the code at
-     * this level pretty much unaltered.
-     */
-    if (!oid->stopTarget()) {
-      LOG(ERROR) << "Couldn't stop target process with PID " << oidConfig.pid;
-      return ExitStatus::StopTargetError;
-    }
+    bool sampling = oidConfig.samples > 1;
+    for (size_t sample = 1; sample <= oidConfig.samples; sample++) {
+      auto sampleStart = time_hr::now();
 
-    if (!oid->patchFunctions()) {
-      oid->contTargetThread();
-      LOG(ERROR) << "Error patching functions";
-      return ExitStatus::PatchingError;
-    }
+      if (sample > 1 && !oid->rearmProbe()) {
+        return ExitStatus::PatchingError;
+      }
 
-    oid->contTargetThread(false);
+      if (sampling && tbConfig.jsonPath.has_value()) {
+        oid->setJsonPath(samplePath(*tbConfig.jsonPath, sample));
+      }
 
-    if (oidConfig.timeout_s > 0) {
-      alarm(oidConfig.timeout_s);
-    }
+      auto status = runProbe(*oid, oidConfig);
+      if (status != ExitStatus::Success) {
+        return status;
+      }
 
-    while (!oid->isInterrupted()) {
-      if (oid->processTrap(oidConfig.pid) == OIDebugger::OID_DONE) {
+      if (oid->isInterrupted()) {
         break;
       }
-    };
 
-    // Disable timeout timer
-    alarm(0);
-
-    // Cleanup all the remaining traps that were injected
-    if (!oid->removeTraps(0)) {
-      LOG(ERROR) << "Failed to remove instrumentation...";
-    }
-
-    {  // Resume stopped thread before cleanup
-      VLOG(1) << "Resuming stopped threads...";
-      metrics::Tracing __("resume_threads");
-      while (oid->processTrap(oidConfig.pid, false) == OIDebugger::OID_CONT) {
+      if (sampling) {
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        std::cout << "SAMPLE " << sample << " time_ms "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(now)
+                         .count()
+                  << " pause_ns " << oid->getProbePauseTime().count()
+                  << std::endl;
       }
-    }
-
-    oid->restoreState();
 
-    if (!oid->isInterrupted() && !oid->processTargetData()) {
-      LOG(ERROR) << "Problems processing target data";
-      return ExitStatus::ProcessingTargetDataError;
+      if (sample < oidConfig.samples &&
+          !sleepUntil(sampleStart + std::chrono::seconds(oidConfig.interval_s),
+                      *oid)) {
+        break;
+      }
     }
   }
 
+  oid->stopSandbox();
+
   // Upload cache artifacts if present
   if (!oid->uploadCache()) {
     LOG(ERROR) << "cache upload requested and failed";
@@ -501,40 +759,18 @@ static ExitStatus::ExitStatus runScript(
   return ExitStatus::Success;
 }
 
-}  // namespace oi::detail
-
-int main(int argc, char* argv[]) {
-  using namespace oi::detail;
-
+/*
+ * Fills `args` from a command line. Returns the status to exit with if the
+ * command line is invalid or only asked for help.
+ */
+static std::optional<ExitStatus::ExitStatus> parseArgs(int argc,
+                                                       char* argv[],
+                                                       Oid::Args& args) {
   int debugLevel = 1;
-  Oid::Config oidConfig = {};
-  std::string scriptFile;
-  std::string scriptSource;
-  std::string configGenOption;
-  std::optional<fs::path> jsonPath{std::nullopt};
-
-  std::map<Feature, bool> features = {
-      {Feature::PackStructs, true},
-      {Feature::GenPaddingStats, true},
-      {Feature::TypeGraph, true},
-      {Feature::PruneTypeGraph, true},
-  };
-
-  bool logAllStructs = true;
-  bool dumpDataSegment = false;
-
-  metrics::Tracing _("main");
-
-#if OI_PORTABILITY_META_INTERNAL()
-  folly::InitOptions init;
-  init.useGFlags(false);
-  init.removeFlags(false);
-  folly::init(&argc, &argv, init);
-#else
-  google::InitGoogleLogging(argv[0]);
-#endif
-  google::SetStderrLogging(google::WARNING);
+  auto& oidConfig = args.oidConfig;
 
+  // A server parses many command lines, so fully reinitialise getopt
+  optind = 0;
   int c = 0;
   while ((c = getopt_long(
               argc, argv, opts.shortOpts(), opts.longOpts(), nullptr)) != -1) {
@@ -543,7 +779,7 @@ int main(int argc, char* argv[]) {
         [[fallthrough]];
       case 'f':
         if (auto f = featureFromStr(optarg); f != Feature::UnknownFeature) {
-          features[f] = c == 'f';  // '-f' enables, '-F' disables
+          args.features[f] = c == 'f';  // '-f' enables, '-F' disables
         } else {
           LOG(ERROR) << "Invalid feature: " << optarg << " specified!";
           usage();
@@ -557,7 +793,7 @@ int main(int argc, char* argv[]) {
           oidConfig.hardDisableDrgn = true;
           oidConfig.cacheRemoteDownload = true;
           oidConfig.cacheBasePath = "/tmp/oid-cache";
-          features[Feature::ChaseRawPointers] = true;
+          args.features[Feature::ChaseRawPointers] = true;
         } else if (strcmp("strict", optarg) == 0) {
           oidConfig.strict = true;
         } else {
@@ -577,6 +813,43 @@ int main(int argc, char* argv[]) {
         oidConfig.dataSegSize = static_cast<size_t>(dataSegSizeArg.value());
         break;
       }
+      case 'T': {
+        // Bounded so that the limit still fits in nanoseconds
+        auto maxTimeArg = strtolpos(optarg);
+        if (!maxTimeArg.has_value() ||
+            maxTimeArg.value() >
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::nanoseconds::max())
+                    .count()) {
+          LOG(ERROR) << "Invalid value specified for max time";
+          usage();
+          return ExitStatus::UsageError;
+        }
+        oidConfig.budget.maxTime =
+            std::chrono::milliseconds(maxTimeArg.value());
+        break;
+      }
+      case 'X': {
+        auto maxBytesArg = strunittol(optarg);
+        if (!maxBytesArg.has_value() || maxBytesArg.value() <= 0) {
+          LOG(ERROR) << "Invalid value specified for max bytes";
+          usage();
+          return ExitStatus::UsageError;
+        }
+        oidConfig.budget.maxBytes = static_cast<size_t>(maxBytesArg.value());
+        break;
+      }
+      case 'N': {
+        auto maxElementsArg = strtolpos(optarg);
+        if (!maxElementsArg.has_value()) {
+          LOG(ERROR) << "Invalid value specified for max elements";
+          usage();
+          return ExitStatus::UsageError;
+        }
+        oidConfig.budget.maxElements =
+            static_cast<size_t>(maxElementsArg.value());
+        break;
+      }
       case 'p':
         oidConfig.pid = atoi(optarg);
         break;
@@ -632,6 +905,16 @@ int main(int argc, char* argv[]) {
           return ExitStatus::FileNotFoundError;
         }
 
+        break;
+      case 'K':
+        oidConfig.coreFile = optarg;
+
+        if (!fs::exists(oidConfig.coreFile)) {
+          LOG(ERROR) << "Non existent core file: " << oidConfig.coreFile;
+          usage();
+          return ExitStatus::FileNotFoundError;
+        }
+
         break;
       case 'o':
         oidConfig.cacheBasePath = optarg;
@@ -654,22 +937,49 @@ int main(int argc, char* argv[]) {
         oidConfig.removeMappings = true;
         break;
       case 'a':
-        logAllStructs = true;
+        args.logAllStructs = true;
         break;
       case 'B':
-        dumpDataSegment = true;
+        args.dumpDataSegment = true;
         break;
       case 's':
-        scriptFile = std::string(optarg);
+        args.scriptFile = std::string(optarg);
         break;
       case 'S':
-        scriptSource = std::string(optarg);
+        args.scriptSource = std::string(optarg);
         break;
       case 't':
         oidConfig.timeout_s = atoi(optarg);
         break;
+      case 'I': {
+        auto intervalArg = strtolpos(optarg);
+        if (!intervalArg.has_value() ||
+            intervalArg.value() > std::numeric_limits<int>::max()) {
+          LOG(ERROR) << "Invalid value specified for interval";
+          usage();
+          return ExitStatus::UsageError;
+        }
+        oidConfig.interval_s = static_cast<int>(intervalArg.value());
+        break;
+      }
+      case 'n': {
+        auto samplesArg = strtolpos(optarg);
+        if (!samplesArg.has_value()) {
+          LOG(ERROR) << "Invalid value specified for samples";
+          usage();
+          return ExitStatus::UsageError;
+        }
+        oidConfig.samples = static_cast<size_t>(samplesArg.value());
+        break;
+      }
       case 'J':
-        jsonPath = optarg != nullptr ? optarg : "oid_out.json";
+        args.jsonPath = optarg != nullptr ? optarg : "oid_out.json";
+        break;
+      case 'D':
+        args.serverSocket = optarg;
+        break;
+      case 'C':
+        args.connectSocket = optarg;
         break;
       case 'h':
       default:
@@ -678,6 +988,11 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  if (!args.serverSocket.empty()) {
+    // The server takes the rest of its options from each request
+    return std::nullopt;
+  }
+
   if (oidConfig.pid != 0 && !oidConfig.debugInfoFile.empty()) {
     LOG(INFO) << "'-p' and '-b' are mutually exclusive";
     usage();
@@ -689,20 +1004,43 @@ int main(int argc, char* argv[]) {
     return ExitStatus::UsageError;
   }
 
-  if (!oidConfig.removeMappings && scriptFile.empty() && scriptSource.empty()) {
+  if (!oidConfig.coreFile.empty()) {
+    if (oidConfig.debugInfoFile.empty()) {
+      LOG(INFO) << "'--core' needs the executable given with '-i'";
+      usage();
+      return ExitStatus::UsageError;
+    }
+    // Probes run against the core, not only compiled
+    oidConfig.compAndExit = false;
+  }
+
+  if (!oidConfig.removeMappings && args.scriptFile.empty() &&
+      args.scriptSource.empty()) {
     LOG(INFO) << "One of '-s', '-r' or '-S' must be specified";
     usage();
     return ExitStatus::UsageError;
   }
 
+  if (oidConfig.samples == 0) {
+    // An interval without a sample count samples until interrupted
+    oidConfig.samples = oidConfig.interval_s > 0 ? SIZE_MAX : 1;
+  }
+
   /*
    * This is unfortunately necessary to stop users having to specify a script
    * just to remove mappings (which doesn't make sense).
    */
-  if (oidConfig.removeMappings && scriptFile.empty() && scriptSource.empty()) {
-    scriptSource = "entry:unknown_function:arg0";
+  if (oidConfig.removeMappings && args.scriptFile.empty() &&
+      args.scriptSource.empty()) {
+    args.scriptSource = "entry:unknown_function:arg0";
   }
 
+  return std::nullopt;
+}
+
+static ExitStatus::ExitStatus runArgs(
+    const Oid::Args& args,
+    std::shared_ptr<SymbolService> symbols = nullptr) {
   OICompiler::Config compilerConfig{};
 
   OICodeGen::Config codeGenConfig;
@@ -710,13 +1048,13 @@ int main(int argc, char* argv[]) {
 
   TreeBuilder::Config tbConfig{
       .features = {},  // fill in after processing the config file
-      .logAllStructs = logAllStructs,
-      .dumpDataSegment = dumpDataSegment,
-      .jsonPath = jsonPath,
+      .logAllStructs = args.logAllStructs,
+      .dumpDataSegment = args.dumpDataSegment,
+      .jsonPath = args.jsonPath,
   };
 
   auto featureSet = config::processConfigFiles(
-      oidConfig.configFiles, features, compilerConfig, codeGenConfig);
+      args.oidConfig.configFiles, args.features, compilerConfig, codeGenConfig);
   if (!featureSet) {
     return ExitStatus::UsageError;
   }
@@ -724,26 +1062,424 @@ int main(int argc, char* argv[]) {
   codeGenConfig.features = *featureSet;
   tbConfig.features = *featureSet;
 
-  if (!scriptFile.empty()) {
-    if (!std::filesystem::exists(scriptFile)) {
-      LOG(ERROR) << "Non-existent script file: " << scriptFile;
+  if (!args.scriptFile.empty()) {
+    if (!std::filesystem::exists(args.scriptFile)) {
+      LOG(ERROR) << "Non-existent script file: " << args.scriptFile;
       return ExitStatus::FileNotFoundError;
     }
-    std::ifstream script(scriptFile);
-    auto status = runScript(
-        scriptFile, script, oidConfig, codeGenConfig, compilerConfig, tbConfig);
+    std::ifstream script(args.scriptFile);
+    auto status = runScript(args.scriptFile,
+                            script,
+                            args.oidConfig,
+                            codeGenConfig,
+                            compilerConfig,
+                            tbConfig,
+                            symbols);
     if (status != ExitStatus::Success) {
       return status;
     }
-  } else if (!scriptSource.empty()) {
-    std::istringstream script(scriptSource);
-    auto status = runScript(
-        scriptFile, script, oidConfig, codeGenConfig, compilerConfig, tbConfig);
+  } else if (!args.scriptSource.empty()) {
+    std::istringstream script(args.scriptSource);
+    auto status = runScript(args.scriptFile,
+                            script,
+                            args.oidConfig,
+                            codeGenConfig,
+                            compilerConfig,
+                            tbConfig,
+                            symbols);
     if (status != ExitStatus::Success) {
       return status;
     }
   }
 
+  return ExitStatus::Success;
+}
+
+/*
+ * Start time of a process in clock ticks since boot, as found in field 22 of
+ * /proc/<pid>/stat. Together with the PID it tells a recycled PID apart from
+ * the process a session was created for.
+ */
+static std::optional<unsigned long long> processStartTime(pid_t pid) {
+  std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+  std::string line;
+  if (!std::getline(stat, line)) {
+    return std::nullopt;
+  }
+
+  // The command name may contain spaces, so only split after it
+  auto commEnd = line.rfind(')');
+  if (commEnd == std::string::npos) {
+    return std::nullopt;
+  }
+
+  std::istringstream fields(line.substr(commEnd + 1));
+  std::string field;
+  for (int i = 3; i < 22; i++) {
+    fields >> field;
+  }
+
+  unsigned long long startTime = 0;
+  if (!(fields >> startTime)) {
+    return std::nullopt;
+  }
+  return startTime;
+}
+
+/*
+ * A request is the client's working directory followed by its command line,
+ * each string NUL terminated. The client shuts down its side of the
+ * connection once the request is sent, and the server replies with the exit
+ * status as a decimal number.
+ */
+static std::optional<std::vector<std::string>> readRequest(int fd) {
+  std::string buf;
+  char chunk[4096];
+  ssize_t n = 0;
+  while ((n = read(fd, chunk, sizeof(chunk))) != 0) {
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      PLOG(ERROR) << "Failed to read request";
+      return std::nullopt;
+    }
+    buf.append(chunk, n);
+  }
+
+  std::vector<std::string> request;
+  size_t pos = 0;
+  while (pos < buf.size()) {
+    auto end = buf.find('\0', pos);
+    if (end == std::string::npos) {
+      LOG(ERROR) << "Malformed request";
+      return std::nullopt;
+    }
+    request.emplace_back(buf, pos, end - pos);
+    pos = end + 1;
+  }
+  return request;
+}
+
+static bool writeAll(int fd, std::string_view data) {
+  while (!data.empty()) {
+    ssize_t n = write(fd, data.data(), data.size());
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data.remove_prefix(n);
+  }
+  return true;
+}
+
+static ExitStatus::ExitStatus serveRequest(
+    std::vector<std::string>& request,
+    std::map<pid_t, Oid::Session>& sessions,
+    const fs::path& defaultCachePath) {
+  if (request.empty()) {
+    LOG(ERROR) << "Empty request";
+    return ExitStatus::UsageError;
+  }
+
+  // Relative paths in the request are relative to the client
+  std::error_code ec;
+  fs::current_path(request[0], ec);
+  if (ec) {
+    LOG(ERROR) << "Failed to change to client directory " << request[0]
+               << ": " << ec.message();
+    return ExitStatus::ServerError;
+  }
+
+  std::vector<char*> argv;
+  for (auto it = request.begin() + 1; it != request.end(); ++it) {
+    argv.push_back(it->data());
+  }
+  argv.push_back(nullptr);
+
+  Oid::Args args;
+  if (auto status = parseArgs(argv.size() - 1, argv.data(), args)) {
+    return *status;
+  }
+  if (!args.serverSocket.empty()) {
+    LOG(ERROR) << "A request can't start another server";
+    return ExitStatus::UsageError;
+  }
+
+  // Reuse compiled probes from earlier requests unless told otherwise
+  if (args.oidConfig.cacheBasePath.empty()) {
+    args.oidConfig.cacheBasePath = defaultCachePath;
+  }
+
+  pid_t pid = args.oidConfig.pid;
+  if (pid == 0) {
+    return runArgs(args);
+  }
+
+  auto startTime = processStartTime(pid);
+  if (!startTime) {
+    sessions.erase(pid);
+    return runArgs(args);
+  }
+
+  auto session = sessions.find(pid);
+  if (session != sessions.end() && session->second.startTime != *startTime) {
+    VLOG(1) << "PID " << pid << " was reused, dropping its session";
+    sessions.erase(session);
+    session = sessions.end();
+  }
+
+  if (session == sessions.end()) {
+    auto symbols = std::make_shared<SymbolService>(pid);
+    session = sessions.emplace(pid, Oid::Session{*startTime, symbols}).first;
+  } else {
+    VLOG(1) << "Reusing session for PID " << pid;
+  }
+
+  return runArgs(args, session->second.symbols);
+}
+
+/*
+ * The logging settings which a request's '-d' changes. The server puts its own
+ * back after each request, so that one client's debug level doesn't carry over
+ * to the next. LogToStderr() also stops logging to files, which isn't undone.
+ */
+struct LogSettings {
+  int vlogLevel;
+  std::string logToStderr;
+  std::string stderrThreshold;
+  std::string minLogLevel;
+
+  static LogSettings save() {
+    LogSettings settings;
+    // glog can only read a module's level by setting it
+    settings.vlogLevel = google::SetVLOGLevel("*", FLAGS_v);
+    google::SetVLOGLevel("*", settings.vlogLevel);
+    gflags::GetCommandLineOption("logtostderr", &settings.logToStderr);
+    gflags::GetCommandLineOption("stderrthreshold", &settings.stderrThreshold);
+    gflags::GetCommandLineOption("minloglevel", &settings.minLogLevel);
+    return settings;
+  }
+
+  void restore() const {
+    google::SetVLOGLevel("*", vlogLevel);
+    gflags::SetCommandLineOption("logtostderr", logToStderr.c_str());
+    gflags::SetCommandLineOption("stderrthreshold", stderrThreshold.c_str());
+    gflags::SetCommandLineOption("minloglevel", minLogLevel.c_str());
+  }
+};
+
+/*
+ * Only root and the user who started the server may send it requests, as the
+ * server runs them with its own privileges.
+ */
+static bool isPeerAllowed(int fd, uid_t serverUid) {
+  ucred cred{};
+  socklen_t len = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+    PLOG(ERROR) << "Failed to get the credentials of the client";
+    return false;
+  }
+  if (cred.uid != 0 && cred.uid != serverUid) {
+    LOG(WARNING) << "Refusing request from uid " << cred.uid << " (pid "
+                 << cred.pid << ")";
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Removes a socket left behind by an earlier server. Anything else at the path
+ * is left alone, so that a mistyped path can't delete a file.
+ */
+static bool removeStaleSocket(const fs::path& socketPath) {
+  struct stat st {};
+  if (lstat(socketPath.c_str(), &st) < 0) {
+    if (errno == ENOENT) {
+      return true;
+    }
+    PLOG(ERROR) << "Failed to stat " << socketPath;
+    return false;
+  }
+  if (!S_ISSOCK(st.st_mode) || st.st_uid != getuid()) {
+    LOG(ERROR) << socketPath << " exists and isn't a socket owned by us";
+    return false;
+  }
+  if (unlink(socketPath.c_str()) < 0) {
+    PLOG(ERROR) << "Failed to remove stale socket " << socketPath;
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Serves requests from `oid --connect` one at a time, keeping a session per
+ * target process so that each probe after the first skips loading debug info
+ * and, through the OICache, compiling its code again.
+ */
+static ExitStatus::ExitStatus runServer(const fs::path& socketPath) {
+  int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listenFd < 0) {
+    PLOG(ERROR) << "Failed to create server socket";
+    return ExitStatus::ServerError;
+  }
+  BOOST_SCOPE_EXIT_ALL(&) {
+    close(listenFd);
+  };
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (socketPath.native().size() >= sizeof(addr.sun_path)) {
+    LOG(ERROR) << "Socket path too long: " << socketPath;
+    return ExitStatus::UsageError;
+  }
+  strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+  if (!removeStaleSocket(socketPath)) {
+    return ExitStatus::ServerError;
+  }
+
+  // Connecting needs write permission on the socket, so only its owner (and
+  // root) can reach it from the moment it's created
+  mode_t oldMask = umask(0077);
+  int bound = bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  umask(oldMask);
+  if (bound < 0 || listen(listenFd, SOMAXCONN) < 0) {
+    PLOG(ERROR) << "Failed to listen on " << socketPath;
+    return ExitStatus::ServerError;
+  }
+
+  auto defaultCachePath = fs::absolute(socketPath).concat(".cache");
+  std::map<pid_t, Oid::Session> sessions;
+  uid_t serverUid = getuid();
+  auto logSettings = LogSettings::save();
+
+  // A client that goes away must not take the server with it
+  signal(SIGPIPE, SIG_IGN);
+
+  LOG(INFO) << "Listening on " << socketPath;
+  while (true) {
+    int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      PLOG(ERROR) << "Failed to accept connection";
+      return ExitStatus::ServerError;
+    }
+    BOOST_SCOPE_EXIT_ALL(&) {
+      close(fd);
+    };
+
+    if (!isPeerAllowed(fd, serverUid)) {
+      continue;
+    }
+
+    auto status = ExitStatus::ServerError;
+    if (auto request = readRequest(fd)) {
+      try {
+        status = serveRequest(*request, sessions, defaultCachePath);
+      } catch (const std::exception& e) {
+        LOG(ERROR) << "Request failed: " << e.what();
+      }
+      logSettings.restore();
+    }
+
+    if (!writeAll(fd, std::to_string(status) + "\n")) {
+      PLOG(WARNING) << "Failed to send reply";
+    }
+  }
+}
+
+/* Hands the command line to `oid --server` and exits with its status */
+static ExitStatus::ExitStatus runClient(const fs::path& socketPath,
+                                        int argc,
+                                        char* argv[]) {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    PLOG(ERROR) << "Failed to create client socket";
+    return ExitStatus::ServerError;
+  }
+  BOOST_SCOPE_EXIT_ALL(&) {
+    close(fd);
+  };
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (socketPath.native().size() >= sizeof(addr.sun_path)) {
+    LOG(ERROR) << "Socket path too long: " << socketPath;
+    return ExitStatus::UsageError;
+  }
+  strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+  if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    PLOG(ERROR) << "Failed to connect to oid server at " << socketPath;
+    return ExitStatus::ServerError;
+  }
+
+  // The server ignores the '--connect' option it gets back
+  std::string request = fs::current_path().string();
+  request.push_back('\0');
+  for (int i = 0; i < argc; i++) {
+    request.append(argv[i]);
+    request.push_back('\0');
+  }
+
+  if (!writeAll(fd, request) || shutdown(fd, SHUT_WR) < 0) {
+    PLOG(ERROR) << "Failed to send request";
+    return ExitStatus::ServerError;
+  }
+
+  std::string reply;
+  char chunk[64];
+  ssize_t n = 0;
+  while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+    reply.append(chunk, n);
+  }
+
+  if (reply.empty() || !isdigit(reply[0])) {
+    LOG(ERROR) << "No reply from oid server";
+    return ExitStatus::ServerError;
+  }
+  return static_cast<ExitStatus::ExitStatus>(std::stoi(reply));
+}
+
+}  // namespace oi::detail
+
+int main(int argc, char* argv[]) {
+  using namespace oi::detail;
+
+  metrics::Tracing _("main");
+
+#if OI_PORTABILITY_META_INTERNAL()
+  folly::InitOptions init;
+  init.useGFlags(false);
+  init.removeFlags(false);
+  folly::init(&argc, &argv, init);
+#else
+  google::InitGoogleLogging(argv[0]);
+#endif
+  google::SetStderrLogging(google::WARNING);
+
+  Oid::Args args;
+  if (auto status = parseArgs(argc, argv, args)) {
+    return *status;
+  }
+
+  if (!args.serverSocket.empty()) {
+    return runServer(args.serverSocket);
+  }
+
+  if (!args.connectSocket.empty()) {
+    return runClient(args.connectSocket, argc, argv);
+  }
+
+  if (auto status = runArgs(args); status != ExitStatus::Success) {
+    return status;
+  }
+
   if (metrics::Tracing::isEnabled()) {
     LOG(INFO) << "Will write metrics (" << metrics::Tracing::isEnabled()
               << ") in " << metrics::Tracing::outputPath();
@@ -28,6 +28,9 @@
 #include <cassert>
 #include <cerrno>
 #include <chrono>
+#include <cinttypes>
+#include <climits>
+#include <csignal>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
@@ -36,8 +39,11 @@
 
 extern "C" {
 #include <fcntl.h>
+#include <linux/futex.h>
 #include <sys/mman.h>
+#include <sys/prctl.h>
 #include <sys/ptrace.h>
+#include <sys/socket.h>
 #include <sys/uio.h>
 #include <sys/user.h>
 #include <sys/wait.h>
@@ -50,7 +56,9 @@ extern "C" {
 #include "oi/ContainerInfo.h"
 #include "oi/Headers.h"
 #include "oi/Metrics.h"
+#include "oi/OIAgent.h"
 #include "oi/OILexer.h"
+#include "oi/OISandbox.h"
 #include "oi/PaddingHunter.h"
 #include "oi/Portability.h"
 #include "oi/Syscall.h"
@@ -290,7 +298,7 @@ bool OIDebugger::segmentInit(void) {
    * TODO: change this. If setup_results_segment() fails we have to remove
    * the text segment.
    */
-  if (!segConfig.existingConfig || segConfig.dataSegSize != dataSegSize) {
+  if (segmentsChanged()) {
     if (!segConfig.existingConfig) {
       if (!setupSegment(SegType::text) || !setupSegment(SegType::data)) {
         LOG(ERROR) << "setUpSegment failed!!!";
@@ -308,17 +316,7 @@ bool OIDebugger::segmentInit(void) {
     }
 
     segConfig.existingConfig = true;
-    segmentConfigFile.seekg(0);
-    segmentConfigFile.write((char*)&segConfig, sizeof(segConfig));
-
-    VLOG(1) << "segConfig size " << sizeof(segConfig);
-
-    if (segmentConfigFile.fail()) {
-      LOG(ERROR) << "init: error in writing configFile" << segConfigFilePath
-                 << strerror(errno);
-    }
-    VLOG(1) << "About to flush segment config file";
-    segmentConfigFile.flush();
+    saveSegmentConfig();
   }
 
   // Using nanoseconds since epoch as the cookie value
@@ -383,12 +381,27 @@ void OIDebugger::createSegmentConfigFile(void) {
             << " dataSegBase: " << segConfig.dataSegBase
             << " dataSegSize: " << segConfig.dataSegSize
             << " replayInstBase: " << segConfig.replayInstBase
-            << " cookie: " << segConfig.cookie;
+            << " cookie: " << segConfig.cookie
+            << " agentTid: " << std::dec << segConfig.agentTid;
 
     assert(segConfig.existingConfig);
   }
 }
 
+void OIDebugger::saveSegmentConfig(void) {
+  segmentConfigFile.seekg(0);
+  segmentConfigFile.write((char*)&segConfig, sizeof(segConfig));
+
+  VLOG(1) << "segConfig size " << sizeof(segConfig);
+
+  if (segmentConfigFile.fail()) {
+    LOG(ERROR) << "init: error in writing configFile" << segConfigFilePath
+               << strerror(errno);
+  }
+  VLOG(1) << "About to flush segment config file";
+  segmentConfigFile.flush();
+}
+
 void OIDebugger::deleteSegmentConfig(bool deleteSegConfigFile) {
   if (!segConfig.existingConfig) {
     return;
@@ -411,6 +424,10 @@ void OIDebugger::deleteSegmentConfig(bool deleteSegConfigFile) {
   segConfig.dataSegBase = 0;
   segConfig.dataSegSize = 0;
   segConfig.cookie = 0;
+  segConfig.agentRingBase = 0;
+  segConfig.agentStackBase = 0;
+  segConfig.agentTid = 0;
+  segConfig.agentRingFd = -1;
 }
 
 /*
@@ -653,6 +670,7 @@ OIDebugger::processTrapRet OIDebugger::processFuncTrap(
           << "\n\n";
 
   auto t = std::make_shared<trapInfo>(tInfo);
+  t->trappedAt = time_hr::now();
 
   /* Save interrupted registers into trap information */
   memcpy((void*)&t->savedRegs, (void*)&regs, sizeof(t->savedRegs));
@@ -787,6 +805,7 @@ OIDebugger::processTrapRet OIDebugger::processJitCodeRet(
      */
     auto t{iter->second};
     t->lifetime.stop();
+    probePauseTime += time_hr::now() - t->trappedAt;
 
     auto jitTrapProcessTime = metrics::Tracing("jit_ret");
 
@@ -1277,30 +1296,47 @@ OIDebugger::processTrapRet OIDebugger::processTrap(pid_t pid,
 }
 
 std::optional<std::vector<uintptr_t>> OIDebugger::findRetLocs(FuncDesc& fd) {
-  size_t maxSize = std::accumulate(
-      fd.ranges.begin(), fd.ranges.end(), size_t(0), [](auto currMax, auto& r) {
-        return std::max(currMax, r.size());
+  /* Copy all the function's ranges into the text vector with a single read */
+  size_t totalSize = std::accumulate(
+      fd.ranges.begin(), fd.ranges.end(), size_t(0), [](auto sum, auto& r) {
+        return sum + r.size();
       });
 
+  std::vector<std::byte> text(totalSize);
+  std::vector<struct iovec> localIov;
+  std::vector<struct iovec> remoteIov;
+  localIov.reserve(fd.ranges.size());
+  remoteIov.reserve(fd.ranges.size());
+
+  size_t off = 0;
+  for (const auto& range : fd.ranges) {
+    localIov.push_back({text.data() + off, range.size()});
+    remoteIov.push_back({(void*)range.start, range.size()});
+    off += range.size();
+  }
+
+  errno = 0;
+  auto readBytes = process_vm_readv(traceePid,
+                                    localIov.data(),
+                                    localIov.size(),
+                                    remoteIov.data(),
+                                    remoteIov.size(),
+                                    0);
+  if (readBytes < 0 || static_cast<size_t>(readBytes) != totalSize) {
+    LOG(ERROR) << "Could not read function ranges of " << fd.symName << ": "
+               << strerror(errno);
+    return std::nullopt;
+  }
+
   std::vector<uintptr_t> retLocs;
-  std::vector<std::byte> text(maxSize);
+  off = 0;
   for (const auto& range : fd.ranges) {
     /*
-     * We already have enough capacity to accomodate any range from the function
-     * But we must ensure the actual `size` of the vector matches what is being
-     * put into it. `locateOpcode` uses the vector's size to know for how long
-     * it must decode instructions. As resize doesn't never reduces the capacity
-     * of the vector, there is no risk of multiple memory allocations impacting
-     * the performances.
+     * `locateOpcodes` uses the size of the text it is given to know for how
+     * long it must decode instructions, so only hand it this range.
      */
-    text.resize(range.size());
-
-    /* Copy the range of instruction into the text vector to be disassembled */
-    if (!readTargetMemory((void*)range.start, text.data(), text.size())) {
-      LOG(ERROR) << "Could not read function range " << fd.symName << "@"
-                 << range;
-      return std::nullopt;
-    }
+    std::span<const std::byte> rangeText{text.data() + off, range.size()};
+    off += range.size();
 
     /*
      * Locate the returns within the function instructions.
@@ -1320,7 +1356,7 @@ std::optional<std::vector<uintptr_t>> OIDebugger::findRetLocs(FuncDesc& fd) {
         std::array{uint8_t(0xCB)}, /* Return from far procedure */
     };
     // clang-format on
-    auto locs = OICompiler::locateOpcodes(text, retInsts);
+    auto locs = OICompiler::locateOpcodes(rangeText, retInsts);
     if (!locs.has_value()) {
       LOG(ERROR)
           << "Failed to locate all Return instructions in function range "
@@ -1565,17 +1601,162 @@ bool OIDebugger::functionPatch(const prequest& req) {
     VLOG(1) << "Patching function " << req.func << " @"
             << (void*)trap->trapAddr;
     activeTraps.emplace(trap->trapAddr, trap);
+  }
 
-    errno = 0;
-    if (ptrace(PTRACE_POKETEXT, traceePid, trap->trapAddr, trap->patchedText) <
-        0) {
-      /* We'll let our cleanup handling restore the original instructions */
-      LOG(ERROR) << "functionPatch POKETEXT failed: " << strerror(errno);
+  if (!writeTraps(tiVec, true)) {
+    /* We'll let our cleanup handling restore the original instructions */
+    LOG(ERROR) << "Failed to insert traps in function " << req.func;
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Executable mappings of the target process, with their protection, sorted by
+ * address.
+ */
+struct TextMapping {
+  uintptr_t start;
+  uintptr_t end;
+  int prot;
+};
+
+static std::vector<TextMapping> readTextMappings(pid_t pid) {
+  std::vector<TextMapping> mappings;
+  std::ifstream maps("/proc/" + std::to_string(pid) + "/maps");
+
+  std::string line;
+  while (std::getline(maps, line)) {
+    uintptr_t start = 0;
+    uintptr_t end = 0;
+    char perm[5] = {};
+    int matched = sscanf(
+        line.c_str(), "%" SCNxPTR "-%" SCNxPTR " %4s", &start, &end, perm);
+    if (matched != 3 || perm[2] != 'x') {
+      continue;
+    }
+
+    int prot = PROT_EXEC;
+    prot |= perm[0] == 'r' ? PROT_READ : 0;
+    prot |= perm[1] == 'w' ? PROT_WRITE : 0;
+    mappings.push_back({start, end, prot});
+  }
+
+  return mappings;
+}
+
+/*
+ * Inserts (or removes) the INT3 of each trap in the target's text.
+ *
+ * Below minBatchedTraps, each trap's word is written with PTRACE_POKETEXT.
+ * Otherwise the text pages holding the traps are made writable with one
+ * remote mprotect(2) per mapping and every trap byte is written with a single
+ * process_vm_writev(2), which stops the target for much less time than a
+ * ptrace round trip per trap. Only the trap's first byte is written then, so
+ * traps less than a word apart can't undo each other.
+ *
+ * The thread the remote syscalls run on (traceePid) must be stopped.
+ */
+bool OIDebugger::writeTraps(const std::vector<std::shared_ptr<trapInfo>>& traps,
+                            bool insert) {
+  metrics::Tracing _("write_traps");
+
+  if (traps.size() < minBatchedTraps) {
+    for (const auto& trap : traps) {
+      auto text = insert ? trap->patchedText : trap->origText;
+
+      errno = 0;
+      if (ptrace(PTRACE_POKETEXT, traceePid, trap->trapAddr, text) < 0) {
+        LOG(ERROR) << "writeTraps POKETEXT failed: " << strerror(errno);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /* Work out which pages of which mapping need to become writable */
+  auto mappings = readTextMappings(traceePid);
+  std::map<size_t, std::pair<uintptr_t, uintptr_t>> unprotect;
+  const uintptr_t pageSize = getpagesize();
+
+  for (const auto& trap : traps) {
+    auto mapping = std::upper_bound(
+        mappings.begin(),
+        mappings.end(),
+        trap->trapAddr,
+        [](uintptr_t addr, const auto& m) { return addr < m.end; });
+    if (mapping == mappings.end() || trap->trapAddr < mapping->start) {
+      LOG(ERROR) << "Trap at " << (void*)trap->trapAddr
+                 << " is not in an executable mapping";
       return false;
     }
+
+    uintptr_t first = trap->trapAddr & ~(pageSize - 1);
+    uintptr_t last = first + pageSize;
+    auto [it, inserted] = unprotect.try_emplace(
+        mapping - mappings.begin(), std::make_pair(first, last));
+    if (!inserted) {
+      it->second.first = std::min(it->second.first, first);
+      it->second.second = std::max(it->second.second, last);
+    }
   }
 
-  return true;
+  bool ret = true;
+  std::vector<size_t> unprotected;
+  for (const auto& [idx, pages] : unprotect) {
+    const auto& [first, last] = pages;
+    if (!remoteSyscall<SysMprotect>(
+            first, last - first, mappings[idx].prot | PROT_WRITE)) {
+      LOG(ERROR) << "Failed to make text at " << (void*)first << " writable";
+      ret = false;
+      break;
+    }
+    unprotected.push_back(idx);
+  }
+
+  if (ret) {
+    std::vector<struct iovec> localIov;
+    std::vector<struct iovec> remoteIov;
+    localIov.reserve(traps.size());
+    remoteIov.reserve(traps.size());
+    for (const auto& trap : traps) {
+      auto* byte = insert ? trap->patchedTextBytes : trap->origTextBytes;
+      localIov.push_back({byte, 1});
+      remoteIov.push_back({(void*)trap->trapAddr, 1});
+    }
+
+    /* The kernel takes at most IOV_MAX iovecs per call */
+    for (size_t off = 0; off < traps.size(); off += IOV_MAX) {
+      size_t count = std::min<size_t>(IOV_MAX, traps.size() - off);
+
+      errno = 0;
+      auto written = process_vm_writev(traceePid,
+                                       localIov.data() + off,
+                                       count,
+                                       remoteIov.data() + off,
+                                       count,
+                                       0);
+      if (written < 0 || static_cast<size_t>(written) != count) {
+        LOG(ERROR) << "writeTraps process_vm_writev failed: "
+                   << strerror(errno);
+        ret = false;
+        break;
+      }
+    }
+  }
+
+  /* Put the original protection back, even if something failed above */
+  for (auto idx : unprotected) {
+    const auto& [first, last] = unprotect.at(idx);
+    if (!remoteSyscall<SysMprotect>(first, last - first, mappings[idx].prot)) {
+      LOG(ERROR) << "Failed to restore protection of text at "
+                 << (void*)first;
+      ret = false;
+    }
+  }
+
+  return ret;
 }
 
 /* See "syscall.h" for an explanation on the `Sys` template argument */
@@ -1762,8 +1943,13 @@ bool OIDebugger::setupSegment(SegType seg) {
     return false;
   }
 
+  setSegmentAddr(seg, (uintptr_t)*segAddr);
+  return true;
+}
+
+void OIDebugger::setSegmentAddr(SegType seg, uintptr_t segAddr) {
   if (seg == SegType::text) {
-    segConfig.textSegBase = (uintptr_t)segAddr.value();
+    segConfig.textSegBase = segAddr;
     segConfig.constStart = segConfig.textSegBase + prologueLength;
     segConfig.jitCodeStart = segConfig.constStart + constLength;
     segConfig.textSegSize = textSegSize;
@@ -1776,11 +1962,9 @@ bool OIDebugger::setupSegment(SegType seg) {
         segConfig.textSegBase + textSegSize - replayInstSize;
     VLOG(1) << "replayInstBase addr " << std::hex << segConfig.replayInstBase;
   } else {
-    segConfig.dataSegBase = (uint64_t)*segAddr;
+    segConfig.dataSegBase = segAddr;
     segConfig.dataSegSize = dataSegSize;
   }
-
-  return true;
 }
 
 bool OIDebugger::unmapSegment(SegType seg) {
@@ -1794,6 +1978,12 @@ bool OIDebugger::unmapSegment(SegType seg) {
 bool OIDebugger::unmapSegments(bool deleteSegConfFile) {
   bool ret = true;
 
+  // The agent runs from the text segment, it must be gone before unmapping it
+  if (!stopAgent()) {
+    LOG(ERROR) << "Problem stopping the agent in target process";
+    return false;
+  }
+
   if (!unmapSegment(SegType::text)) {
     LOG(ERROR) << "Problem unmapping target process text segment";
     ret = false;
@@ -1829,6 +2019,7 @@ bool OIDebugger::removeTraps(pid_t pid) {
   pid_t targetPid = pid ? pid : traceePid;
 
   /* Hijack the main thread to remove the traps and flush the JIT logs */
+  auto stopStart = time_hr::now();
   errno = 0;
   if (ptrace(PTRACE_INTERRUPT, targetPid, nullptr, nullptr) < 0) {
     LOG(ERROR) << "Couldn't interrupt target pid " << targetPid << ": "
@@ -1842,6 +2033,7 @@ bool OIDebugger::removeTraps(pid_t pid) {
                << strerror(errno);
   }
 
+  std::vector<std::shared_ptr<trapInfo>> traps;
   for (auto it = activeTraps.begin(); it != activeTraps.end();) {
     const auto& tInfo = it->second;
 
@@ -1852,21 +2044,23 @@ bool OIDebugger::removeTraps(pid_t pid) {
     }
 
     VLOG(1) << "removeTraps removing int3 at " << std::hex << tInfo->trapAddr;
-
-    errno = 0;
-    if (ptrace(PTRACE_POKETEXT, targetPid, tInfo->trapAddr, tInfo->origText) <
-        0) {
-      LOG(ERROR) << "Execute: Couldn't poke text: " << strerror(errno);
-    }
-
+    traps.push_back(tInfo);
     it = activeTraps.erase(it);
   }
 
+  if (!writeTraps(traps, false)) {
+    LOG(ERROR) << "Couldn't remove all the traps";
+  }
+
   /* Resume the main thread now, so it doesn't have to wait on restoreState */
   if (!contTargetThread(targetPid)) {
     return false;
   }
 
+  auto stoppedNs = time_ns(time_hr::now() - stopStart);
+  metrics::Tracing::counter("unpatch_stop_ns", stoppedNs);
+  LOG(INFO) << "Target stopped for " << stoppedNs << " nsecs to remove traps";
+
   return true;
 }
 
@@ -1924,9 +2118,21 @@ OIDebugger::OIDebugger(pid_t pid,
                        const OICodeGen::Config& genConfig,
                        OICompiler::Config ccConfig,
                        TreeBuilder::Config tbConfig)
+    : OIDebugger(pid,
+                 std::make_shared<SymbolService>(pid),
+                 genConfig,
+                 std::move(ccConfig),
+                 std::move(tbConfig)) {
+}
+
+OIDebugger::OIDebugger(pid_t pid,
+                       std::shared_ptr<SymbolService> symbolService,
+                       const OICodeGen::Config& genConfig,
+                       OICompiler::Config ccConfig,
+                       TreeBuilder::Config tbConfig)
     : OIDebugger(genConfig, std::move(ccConfig), std::move(tbConfig)) {
   traceePid = pid;
-  symbols = std::make_shared<SymbolService>(traceePid);
+  symbols = std::move(symbolService);
   setDataSegmentSize(dataSegSize);
   createSegmentConfigFile();
   cache.symbols = symbols;
@@ -1941,6 +2147,18 @@ OIDebugger::OIDebugger(fs::path debugInfo,
   cache.symbols = symbols;
 }
 
+OIDebugger::OIDebugger(fs::path executable,
+                       fs::path core,
+                       const OICodeGen::Config& genConfig,
+                       OICompiler::Config ccConfig,
+                       TreeBuilder::Config tbConfig)
+    : OIDebugger(genConfig, std::move(ccConfig), std::move(tbConfig)) {
+  symbols = std::make_shared<SymbolService>(std::move(executable), core);
+  corePath = std::move(core);
+  setDataSegmentSize(dataSegSize);
+  cache.symbols = symbols;
+}
+
 /*
  * Copy local buffer from specified address into the remote address in
  * the target process. Note that this only works for mappings that have
@@ -2148,6 +2366,10 @@ bool OIDebugger::writePrologue(
     memcpy(newInsts + off, &objectAddr, sizeof(objectAddr));
     off += sizeof(objectAddr);
 
+    if (preq.type == "global") {
+      globalProbeEntry = jitCodeStart->second;
+    }
+
     newInsts[off++] = movabsrax0Inst;
     newInsts[off++] = movabsrax1Inst;
     memcpy(newInsts + off, &jitCodeStart->second, sizeof(jitCodeStart->second));
@@ -2185,6 +2407,7 @@ bool OIDebugger::writePrologue(
  * is that the target processes text segment is populated and ready to go.
  */
 bool OIDebugger::compileCode() {
+  metrics::Tracing _("compile_code");
   assert(pdata.numReqs() == 1);
   const auto& preq = pdata.getReq();
 
@@ -2304,11 +2527,25 @@ bool OIDebugger::compileCode() {
   }
 
   if (traceePid) {  // we attach to a process
+    // The agent's thread shares the TLS of the thread that started it, and
+    // the sandbox's TLS is its own rather than the core's
+    if ((agentEnabled() || sandboxRunning()) && preq.type == "global") {
+      if (auto sym = OICompiler::findThreadLocalUse(objectFiles)) {
+        LOG(ERROR) << "The probe can't run "
+                   << (sandboxRunning() ? "against the core" : "on the agent")
+                   << ", it uses TLS through '" << *sym << "'";
+        return false;
+      }
+    }
+
     std::unordered_map<std::string, uintptr_t> syntheticSymbols{
         {"dataBase", segConfig.constStart + 0 * sizeof(uintptr_t)},
         {"dataSize", segConfig.constStart + 1 * sizeof(uintptr_t)},
         {"cookieValue", segConfig.constStart + 2 * sizeof(uintptr_t)},
         {"logFile", segConfig.constStart + 3 * sizeof(uintptr_t)},
+        {"budgetTimeNs", segConfig.constStart + 4 * sizeof(uintptr_t)},
+        {"budgetBytes", segConfig.constStart + 5 * sizeof(uintptr_t)},
+        {"budgetElements", segConfig.constStart + 6 * sizeof(uintptr_t)},
     };
 
     VLOG(2) << "Relocating...";
@@ -2329,7 +2566,7 @@ bool OIDebugger::compileCode() {
 
     const auto& lastSeg = segments.back();
     auto segmentsLimit = lastSeg.RelocAddr + lastSeg.Size;
-    auto remoteSegmentLimit = segConfig.textSegBase + segConfig.textSegSize;
+    auto remoteSegmentLimit = segConfig.replayInstBase - agentLength;
     if (segmentsLimit > remoteSegmentLimit) {
       size_t totalSegmentsSize = segmentsLimit - segConfig.textSegBase;
       LOG(ERROR) << "Generated instruction sequence too large for currently "
@@ -2338,11 +2575,14 @@ bool OIDebugger::compileCode() {
       return false;
     }
 
-    for (const auto& [BaseAddr, RelocAddr, Size] : segments) {
-      if (!writeTargetMemory((void*)BaseAddr, (void*)RelocAddr, Size)) {
+    metrics::Tracing writeTracing("write_jit_code");
+    for (const auto& seg : segments) {
+      if (!writeTargetMemory(
+              (void*)seg.BaseAddr, (void*)seg.RelocAddr, seg.Size)) {
         return false;
       }
     }
+    writeTracing.stop();
 
     if (!writeTargetMemory(&segConfig.dataSegBase,
                            (void*)syntheticSymbols["dataBase"],
@@ -2373,6 +2613,28 @@ bool OIDebugger::compileCode() {
       return false;
     }
 
+    uint64_t budgetTimeNs = budget.maxTime.count();
+    if (!writeTargetMemory(&budgetTimeNs,
+                           (void*)syntheticSymbols["budgetTimeNs"],
+                           sizeof(budgetTimeNs))) {
+      LOG(ERROR) << "Failed to write budgetTimeNs in probe's budgetTimeNs";
+      return false;
+    }
+
+    if (!writeTargetMemory(&budget.maxBytes,
+                           (void*)syntheticSymbols["budgetBytes"],
+                           sizeof(budget.maxBytes))) {
+      LOG(ERROR) << "Failed to write budgetBytes in probe's budgetBytes";
+      return false;
+    }
+
+    if (!writeTargetMemory(&budget.maxElements,
+                           (void*)syntheticSymbols["budgetElements"],
+                           sizeof(budget.maxElements))) {
+      LOG(ERROR) << "Failed to write budgetElements in probe's budgetElements";
+      return false;
+    }
+
     if (!writePrologue(preq, jitSymbols)) {
       LOG(ERROR) << "Failed to write prologue";
       return false;
@@ -2731,6 +2993,587 @@ void OIDebugger::stopAll() {
   oidShouldExit = true;
 }
 
+/*
+ * Points the JIT code's dataBase back at the start of the data segment. The
+ * JIT code advances it past what each run writes, so it must be rewound before
+ * every run after the first.
+ */
+bool OIDebugger::rewindDataBase(void) {
+  auto* dataBase = reinterpret_cast<void*>(segConfig.constStart +
+                                           0 * sizeof(uintptr_t));
+  if (!writeTargetMemory(&segConfig.dataSegBase,
+                         dataBase,
+                         sizeof(segConfig.dataSegBase))) {
+    LOG(ERROR) << "Failed to write dataSegBase in probe's dataBase";
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Prepares another run of the probe once the previous one has completed and
+ * the target has been released. The segments, the JIT code and its prologue
+ * stay installed in the target; only the traps need patching in again and the
+ * dataBase rewinding. A new cookie keeps the results of the previous run from
+ * being read as this one's if the probe doesn't fire.
+ */
+bool OIDebugger::rearmProbe(void) {
+  if (generatorConfig.features[Feature::JitLogging]) {
+    LOG(ERROR) << "JIT logging only supports probing once";
+    return false;
+  }
+
+  // restoreState() already rewound threads still trapped in the last run
+  threadTrapState.clear();
+  threadList.clear();
+  count = 0;
+  probePauseTime = {};
+
+  if (!rewindDataBase()) {
+    return false;
+  }
+
+  using namespace std::chrono;
+  auto now = high_resolution_clock::now().time_since_epoch();
+  segConfig.cookie = duration_cast<duration<uintptr_t, std::nano>>(now).count();
+
+  auto* cookieValue = reinterpret_cast<void*>(segConfig.constStart +
+                                              2 * sizeof(uintptr_t));
+  if (!writeTargetMemory(
+          &segConfig.cookie, cookieValue, sizeof(segConfig.cookie))) {
+    LOG(ERROR) << "Failed to write cookie in probe's cookieValue";
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Hijacks the stopped main thread of the target to run the agent's clone
+ * trampoline at `trampoline`, starting a thread that runs the agent with
+ * `ring` on the stack ending at `stackTop`. Returns the new thread's TID.
+ */
+std::optional<pid_t> OIDebugger::remoteClone(uintptr_t trampoline,
+                                             uintptr_t stackTop,
+                                             uintptr_t ring) {
+  errno = 0;
+  struct user_regs_struct oldregs {};
+  if (ptrace(PTRACE_GETREGS, traceePid, nullptr, &oldregs) < 0) {
+    LOG(ERROR) << "remoteClone: GETREGS failed for process " << traceePid
+               << ": " << strerror(errno);
+    return std::nullopt;
+  }
+
+  BOOST_SCOPE_EXIT_ALL(&) {
+    errno = 0;
+    if (ptrace(PTRACE_SETREGS, traceePid, nullptr, &oldregs) < 0) {
+      LOG(ERROR) << "remoteClone: restore SETREGS failed: " << strerror(errno);
+    }
+  };
+
+  /* See clone(2) for the arguments of the raw syscall */
+  struct user_regs_struct regs = oldregs;
+  regs.orig_rax = -1;  // Don't restart the syscall the thread may be in
+  regs.rip = trampoline;
+  regs.rax = SYS_clone;
+  regs.rdi = agent::cloneFlags;
+  regs.rsi = stackTop;
+  regs.rdx = 0;
+  regs.r10 = 0;
+  regs.r8 = 0;
+  regs.r12 = ring;
+
+  errno = 0;
+  if (ptrace(PTRACE_SETREGS, traceePid, nullptr, &regs) < 0) {
+    LOG(ERROR) << "remoteClone: SETREGS failed: " << strerror(errno);
+    return std::nullopt;
+  }
+
+  errno = 0;
+  if (ptrace(PTRACE_CONT, traceePid, nullptr, nullptr) < 0) {
+    LOG(ERROR) << "remoteClone: CONT failed: " << strerror(errno);
+    return std::nullopt;
+  }
+
+  int status = 0;
+  waitpid(traceePid, &status, 0);
+  if (!WIFSTOPPED(status) || WSTOPSIG(status) != SIGTRAP) {
+    LOG(ERROR) << "remoteClone: process didn't stop on the trampoline's INT3 "
+               << "(status " << std::hex << status << ")";
+    return std::nullopt;
+  }
+
+  errno = 0;
+  if (ptrace(PTRACE_GETREGS, traceePid, nullptr, &regs) < 0) {
+    LOG(ERROR) << "remoteClone: return GETREGS failed: " << strerror(errno);
+    return std::nullopt;
+  }
+
+  if ((long long)regs.rax < 0) {
+    LOG(ERROR) << "remoteClone: clone failed with error: "
+               << strerror((int)-regs.rax);
+    return std::nullopt;
+  }
+
+  return static_cast<pid_t>(regs.rax);
+}
+
+/*
+ * Starts the agent in the target, whose main thread must be stopped. The agent
+ * outlives this oid run: its ring, stack and thread are saved in the segment
+ * config for the following runs to submit probes to it without stopping the
+ * target. See OIAgent.h for the agent itself.
+ */
+bool OIDebugger::startAgent(void) {
+  metrics::Tracing _("start_agent");
+  assert(mode == OID_MODE_THREAD);
+
+  auto code = agent::code();
+  if (code.size() > agentLength) {
+    LOG(ERROR) << "Agent code too large: " << code.size() << " bytes";
+    return false;
+  }
+  auto agentBase = segConfig.replayInstBase - agentLength;
+
+  auto fail = [this]() {
+    stopAgent();
+    return false;
+  };
+
+  // The ring's memfd needs a name in the target. Borrow the agent's area for
+  // it, the agent's code overwrites it below.
+  static const std::string kRingFileName{"oid-agent"};
+  if (!writeTargetMemory((void*)(kRingFileName.c_str()),
+                         reinterpret_cast<void*>(agentBase),
+                         kRingFileName.length() + 1)) {
+    LOG(ERROR) << "Failed to write agent ring file's name into target process";
+    return false;
+  }
+
+  auto ringFd = remoteSyscall<MemfdCreate>(agentBase, 0);
+  if (!ringFd.has_value()) {
+    LOG(ERROR) << "Failed to create the agent's ring file";
+    return false;
+  }
+  segConfig.agentRingFd = *ringFd;
+
+  if (!remoteSyscall<SysFtruncate>(*ringFd, agentRingSize).has_value()) {
+    LOG(ERROR) << "Failed to size the agent's ring file";
+    return fail();
+  }
+
+  auto ring = remoteSyscall<SysMmap>(nullptr,
+                                     agentRingSize,
+                                     PROT_READ | PROT_WRITE,
+                                     MAP_SHARED,
+                                     *ringFd,
+                                     0);
+  if (!ring.has_value()) {
+    LOG(ERROR) << "Failed to map the agent's ring";
+    return fail();
+  }
+  segConfig.agentRingBase = reinterpret_cast<uintptr_t>(*ring);
+
+  auto stack = remoteSyscall<SysMmap>(nullptr,
+                                      agentStackSize,
+                                      PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+                                      -1,
+                                      0);
+  if (!stack.has_value()) {
+    LOG(ERROR) << "Failed to map the agent's stack";
+    return fail();
+  }
+  segConfig.agentStackBase = reinterpret_cast<uintptr_t>(*stack);
+
+  if (!writeTargetMemory((void*)code.data(),
+                         reinterpret_cast<void*>(agentBase),
+                         code.size())) {
+    LOG(ERROR) << "Failed to write the agent's code into target process";
+    return fail();
+  }
+
+  auto tid = remoteClone(agentBase + agent::cloneOffset(),
+                         segConfig.agentStackBase + agentStackSize,
+                         segConfig.agentRingBase);
+  if (!tid.has_value()) {
+    LOG(ERROR) << "Failed to start the agent's thread";
+    return fail();
+  }
+  segConfig.agentTid = *tid;
+
+  saveSegmentConfig();
+  LOG(INFO) << "Started agent thread " << segConfig.agentTid;
+  return true;
+}
+
+bool OIDebugger::agentRunning(void) const {
+  if (segConfig.agentTid == 0) {
+    return false;
+  }
+
+  std::error_code ec;
+  return fs::exists(fs::path("/proc") / std::to_string(traceePid) / "task" /
+                        std::to_string(segConfig.agentTid),
+                    ec);
+}
+
+/* Maps the agent's ring in oid, through a duplicate of the target's memfd */
+bool OIDebugger::mapAgentRing(void) {
+  if (agentRing) {
+    return true;
+  }
+
+  auto traceePidFd = syscall(SYS_pidfd_open, traceePid, 0);
+  if (traceePidFd == -1) {
+    PLOG(ERROR) << "Failed to open child pidfd";
+    return false;
+  }
+  auto ringFd =
+      syscall(SYS_pidfd_getfd, traceePidFd, segConfig.agentRingFd, 0);
+  close(static_cast<int>(traceePidFd));
+  if (ringFd == -1) {
+    PLOG(ERROR) << "Failed to duplicate the agent's ring file to debugger";
+    return false;
+  }
+
+  void* ring = mmap(nullptr,
+                    agentRingSize,
+                    PROT_READ | PROT_WRITE,
+                    MAP_SHARED,
+                    static_cast<int>(ringFd),
+                    0);
+  close(static_cast<int>(ringFd));
+  if (ring == MAP_FAILED) {
+    PLOG(ERROR) << "Failed to map the agent's ring";
+    return false;
+  }
+
+  agentRing = std::shared_ptr<agent::Ring>(
+      static_cast<agent::Ring*>(ring),
+      [](agent::Ring* r) { munmap(r, agentRingSize); });
+  return true;
+}
+
+/*
+ * Waits for the agent to complete the commands before `seq`. Gives up if oid
+ * is interrupted or, when it is non-zero, after `timeout`.
+ */
+bool OIDebugger::waitAgent(uint32_t seq, std::chrono::milliseconds timeout) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  auto* doneSeq = reinterpret_cast<uint32_t*>(&agentRing->doneSeq);
+
+  while (true) {
+    auto done = agentRing->doneSeq.load(std::memory_order_acquire);
+    if (static_cast<int32_t>(done - seq) >= 0) {
+      return true;
+    }
+    if (oidShouldExit || (timeout.count() > 0 &&
+                          std::chrono::steady_clock::now() >= deadline)) {
+      return false;
+    }
+
+    // Bound the wait, so a signal landing just before it isn't missed
+    struct timespec tick {
+      .tv_sec = 0, .tv_nsec = 100'000'000,
+    };
+    syscall(SYS_futex, doneSeq, FUTEX_WAIT, done, &tick, nullptr, 0);
+  }
+}
+
+static void submitAgentCommand(agent::Ring& ring, agent::Command cmd) {
+  auto seq = ring.cmdSeq.load(std::memory_order_relaxed);
+  ring.commands[seq % agent::ringSlots] = cmd;
+  ring.cmdSeq.store(seq + 1, std::memory_order_release);
+  syscall(SYS_futex,
+          reinterpret_cast<uint32_t*>(&ring.cmdSeq),
+          FUTEX_WAKE,
+          1,
+          nullptr,
+          nullptr,
+          0);
+}
+
+/*
+ * Runs the installed global probe from the agent. The target isn't stopped,
+ * so there's no pause time to report.
+ */
+bool OIDebugger::runAgentProbe(void) {
+  metrics::Tracing _("agent_probe");
+  assert(pdata.numReqs() == 1);
+  const auto& preq = pdata.getReq();
+
+  if (preq.type != "global" || globalProbeEntry == 0) {
+    LOG(ERROR) << "The agent only runs installed global probes";
+    return false;
+  }
+
+  if (!mapAgentRing()) {
+    return false;
+  }
+
+  auto sym = symbols->locateSymbol(preq.func);
+  if (!sym.has_value()) {
+    LOG(ERROR) << "runAgentProbe: failed to get global's address!";
+    return false;
+  }
+
+  auto seq = agentRing->cmdSeq.load(std::memory_order_relaxed);
+  if (agentRing->doneSeq.load(std::memory_order_acquire) != seq) {
+    LOG(ERROR) << "The agent is still running an earlier probe";
+    return false;
+  }
+
+  // The agent is idle, so the probe's dataBase can be written under it
+  if (!rewindDataBase()) {
+    return false;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  submitAgentCommand(*agentRing, {globalProbeEntry, sym->addr});
+
+  // Only an interruption stops the wait, the caller checks isInterrupted()
+  if (waitAgent(seq + 1, {})) {
+    auto took = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    VLOG(1) << "Agent ran the probe in " << std::dec << took.count()
+            << " nsecs";
+  }
+  probePauseTime = {};
+  return true;
+}
+
+/*
+ * Stops the agent, if any, and releases its ring and stack in the target, whose
+ * main thread must be stopped. An agent that doesn't stop is left in place:
+ * unmapping its code or stack would crash the target.
+ */
+bool OIDebugger::stopAgent(void) {
+  metrics::Tracing _("stop_agent");
+
+  if (agentRunning()) {
+    if (!mapAgentRing()) {
+      return false;
+    }
+
+    auto seq = agentRing->cmdSeq.load(std::memory_order_relaxed);
+    submitAgentCommand(*agentRing, {0, 0});
+    if (!waitAgent(seq + 1, std::chrono::seconds(1))) {
+      LOG(ERROR) << "Agent thread " << segConfig.agentTid << " didn't stop";
+      return false;
+    }
+
+    // The agent exits right after completing the command, still in its code
+    for (int i = 0; agentRunning() && i < 1000; i++) {
+      usleep(1000);
+    }
+    if (agentRunning()) {
+      LOG(ERROR) << "Agent thread " << segConfig.agentTid << " didn't exit";
+      return false;
+    }
+  }
+  agentRing.reset();
+
+  bool ret = true;
+  if (segConfig.agentRingBase != 0 &&
+      !remoteSyscall<SysMunmap>(segConfig.agentRingBase, agentRingSize)
+           .has_value()) {
+    LOG(ERROR) << "Failed to unmap the agent's ring";
+    ret = false;
+  }
+  if (segConfig.agentStackBase != 0 &&
+      !remoteSyscall<SysMunmap>(segConfig.agentStackBase, agentStackSize)
+           .has_value()) {
+    LOG(ERROR) << "Failed to unmap the agent's stack";
+    ret = false;
+  }
+  if (segConfig.agentRingFd != -1 &&
+      !remoteSyscall<SysClose>(segConfig.agentRingFd).has_value()) {
+    LOG(ERROR) << "Failed to close the agent's ring file";
+    ret = false;
+  }
+
+  segConfig.agentRingBase = 0;
+  segConfig.agentStackBase = 0;
+  segConfig.agentTid = 0;
+  segConfig.agentRingFd = -1;
+  return ret;
+}
+
+/*
+ * Starts oid_sandbox from next to oid's executable. It's exec'd rather than
+ * forked from oid so that the core is mapped in an address space holding
+ * little but the sandbox's own libraries and stack: oid's heap, libraries and
+ * thread stacks would sit wherever ASLR put them and could overlap the core.
+ * Returns the sandbox's PID, or -1 if it couldn't be started.
+ */
+static pid_t execSandbox(const fs::path& corePath,
+                         int fd,
+                         size_t textSize,
+                         size_t dataSize) {
+  std::error_code ec;
+  auto exe = fs::read_symlink("/proc/self/exe", ec);
+  if (ec) {
+    LOG(ERROR) << "Failed to find oid's executable: " << ec.message();
+    return -1;
+  }
+  auto sandbox = exe.parent_path() / "oid_sandbox";
+
+  // Everything the child needs is built before the fork, as oid is threaded
+  auto fdArg = std::to_string(fd);
+  auto textArg = std::to_string(textSize);
+  auto dataArg = std::to_string(dataSize);
+  const char* argv[] = {sandbox.c_str(),
+                        fdArg.c_str(),
+                        corePath.c_str(),
+                        textArg.c_str(),
+                        dataArg.c_str(),
+                        nullptr};
+
+  pid_t pid = fork();
+  if (pid == -1) {
+    PLOG(ERROR) << "Failed to fork the sandbox";
+    return -1;
+  }
+
+  if (pid == 0) {
+    // Don't outlive oid. The socket is the only descriptor kept over exec.
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (fcntl(fd, F_SETFD, 0) == 0) {
+      execv(argv[0], const_cast<char* const*>(argv));
+    }
+    _exit(127);
+  }
+
+  return pid;
+}
+
+/*
+ * Starts the sandbox, a process that holds the core's address space and
+ * stands in for the target process: oid installs the JIT code in it and reads
+ * its data segment back as for a live process. Only the probe's call differs,
+ * the sandbox makes it when oid asks for it. See oi/OISandbox.h.
+ */
+bool OIDebugger::startSandbox(void) {
+  metrics::Tracing _("start_sandbox");
+
+  // A core segment may still overlap where ASLR put the sandbox's own
+  // mappings, a fresh sandbox gets a fresh layout
+  constexpr int maxAttempts = 4;
+  for (int attempt = 1; attempt <= maxAttempts; attempt++) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0) {
+      PLOG(ERROR) << "Failed to create the sandbox's socket";
+      return false;
+    }
+
+    pid_t pid = execSandbox(corePath, fds[1], textSegSize, dataSegSize);
+    close(fds[1]);
+    if (pid == -1) {
+      close(fds[0]);
+      return false;
+    }
+    sandboxFd = fds[0];
+    traceePid = pid;
+
+    uintptr_t bases[2];
+    if (recv(sandboxFd, bases, sizeof(bases), 0) == sizeof(bases)) {
+      setSegmentAddr(SegType::text, bases[0]);
+      setSegmentAddr(SegType::data, bases[1]);
+
+      using namespace std::chrono;
+      auto now = high_resolution_clock::now().time_since_epoch();
+      segConfig.cookie =
+          duration_cast<duration<uintptr_t, std::nano>>(now).count();
+
+      LOG(INFO) << "Mapped the core " << corePath << " in sandbox process "
+                << pid;
+      return true;
+    }
+
+    int status = stopSandbox();
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != sandbox::exitOverlap) {
+      if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+        LOG(ERROR) << "Failed to run oid_sandbox, it should be installed "
+                      "next to oid";
+      }
+      break;
+    }
+    VLOG(1) << "The core overlaps the sandbox's mappings, attempt " << attempt
+            << " of " << maxAttempts;
+  }
+
+  LOG(ERROR) << "Failed to map the core " << corePath << " in the sandbox";
+  return false;
+}
+
+/*
+ * Runs the installed global probe in the sandbox. A probe reading memory the
+ * core and its mapped files don't have kills the sandbox.
+ */
+bool OIDebugger::runSandboxProbe(void) {
+  metrics::Tracing _("sandbox_probe");
+  assert(pdata.numReqs() == 1);
+  const auto& preq = pdata.getReq();
+
+  if (preq.type != "global" || globalProbeEntry == 0) {
+    LOG(ERROR) << "Only global probes can run against a core";
+    return false;
+  }
+
+  auto sym = symbols->locateSymbol(preq.func);
+  if (!sym.has_value()) {
+    LOG(ERROR) << "runSandboxProbe: failed to get global's address!";
+    return false;
+  }
+
+  agent::Command cmd{globalProbeEntry, sym->addr};
+  if (send(sandboxFd, &cmd, sizeof(cmd), MSG_NOSIGNAL) != sizeof(cmd)) {
+    PLOG(ERROR) << "Failed to send the probe to the sandbox";
+    return false;
+  }
+
+  char done = 0;
+  ssize_t n = 0;
+  while ((n = recv(sandboxFd, &done, sizeof(done), 0)) == -1 &&
+         errno == EINTR) {
+    if (oidShouldExit) {
+      return true;  // The sandbox goes away with oid
+    }
+  }
+
+  if (n != sizeof(done)) {
+    int status = stopSandbox();
+    if (WIFSIGNALED(status)) {
+      LOG(ERROR) << "The sandbox was killed by signal " << WTERMSIG(status)
+                 << " running the probe. It may have read memory missing "
+                    "from the core";
+    } else {
+      LOG(ERROR) << "The sandbox exited while running the probe";
+    }
+    return false;
+  }
+
+  return true;
+}
+
+/* Returns the sandbox's wait status */
+int OIDebugger::stopSandbox(void) {
+  if (sandboxFd == -1) {
+    return 0;
+  }
+
+  // The sandbox exits once its socket is closed
+  close(sandboxFd);
+  sandboxFd = -1;
+
+  int status = 0;
+  while (waitpid(traceePid, &status, 0) == -1 && errno == EINTR) {
+  }
+  traceePid = 0;
+  return status;
+}
+
 void OIDebugger::setDataSegmentSize(size_t size) {
   /* round up to the next page boundary if not aligned */
   int pgsz = getpagesize();
@@ -2739,6 +3582,76 @@ void OIDebugger::setDataSegmentSize(size_t size) {
   VLOG(1) << "setDataSegmentSize: segment size: " << dataSegSize;
 }
 
+/*
+ * Decodes the per-type profile written after the end of the data by the
+ * JitProfiling instrumentation and logs it, sorted by the cycles spent in
+ * each type excluding the types nested within it.
+ */
+static bool reportJitProfile(folly::ByteRange& range) {
+  struct Entry {
+    std::string name;
+    uint64_t exclusiveCycles;
+    uint64_t inclusiveCycles;
+    uint64_t calls;
+  };
+
+  auto decode = [&range]() -> std::optional<uint64_t> {
+    auto val = tryDecodeVarint(range);
+    if (!val)
+      return std::nullopt;
+    return *val;
+  };
+
+  auto count = decode();
+  if (!count)
+    return false;
+
+  std::vector<Entry> entries;
+  entries.reserve(*count);
+  uint64_t totalCycles = 0;
+  for (uint64_t i = 0; i < *count; i++) {
+    auto& entry = entries.emplace_back();
+    auto nameLen = decode();
+    if (!nameLen)
+      return false;
+    for (uint64_t j = 0; j < *nameLen; j++) {
+      auto c = decode();
+      if (!c)
+        return false;
+      entry.name.push_back(static_cast<char>(*c));
+    }
+
+    auto exclusive = decode();
+    auto inclusive = decode();
+    auto calls = decode();
+    if (!exclusive || !inclusive || !calls)
+      return false;
+    entry.exclusiveCycles = *exclusive;
+    entry.inclusiveCycles = *inclusive;
+    entry.calls = *calls;
+    totalCycles += *exclusive;
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+    return a.exclusiveCycles > b.exclusiveCycles;
+  });
+
+  LOG(INFO) << "JIT profile (" << entries.size() << " types, " << totalCycles
+            << " cycles):";
+  LOG(INFO) << (boost::format("%7s %16s %16s %12s  %s") % "self%" %
+                "self cycles" % "total cycles" % "calls" % "type");
+  for (const auto& entry : entries) {
+    double percent = totalCycles == 0 ? 0
+                                      : 100.0 * entry.exclusiveCycles /
+                                            static_cast<double>(totalCycles);
+    LOG(INFO) << (boost::format("%6.2f%% %16d %16d %12d  %s") % percent %
+                  entry.exclusiveCycles % entry.inclusiveCycles % entry.calls %
+                  entry.name);
+  }
+
+  return true;
+}
+
 bool OIDebugger::decodeTargetData(const DataHeader& dataHeader,
                                   std::vector<uint64_t>& outVec) const {
   VLOG(1) << "== magicId: " << std::hex << dataHeader.magicId;
@@ -2775,12 +3688,18 @@ bool OIDebugger::decodeTargetData(const DataHeader& dataHeader,
 
   VLOG(1) << "Pointer tracking stats: " << dataHeader.pointersCapacity << "/"
           << dataHeader.pointersSize;
+  metrics::Tracing::counter("data_segment_bytes", dataHeader.size);
+  metrics::Tracing::counter("pointers_deduplicated", dataHeader.pointersSize);
 
   if (dataHeader.pointersCapacity == dataHeader.pointersSize) {
     VLOG(1) << "Pointer tracking array is exhausted! Results may be"
                " partial.";
   }
 
+  if (dataHeader.truncated) {
+    LOG(WARNING) << "Traversal budget exhausted, results are truncated";
+  }
+
   /*
    * Currently  we use MAX_INT to indicate two things:
    *  - a single MAX_INT indicates the end of results for  the current object
@@ -2817,6 +3736,11 @@ bool OIDebugger::decodeTargetData(const DataHeader& dataHeader,
     prevVal = currVal;
   }
 
+  if (generatorConfig.features[Feature::JitProfiling] &&
+      !reportJitProfile(range)) {
+    LOG(ERROR) << "Failed to decode the JIT profile";
+  }
+
   return true;
 }
 
@@ -2887,9 +3811,12 @@ bool OIDebugger::processTargetData() {
     res += dataHeader.size;
 
     outVec.clear();
-    if (!decodeTargetData(dataHeader, outVec)) {
-      LOG(ERROR) << "Failed to decode target data for arg: " << req.arg;
-      return false;
+    {
+      metrics::Tracing decodeTracing("decode_target_data");
+      if (!decodeTargetData(dataHeader, outVec)) {
+        LOG(ERROR) << "Failed to decode target data for arg: " << req.arg;
+        return false;
+      }
     }
 
     if (treeBuilderConfig.dumpDataSegment) {
@@ -2917,8 +3844,11 @@ bool OIDebugger::processTargetData() {
     }
 
     try {
-      typeTree.build(
-          outVec, rootType.varName, rootType.type.type, typeHierarchy);
+      typeTree.build(outVec,
+                     rootType.varName,
+                     rootType.type.type,
+                     typeHierarchy,
+                     dataHeader.truncated);
     } catch (std::exception& e) {
       LOG(ERROR) << "Failed to run TreeBuilder for " << req.arg;
       LOG(ERROR) << e.what();
@@ -2962,6 +3892,7 @@ bool OIDebugger::processTargetData() {
 }
 
 std::optional<std::string> OIDebugger::generateCode(const irequest& req) {
+  metrics::Tracing _("generate_code");
   auto root = symbols->getRootType(req);
   if (!root.has_value()) {
     return std::nullopt;
@@ -2972,6 +3903,8 @@ std::optional<std::string> OIDebugger::generateCode(const irequest& req) {
   if (generatorConfig.features[Feature::TypeGraph]) {
     // CodeGen v2
     CodeGen codegen2{generatorConfig, *symbols};
+    if (cache.isEnabled())
+      codegen2.setTypeGraphCacheDir(cache.basePath);
     codegen2.codegenFromDrgn(root->type.type, code);
 
     TypeHierarchy th;
@@ -17,9 +17,11 @@
 
 #include <glog/logging.h>
 
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 
+#include "oi/Budget.h"
 #include "oi/OICache.h"
 #include "oi/OICodeGen.h"
 #include "oi/OICompiler.h"
@@ -31,6 +33,10 @@
 
 namespace oi::detail {
 
+namespace agent {
+struct Ring;
+}
+
 class OIDebugger {
   OIDebugger(const OICodeGen::Config&, OICompiler::Config, TreeBuilder::Config);
 
@@ -39,10 +45,25 @@ class OIDebugger {
              const OICodeGen::Config&,
              OICompiler::Config,
              TreeBuilder::Config);
+  /*
+   * Reuses symbols already loaded for the target process, e.g. by a previous
+   * OIDebugger for the same process.
+   */
+  OIDebugger(pid_t,
+             std::shared_ptr<SymbolService>,
+             const OICodeGen::Config&,
+             OICompiler::Config,
+             TreeBuilder::Config);
   OIDebugger(std::filesystem::path,
              const OICodeGen::Config&,
              OICompiler::Config,
              TreeBuilder::Config);
+  /* Introspects a core dump of the executable instead of a process */
+  OIDebugger(std::filesystem::path executable,
+             std::filesystem::path core,
+             const OICodeGen::Config&,
+             OICompiler::Config,
+             TreeBuilder::Config);
 
   bool segmentInit(void);
   bool stopTarget(void);
@@ -55,6 +76,10 @@ class OIDebugger {
   bool segConfigExists(void) const {
     return segConfig.existingConfig;
   };
+  /* Whether segmentInit() has to map segments in the target */
+  bool segmentsChanged(void) const {
+    return !segConfig.existingConfig || segConfig.dataSegSize != dataSegSize;
+  }
   enum oidMode { OID_MODE_THREAD, OID_MODE_FUNC };
   void setMode(oidMode newMode) {
     mode = newMode;
@@ -76,6 +101,24 @@ class OIDebugger {
   bool isInterrupted(void) const {
     return oidShouldExit;
   };
+  bool rearmProbe(void);
+  /* Time the probed threads spent stopped in traps and running JIT code */
+  std::chrono::nanoseconds getProbePauseTime(void) const {
+    return probePauseTime;
+  }
+  bool agentEnabled(void) const {
+    return generatorConfig.features[Feature::Agent];
+  }
+  bool agentRunning(void) const;
+  bool startAgent(void);
+  bool stopAgent(void);
+  bool runAgentProbe(void);
+  bool startSandbox(void);
+  bool sandboxRunning(void) const {
+    return sandboxFd != -1;
+  }
+  bool runSandboxProbe(void);
+  int stopSandbox(void);
 
   void setCacheBasePath(std::filesystem::path basePath) {
     if (std::filesystem::exists(basePath.parent_path()) &&
@@ -108,6 +151,12 @@ class OIDebugger {
   void setStrict(bool val) {
     treeBuilderConfig.strict = val;
   }
+  void setJsonPath(std::optional<std::string> path) {
+    treeBuilderConfig.jsonPath = std::move(path);
+  }
+  void setBudget(const oi::Budget& val) {
+    budget = val;
+  }
 
   bool uploadCache() {
     return std::all_of(
@@ -173,6 +222,11 @@ class OIDebugger {
   uint64_t replayInstsCurIdx{};
   bool oidShouldExit{false};
   uint64_t count{};
+  std::chrono::nanoseconds probePauseTime{};
+  uintptr_t globalProbeEntry{};
+  std::shared_ptr<agent::Ring> agentRing;
+  std::filesystem::path corePath;
+  int sandboxFd{-1};
   bool sigIntHandlerActive{false};
   const int sizeofInt3 = 1;
   const int sizeofUd2 = 2;
@@ -198,6 +252,10 @@ class OIDebugger {
   std::optional<typename Sys::RetType> remoteSyscall(Args...);
   bool setupLogFile(void);
   bool cleanupLogFile(void);
+  std::optional<pid_t> remoteClone(uintptr_t, uintptr_t, uintptr_t);
+  bool mapAgentRing(void);
+  bool waitAgent(uint32_t, std::chrono::milliseconds);
+  bool rewindDataBase(void);
 
   using ObjectAddrMap =
       std::unordered_map<std::variant<std::shared_ptr<GlobalDesc>,
@@ -207,6 +265,7 @@ class OIDebugger {
   ObjectAddrMap remoteObjAddrs{};
 
   bool setupSegment(SegType);
+  void setSegmentAddr(SegType, uintptr_t);
   bool unmapSegment(SegType);
   bool writeTargetMemory(void*, void*, size_t) const;
   bool readTargetMemory(void*, void*, size_t) const;
@@ -215,11 +274,13 @@ class OIDebugger {
   bool writePrologue(const prequest&, const OICompiler::RelocResult::SymTable&);
   bool readInstFromTarget(uintptr_t, uint8_t*, size_t);
   void createSegmentConfigFile(void);
+  void saveSegmentConfig(void);
   void deleteSegmentConfig(bool);
   std::optional<std::shared_ptr<trapInfo>> makeTrapInfo(const prequest&,
                                                         const trapType,
                                                         const uint64_t);
   bool functionPatch(const prequest&);
+  bool writeTraps(const std::vector<std::shared_ptr<trapInfo>>&, bool);
   bool canProcessTrapForThread(pid_t) const;
   bool replayTrappedInstr(const trapInfo&,
                           pid_t,
@@ -264,8 +325,15 @@ class OIDebugger {
     uintptr_t dataSegBase{};
     size_t dataSegSize{};
     uintptr_t cookie{};
+    /* The agent's ring and stack mappings, its thread and its ring's memfd */
+    uintptr_t agentRingBase{};
+    uintptr_t agentStackBase{};
+    pid_t agentTid{};
+    int agentRingFd{-1};
   } segConfig{};
 
+  oi::Budget budget{};
+
   /*
    * The first 3 words of the data segment contain:
    *  1. The OID identifier a.k.a. "magic id", 01DE8 in hex
@@ -282,6 +350,7 @@ class OIDebugger {
     uintptr_t timeTakenNs;
     size_t pointersSize;
     size_t pointersCapacity;
+    uintptr_t truncated;
 
     /*
      * Flexible Array Member are not standard in C++, but this is
@@ -299,8 +368,17 @@ class OIDebugger {
 
   bool decodeTargetData(const DataHeader&, std::vector<uint64_t>&) const;
 
+  /*
+   * Below this many traps, poking each trap's word with ptrace stops the
+   * target for less time than the two remote mprotect calls of a batch.
+   */
+  static constexpr size_t minBatchedTraps = 8;
   static constexpr size_t prologueLength = 64;
   static constexpr size_t constLength = 64;
+  /* The agent's code sits at the end of the text segment, below replay insts */
+  static constexpr size_t agentLength = 256;
+  static constexpr size_t agentRingSize = 4096;
+  static constexpr size_t agentStackSize = 1 << 20;
 };
 
 }  // namespace oi::detail
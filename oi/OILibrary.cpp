@@ -13,21 +13,214 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "oi/JitCodeArena.h"
 #include "oi/OILibraryImpl.h"
 #include "oi/oi-jit.h"
 
 namespace oi {
+namespace detail {
+namespace {
+
+/*
+ * Each compilation holds a Clang instance and the whole type graph in memory,
+ * so only a handful run at once. The threads are started on the first
+ * submission and joined when the pool is destroyed at exit: compilations
+ * already running are waited for, while tasks still queued are abandoned and
+ * their futures see a broken promise.
+ */
+class PreparePool {
+ public:
+  PreparePool() {
+    // Compilations write to the arena, so it's constructed first to be
+    // destroyed after the threads are joined
+    JitCodeArena::get();
+
+    unsigned n = std::clamp(std::thread::hardware_concurrency(), 1u, 4u);
+    threads_.reserve(n);
+    for (unsigned i = 0; i < n; i++)
+      threads_.emplace_back([this] { run(); });
+  }
+
+  ~PreparePool() {
+    {
+      std::lock_guard<std::mutex> guard{mutex_};
+      stopping_ = true;
+      tasks_.clear();
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_)
+      thread.join();
+  }
+
+  PreparePool(const PreparePool&) = delete;
+  PreparePool& operator=(const PreparePool&) = delete;
+
+  std::future<void> submit(std::function<void()> fn) {
+    std::packaged_task<void()> task{std::move(fn)};
+    auto future = task.get_future();
+    {
+      std::lock_guard<std::mutex> guard{mutex_};
+      tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+    return future;
+  }
+
+ private:
+  void run() {
+    while (true) {
+      std::packaged_task<void()> task;
+      {
+        std::unique_lock<std::mutex> lock{mutex_};
+        cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+        if (stopping_)
+          return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::packaged_task<void()>> tasks_;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+bool writeAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(fd, data, size);
+    if (n == -1 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool readAll(int fd, std::vector<uint8_t>& buf) {
+  constexpr size_t chunkSize = 1 << 16;
+  while (true) {
+    size_t off = buf.size();
+    buf.resize(off + chunkSize);
+    ssize_t n = read(fd, buf.data() + off, chunkSize);
+    buf.resize(off + std::max<ssize_t>(n, 0));
+    if (n == 0)
+      return true;
+    if (n == -1 && errno != EINTR)
+      return false;
+  }
+}
+
+}  // namespace
+
+std::future<void> submitPrepareTask(std::function<void()> task) {
+  static PreparePool pool;
+  return pool.submit(std::move(task));
+}
+
+std::future<IntrospectionResult> introspectInSnapshot(
+    const std::function<void(std::vector<uint8_t>&)>& traverse,
+    const exporters::inst::Inst& ty) {
+  // The child can't be waited for if the kernel reaps it by itself
+  struct sigaction sa;
+  if (sigaction(SIGCHLD, nullptr, &sa) == 0 &&
+      (sa.sa_handler == SIG_IGN || (sa.sa_flags & SA_NOCLDWAIT)))
+    throw std::runtime_error(
+        "introspectSnapshot can't wait for its child process as SIGCHLD is "
+        "ignored");
+
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0)
+    throw std::system_error(errno, std::generic_category(), "pipe2");
+
+  pid_t pid = fork();
+  if (pid == -1) {
+    int err = errno;
+    close(fds[0]);
+    close(fds[1]);
+    throw std::system_error(err, std::generic_category(), "fork");
+  }
+
+  if (pid == 0) {
+    // Leave without running the parent's exit handlers or flushing its stdio
+    close(fds[0]);
+    int status = 1;
+    try {
+      std::vector<uint8_t> buf;
+      traverse(buf);
+      if (writeAll(fds[1], buf.data(), buf.size()))
+        status = 0;
+    } catch (...) {
+    }
+    _exit(status);
+  }
+
+  close(fds[1]);
+
+  // Read the result on another thread so the caller doesn't wait for the
+  // child. The future joins that thread, and so the child, when destroyed.
+  return std::async(std::launch::async, [pid, fd = fds[0], ty] {
+    std::vector<uint8_t> buf;
+    bool complete = readAll(fd, buf);
+    close(fd);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) == -1) {
+      if (errno == ECHILD)
+        throw std::runtime_error(
+            "introspectSnapshot's child process was reaped by someone else, "
+            "e.g. by the application waiting for all of its children");
+      if (errno != EINTR)
+        throw std::system_error(errno, std::generic_category(), "waitpid");
+    }
+    if (!complete || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      throw std::runtime_error("failed to introspect the snapshot");
+
+    return IntrospectionResult{std::move(buf), ty};
+  });
+}
+
+}  // namespace detail
 
 OILibrary::OILibrary(void* atomicHole,
                      std::unordered_set<Feature> fs,
                      GeneratorOptions opts)
+    : OILibrary(
+          std::vector<void*>{atomicHole}, std::move(fs), std::move(opts)) {
+}
+OILibrary::OILibrary(std::vector<void*> atomicHoles,
+                     std::unordered_set<Feature> fs,
+                     GeneratorOptions opts)
     : pimpl_{std::make_unique<detail::OILibraryImpl>(
-          atomicHole, std::move(fs), std::move(opts))} {
+          std::move(atomicHoles), std::move(fs), std::move(opts))} {
 }
 OILibrary::~OILibrary() {
 }
 
 std::pair<void*, const exporters::inst::Inst&> OILibrary::init() {
+  return pimpl_->init().front();
+}
+
+std::vector<std::pair<void*, const exporters::inst::Inst&>>
+OILibrary::initBatch() {
   return pimpl_->init();
 }
 
@@ -19,15 +19,24 @@
 #include <sys/mman.h>
 
 #include <boost/core/demangle.hpp>
+#include <algorithm>
 #include <boost/format.hpp>
 #include <cerrno>
 #include <cstring>
 #include <fstream>
+#include <future>
+#include <memory>
+#include <optional>
+#include <set>
 #include <stdexcept>
+#include <string_view>
+#include <thread>
 
 #include "oi/Config.h"
 #include "oi/DrgnUtils.h"
 #include "oi/Headers.h"
+#include "oi/JitCodeArena.h"
+#include "oi/Metrics.h"
 
 namespace oi::detail {
 namespace {
@@ -39,28 +48,6 @@ std::map<Feature, bool> convertFeatures(std::unordered_set<oi::Feature> fs);
 drgn_qualified_type getTypeFromAtomicHole(drgn_program* prog, void* hole);
 }  // namespace
 
-OILibraryImpl::LocalTextSegment::LocalTextSegment(size_t size) {
-  void* base = mmap(NULL,
-                    size,
-                    PROT_EXEC | PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANONYMOUS,
-                    -1,
-                    0);
-  if (base == MAP_FAILED)
-    throw std::runtime_error(std::string("segment map failed: ") +
-                             std::strerror(errno));
-
-  data_ = {static_cast<uint8_t*>(base), size};
-}
-
-OILibraryImpl::LocalTextSegment::~LocalTextSegment() {
-  if (data_.empty())
-    return;
-
-  PLOG_IF(ERROR, munmap(data_.data(), data_.size()) != 0)
-      << "segment unmap failed";
-}
-
 OILibraryImpl::MemoryFile::MemoryFile(const char* name) {
   fd_ = memfd_create(name, 0);
   if (fd_ == -1)
@@ -79,20 +66,17 @@ std::filesystem::path OILibraryImpl::MemoryFile::path() {
   return {(boost::format("/dev/fd/%1%") % fd_).str()};
 }
 
-OILibraryImpl::OILibraryImpl(void* atomicHole,
+OILibraryImpl::OILibraryImpl(std::vector<void*> atomicHoles,
                              std::unordered_set<oi::Feature> fs,
                              GeneratorOptions opts)
-    : atomicHole_(atomicHole),
+    : atomicHoles_(std::move(atomicHoles)),
       requestedFeatures_(convertFeatures(std::move(fs))),
       opts_(std::move(opts)) {
 }
 
-std::pair<void*, const exporters::inst::Inst&> OILibraryImpl::init() {
+std::vector<OILibraryImpl::Entry> OILibraryImpl::init() {
+  metrics::Tracing _("oil_init");
   processConfigFile();
-
-  constexpr size_t TextSegSize = 1u << 22;
-  textSeg = {TextSegSize};
-
   return compileCode();
 }
 
@@ -108,7 +92,7 @@ void OILibraryImpl::processConfigFile() {
   compilerConfig_.features = *features;
 }
 
-std::pair<void*, const exporters::inst::Inst&> OILibraryImpl::compileCode() {
+std::vector<OILibraryImpl::Entry> OILibraryImpl::compileCode() {
   google::SetVLOGLevel("*", opts_.debugLevel);
 
   auto symbols = std::make_shared<SymbolService>(getpid());
@@ -116,64 +100,142 @@ std::pair<void*, const exporters::inst::Inst&> OILibraryImpl::compileCode() {
   auto* prog = symbols->getDrgnProgram();
   CHECK(prog != nullptr) << "does this check need to exist?";
 
-  auto rootType = getTypeFromAtomicHole(symbols->getDrgnProgram(), atomicHole_);
+  // Every root shares one type graph. Holes for the same type share a root.
+  // Distinct types can have the same name, e.g. in different anonymous
+  // namespaces, so roots are told apart by their drgn type and only named
+  // after it. A repeated name is suffixed with the root's index, so that every
+  // root gets its own entry point symbols.
+  std::vector<drgn_type*> rootTypes;
+  std::vector<std::string> rootNames;
+  std::vector<std::string> rootNameHashes;
+  std::vector<size_t> holeRoots;
+  holeRoots.reserve(atomicHoles_.size());
+  for (void* hole : atomicHoles_) {
+    auto rootType = getTypeFromAtomicHole(prog, hole);
+
+    auto it = std::find(rootTypes.begin(), rootTypes.end(), rootType.type);
+    holeRoots.push_back(it - rootTypes.begin());
+    if (it != rootTypes.end())
+      continue;
+
+    std::string name = SymbolService::getTypeName(rootType.type);
+    if (std::find(rootNames.begin(), rootNames.end(), name) != rootNames.end())
+      name += "#" + std::to_string(rootTypes.size());
+    rootNameHashes.push_back(
+        (boost::format("%1$016x") % std::hash<std::string>{}(name)).str());
+    rootNames.push_back(std::move(name));
+    rootTypes.push_back(rootType.type);
+  }
 
   CodeGen codegen{generatorConfig_, *symbols};
-
-  std::string code;
-  if (!codegen.codegenFromDrgn(rootType.type, code))
+  codegen.setTypeGraphCacheDir(opts_.typeGraphCacheDir);
+
+  // Roots are split between translation units which are compiled
+  // concurrently, as clang only uses one core for each. There's nothing to
+  // split with a single root.
+  std::vector<CodeGen::RootFunctionName> names;
+  names.reserve(rootNames.size());
+  for (const auto& name : rootNames)
+    names.emplace_back(CodeGen::HashedComponent{name});
+  std::vector<std::string> units;
+  if (!codegen.codegenFromDrgn(rootTypes,
+                               std::move(names),
+                               std::thread::hardware_concurrency(),
+                               units))
     throw std::runtime_error("oil jit codegen failed!");
 
-  std::string sourcePath = opts_.sourceFileDumpPath;
-  if (sourcePath.empty()) {
-    sourcePath = "oil_jit.cpp";  // fake path for JIT debug info
-  } else {
-    std::ofstream outputFile(sourcePath);
-    outputFile << code;
+  // Fake paths for JIT debug info, unless the source is dumped
+  std::vector<std::string> sourcePaths;
+  for (size_t i = 0; i < units.size(); i++) {
+    std::string sourcePath = opts_.sourceFileDumpPath;
+    if (sourcePath.empty())
+      sourcePath = "oil_jit.cpp";
+    if (units.size() > 1)
+      sourcePath += "." + std::to_string(i);
+    if (!opts_.sourceFileDumpPath.empty()) {
+      std::ofstream outputFile(sourcePath);
+      outputFile << units[i];
+    }
+    sourcePaths.push_back(std::move(sourcePath));
+  }
+
+  std::vector<std::unique_ptr<MemoryFile>> objects;
+  std::set<std::filesystem::path> objectPaths;
+  for (size_t i = 0; i < units.size(); i++) {
+    objects.push_back(std::make_unique<MemoryFile>("oil_object_code"));
+    objectPaths.insert(objects.back()->path());
   }
 
-  auto object = MemoryFile("oil_object_code");
   OICompiler compiler{symbols, compilerConfig_};
-  if (!compiler.compile(code, sourcePath, object.path()))
+  std::vector<std::future<bool>> compiled;
+  for (size_t i = 1; i < units.size(); i++) {
+    compiled.push_back(std::async(std::launch::async, [&, i] {
+      return compiler.compile(units[i], sourcePaths[i], objects[i]->path());
+    }));
+  }
+  bool ok = compiler.compile(units[0], sourcePaths[0], objects[0]->path());
+  for (auto& unit : compiled)
+    ok &= unit.get();
+  if (!ok)
     throw std::runtime_error("oil jit compilation failed!");
 
+  // Sized from the loaded objects, so types share the arena's pages
   auto relocRes = compiler.applyRelocs(
-      reinterpret_cast<uint64_t>(textSeg.data().data()), {object.path()}, {});
+      [](size_t size) -> std::optional<uintptr_t> {
+        return reinterpret_cast<uintptr_t>(
+            JitCodeArena::get().allocate(size).data());
+      },
+      objectPaths,
+      {});
   if (!relocRes)
     throw std::runtime_error("oil jit relocation failed!");
 
   const auto& [_, segments, jitSymbols] = *relocRes;
 
-  std::string nameHash =
-      (boost::format("%1$016x") %
-       std::hash<std::string>{}(SymbolService::getTypeName(rootType.type)))
-          .str();
-  std::string functionSymbolPrefix = "_Z27introspect_" + nameHash;
-  std::string typeSymbolName = "treeBuilderInstructions" + nameHash;
-  void* fp = nullptr;
-  const exporters::inst::Inst* ty = nullptr;
+  // The entry point's mangled name starts with the hash of the root's name,
+  // followed by its parameter types
+  constexpr std::string_view functionSymbolPrefix = "_Z27introspect_";
+  constexpr std::string_view typeSymbolPrefix = "treeBuilderInstructions";
+  constexpr size_t hashLength = 16;
+  std::vector<void*> fps(rootTypes.size(), nullptr);
+  std::vector<const exporters::inst::Inst*> tys(rootTypes.size(), nullptr);
+  auto findRoot = [&](std::string_view hash) -> std::optional<size_t> {
+    auto it = std::find(rootNameHashes.begin(), rootNameHashes.end(), hash);
+    if (it == rootNameHashes.end())
+      return std::nullopt;
+    return it - rootNameHashes.begin();
+  };
   for (const auto& [symName, symAddr] : jitSymbols) {
-    if (fp == nullptr && symName.starts_with(functionSymbolPrefix)) {
-      fp = reinterpret_cast<void*>(symAddr);
-      if (ty != nullptr)
-        break;
-    } else if (ty == nullptr && symName == typeSymbolName) {
-      ty = reinterpret_cast<const exporters::inst::Inst*>(symAddr);
-      if (fp != nullptr)
-        break;
+    std::string_view name = symName;
+    if (name.starts_with(functionSymbolPrefix)) {
+      auto root = findRoot(
+          name.substr(functionSymbolPrefix.size(), hashLength));
+      if (root && fps[*root] == nullptr)
+        fps[*root] = reinterpret_cast<void*>(symAddr);
+    } else if (name.starts_with(typeSymbolPrefix) &&
+               name.size() == typeSymbolPrefix.size() + hashLength) {
+      if (auto root = findRoot(name.substr(typeSymbolPrefix.size())))
+        tys[*root] = reinterpret_cast<const exporters::inst::Inst*>(symAddr);
     }
   }
 
-  CHECK(fp != nullptr && ty != nullptr)
-      << "failed to find always present symbols!";
+  for (size_t i = 0; i < rootTypes.size(); i++)
+    CHECK(fps[i] != nullptr && tys[i] != nullptr)
+        << "failed to find always present symbols!";
 
-  for (const auto& [baseAddr, relocAddr, size] : segments)
-    std::memcpy(reinterpret_cast<void*>(relocAddr),
-                reinterpret_cast<void*>(baseAddr),
-                size);
+  for (const auto& seg : segments) {
+    std::memcpy(reinterpret_cast<void*>(seg.RelocAddr),
+                reinterpret_cast<void*>(seg.BaseAddr),
+                seg.Size);
+    JitCodeArena::makeExecutable(
+        {reinterpret_cast<uint8_t*>(seg.RelocAddr), seg.WritableOffset});
+  }
 
-  textSeg.release();  // don't munmap() the region containing the code
-  return {fp, *ty};
+  std::vector<Entry> entries;
+  entries.reserve(holeRoots.size());
+  for (size_t root : holeRoots)
+    entries.emplace_back(fps[root], *tys[root]);
+  return entries;
 }
 
 namespace {
@@ -197,6 +259,12 @@ std::map<Feature, bool> convertFeatures(std::unordered_set<oi::Feature> fs) {
       case oi::Feature::GenJitDebug:
         out[Feature::GenJitDebug] = true;
         break;
+      case oi::Feature::ParallelTraversal:
+        out[Feature::ParallelTraversal] = true;
+        break;
+      case oi::Feature::DeltaPointers:
+        out[Feature::DeltaPointers] = true;
+        break;
     }
   }
 
@@ -205,25 +273,26 @@ std::map<Feature, bool> convertFeatures(std::unordered_set<oi::Feature> fs) {
 
 drgn_qualified_type getTypeFromAtomicHole(drgn_program* prog, void* hole) {
   // get the getter type:
-  // std::atomic<std::vector<uint8_t> (*)(const T&)>& getIntrospectionFunc();
+  // std::atomic<void (*)(const T&, std::vector<uint8_t>&, const Budget&)>&
+  // getIntrospectionFunc();
   auto atomicGetterType =
       SymbolService::findTypeOfAddr(prog, reinterpret_cast<uintptr_t>(hole));
   if (!atomicGetterType)
     throw std::runtime_error("failed to lookup function");
 
   // get the return type:
-  // std::atomic<std::vector<uint8_t> (*)(const T&)>&
+  // std::atomic<void (*)(const T&, std::vector<uint8_t>&, const Budget&)>&
   CHECK(drgn_type_has_type(atomicGetterType->type))
       << "functions have a return type";
   auto retType = drgn_type_type(atomicGetterType->type);
 
   // get the atomic type:
-  // std::atomic<std::vector<uint8_t> (*)(const T&)>
+  // std::atomic<void (*)(const T&, std::vector<uint8_t>&, const Budget&)>
   CHECK(drgn_type_has_type(retType.type)) << "pointers have a value type";
   auto atomicType = drgn_type_type(retType.type);
 
   // get the function pointer type:
-  // std::vector<uint8_t> (*)(const T&)
+  // void (*)(const T&, std::vector<uint8_t>&, const Budget&)
   CHECK(drgn_type_has_template_parameters(atomicType.type))
       << "atomic should have template parameters";
   CHECK(drgn_type_num_template_parameters(atomicType.type) == 1)
@@ -234,7 +303,7 @@ drgn_qualified_type getTypeFromAtomicHole(drgn_program* prog, void* hole) {
     throw drgnplusplus::error(err);
 
   // get the function type:
-  // std::vector<uint8_t>(const T&)
+  // void(const T&, std::vector<uint8_t>&, const Budget&)
   CHECK(drgn_type_has_type(funcPointerType.type))
       << "function pointers have a value type";
   auto funcType = drgn_type_type(funcPointerType.type);
@@ -242,8 +311,8 @@ drgn_qualified_type getTypeFromAtomicHole(drgn_program* prog, void* hole) {
   // get the argument type:
   // const T&
   CHECK(drgn_type_has_parameters(funcType.type)) << "functions have parameters";
-  CHECK(drgn_type_num_parameters(funcType.type) == 2)
-      << "function should have 2 parameters";
+  CHECK(drgn_type_num_parameters(funcType.type) == 3)
+      << "function should have 3 parameters";
   drgn_qualified_type argType;
   if (auto err =
           drgn_parameter_type(drgn_type_parameters(funcType.type), &argType))
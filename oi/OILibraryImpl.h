@@ -18,9 +18,9 @@
 
 #include <filesystem>
 #include <map>
-#include <span>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "oi/CodeGen.h"
 #include "oi/Features.h"
@@ -30,31 +30,6 @@ namespace oi::detail {
 
 class OILibraryImpl {
  private:
-  class LocalTextSegment {
-   public:
-    LocalTextSegment() = default;
-    LocalTextSegment(size_t size);
-    ~LocalTextSegment();
-    LocalTextSegment(const LocalTextSegment&) = delete;
-    LocalTextSegment& operator=(const LocalTextSegment&) = delete;
-    LocalTextSegment(LocalTextSegment&& that) {
-      std::swap(this->data_, that.data_);
-    }
-    LocalTextSegment& operator=(LocalTextSegment&& that) {
-      std::swap(this->data_, that.data_);
-      return *this;
-    }
-
-    std::span<uint8_t> data() {
-      return data_;
-    }
-    void release() {
-      data_ = {};
-    }
-
-   private:
-    std::span<uint8_t> data_;
-  };
   class MemoryFile {
    public:
     MemoryFile(const char* name);
@@ -67,23 +42,29 @@ class OILibraryImpl {
   };
 
  public:
-  OILibraryImpl(void* atomicHole,
+  using Entry = std::pair<void*, const exporters::inst::Inst&>;
+
+  /*
+   * Compiles every type named by the atomic holes together. Several types may
+   * be split between translation units compiled in parallel, while a single
+   * type is always compiled as one unit. init() returns an entry for each
+   * hole, in the same order.
+   */
+  OILibraryImpl(std::vector<void*> atomicHoles,
                 std::unordered_set<oi::Feature> fs,
                 GeneratorOptions opts);
-  std::pair<void*, const exporters::inst::Inst&> init();
+  std::vector<Entry> init();
 
  private:
-  void* atomicHole_;
+  std::vector<void*> atomicHoles_;
   std::map<Feature, bool> requestedFeatures_;
   GeneratorOptions opts_;
 
   oi::detail::OICompiler::Config compilerConfig_{};
   oi::detail::OICodeGen::Config generatorConfig_{};
 
-  LocalTextSegment textSeg;
-
   void processConfigFile();
-  std::pair<void*, const exporters::inst::Inst&> compileCode();
+  std::vector<Entry> compileCode();
 };
 
 }  // namespace oi::detail
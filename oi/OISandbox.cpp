@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "oi/OISandbox.h"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "oi/CoreImage.h"
+#include "oi/OIAgent.h"
+
+using namespace oi::detail;
+
+namespace {
+
+bool parsePositive(const char* str, size_t& out) {
+  char* end = nullptr;
+  errno = 0;
+  unsigned long long val = strtoull(str, &end, 10);
+  if (errno != 0 || end == str || *end != '\0' || val == 0) {
+    return false;
+  }
+  out = val;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t fd = 0;
+  size_t textSize = 0;
+  size_t dataSize = 0;
+  if (argc != 5 || !parsePositive(argv[1], fd) || !parsePositive(argv[3], textSize) ||
+      !parsePositive(argv[4], dataSize)) {
+    fprintf(stderr,
+            "usage: %s <socket fd> <core> <text size> <data size>\n"
+            "Run by oid to probe a core dump, not meant to be run directly\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // A Ctrl-C is meant for oid, which stops the sandbox itself
+  signal(SIGINT, SIG_IGN);
+
+  auto image = CoreImage::open(argv[2]);
+  if (!image.has_value()) {
+    return EXIT_FAILURE;
+  }
+  if (!image->map()) {
+    return errno == EEXIST ? sandbox::exitOverlap : EXIT_FAILURE;
+  }
+
+  void* text = mmap(nullptr,
+                    textSize,
+                    PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1,
+                    0);
+  void* data = mmap(nullptr,
+                    dataSize,
+                    PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS,
+                    -1,
+                    0);
+  if (text == MAP_FAILED || data == MAP_FAILED) {
+    perror("Failed to map the sandbox's segments");
+    return EXIT_FAILURE;
+  }
+
+  int sock = static_cast<int>(fd);
+  uintptr_t bases[] = {reinterpret_cast<uintptr_t>(text),
+                       reinterpret_cast<uintptr_t>(data)};
+  if (send(sock, bases, sizeof(bases), 0) != sizeof(bases)) {
+    return EXIT_FAILURE;
+  }
+
+  agent::Command cmd{};
+  while (recv(sock, &cmd, sizeof(cmd), 0) == sizeof(cmd) && cmd.func != 0) {
+    reinterpret_cast<void (*)(uint64_t)>(cmd.func)(cmd.arg);
+
+    char done = 1;
+    if (send(sock, &done, sizeof(done), 0) != sizeof(done)) {
+      break;
+    }
+  }
+  return EXIT_SUCCESS;
+}
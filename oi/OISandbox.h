@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+/*
+ * oid_sandbox stands in for the process a core was dumped from. oid executes
+ * it as
+ *
+ *   oid_sandbox <socket fd> <core> <text size> <data size>
+ *
+ * It maps the core at its original addresses, then anonymous text and data
+ * segments of the given sizes, and sends their addresses as two uintptr_t over
+ * the SOCK_SEQPACKET socket. From then on it calls each agent::Command it
+ * receives and answers with a single byte, until the socket is closed.
+ *
+ * Being a fresh executable rather than a fork of oid, little but its own
+ * libraries and stack is mapped when it maps the core. Probes run on its main
+ * thread, whose TLS isn't the dumped thread's, so oid rejects probes using TLS
+ * as it does for the agent.
+ */
+namespace oi::detail::sandbox {
+
+/* Exit status when a core segment overlaps one of the sandbox's own mappings */
+constexpr int exitOverlap = 3;
+
+}  // namespace oi::detail::sandbox
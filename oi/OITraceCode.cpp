@@ -27,6 +27,8 @@
 #include <xmmintrin.h>
 #include <cstdint>
 
+#include <ctime>
+#include <type_traits>
 #include <utility>
 #include <unistd.h>
 
@@ -117,6 +119,116 @@ class PointerHashSet {
   }
 };
 
+/*
+ * Bounds the work done by a single traversal. A limit of zero is unlimited.
+ *
+ * `exhausted()` is called before traversing each object: it counts the
+ * object, compares the bytes written so far against the byte limit and reads
+ * the clock every `kTimeCheckInterval` objects. Once any limit is reached the
+ * budget stays exhausted, and the traversal drops all further writes so that
+ * the data is cut on an object boundary.
+ */
+class TraversalBudget {
+ public:
+  void initialize(uint64_t maxTimeNs,
+                  size_t maxBytes,
+                  size_t maxElements) noexcept {
+    deadlineNs = maxTimeNs == 0 ? UINT64_MAX : nowNs() + maxTimeNs;
+    bytesLimit = maxBytes == 0 ? SIZE_MAX : maxBytes;
+    elementsLimit = maxElements == 0 ? SIZE_MAX : maxElements;
+    elements = 0;
+    untilTimeCheck = kTimeCheckInterval;
+    stopped = false;
+  }
+
+  bool exhausted(size_t bytesWritten) noexcept {
+    if (__builtin_expect(stopped, 0)) {
+      return true;
+    }
+    if (++elements > elementsLimit || bytesWritten > bytesLimit) {
+      return stopped = true;
+    }
+    if (--untilTimeCheck == 0) {
+      untilTimeCheck = kTimeCheckInterval;
+      if (deadlineNs != UINT64_MAX && nowNs() > deadlineNs) {
+        return stopped = true;
+      }
+    }
+    return false;
+  }
+
+  /*
+   * Primitives aren't counted: they write no data of their own, and counting
+   * them would stop the compiler from removing loops over them.
+   */
+  template <typename T>
+  bool exhausted(const T&, size_t bytesWritten) noexcept {
+    if constexpr (std::is_fundamental_v<T>) {
+      return stopped;
+    } else {
+      return exhausted(bytesWritten);
+    }
+  }
+
+  bool isExhausted() const noexcept {
+    return stopped;
+  }
+
+  void stop() noexcept {
+    stopped = true;
+  }
+
+  /*
+   * Whether bytes or elements are limited. These are counted in traversal
+   * order, so work split between threads can't stop where a sequential
+   * traversal would.
+   */
+  bool hasCountLimits() const noexcept {
+    return bytesLimit != SIZE_MAX || elementsLimit != SIZE_MAX;
+  }
+
+  /*
+   * A budget for part of the traversal run on another thread, sharing this
+   * budget's limits. Its usage is added back with join().
+   */
+  TraversalBudget fork() const noexcept {
+    TraversalBudget part = *this;
+    part.elements = 0;
+    return part;
+  }
+
+  void join(const TraversalBudget& part) noexcept {
+    elements += part.elements;
+    stopped = stopped || part.stopped;
+  }
+
+  /*
+   * Ends the traversal, returning whether it was cut short. Lifts the limits
+   * so that any trailing metadata can be written.
+   */
+  bool finish() noexcept {
+    bool wasExhausted = stopped;
+    initialize(0, 0, 0);
+    return wasExhausted;
+  }
+
+ private:
+  static constexpr size_t kTimeCheckInterval = 256;
+
+  static uint64_t nowNs() noexcept {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1'000'000'000ULL + ts.tv_nsec;
+  }
+
+  uint64_t deadlineNs;
+  size_t bytesLimit;
+  size_t elementsLimit;
+  size_t elements;
+  size_t untilTimeCheck;
+  bool stopped;
+};
+
 }  // namespace
 
 // alignas(0) is ignored according to docs so can be default
@@ -15,7 +15,9 @@
  */
 #include "oi/SymbolService.h"
 
+#include <fcntl.h>
 #include <glog/logging.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <boost/scope_exit.hpp>
@@ -24,6 +26,7 @@
 #include <fstream>
 
 #include "oi/DrgnUtils.h"
+#include "oi/Metrics.h"
 #include "oi/OIParser.h"
 
 extern "C" {
@@ -123,11 +126,27 @@ SymbolService::SymbolService(fs::path executablePath)
   }
 }
 
+SymbolService::SymbolService(fs::path executable, fs::path core)
+    : target{CoreTarget{std::move(executable), std::move(core)}} {
+  if (!loadModules()) {
+    throw std::runtime_error("Failed to load modules for core " +
+                             std::get<CoreTarget>(target).core.string());
+  }
+}
+
 SymbolService::~SymbolService() {
   if (dwfl != nullptr) {
     dwfl_end(dwfl);
   }
 
+  if (coreElf != nullptr) {
+    elf_end(coreElf);
+  }
+
+  if (coreFd != -1) {
+    close(coreFd);
+  }
+
   if (prog != nullptr) {
     drgn_program_destroy(prog);
   }
@@ -270,6 +289,46 @@ bool SymbolService::loadModulesFromPath(const fs::path& targetPath) {
   return true;
 }
 
+/* Load modules from a core dump, at the addresses they had in the process */
+bool SymbolService::loadModulesFromCore(const CoreTarget& coreTarget) {
+  coreFd = open(coreTarget.core.c_str(), O_RDONLY | O_CLOEXEC);
+  if (coreFd == -1) {
+    PLOG(ERROR) << "Failed to open core " << coreTarget.core;
+    return false;
+  }
+
+  // Read the core rather than map it, the sandbox needs its address space free
+  elf_version(EV_CURRENT);
+  coreElf = elf_begin(coreFd, ELF_C_READ, nullptr);
+  if (coreElf == nullptr) {
+    LOG(ERROR) << "elf_begin: " << elf_errmsg(-1);
+    return false;
+  }
+
+  if (dwfl_core_file_report(dwfl, coreElf, coreTarget.executable.c_str()) <
+      0) {
+    LOG(ERROR) << "dwfl_core_file_report: " << dwfl_errmsg(-1);
+    return false;
+  }
+
+  // Functions are only looked up in executable segments, as for a process
+  size_t phnum = 0;
+  if (elf_getphdrnum(coreElf, &phnum) != 0) {
+    LOG(ERROR) << "elf_getphdrnum: " << elf_errmsg(-1);
+    return false;
+  }
+  for (size_t i = 0; i < phnum; i++) {
+    GElf_Phdr phdr;
+    if (gelf_getphdr(coreElf, i, &phdr) != nullptr &&
+        phdr.p_type == PT_LOAD && (phdr.p_flags & PF_X)) {
+      executableAddrs.emplace_back(phdr.p_vaddr, phdr.p_vaddr + phdr.p_memsz);
+    }
+  }
+  std::sort(executableAddrs.begin(), executableAddrs.end());
+
+  return true;
+}
+
 bool SymbolService::loadModules() {
   static char* debuginfo_path;
   static const Dwfl_Callbacks proc_callbacks{
@@ -291,6 +350,9 @@ bool SymbolService::loadModules() {
       visitor{[this](pid_t targetPid) { return loadModulesFromPid(targetPid); },
               [this](const fs::path& targetPath) {
                 return loadModulesFromPath(targetPath);
+              },
+              [this](const CoreTarget& coreTarget) {
+                return loadModulesFromCore(coreTarget);
               }},
       target);
 
@@ -440,6 +502,7 @@ struct drgn_program* SymbolService::getDrgnProgram() {
     return prog;
   }
 
+  metrics::Tracing _("drgn_load");
   LOG(INFO) << "Initialising drgn. This might take a while";
   switch (target.index()) {
     case 0: {
@@ -458,14 +521,18 @@ struct drgn_program* SymbolService::getDrgnProgram() {
       }
       break;
     }
-    case 1: {
+    case 1:
+    case 2: {
       if (auto* err = drgn_program_create(nullptr, &prog)) {
         LOG(ERROR) << "Failed to create empty drgn program: " << err->code
                    << " " << err->message;
         return nullptr;
       }
 
-      const char* path = std::get<fs::path>(target).c_str();
+      // Types only need the executable's debug info, even for a core
+      const char* path = target.index() == 1
+                             ? std::get<fs::path>(target).c_str()
+                             : std::get<CoreTarget>(target).executable.c_str();
       if (auto* err =
               drgn_program_load_debug_info(prog, &path, 1, false, false)) {
         LOG(ERROR) << "Failed to read debug info: " << err->code << " "
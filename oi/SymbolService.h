@@ -27,6 +27,7 @@
 #include "oi/TypeHierarchy.h"
 
 struct Dwfl;
+struct Elf;
 struct drgn_program;
 struct irequest;
 
@@ -41,6 +42,8 @@ class SymbolService {
  public:
   SymbolService(pid_t);
   SymbolService(std::filesystem::path);
+  /* A core dump of the executable, with its modules where it had them */
+  SymbolService(std::filesystem::path executable, std::filesystem::path core);
   SymbolService(const SymbolService&) = delete;
   SymbolService& operator=(const SymbolService&) = delete;
   ~SymbolService();
@@ -69,13 +72,22 @@ class SymbolService {
   }
 
  private:
-  std::variant<pid_t, std::filesystem::path> target;
+  struct CoreTarget {
+    std::filesystem::path executable;
+    std::filesystem::path core;
+  };
+
+  std::variant<pid_t, std::filesystem::path, CoreTarget> target;
   struct Dwfl* dwfl{nullptr};
   struct drgn_program* prog{nullptr};
+  /* The core stays open for as long as dwfl reads it */
+  int coreFd{-1};
+  struct Elf* coreElf{nullptr};
 
   bool loadModules();
   bool loadModulesFromPid(pid_t);
   bool loadModulesFromPath(const std::filesystem::path&);
+  bool loadModulesFromCore(const CoreTarget&);
 
   std::vector<std::pair<uint64_t, uint64_t>> executableAddrs{};
   bool hardDisableDrgn = false;
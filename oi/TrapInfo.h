@@ -20,6 +20,7 @@
 
 #include "oi/Metrics.h"
 #include "oi/OICompiler.h"
+#include "oi/TimeUtils.h"
 
 extern "C" {
 #include <sys/user.h>
@@ -116,7 +117,10 @@ class trapInfo {
    */
   uintptr_t replayInstAddr{};
 
-  metrics::Tracing lifetime{"trap"};
+  metrics::Tracing lifetime{"trap", metrics::Tracing::Scope::Detached};
+
+  /* When the thread trapped into OID, to account for the time it's paused */
+  time_hr::time_point trappedAt{};
 
   trapInfo() = default;
   trapInfo(trapType t, uint64_t ta, uint64_t po = 0, bool fv = false)
@@ -28,6 +28,7 @@
 #include "oi/ContainerInfo.h"
 #include "oi/DrgnUtils.h"
 #include "oi/Metrics.h"
+#include "oi/NodeIndex.h"
 #include "oi/OICodeGen.h"
 #include "oi/PaddingHunter.h"
 #include "rocksdb/db.h"
@@ -73,6 +74,16 @@ TreeBuilder::TreeBuilder(Config c) : config{std::move(c)} {
   if (auto status = rocksdb::DB::Open(options, testdbPath, &db); !status.ok()) {
     LOG(FATAL) << "RocksDB error while opening database: " << status.ToString();
   }
+
+  if (auto status =
+          db->CreateColumnFamily(rocksdb::ColumnFamilyOptions{options},
+                                 std::string{node_index::kColumnFamily},
+                                 &indexFamily);
+      !status.ok()) {
+    LOG(FATAL) << "RocksDB error while creating the index column family: "
+               << status.ToString();
+  }
+  index = std::make_unique<NodeIndexWriter>(db, indexFamily);
 }
 
 struct TreeBuilder::Variable {
@@ -176,6 +187,12 @@ struct TreeBuilder::Node {
    */
   size_t exclusiveSize{};
 
+  /**
+   * Set when the traversal stopped, on an exhausted budget, before this node or
+   * one of its descendants was fully recorded.
+   */
+  bool truncated{};
+
   MSGPACK_DEFINE_ARRAY(id,
                        name,
                        typeName,
@@ -188,7 +205,8 @@ struct TreeBuilder::Node {
                        pointer,
                        children,
                        isset,
-                       exclusiveSize)
+                       exclusiveSize,
+                       truncated)
 };
 
 TreeBuilder::~TreeBuilder() {
@@ -210,6 +228,14 @@ TreeBuilder::~TreeBuilder() {
     LOG(ERROR) << "RocksDB error while writing DBHeader: " << status.ToString();
   }
 
+  try {
+    index->finish();
+  } catch (const std::exception& e) {
+    LOG(ERROR) << e.what();
+  }
+  index.reset();
+  db->DestroyColumnFamilyHandle(indexFamily);
+
   if (auto status = db->Close(); !status.ok()) {
     LOG(ERROR) << "RocksDB error while closing database: " << status.ToString();
   }
@@ -225,9 +251,12 @@ bool TreeBuilder::emptyOutput() const {
 void TreeBuilder::build(const std::vector<uint64_t>& data,
                         const std::string& argName,
                         struct drgn_type* type,
-                        const TypeHierarchy& typeHierarchy) {
+                        const TypeHierarchy& typeHierarchy,
+                        bool truncated) {
   th = &typeHierarchy;
   oidData = &data;
+  this->truncated = truncated;
+  outOfData = false;
 
   oidDataIndex = 4;  // HACK: OID's first 4 outputs are dummy 0s
 
@@ -235,6 +264,7 @@ void TreeBuilder::build(const std::vector<uint64_t>& data,
   VLOG(1) << "Building tree...";
 
   {
+    metrics::Tracing processTracing("tree_builder_process");
     auto& rootID = rootIDs.emplace_back(nextNodeID++);
 
     try {
@@ -247,15 +277,25 @@ void TreeBuilder::build(const std::vector<uint64_t>& data,
   }
 
   VLOG(1) << "Finished building tree";
-  rocksdb::CompactRangeOptions opts;
-  rocksdb::Status s = db->CompactRange(opts, nullptr, nullptr);
-  if (!s.ok()) {
-    LOG(FATAL) << "RocksDB error while compacting: " << s.ToString();
+  metrics::Tracing::counter("tree_builder_nodes", nextNodeID);
+  {
+    metrics::Tracing compactTracing("compact_db");
+    index->flush();
+    rocksdb::CompactRangeOptions opts;
+    for (auto* family : {db->DefaultColumnFamily(), indexFamily}) {
+      rocksdb::Status s = db->CompactRange(opts, family, nullptr, nullptr);
+      if (!s.ok()) {
+        LOG(FATAL) << "RocksDB error while compacting: " << s.ToString();
+      }
+    }
   }
   VLOG(1) << "Finished compacting db";
 
   // Were all object sizes consumed?
-  if (oidDataIndex != oidData->size()) {
+  if (truncated) {
+    VLOG(1) << "Object tree is truncated, consumed " << oidDataIndex << "/"
+            << oidData->size() << " object sizes";
+  } else if (oidDataIndex != oidData->size()) {
     if (config.strict) {
       LOG(FATAL) << "some object sizes not consumed and OID is in strict mode!"
                  << "reported: " << oidData->size() << " consumed "
@@ -279,6 +319,7 @@ void TreeBuilder::dumpJson() {
     return;
   }
 
+  metrics::Tracing _("dump_json");
   std::ofstream output(*config.jsonPath);
   output << '[';
   for (auto rootID : rootIDs) {
@@ -371,6 +412,10 @@ uint64_t TreeBuilder::getDrgnTypeSize(struct drgn_type* type) {
 
 uint64_t TreeBuilder::next() {
   if (oidDataIndex >= oidData->size()) {
+    if (truncated) {
+      outOfData = true;
+      return 0;
+    }
     throw std::runtime_error("Unexpected end of data");
   }
   VLOG(3) << "next = " << (void*)(*oidData)[oidDataIndex];
@@ -434,6 +479,17 @@ TreeBuilder::Node TreeBuilder::process(NodeID id, Variable variable) {
       .staticSize = getDrgnTypeSize(variable.type),
       .isset = variable.isset,
   };
+
+  const auto parentPathSize = path.size();
+  if (!node.typePath.empty()) {
+    if (!path.empty())
+      path += '/';
+    path += node.typePath;
+  }
+  BOOST_SCOPE_EXIT_ALL(&) {
+    path.resize(parentPathSize);
+  };
+
   VLOG(2) << "Processing node [" << id << "] (name: '" << variable.name
           << "', typeName: '" << node.typeName
           << "', kind: " << drgnKindStr(variable.type) << ")"
@@ -571,6 +627,10 @@ TreeBuilder::Node TreeBuilder::process(NodeID id, Variable variable) {
     }
   }
 
+  node.truncated = outOfData;
+
+  index->add(node.id, node.exclusiveSize, node.typeName, path);
+
   rocksdb::WriteOptions options{};
   options.disableWAL = true;
   auto status = db->Put(options, std::to_string(node.id), serialize(node));
@@ -722,7 +782,7 @@ void TreeBuilder::processContainer(const Variable& variable, Node& node) {
       //
       // However, this conversion may be optimised away in the target process,
       // so we need to treat any invalid index as variant_npos.
-      if (auto index = next(); index < elementTypes.size()) {
+      if (auto index = next(); !outOfData && index < elementTypes.size()) {
         // Recurse only into the type of the template parameter which
         // is currently stored in this variant
         node.children = {nextNodeID, nextNodeID + 1};
@@ -915,7 +975,7 @@ void TreeBuilder::processContainer(const Variable& variable, Node& node) {
   nextNodeID += numChildren;
   auto childID = node.children->first;
   uint64_t memberSizes = 0;
-  for (size_t i = 0; i < containerStats.length; i++) {
+  for (size_t i = 0; i < containerStats.length && !outOfData; i++) {
     for (auto& type : elementTypes) {
       auto child = process(childID++,
                            {.type = type.type,
@@ -925,6 +985,13 @@ void TreeBuilder::processContainer(const Variable& variable, Node& node) {
       memberSizes += child.dynamicSize + child.staticSize;
     }
   }
+  if (outOfData) {
+    // Only the elements processed before the data ran out were recorded
+    if (childID == node.children->first)
+      node.children.reset();
+    else
+      node.children->second = childID;
+  }
   setSize(node, node.dynamicSize, memberSizes);
 }
 
@@ -977,6 +1044,10 @@ void TreeBuilder::JSON(NodeID id, std::ofstream& output) {
     output << ",";
     output << "\"isset\":" << (*node.isset ? "true" : "false");
   }
+  if (node.truncated) {
+    output << ",";
+    output << "\"truncated\":true";
+  }
   if (node.children.has_value()) {
     output << ",";
     output << "\"members\":[";
@@ -30,6 +30,7 @@
 // so we just forward-declare `DB` to avoid making other compile units
 // pay the cost of including the relevant headers.
 namespace rocksdb {
+class ColumnFamilyHandle;
 class DB;
 }
 
@@ -38,6 +39,8 @@ struct PaddingInfo;
 
 namespace oi::detail {
 
+class NodeIndexWriter;
+
 class TreeBuilder {
  public:
   struct Config {
@@ -56,7 +59,8 @@ class TreeBuilder {
   void build(const std::vector<uint64_t>&,
              const std::string&,
              struct drgn_type*,
-             const TypeHierarchy&);
+             const TypeHierarchy&,
+             bool truncated = false);
   void dumpJson();
   void setPaddedStructs(std::map<std::string, PaddingInfo>* paddedStructs);
   bool emptyOutput() const;
@@ -70,12 +74,24 @@ class TreeBuilder {
 
   const TypeHierarchy* th = nullptr;
   const std::vector<uint64_t>* oidData = nullptr;
+  /*
+   * Set when the traversal stopped early on an exhausted budget. Reading past
+   * the end of truncated data yields zeroes and sets `outOfData` instead of
+   * failing.
+   */
+  bool truncated = false;
+  bool outOfData = false;
   std::map<std::string, PaddingInfo>* paddedStructs = nullptr;
 
   /*
    * The RocksDB output needs versioning so they are imported correctly in
    * Scuba. Version 1 had no concept of versioning and no header.
-   * We currently are at version 2.1:
+   * We currently are at version 2.3:
+   *  - Introduce the secondary indexes of NodeIndex.h, in their own column
+   *    family
+   * Changelog v2.2:
+   *  - Introduce the `truncated` flag on Nodes
+   * Changelog v2.1:
    *  - Introduce the Error ID at index 1023, but don't output it
    * Changelog v2:
    *  - Introduce the DBHeader at index 0
@@ -105,6 +121,14 @@ class TreeBuilder {
    */
   std::unique_ptr<msgpack::sbuffer> buffer;
   rocksdb::DB* db = nullptr;
+  rocksdb::ColumnFamilyHandle* indexFamily = nullptr;
+  std::unique_ptr<NodeIndexWriter> index;
+
+  /*
+   * The index path of the node being processed: the non-empty `typePath`s of
+   * its ancestors and itself, joined by '/'.
+   */
+  std::string path;
 
   uint64_t getDrgnTypeSize(struct drgn_type* type);
   uint64_t next();
@@ -90,6 +90,12 @@ void CSV::print(IntrospectionResult::const_iterator& it,
       out_ << it->is_set_stats->is_set << kDelimiter;
     }
 
+    if (!it->is_truncated) {
+      out_ << kDelimiter;
+    } else {
+      out_ << it->is_truncated << kDelimiter;
+    }
+
     while (parentIdStack_.size() > it->type_path.size()) {
       parentIdStack_.pop_back();
     }
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <oi/exporters/Columnar.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef OI_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace oi::exporters {
+namespace {
+
+template <typename T>
+void append(std::vector<char>& buf, const T& value) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buf.insert(buf.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+void appendColumn(std::vector<char>& buf,
+                  const std::vector<columnar::Row>& rows,
+                  T columnar::Row::*column) {
+  size_t offset = buf.size();
+  buf.resize(offset + rows.size() * sizeof(T));
+  char* out = buf.data() + offset;
+  for (const auto& row : rows) {
+    std::memcpy(out, &(row.*column), sizeof(T));
+    out += sizeof(T);
+  }
+}
+
+}  // namespace
+
+Columnar::Columnar(std::ostream& out, columnar::Compression compression)
+    : out_(out), compression_(compression) {
+#ifndef OI_HAVE_ZSTD
+  if (compression_ == columnar::Compression::Zstd) {
+    throw std::runtime_error(
+        "zstd compression is not supported by this build");
+  }
+#endif
+  rows_.reserve(columnar::kBlockRows);
+}
+
+void Columnar::print(const IntrospectionResult& result) {
+  auto begin = result.cbegin();
+  return print(begin, result.cend());
+}
+
+void Columnar::print(IntrospectionResult::const_iterator& it,
+                     IntrospectionResult::const_iterator end) {
+  if (!headerWritten_) {
+    columnar::FileHeader header{
+        .magic = columnar::kMagic,
+        .version = columnar::kVersion,
+        .reserved = 0,
+    };
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    headerWritten_ = true;
+  }
+
+  parentIdStack_.resize(1);  // Reset to parentIdStack_ = {0}
+  pathIdStack_.resize(1);
+  for (/* it */; it != end; ++it) {
+    ++id_;
+
+    while (parentIdStack_.size() > it->type_path.size()) {
+      parentIdStack_.pop_back();
+      pathIdStack_.pop_back();
+    }
+
+    // The parent's path is this element's path without its last entry, so
+    // only the last entry needs interning.
+    uint32_t path = 0;
+    if (!it->type_path.empty() &&
+        pathIdStack_.size() == it->type_path.size()) {
+      path = internPath(pathIdStack_.back(), it->type_path.back());
+    } else {
+      for (const auto& entry : it->type_path) {
+        path = internPath(path, entry);
+      }
+    }
+
+    uint8_t flags = 0;
+    if (it->pointer.has_value())
+      flags |= columnar::kHasPointer;
+    if (it->container_stats.has_value())
+      flags |= columnar::kHasContainerStats;
+    if (it->is_set_stats.has_value()) {
+      flags |= columnar::kHasIsSet;
+      if (it->is_set_stats->is_set)
+        flags |= columnar::kIsSet;
+    }
+    if (it->is_truncated)
+      flags |= columnar::kIsTruncated;
+    if (it->is_primitive)
+      flags |= columnar::kIsPrimitive;
+
+    rows_.push_back(columnar::Row{
+        .parentId = parentIdStack_.back(),
+        .name = internString(it->name),
+        .typePath = path,
+        .typeNames = internTypeNames(it->type_names),
+        .staticSize = it->static_size,
+        .exclusiveSize = it->exclusive_size,
+        .pointer = it->pointer.value_or(0),
+        .length = it->container_stats ? it->container_stats->length : 0,
+        .capacity = it->container_stats ? it->container_stats->capacity : 0,
+        .flags = flags,
+    });
+
+    parentIdStack_.push_back(id_);
+    pathIdStack_.push_back(path);
+
+    if (rows_.size() == columnar::kBlockRows)
+      writeBlock();
+  }
+
+  if (!rows_.empty())
+    writeBlock();
+  out_.flush();
+}
+
+uint32_t Columnar::internString(std::string_view str) {
+  if (auto it = stringIds_.find(str); it != stringIds_.end())
+    return it->second;
+
+  auto id = static_cast<uint32_t>(strings_.size());
+  const auto& owned = strings_.emplace_back(str);
+  stringIds_.emplace(owned, id);
+  return id;
+}
+
+uint32_t Columnar::internPath(uint32_t parent, std::string_view name) {
+  uint32_t str = internString(name);
+  uint64_t key = (static_cast<uint64_t>(parent) << 32) | str;
+
+  // Path 0 is the empty path
+  auto [it, inserted] =
+      pathIds_.emplace(key, static_cast<uint32_t>(pathIds_.size() + 1));
+  if (inserted)
+    newPaths_.emplace_back(parent, str);
+  return it->second;
+}
+
+uint32_t Columnar::internTypeNames(std::span<const std::string_view> names) {
+  typeNamesScratch_.clear();
+  for (const auto& name : names)
+    typeNamesScratch_.push_back(internString(name));
+
+  if (auto it = typeNamesIds_.find(typeNamesScratch_);
+      it != typeNamesIds_.end())
+    return it->second;
+
+  auto id = static_cast<uint32_t>(typeNamesIds_.size());
+  typeNamesIds_.emplace(typeNamesScratch_, id);
+  newTypeNames_.push_back(typeNamesScratch_.size());
+  newTypeNames_.insert(
+      newTypeNames_.end(), typeNamesScratch_.begin(), typeNamesScratch_.end());
+  newTypeNamesCount_++;
+  return id;
+}
+
+size_t Columnar::TypeNamesHash::operator()(
+    const std::vector<uint32_t>& ids) const {
+  size_t hash = ids.size();
+  for (auto id : ids)
+    hash ^= id + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+  return hash;
+}
+
+void Columnar::writeBlock() {
+  payload_.clear();
+
+  append(payload_, static_cast<uint32_t>(strings_.size() - stringsWritten_));
+  for (size_t i = stringsWritten_; i < strings_.size(); i++) {
+    const auto& str = strings_[i];
+    append(payload_, static_cast<uint32_t>(str.size()));
+    payload_.insert(payload_.end(), str.begin(), str.end());
+  }
+  stringsWritten_ = strings_.size();
+
+  append(payload_, static_cast<uint32_t>(newPaths_.size()));
+  for (const auto& [parent, str] : newPaths_) {
+    append(payload_, parent);
+    append(payload_, str);
+  }
+  newPaths_.clear();
+
+  append(payload_, newTypeNamesCount_);
+  for (auto word : newTypeNames_)
+    append(payload_, word);
+  newTypeNames_.clear();
+  newTypeNamesCount_ = 0;
+
+  appendColumn(payload_, rows_, &columnar::Row::parentId);
+  appendColumn(payload_, rows_, &columnar::Row::name);
+  appendColumn(payload_, rows_, &columnar::Row::typePath);
+  appendColumn(payload_, rows_, &columnar::Row::typeNames);
+  appendColumn(payload_, rows_, &columnar::Row::staticSize);
+  appendColumn(payload_, rows_, &columnar::Row::exclusiveSize);
+  appendColumn(payload_, rows_, &columnar::Row::pointer);
+  appendColumn(payload_, rows_, &columnar::Row::length);
+  appendColumn(payload_, rows_, &columnar::Row::capacity);
+  appendColumn(payload_, rows_, &columnar::Row::flags);
+
+  const std::vector<char>* stored = &payload_;
+#ifdef OI_HAVE_ZSTD
+  if (compression_ == columnar::Compression::Zstd) {
+    compressed_.resize(ZSTD_compressBound(payload_.size()));
+    size_t size = ZSTD_compress(compressed_.data(),
+                                compressed_.size(),
+                                payload_.data(),
+                                payload_.size(),
+                                ZSTD_CLEVEL_DEFAULT);
+    if (ZSTD_isError(size)) {
+      throw std::runtime_error(std::string("zstd compression failed: ") +
+                               ZSTD_getErrorName(size));
+    }
+    compressed_.resize(size);
+    stored = &compressed_;
+  }
+#endif
+
+  columnar::BlockHeader header{
+      .rows = static_cast<uint32_t>(rows_.size()),
+      .codec = compression_,
+      .rawSize = payload_.size(),
+      .storedSize = stored->size(),
+  };
+  out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out_.write(stored->data(), static_cast<std::streamsize>(stored->size()));
+
+  rows_.clear();
+}
+
+}  // namespace oi::exporters
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <oi/exporters/ColumnarReader.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef OI_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace oi::exporters {
+namespace {
+
+class Cursor {
+ public:
+  Cursor(const std::vector<char>& buf)
+      : pos_(buf.data()), end_(pos_ + buf.size()) {
+  }
+
+  const char* take(size_t len) {
+    if (len > static_cast<size_t>(end_ - pos_))
+      throw std::runtime_error("columnar block is truncated");
+    const char* data = pos_;
+    pos_ += len;
+    return data;
+  }
+
+  template <typename T>
+  T read() {
+    T value;
+    std::memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  void readColumn(std::vector<columnar::Row>& rows, T columnar::Row::*column) {
+    const char* data = take(rows.size() * sizeof(T));
+    for (auto& row : rows) {
+      std::memcpy(&(row.*column), data, sizeof(T));
+      data += sizeof(T);
+    }
+  }
+
+  bool atEnd() const {
+    return pos_ == end_;
+  }
+
+ private:
+  const char* pos_;
+  const char* end_;
+};
+
+}  // namespace
+
+ColumnarReader::ColumnarReader(std::istream& in) : in_(in) {
+  columnar::FileHeader header;
+  if (!in_.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      header.magic != columnar::kMagic) {
+    throw std::runtime_error("not a columnar introspection result");
+  }
+  if (header.version != columnar::kVersion) {
+    throw std::runtime_error("unsupported columnar format version " +
+                             std::to_string(header.version));
+  }
+}
+
+bool ColumnarReader::next(std::vector<columnar::Row>& rows) {
+  columnar::BlockHeader header;
+  if (!in_.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    if (in_.gcount() != 0)
+      throw std::runtime_error("columnar block header is truncated");
+    return false;
+  }
+
+  stored_.resize(header.storedSize);
+  if (!in_.read(stored_.data(), static_cast<std::streamsize>(stored_.size())))
+    throw std::runtime_error("columnar block is truncated");
+
+  switch (header.codec) {
+    case columnar::Compression::None:
+      payload_.swap(stored_);
+      break;
+    case columnar::Compression::Zstd: {
+#ifdef OI_HAVE_ZSTD
+      payload_.resize(header.rawSize);
+      size_t size = ZSTD_decompress(
+          payload_.data(), payload_.size(), stored_.data(), stored_.size());
+      if (ZSTD_isError(size) || size != header.rawSize) {
+        throw std::runtime_error("columnar block failed to decompress");
+      }
+      break;
+#else
+      throw std::runtime_error(
+          "zstd compression is not supported by this build");
+#endif
+    }
+    default:
+      throw std::runtime_error("unknown columnar block codec");
+  }
+
+  Cursor cur{payload_};
+
+  auto newStrings = cur.read<uint32_t>();
+  for (uint32_t i = 0; i < newStrings; i++) {
+    auto len = cur.read<uint32_t>();
+    strings_.emplace_back(cur.take(len), len);
+  }
+
+  auto newPaths = cur.read<uint32_t>();
+  for (uint32_t i = 0; i < newPaths; i++) {
+    auto parent = cur.read<uint32_t>();
+    auto str = cur.read<uint32_t>();
+    if (parent >= paths_.size() || str >= strings_.size())
+      throw std::runtime_error("columnar type path refers to unknown ids");
+    paths_.emplace_back(parent, str);
+  }
+
+  auto newTypeNames = cur.read<uint32_t>();
+  for (uint32_t i = 0; i < newTypeNames; i++) {
+    auto len = cur.read<uint32_t>();
+    for (uint32_t j = 0; j < len; j++) {
+      auto str = cur.read<uint32_t>();
+      if (str >= strings_.size())
+        throw std::runtime_error("columnar type names refer to unknown ids");
+      typeNamesData_.push_back(str);
+    }
+    typeNamesOffsets_.push_back(typeNamesData_.size());
+  }
+
+  rows.resize(header.rows);
+  cur.readColumn(rows, &columnar::Row::parentId);
+  cur.readColumn(rows, &columnar::Row::name);
+  cur.readColumn(rows, &columnar::Row::typePath);
+  cur.readColumn(rows, &columnar::Row::typeNames);
+  cur.readColumn(rows, &columnar::Row::staticSize);
+  cur.readColumn(rows, &columnar::Row::exclusiveSize);
+  cur.readColumn(rows, &columnar::Row::pointer);
+  cur.readColumn(rows, &columnar::Row::length);
+  cur.readColumn(rows, &columnar::Row::capacity);
+  cur.readColumn(rows, &columnar::Row::flags);
+  if (!cur.atEnd())
+    throw std::runtime_error("columnar block has trailing data");
+
+  for (const auto& row : rows) {
+    if (row.name >= strings_.size() || row.typePath >= paths_.size() ||
+        row.typeNames + 1 >= typeNamesOffsets_.size())
+      throw std::runtime_error("columnar row refers to unknown ids");
+  }
+
+  firstId_ = nextId_;
+  nextId_ += rows.size();
+  return true;
+}
+
+std::string_view ColumnarReader::string(uint32_t id) const {
+  return strings_.at(id);
+}
+
+std::vector<std::string_view> ColumnarReader::typePath(uint32_t id) const {
+  if (id >= paths_.size())
+    throw std::out_of_range("unknown columnar type path");
+
+  std::vector<std::string_view> path;
+  // Paths only extend earlier paths, so this always reaches the empty path
+  for (; id != 0; id = paths_[id].first) {
+    path.push_back(strings_[paths_[id].second]);
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+std::vector<std::string_view> ColumnarReader::typeNames(uint32_t id) const {
+  std::vector<std::string_view> names;
+  for (uint32_t i = typeNamesOffsets_.at(id); i < typeNamesOffsets_.at(id + 1);
+       i++) {
+    names.push_back(strings_[typeNamesData_[i]]);
+  }
+  return names;
+}
+
+}  // namespace oi::exporters
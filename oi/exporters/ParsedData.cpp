@@ -28,31 +28,37 @@ uint64_t parseVarint(std::vector<uint8_t>::const_iterator& it);
 }
 
 ParsedData ParsedData::parse(std::vector<uint8_t>::const_iterator& it,
+                             uintptr_t& lastPointer,
                              types::dy::Dynamic dy) {
   return std::visit(
-      [&it](const auto el) -> ParsedData {
+      [&it, &lastPointer](const auto el) -> ParsedData {
         auto ty = el.get();
         using T = std::decay_t<decltype(ty)>;
         if constexpr (std::is_same_v<T, types::dy::Unit>) {
           return ParsedData::Unit{};
         } else if constexpr (std::is_same_v<T, types::dy::VarInt>) {
           return ParsedData::VarInt{.value = parseVarint(it)};
+        } else if constexpr (std::is_same_v<T, types::dy::Pointer>) {
+          // Zigzag encoded difference from the previous pointer
+          auto zigzag = parseVarint(it);
+          lastPointer += (zigzag >> 1) ^ -(zigzag & 1);
+          return ParsedData::VarInt{.value = lastPointer};
         } else if constexpr (std::is_same_v<T, types::dy::Pair>) {
           return ParsedData::Pair{
-              .first = Lazy{it, ty.first},
-              .second = Lazy{it, ty.second},
+              .first = Lazy{it, lastPointer, ty.first},
+              .second = Lazy{it, lastPointer, ty.second},
           };
         } else if constexpr (std::is_same_v<T, types::dy::List>) {
           return ParsedData::List{
               .length = parseVarint(it),
-              .values = {it, ty.element},
+              .values = {it, lastPointer, ty.element},
           };
         } else if constexpr (std::is_same_v<T, types::dy::Sum>) {
           auto index = parseVarint(it);
           assert(index < ty.variants.size());
           return ParsedData::Sum{
               .index = index,
-              .value = {it, ty.variants[index]},
+              .value = {it, lastPointer, ty.variants[index]},
           };
         } else {
           static_assert(always_false_v<T>, "non-exhaustive visitor!");
@@ -41,6 +41,12 @@ std::optional<TypeCheckingWalker::Element> TypeCheckingWalker::advance() {
         } else if constexpr (std::is_same_v<T, types::dy::VarInt>) {
           // VarInt type - pop one element and return as a `VarInt`.
           return TypeCheckingWalker::VarInt{popFront()};
+        } else if constexpr (std::is_same_v<T, types::dy::Pointer>) {
+          // Pointer type - pop one element as the zigzag encoded difference
+          // from the previous pointer and return the pointer as a `Pointer`.
+          auto el = popFront();
+          lastPointer += (el >> 1) ^ -(el & 1);
+          return TypeCheckingWalker::Pointer{lastPointer};
         } else if constexpr (std::is_same_v<T, types::dy::Pair>) {
           // Pair type - read all of left then all of right. Recurse to get the
           // values.
@@ -43,13 +43,16 @@ class TypeCheckingWalker {
   struct VarInt {
     uint64_t value;
   };
+  struct Pointer {
+    uintptr_t value;
+  };
   struct SumIndex {
     uint64_t index;
   };
   struct ListLength {
     uint64_t length;
   };
-  using Element = std::variant<VarInt, SumIndex, ListLength>;
+  using Element = std::variant<VarInt, Pointer, SumIndex, ListLength>;
 
   TypeCheckingWalker(types::dy::Dynamic rootType,
                      std::span<const uint64_t> buffer)
@@ -61,6 +64,7 @@ class TypeCheckingWalker {
  private:
   std::stack<types::dy::Dynamic> stack;
   std::span<const uint64_t> buf;
+  uintptr_t lastPointer = 0;
 
  private:
   uint64_t popFront() {
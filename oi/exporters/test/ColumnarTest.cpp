@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <oi/exporters/Columnar.h>
+#include <oi/exporters/ColumnarReader.h>
+
+#include <sstream>
+
+using namespace oi;
+using namespace oi::exporters;
+
+namespace {
+
+const std::array<std::string_view, 1> kIntNames{"int"};
+const std::array<std::string_view, 2> kBarNames{"Bar", "struct Bar"};
+const std::array<std::string_view, 1> kFooNames{"Foo"};
+const std::array<inst::Field, 0> kNoFields{};
+const std::array<inst::ProcessorInst, 0> kNoProcessors{};
+
+const std::array<inst::Field, 1> kBarFields{
+    inst::Field{4, "z", kIntNames, kNoFields, kNoProcessors, true},
+};
+const std::array<inst::Field, 2> kFooFields{
+    inst::Field{4, "x", kIntNames, kNoFields, kNoProcessors, true},
+    inst::Field{4, "y", kBarNames, kBarFields, kNoProcessors, false},
+};
+const inst::Field kFoo{16, 8, "a", kFooNames, kFooFields, kNoProcessors, false};
+
+std::vector<columnar::Row> readAll(ColumnarReader& reader) {
+  std::vector<columnar::Row> all;
+  std::vector<columnar::Row> block;
+  while (reader.next(block))
+    all.insert(all.end(), block.begin(), block.end());
+  return all;
+}
+
+}  // namespace
+
+TEST(Columnar, RoundTrip) {
+  std::stringstream out;
+  Columnar exporter{out};
+  exporter.print(IntrospectionResult{{}, std::cref(kFoo)});
+
+  ColumnarReader reader{out};
+  auto rows = readAll(reader);
+  ASSERT_EQ(rows.size(), 4);
+
+  // a, a.x, a.y, a.y.z
+  EXPECT_EQ(reader.string(rows[0].name), "a");
+  EXPECT_EQ(rows[0].parentId, 0);
+  EXPECT_EQ(rows[0].staticSize, 16);
+  EXPECT_EQ(rows[0].exclusiveSize, 8);
+  EXPECT_EQ(reader.typeNames(rows[0].typeNames),
+            std::vector<std::string_view>{"Foo"});
+  EXPECT_EQ(rows[0].flags, 0);
+
+  EXPECT_EQ(reader.string(rows[1].name), "x");
+  EXPECT_EQ(rows[1].parentId, 1);
+  EXPECT_EQ(rows[1].flags, columnar::kIsPrimitive);
+
+  EXPECT_EQ(reader.string(rows[2].name), "y");
+  EXPECT_EQ(rows[2].parentId, 1);
+  EXPECT_EQ(reader.typeNames(rows[2].typeNames),
+            (std::vector<std::string_view>{"Bar", "struct Bar"}));
+
+  EXPECT_EQ(reader.string(rows[3].name), "z");
+  EXPECT_EQ(rows[3].parentId, 3);
+  EXPECT_EQ(reader.typePath(rows[3].typePath),
+            (std::vector<std::string_view>{"a", "y", "z"}));
+
+  // Repeated type names are stored once
+  EXPECT_EQ(rows[1].typeNames, rows[3].typeNames);
+}
+
+TEST(Columnar, IdsContinueAcrossResults) {
+  std::stringstream out;
+  Columnar exporter{out};
+  exporter.print(IntrospectionResult{{}, std::cref(kFoo)});
+  exporter.print(IntrospectionResult{{}, std::cref(kFoo)});
+
+  ColumnarReader reader{out};
+  std::vector<columnar::Row> rows;
+  ASSERT_TRUE(reader.next(rows));
+  EXPECT_EQ(reader.firstId(), 1);
+
+  ASSERT_TRUE(reader.next(rows));
+  EXPECT_EQ(reader.firstId(), 5);
+  ASSERT_EQ(rows.size(), 4);
+  EXPECT_EQ(rows[0].parentId, 0);
+  EXPECT_EQ(rows[3].parentId, 7);
+  EXPECT_EQ(reader.typePath(rows[3].typePath),
+            (std::vector<std::string_view>{"a", "y", "z"}));
+
+  EXPECT_FALSE(reader.next(rows));
+}
+
+TEST(Columnar, RejectsOtherFiles) {
+  std::stringstream csv{"id,name,typePath\r\n"};
+  EXPECT_THROW(ColumnarReader{csv}, std::runtime_error);
+}
+
+TEST(Columnar, RejectsTruncatedBlocks) {
+  std::stringstream out;
+  Columnar exporter{out};
+  exporter.print(IntrospectionResult{{}, std::cref(kFoo)});
+
+  auto data = out.str();
+  std::stringstream truncated{data.substr(0, data.size() - 1)};
+  ColumnarReader reader{truncated};
+  std::vector<columnar::Row> rows;
+  EXPECT_THROW(reader.next(rows), std::runtime_error);
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <oi/exporters/Json.h>
+
+#include <sstream>
+
+using namespace oi;
+using namespace oi::exporters;
+
+namespace {
+
+const std::array<std::string_view, 1> kIntNames{"int"};
+const std::array<inst::Field, 0> kNoFields{};
+const std::array<inst::ProcessorInst, 0> kNoProcessors{};
+
+std::string print(const inst::Field& field, bool typePaths = true) {
+  std::stringstream out;
+  Json json{out};
+  json.setTypePaths(typePaths);
+  json.print(IntrospectionResult{{}, std::cref(field)});
+  return out.str();
+}
+
+}  // namespace
+
+TEST(Json, Simple) {
+  const inst::Field field{4, "a", kIntNames, kNoFields, kNoProcessors, true};
+  EXPECT_EQ(print(field),
+            R"([{"name":"a","typePath":["a"],"typeNames":["int"],)"
+            R"("staticSize":4,"exclusiveSize":4,"is_primitive":true,)"
+            R"("members":[]}])");
+}
+
+TEST(Json, EscapesStrings) {
+  // Long enough to go through the vectorised path and the tail after it
+  const inst::Field field{
+      4,
+      "quote\" backslash\\ newline\n control\x01 high\xc3\xa9 and the rest",
+      kIntNames,
+      kNoFields,
+      kNoProcessors,
+      true};
+  auto json = print(field, false);
+  EXPECT_NE(json.find(R"("name":"quote\" backslash\\ newline\n )"
+                      R"(control\u0001 high)"
+                      "\xc3\xa9"
+                      R"( and the rest")"),
+            std::string::npos)
+      << json;
+}
+
+TEST(Json, OmitsTypePaths) {
+  const std::array<inst::Field, 1> fields{
+      inst::Field{4, "b", kIntNames, kNoFields, kNoProcessors, true}};
+  const inst::Field field{4, "a", kIntNames, fields, kNoProcessors, false};
+  EXPECT_EQ(print(field, false).find("typePath"), std::string::npos);
+  EXPECT_NE(print(field, true).find(R"("typePath":["a","b"])"),
+            std::string::npos);
+}
@@ -183,3 +183,27 @@ TEST(TypeCheckingWalker, TestListSome) {
 
   ASSERT_FALSE(fifth.has_value());
 }
+
+TEST(TypeCheckingWalker, TestPointerDeltas) {
+  // ASSIGN
+  // Zigzag encoded deltas of +0x1000, +0x10 and -0x8
+  std::vector<uint64_t> data{3, 0x2000, 0x20, 0xf};
+
+  types::dy::Pointer pointer;
+  types::dy::List rootType{pointer};
+
+  TypeCheckingWalker walker(rootType, data);
+
+  // ACT
+  auto length = walker.advance();
+  std::vector<uintptr_t> pointers;
+  while (auto el = walker.advance()) {
+    ASSERT_TRUE(std::holds_alternative<TypeCheckingWalker::Pointer>(*el));
+    pointers.push_back(std::get<TypeCheckingWalker::Pointer>(*el).value);
+  }
+
+  // ASSERT
+  ASSERT_TRUE(length.has_value());
+  EXPECT_EQ(std::get<TypeCheckingWalker::ListLength>(*length).length, 3);
+  EXPECT_EQ(pointers, (std::vector<uintptr_t>{0x1000, 0x1010, 0x1008}));
+}
@@ -98,6 +98,8 @@ void AddChildren::visit(Class& c) {
     if (isActuallyChild)
       c.children.push_back(*childClass);
   }
+  if (!c.children.empty())
+    typeGraph_.markChanged(c);
 
   // Recurse to find children-of-children
   for (const auto& child : c.children) {
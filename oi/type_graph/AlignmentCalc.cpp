@@ -25,8 +25,8 @@ using ref = std::reference_wrapper<T>;
 namespace oi::detail::type_graph {
 
 Pass AlignmentCalc::createPass() {
-  auto fn = [](TypeGraph& typeGraph, NodeTracker&) {
-    AlignmentCalc alignmentCalc;
+  auto fn = [](TypeGraph& typeGraph, NodeTracker& tracker) {
+    AlignmentCalc alignmentCalc{tracker};
     alignmentCalc.calculateAlignments(typeGraph.rootTypes());
   };
 
@@ -40,10 +40,9 @@ void AlignmentCalc::calculateAlignments(const std::vector<ref<Type>>& types) {
 };
 
 void AlignmentCalc::accept(Type& type) {
-  if (visited_.count(&type) != 0)
+  if (tracker_.visit(type))
     return;
 
-  visited_.insert(&type);
   type.accept(*this);
 }
 
@@ -16,9 +16,9 @@
 #pragma once
 
 #include <functional>
-#include <unordered_set>
 #include <vector>
 
+#include "NodeTracker.h"
 #include "PassManager.h"
 #include "Types.h"
 #include "Visitor.h"
@@ -34,6 +34,9 @@ class AlignmentCalc final : public RecursiveVisitor {
  public:
   static Pass createPass();
 
+  AlignmentCalc(NodeTracker& tracker) : tracker_(tracker) {
+  }
+
   void calculateAlignments(
       const std::vector<std::reference_wrapper<Type>>& types);
 
@@ -44,7 +47,7 @@ class AlignmentCalc final : public RecursiveVisitor {
   void visit(Container& c) override;
 
  private:
-  std::unordered_set<Type*> visited_;
+  NodeTracker& tracker_;
 };
 
 }  // namespace oi::detail::type_graph
@@ -277,7 +277,7 @@ std::optional<TemplateParam> ClangTypeParser::enumerateTemplateParam(
         value = std::string{val};
       }
 
-      return TemplateParam{ty, value};
+      return TemplateParam{ty, typeGraph_.intern(value)};
     }
     case clang::TemplateArgument::Template: {
       return enumerateTemplateTemplateParam(p.getAsTemplate());
@@ -365,7 +365,8 @@ void ClangTypeParser::enumerateClassMembers(const clang::RecordType& ty,
     size_t offset_in_bits = decl->getASTContext().getFieldOffset(field);
 
     auto& mtype = enumerateType(*qualType);
-    Member m{mtype, std::move(member_name), offset_in_bits, size_in_bits};
+    Member m{
+        mtype, typeGraph_.intern(member_name), offset_in_bits, size_in_bits};
     m.align = field->getMaxAlignment() / 8;
     members.push_back(m);
   }
@@ -72,7 +72,11 @@ drgn_type* DrgnExporter::visit(Class& c) {
     drgn_type* memType = accept(mem.type());
 
     th_.classMembersMap[drgnType].push_back(DrgnClassMemberInfo{
-        memType, mem.inputName, mem.bitOffset, mem.bitsize, false});
+        memType,
+        std::string{mem.inputName},
+        mem.bitOffset,
+        mem.bitsize,
+        false});
 
     if (const auto* container = dynamic_cast<const Container*>(&mem.type());
         container && container->containerInfo_.ctype == THRIFT_ISSET_TYPE) {
@@ -257,9 +257,9 @@ void DrgnParser::enumerateClassMembers(struct drgn_type* type,
     //      isStubbed = true;
     //      return;
     //    }
-    std::string member_name = "";
+    std::string_view member_name;
     if (drgn_members[i].name)
-      member_name = drgn_members[i].name;
+      member_name = typeGraph_.intern(drgn_members[i].name);
 
     auto& mtype = enumerateType(member_type);
     uint64_t moffset = drgn_members[i].bit_offset;
@@ -373,7 +373,7 @@ void DrgnParser::enumerateTemplateParam(struct drgn_type* type,
       }
     }
 
-    params.emplace_back(ttype, std::move(value));
+    params.emplace_back(ttype, typeGraph_.intern(value));
   }
 }
 
@@ -408,9 +408,8 @@ void DrgnParser::enumerateClassFunctions(struct drgn_type* type,
     }
 
     auto virtuality = drgn_type_virtuality(t.type);
-    std::string name = drgn_type_tag(t.type);
-    Function f(name, virtuality);
-    functions.push_back(f);
+    functions.emplace_back(typeGraph_.intern(drgn_type_tag(t.type)),
+                           virtuality);
   }
 }
 
@@ -22,8 +22,8 @@ namespace oi::detail::type_graph {
 
 Pass IdentifyContainers::createPass(
     const std::vector<std::unique_ptr<ContainerInfo>>& containers) {
-  auto fn = [&containers](TypeGraph& typeGraph, NodeTracker&) {
-    IdentifyContainers typeId{typeGraph, containers};
+  auto fn = [&containers](TypeGraph& typeGraph, NodeTracker& tracker) {
+    IdentifyContainers typeId{tracker, typeGraph, containers};
     for (auto& type : typeGraph.rootTypes()) {
       type = typeId.mutate(type);
     }
@@ -33,9 +33,11 @@ Pass IdentifyContainers::createPass(
 }
 
 IdentifyContainers::IdentifyContainers(
+    NodeTracker& visited,
     TypeGraph& typeGraph,
     const std::vector<std::unique_ptr<ContainerInfo>>& containers)
-    : tracker_(typeGraph.size()),
+    : visited_(visited),
+      tracker_(typeGraph.size()),
       typeGraph_(typeGraph),
       containers_(containers) {
 }
@@ -43,18 +45,31 @@ IdentifyContainers::IdentifyContainers(
 Type& IdentifyContainers::mutate(Type& type) {
   if (Type* mutated = tracker_.get(type))
     return *mutated;
+  // Nodes marked as visited without a result are outside of this run's scope.
+  // An earlier run replaced containers' Class nodes wherever they were then
+  // referenced, but nodes added since, e.g. by AddChildren through
+  // DrgnParser's cache, may reference them again, so those are still replaced.
+  if (visited_.visit(type)) {
+    auto* c = dynamic_cast<Class*>(&type);
+    if (c == nullptr || findContainer(*c) == nullptr)
+      return type;
+  }
 
   Type& mutated = type.accept(*this);
   tracker_.set(type, &mutated);
   return mutated;
 }
 
-Type& IdentifyContainers::visit(Class& c) {
+const ContainerInfo* IdentifyContainers::findContainer(const Class& c) const {
   for (const auto& containerInfo : containers_) {
-    if (!containerInfo->matches(c.fqName())) {
-      continue;
-    }
+    if (containerInfo->matches(c.fqName()))
+      return containerInfo.get();
+  }
+  return nullptr;
+}
 
+Type& IdentifyContainers::visit(Class& c) {
+  if (const auto* containerInfo = findContainer(c)) {
     auto& container =
         typeGraph_.makeType<Container>(*containerInfo, c.size(), &c);
     container.templateParams = c.templateParams;
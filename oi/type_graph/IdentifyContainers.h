@@ -41,6 +41,7 @@ class IdentifyContainers : public RecursiveMutator {
       const std::vector<std::unique_ptr<ContainerInfo>>& containers);
 
   IdentifyContainers(
+      NodeTracker& visited,
       TypeGraph& typeGraph,
       const std::vector<std::unique_ptr<ContainerInfo>>& containers);
 
@@ -51,6 +52,9 @@ class IdentifyContainers : public RecursiveMutator {
   Type& visit(Container& c) override;
 
  private:
+  const ContainerInfo* findContainer(const Class& c) const;
+
+  NodeTracker& visited_;
   ResultTracker<Type*> tracker_;
   TypeGraph& typeGraph_;
   const std::vector<std::unique_ptr<ContainerInfo>>& containers_;
@@ -24,7 +24,7 @@ namespace oi::detail::type_graph {
 
 Pass NameGen::createPass() {
   auto fn = [](TypeGraph& typeGraph, NodeTracker&) {
-    NameGen nameGen;
+    NameGen nameGen{typeGraph};
     nameGen.generateNames(typeGraph.rootTypes());
   };
 
@@ -72,22 +72,22 @@ void NameGen::visit(Class& c) {
   removeTemplateParams(name);
   deduplicate(name);
   if (c.name().empty())
-    c.setInputName(name);
+    c.setInputName(typeGraph_.intern(name));
   c.setName(name);
 
   // Deduplicate member names. Duplicates may be present after flattening.
   for (size_t i = 0; i < c.members.size(); i++) {
-    if (c.members[i].name.empty())
-      c.members[i].name = AnonPrefix;
+    auto& member = c.members[i];
+    std::string memberName{member.name.empty() ? AnonPrefix : member.name};
+    memberName += "_" + std::to_string(i);
 
-    c.members[i].name += "_" + std::to_string(i);
-
-    if (c.members[i].inputName.empty())
-      c.members[i].inputName = c.members[i].name;
+    if (member.inputName.empty())
+      member.inputName = typeGraph_.intern(memberName);
 
     // GCC includes dots in vptr member names, e.g. "_vptr.MyClass"
     // These aren't valid in C++, so we must replace them
-    std::replace(c.members[i].name.begin(), c.members[i].name.end(), '.', '$');
+    std::replace(memberName.begin(), memberName.end(), '.', '$');
+    member.name = typeGraph_.intern(memberName);
   }
 
   for (const auto& param : c.templateParams) {
@@ -153,14 +153,14 @@ void NameGen::visit(Container& c) {
   inputName += '>';
 
   c.setName(name);
-  c.setInputName(inputName);
+  c.setInputName(typeGraph_.intern(inputName));
 }
 
 void NameGen::visit(Enum& e) {
   std::string name = e.name();
   deduplicate(name);
   if (e.name().empty())
-    e.setInputName(name);
+    e.setInputName(typeGraph_.intern(name));
   e.setName(name);
 }
 
@@ -170,7 +170,7 @@ void NameGen::visit(Array& a) {
   a.regenerateName();
   std::string name{a.elementType().inputName()};
   name += "[" + std::to_string(a.len()) + "]";
-  a.setInputName(name);
+  a.setInputName(typeGraph_.intern(name));
 }
 
 void NameGen::visit(Typedef& td) {
@@ -197,7 +197,7 @@ void NameGen::visit(Pointer& p) {
   p.regenerateName();
   std::string inputName{p.pointeeType().inputName()};
   inputName += '*';
-  p.setInputName(inputName);
+  p.setInputName(typeGraph_.intern(inputName));
 }
 
 void NameGen::visit(Reference& r) {
@@ -206,7 +206,7 @@ void NameGen::visit(Reference& r) {
   r.regenerateName();
   std::string inputName{r.pointeeType().inputName()};
   inputName += '&';
-  r.setInputName(inputName);
+  r.setInputName(typeGraph_.intern(inputName));
 }
 
 void NameGen::visit(DummyAllocator& d) {
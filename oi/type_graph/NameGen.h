@@ -26,16 +26,22 @@
 
 namespace oi::detail::type_graph {
 
+class TypeGraph;
+
 // TODO make all final
 /*
  * NameGen
  *
- * Generates unique names for all types in a type graph.
+ * Generates unique names for all types in a type graph. The input names it
+ * builds are interned in the graph.
  */
 class NameGen final : public RecursiveVisitor {
  public:
   static Pass createPass();
 
+  explicit NameGen(TypeGraph& typeGraph) : typeGraph_(typeGraph) {
+  }
+
   void generateNames(const std::vector<std::reference_wrapper<Type>>& types);
 
   using RecursiveVisitor::accept;
@@ -57,6 +63,7 @@ class NameGen final : public RecursiveVisitor {
   void accept(Type& type) override;
   void deduplicate(std::string& name);
 
+  TypeGraph& typeGraph_;
   std::unordered_set<Type*> visited_;
   int n = 0;
 };
@@ -50,6 +50,31 @@ class NodeTracker {
     return result;
   }
 
+  /*
+   * visitBefore
+   *
+   * Marks every node with an ID lower than `id` as visited, leaving only the
+   * nodes created since then to be visited.
+   */
+  void visitBefore(NodeId id) {
+    if (id <= 0)
+      return;
+    if (visited_.size() < static_cast<size_t>(id))
+      visited_.resize(id);
+    std::fill(visited_.begin(), visited_.begin() + id, true);
+  }
+
+  /*
+   * unvisit
+   *
+   * Marks a given node as not visited.
+   */
+  void unvisit(const Type& type) {
+    auto id = type.id();
+    if (id >= 0 && static_cast<size_t>(id) < visited_.size())
+      visited_[id] = false;
+  }
+
   /*
    * reset
    *
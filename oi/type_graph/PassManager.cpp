@@ -17,12 +17,17 @@
 
 #include <glog/logging.h>
 
+#include <cassert>
+#include <chrono>
 #include <iostream>
+#include <optional>
 #include <sstream>
+#include <utility>
 
 #include "NodeTracker.h"
 #include "Printer.h"
 #include "TypeGraph.h"
+#include "oi/Metrics.h"
 
 template <typename T>
 using ref = std::reference_wrapper<T>;
@@ -33,10 +38,39 @@ void Pass::run(TypeGraph& typeGraph, NodeTrackerHolder tracker) {
   fn_(typeGraph, tracker.get(typeGraph.size()));
 }
 
+void Pass::run(TypeGraph& typeGraph,
+               NodeTrackerHolder tracker,
+               const Checkpoint& since) {
+  auto& t = tracker.get(typeGraph.size());
+  t.visitBefore(since.nextId);
+
+  const auto& changed = typeGraph.changedTypes();
+  std::vector<ref<Type>> scope(changed.begin() + since.changed, changed.end());
+  for (const auto& type : scope) {
+    t.unvisit(type);
+  }
+  auto created = typeGraph.typesSince(since.size);
+  scope.insert(scope.end(), created.begin(), created.end());
+
+  auto roots = std::exchange(typeGraph.rootTypes(), std::move(scope));
+  fn_(typeGraph, t);
+  typeGraph.rootTypes() = std::move(roots);
+}
+
 void PassManager::addPass(Pass p) {
   passes_.push_back(std::move(p));
 }
 
+void PassManager::addCheckpoint() {
+  checkpoints_.push_back(passes_.size());
+}
+
+void PassManager::addIncrementalPass(Pass p) {
+  assert(!checkpoints_.empty() && "incremental passes need a checkpoint");
+  p.incremental_ = true;
+  passes_.push_back(std::move(p));
+}
+
 namespace {
 void print(const TypeGraph& typeGraph, NodeTrackerHolder tracker) {
   if (!VLOG_IS_ON(1))
@@ -55,6 +89,7 @@ void print(const TypeGraph& typeGraph, NodeTrackerHolder tracker) {
 const std::string separator = "----------------";
 
 void PassManager::run(TypeGraph& typeGraph) {
+  metrics::Tracing _("type_graph_passes");
   NodeTracker tracker;
 
   VLOG(1) << separator;
@@ -63,15 +98,53 @@ void PassManager::run(TypeGraph& typeGraph) {
   print(typeGraph, tracker);
   VLOG(1) << separator;
 
+  std::optional<Checkpoint> checkpoint;
+  auto nextCheckpoint = checkpoints_.begin();
   for (size_t i = 0; i < passes_.size(); i++) {
+    for (; nextCheckpoint != checkpoints_.end() && *nextCheckpoint == i;
+         ++nextCheckpoint) {
+      checkpoint = Checkpoint{
+          typeGraph.size(),
+          typeGraph.nextId(),
+          typeGraph.changedTypes().size(),
+      };
+    }
+
     auto& pass = passes_[i];
+    bool incremental = pass.incremental() && checkpoint.has_value();
+    size_t nodesBefore = typeGraph.size();
+    size_t nodesInScope =
+        incremental ? nodesBefore - checkpoint->size +
+                          typeGraph.changedTypes().size() - checkpoint->changed
+                    : nodesBefore;
     LOG(INFO) << "Running pass (" << i + 1 << "/" << passes_.size()
-              << "): " << pass.name();
-    pass.run(typeGraph, tracker);
+              << "): " << pass.name()
+              << (incremental ? " (incremental)" : "");
+
+    auto start = std::chrono::steady_clock::now();
+    {
+      metrics::Tracing passTracing("pass_" + pass.name());
+      if (incremental)
+        pass.run(typeGraph, tracker, *checkpoint);
+      else
+        pass.run(typeGraph, tracker);
+
+      metrics::Tracing::counter("pass_nodes_in_scope", nodesInScope);
+      metrics::Tracing::counter("pass_nodes_created",
+                                typeGraph.size() - nodesBefore);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    LOG(INFO) << "Finished pass " << pass.name() << " in " << elapsed.count()
+              << "us over " << nodesInScope << " nodes, creating "
+              << typeGraph.size() - nodesBefore;
     VLOG(1) << separator;
     print(typeGraph, tracker);
     VLOG(1) << separator;
   }
+
+  metrics::Tracing::counter("type_graph_nodes", typeGraph.size());
+  metrics::Tracing::counter("final_types", typeGraph.finalTypes.size());
 }
 
 }  // namespace oi::detail::type_graph
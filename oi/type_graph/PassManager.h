@@ -15,7 +15,9 @@
  */
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -26,6 +28,19 @@ class NodeTracker;
 class TypeGraph;
 class Type;
 
+/*
+ * Checkpoint
+ *
+ * Records how far a TypeGraph had grown, so that the nodes created since can
+ * be told apart from the older ones.
+ */
+struct Checkpoint {
+  // TypeGraph::size(), nextId() and changedTypes().size() at the time
+  size_t size;
+  int32_t nextId;
+  size_t changed;
+};
+
 /*
  * Pass
  *
@@ -39,27 +54,54 @@ class Pass {
   Pass(std::string name, PassFn fn) : name_(std::move(name)), fn_(fn) {
   }
   void run(TypeGraph& typeGraph, NodeTrackerHolder tracker);
+  /*
+   * Runs the pass over the nodes created or marked as changed since `since`
+   * only. These stand in for the graph's roots and every other node is marked
+   * as visited, so the pass stops wherever it reaches one.
+   */
+  void run(TypeGraph& typeGraph,
+           NodeTrackerHolder tracker,
+           const Checkpoint& since);
   std::string& name() {
     return name_;
   };
+  bool incremental() const {
+    return incremental_;
+  }
 
  private:
+  friend class PassManager;
+
   std::string name_;
   PassFn fn_;
+  bool incremental_ = false;
 };
 
 /*
  * PassManager
  *
- * TODO
+ * Runs passes over a type graph in the order they were added, timing each
+ * one. A pass added with addIncrementalPass only visits the nodes created, or
+ * marked with TypeGraph::markChanged, since the last checkpoint was reached.
+ * This suits re-running passes over the nodes a later pass has added, e.g.
+ * AddChildren. Passes run this way must leave the nodes they have already
+ * processed unchanged if run over them again, as skipping them must not
+ * change the result.
  */
 class PassManager {
  public:
   void addPass(Pass p);
+  void addCheckpoint();
+  void addIncrementalPass(Pass p);
   void run(TypeGraph& typeGraph);
+  std::span<Pass> passes() {
+    return passes_;
+  }
 
  private:
   std::vector<Pass> passes_;
+  // The index of the pass each checkpoint is reached before
+  std::vector<size_t> checkpoints_;
 };
 
 }  // namespace oi::detail::type_graph
@@ -264,7 +264,7 @@ void Printer::print_type(std::string_view header, const Type& type) {
   depth_--;
 }
 
-void Printer::print_value(const std::string& value) {
+void Printer::print_value(std::string_view value) {
   depth_++;
   prefix();
   out_ << "Value: " << value << std::endl;
@@ -53,7 +53,7 @@ class Printer : public ConstVisitor {
   void print_member(const Member& member);
   void print_function(const Function& function);
   void print_type(std::string_view header, const Type& type);
-  void print_value(const std::string& value);
+  void print_value(std::string_view value);
   void print_qualifiers(const QualifierSet& qualifiers);
   void print_enumerator(int64_t val, const std::string& name);
   static std::string align_str(uint64_t align);
@@ -70,7 +70,7 @@ void RemoveMembers::visit(Class& c) {
 }
 
 bool RemoveMembers::ignoreMember(std::string_view typeName,
-                                 const std::string& memberName) const {
+                                 std::string_view memberName) const {
   for (const auto& [ignoredType, ignoredMember] : membersToIgnore_) {
     if (typeName == ignoredType &&
         (memberName == ignoredMember || ignoredMember == "*")) {
@@ -48,7 +48,7 @@ class RemoveMembers : public RecursiveVisitor {
 
  private:
   bool ignoreMember(std::string_view typeName,
-                    const std::string& memberName) const;
+                    std::string_view memberName) const;
 
   std::unordered_set<Type*> visited_;
   const std::vector<std::pair<std::string, std::string>>& membersToIgnore_;
@@ -15,8 +15,48 @@
  */
 #include "TypeGraph.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace oi::detail::type_graph {
 
+TypeGraph& TypeGraph::operator=(TypeGraph&& other) noexcept {
+  if (this == &other)
+    return *this;
+
+  destroyTypes();
+  finalTypes = std::move(other.finalTypes);
+  arena_ = std::move(other.arena_);
+  strings_ = std::move(other.strings_);
+  rootTypes_ = std::move(other.rootTypes_);
+  types_ = std::move(other.types_);
+  other.types_.clear();
+  changedTypes_ = std::move(other.changedTypes_);
+  next_id_ = other.next_id_;
+  return *this;
+}
+
+TypeGraph::~TypeGraph() {
+  destroyTypes();
+}
+
+void TypeGraph::destroyTypes() noexcept {
+  // The arena only frees memory, the nodes' destructors must be run by hand
+  for (auto it = types_.rbegin(); it != types_.rend(); ++it) {
+    (*it)->~Type();
+  }
+  types_.clear();
+}
+
+std::string_view TypeGraph::intern(std::string_view str) {
+  if (auto it = strings_.find(str); it != strings_.end())
+    return *it;
+
+  auto* data = static_cast<char*>(arena_->allocate(str.size(), alignof(char)));
+  std::memcpy(data, str.data(), str.size());
+  return *strings_.emplace(data, str.size()).first;
+}
+
 template <>
 Primitive& TypeGraph::makeType<Primitive>(Primitive::Kind kind) {
   switch (kind) {
@@ -68,4 +108,14 @@ Primitive& TypeGraph::makeType<Primitive>(Primitive::Kind kind) {
   }
 }
 
+std::vector<std::reference_wrapper<Type>> TypeGraph::typesSince(
+    size_t count) const {
+  std::vector<std::reference_wrapper<Type>> types;
+  types.reserve(types_.size() - std::min(count, types_.size()));
+  for (size_t i = count; i < types_.size(); i++) {
+    types.push_back(*types_[i]);
+  }
+  return types;
+}
+
 }  // namespace oi::detail::type_graph
@@ -17,6 +17,11 @@
 
 #include <functional>
 #include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
 #include <vector>
 
 #include "Types.h"
@@ -27,9 +32,19 @@ namespace oi::detail::type_graph {
  * TypeGraph
  *
  * Holds the nodes and metadata which form a type graph.
+ *
+ * Nodes are bump-allocated from an arena owned by the graph rather than
+ * individually on the heap, so they live exactly as long as the graph does.
  */
 class TypeGraph {
  public:
+  TypeGraph() = default;
+  TypeGraph(const TypeGraph&) = delete;
+  TypeGraph& operator=(const TypeGraph&) = delete;
+  TypeGraph(TypeGraph&&) = default;
+  TypeGraph& operator=(TypeGraph&& other) noexcept;
+  ~TypeGraph();
+
   size_t size() const noexcept {
     return types_.size();
   }
@@ -47,6 +62,40 @@ class TypeGraph {
     rootTypes_.push_back(type);
   }
 
+  /*
+   * The ID the next node will be given. Every node created after this is
+   * called has an ID at least this large.
+   */
+  NodeId nextId() const noexcept {
+    return next_id_;
+  }
+
+  /*
+   * The nodes created since the graph held `count` nodes, in creation order.
+   */
+  std::vector<std::reference_wrapper<Type>> typesSince(size_t count) const;
+
+  /*
+   * Records that an existing node has been changed, e.g. given new children,
+   * so that incremental passes visit it again. See PassManager.
+   */
+  void markChanged(Type& type) {
+    changedTypes_.push_back(type);
+  }
+
+  const std::vector<std::reference_wrapper<Type>>& changedTypes() const {
+    return changedTypes_;
+  }
+
+  /*
+   * Returns a copy of `str` owned by the graph. Equal strings share the same
+   * storage, so names repeated across many nodes are only stored once.
+   *
+   * Nodes don't own their input names, member names or template parameter
+   * values, so anything assigned to them after creation must come from here.
+   */
+  std::string_view intern(std::string_view str);
+
   // Override of the generic makeType function that returns singleton Primitive
   // objects
   template <typename T>
@@ -56,10 +105,7 @@ class TypeGraph {
   T& makeType(NodeId id, Args&&... args) {
     static_assert(T::has_node_id, "Unnecessary node ID provided");
     next_id_ = std::max(next_id_, id + 1);
-    auto type_unique_ptr = std::make_unique<T>(id, std::forward<Args>(args)...);
-    auto type_raw_ptr = type_unique_ptr.get();
-    types_.push_back(std::move(type_unique_ptr));
-    return *type_raw_ptr;
+    return allocate<T>(id, std::forward<Args>(args)...);
   }
 
   template <typename T, typename... Args>
@@ -71,10 +117,7 @@ class TypeGraph {
       return makeType<T>(next_id_++, std::forward<Args>(args)...);
     } else {
       // No Node ID
-      auto type_unique_ptr = std::make_unique<T>(std::forward<Args>(args)...);
-      auto type_raw_ptr = type_unique_ptr.get();
-      types_.push_back(std::move(type_unique_ptr));
-      return *type_raw_ptr;
+      return allocate<T>(std::forward<Args>(args)...);
     }
   }
 
@@ -82,9 +125,40 @@ class TypeGraph {
   std::vector<std::reference_wrapper<Type>> finalTypes;
 
  private:
+  static constexpr size_t kInitialArenaSize = 64 * 1024;
+
+  void destroyTypes() noexcept;
+
+  template <typename T, typename... Args>
+  T& allocate(Args&&... args) {
+    void* mem = arena_->allocate(sizeof(T), alignof(T));
+    auto* type = new (mem) T(internArg(std::forward<Args>(args))...);
+    types_.push_back(type);
+    return *type;
+  }
+
+  // Node constructors take their strings as views, so copy them into the graph
+  template <typename Arg>
+  decltype(auto) internArg(Arg&& arg) {
+    using A = std::decay_t<Arg>;
+    if constexpr (std::is_same_v<A, std::string> ||
+                  std::is_same_v<A, std::string_view> ||
+                  std::is_same_v<A, const char*> || std::is_same_v<A, char*>) {
+      return intern(arg);
+    } else {
+      return std::forward<Arg>(arg);
+    }
+  }
+
+  // Behind a pointer so that the graph stays movable
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_ =
+      std::make_unique<std::pmr::monotonic_buffer_resource>(kInitialArenaSize);
+  std::unordered_set<std::string_view> strings_;
+
   std::vector<std::reference_wrapper<Type>> rootTypes_;
-  // Store all type objects in vectors for ownership. Order is not significant.
-  std::vector<std::unique_ptr<Type>> types_;
+  // Every node in creation order, for destruction. The arena owns the memory.
+  std::vector<Type*> types_;
+  std::vector<std::reference_wrapper<Type>> changedTypes_;
   NodeId next_id_ = 0;
 };
 
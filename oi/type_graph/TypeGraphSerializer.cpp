@@ -0,0 +1,698 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "TypeGraphSerializer.h"
+
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Visitor.h"
+#include "oi/ContainerInfo.h"
+
+/*
+ * Format
+ *
+ *   magic, version, node count
+ *   one record per node: its kind and what's needed to construct it
+ *   one record per node, in the same order: its edges and the rest
+ *   root nodes, final types
+ *
+ * Integers are LEB128 varints (zigzag encoded if signed), strings are length
+ * prefixed and edges are node indices. Splitting each node in two means every
+ * node exists before any edge to it is read, so cycles need no special care.
+ */
+
+namespace oi::detail::type_graph {
+namespace {
+
+constexpr uint32_t kMagic = 0x4754494f;  // "OITG"
+constexpr uint32_t kVersion = 1;
+
+enum class Tag : uint8_t {
+#define X(OI_TYPE_NAME) OI_TYPE_NAME,
+  OI_TYPE_LIST
+#undef X
+};
+
+class Writer {
+ public:
+  void u8(uint8_t value) {
+    buf_.push_back(static_cast<char>(value));
+  }
+
+  void varint(uint64_t value) {
+    while (value >= 0x80) {
+      u8(static_cast<uint8_t>(value) | 0x80);
+      value >>= 7;
+    }
+    u8(static_cast<uint8_t>(value));
+  }
+
+  void svarint(int64_t value) {
+    varint((static_cast<uint64_t>(value) << 1) ^
+           static_cast<uint64_t>(value >> 63));
+  }
+
+  void str(std::string_view value) {
+    varint(value.size());
+    buf_ += value;
+  }
+
+  const std::string& data() const {
+    return buf_;
+  }
+
+ private:
+  std::string buf_;
+};
+
+class Reader {
+ public:
+  explicit Reader(std::string data) : data_(std::move(data)) {
+  }
+
+  uint8_t u8() {
+    if (pos_ == data_.size())
+      throw TypeGraphSerializerError{"Truncated type graph"};
+    return static_cast<uint8_t>(data_[pos_++]);
+  }
+
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte = u8();
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+        return value;
+    }
+    throw TypeGraphSerializerError{"Invalid varint in type graph"};
+  }
+
+  int64_t svarint() {
+    uint64_t value = varint();
+    return static_cast<int64_t>((value >> 1) ^ -(value & 1));
+  }
+
+  std::string str() {
+    uint64_t size = varint();
+    if (size > data_.size() - pos_)
+      throw TypeGraphSerializerError{"Truncated type graph"};
+    std::string value = data_.substr(pos_, size);
+    pos_ += size;
+    return value;
+  }
+
+  bool done() const {
+    return pos_ == data_.size();
+  }
+
+ private:
+  std::string data_;
+  size_t pos_ = 0;
+};
+
+class Serializer : public ConstVisitor {
+ public:
+  void serialize(const TypeGraph& typeGraph, std::ostream& out);
+
+  void visit(const Incomplete& i) override;
+  void visit(const Class& c) override;
+  void visit(const Container& c) override;
+  void visit(const Primitive& p) override;
+  void visit(const Enum& e) override;
+  void visit(const Array& a) override;
+  void visit(const Typedef& td) override;
+  void visit(const Pointer& p) override;
+  void visit(const Reference& r) override;
+  void visit(const Dummy& d) override;
+  void visit(const DummyAllocator& d) override;
+  void visit(const CaptureKeys& c) override;
+
+ private:
+  uint64_t ref(const Type& type);
+  void writeParams(const std::vector<TemplateParam>& params);
+
+  std::unordered_map<const Type*, uint64_t> indices_;
+  std::vector<const Type*> queue_;
+  Writer nodes_;
+  Writer edges_;
+};
+
+void Serializer::serialize(const TypeGraph& typeGraph, std::ostream& out) {
+  Writer graph;
+  graph.varint(typeGraph.rootTypes().size());
+  for (const auto& type : typeGraph.rootTypes())
+    graph.varint(ref(type));
+  graph.varint(typeGraph.finalTypes.size());
+  for (const auto& type : typeGraph.finalTypes)
+    graph.varint(ref(type));
+
+  // Visiting a node queues the nodes it refers to
+  for (size_t i = 0; i < queue_.size(); i++)
+    queue_[i]->accept(*this);
+
+  Writer header;
+  header.varint(kMagic);
+  header.varint(kVersion);
+  header.varint(queue_.size());
+
+  for (const auto* writer : {&header, &nodes_, &edges_, &graph}) {
+    const auto& data = writer->data();
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+  }
+}
+
+uint64_t Serializer::ref(const Type& type) {
+  auto [it, inserted] = indices_.emplace(&type, queue_.size());
+  if (inserted)
+    queue_.push_back(&type);
+  return it->second;
+}
+
+void Serializer::writeParams(const std::vector<TemplateParam>& params) {
+  edges_.varint(params.size());
+  for (const auto& param : params) {
+    edges_.varint(ref(param.type()));
+
+    uint64_t qualifiers = 0;
+    for (size_t i = 0; i < static_cast<size_t>(Qualifier::Max); i++) {
+      if (param.qualifiers[static_cast<Qualifier>(i)])
+        qualifiers |= uint64_t{1} << i;
+    }
+    edges_.varint(qualifiers);
+
+    edges_.u8(param.value.has_value());
+    if (param.value)
+      edges_.str(*param.value);
+  }
+}
+
+void Serializer::visit(const Incomplete& i) {
+  auto underlying = i.underlyingType();
+  nodes_.u8(static_cast<uint8_t>(Tag::Incomplete));
+  nodes_.svarint(i.id());
+  nodes_.str(i.name());
+  nodes_.u8(underlying.has_value());
+  if (underlying)
+    edges_.varint(ref(underlying->get()));
+  else
+    nodes_.str(i.inputName());
+}
+
+void Serializer::visit(const Class& c) {
+  nodes_.u8(static_cast<uint8_t>(Tag::Class));
+  nodes_.svarint(c.id());
+  nodes_.u8(static_cast<uint8_t>(c.kind()));
+  nodes_.str(c.name());
+  nodes_.str(c.inputName());
+  nodes_.varint(c.size());
+  nodes_.svarint(c.virtuality());
+  nodes_.varint(c.align());
+  nodes_.u8(c.packed());
+
+  writeParams(c.templateParams);
+
+  edges_.varint(c.parents.size());
+  for (const auto& parent : c.parents) {
+    edges_.varint(ref(parent.type()));
+    edges_.varint(parent.bitOffset);
+  }
+
+  edges_.varint(c.members.size());
+  for (const auto& member : c.members) {
+    edges_.varint(ref(member.type()));
+    edges_.str(member.name);
+    edges_.str(member.inputName);
+    edges_.varint(member.bitOffset);
+    edges_.varint(member.bitsize);
+    edges_.varint(member.align);
+  }
+
+  edges_.varint(c.functions.size());
+  for (const auto& function : c.functions) {
+    edges_.str(function.name);
+    edges_.svarint(function.virtuality);
+  }
+
+  edges_.varint(c.children.size());
+  for (const auto& child : c.children)
+    edges_.varint(ref(child));
+}
+
+void Serializer::visit(const Container& c) {
+  nodes_.u8(static_cast<uint8_t>(Tag::Container));
+  nodes_.svarint(c.id());
+  nodes_.str(c.containerInfo_.typeName);
+  nodes_.varint(c.size());
+  nodes_.str(c.name());
+  nodes_.str(c.inputName());
+  nodes_.varint(c.align());
+
+  // 0 for no underlying type, otherwise its index plus one
+  edges_.varint(c.underlying() ? ref(*c.underlying()) + 1 : 0);
+  writeParams(c.templateParams);
+}
+
+void Serializer::visit(const Primitive& p) {
+  nodes_.u8(static_cast<uint8_t>(Tag::Primitive));
+  nodes_.u8(static_cast<uint8_t>(p.kind()));
+}
+
+void Serializer::visit(const Enum& e) {
+  nodes_.u8(static_cast<uint8_t>(Tag::Enum));
+  nodes_.str(e.name());
+  nodes_.str(e.inputName());
+  nodes_.varint(e.size());
+
+  auto enumerators = e.enumerators();
+  nodes_.varint(enumerators.size());
+  for (const auto& [value, name] : enumerators) {
+    nodes_.svarint(value);
+    nodes_.str(name);
+  }
+}
+
+void Serializer::visit(const Array& a) {
+  nodes_.u8(static_cast<uint8_t>(Tag::Array));
+  nodes_.svarint(a.id());
+  nodes_.varint(a.len());
+  nodes_.str(a.inputName());
+  edges_.varint(ref(a.elementType()));
+}
+
+void Serializer::visit(const Typedef& td) {
+  nodes_.u8(static_cast<uint8_t>(Tag::Typedef));
+  nodes_.svarint(td.id());
+  nodes_.str(td.name());
+  nodes_.str(td.inputName());
+  edges_.varint(ref(td.underlyingType()));
+}
+
+void Serializer::visit(const Pointer& p) {
+  nodes_.u8(static_cast<uint8_t>(Tag::Pointer));
+  nodes_.svarint(p.id());
+  nodes_.str(p.inputName());
+  edges_.varint(ref(p.pointeeType()));
+}
+
+void Serializer::visit(const Reference& r) {
+  nodes_.u8(static_cast<uint8_t>(Tag::Reference));
+  nodes_.svarint(r.id());
+  nodes_.str(r.inputName());
+  edges_.varint(ref(r.pointeeType()));
+}
+
+void Serializer::visit(const Dummy& d) {
+  nodes_.u8(static_cast<uint8_t>(Tag::Dummy));
+  nodes_.svarint(d.id());
+  nodes_.varint(d.size());
+  nodes_.varint(d.align());
+  nodes_.str(d.inputName());
+}
+
+void Serializer::visit(const DummyAllocator& d) {
+  nodes_.u8(static_cast<uint8_t>(Tag::DummyAllocator));
+  nodes_.svarint(d.id());
+  nodes_.varint(d.size());
+  nodes_.varint(d.align());
+  nodes_.str(d.inputName());
+  edges_.varint(ref(d.allocType()));
+}
+
+void Serializer::visit(const CaptureKeys& c) {
+  nodes_.u8(static_cast<uint8_t>(Tag::CaptureKeys));
+  nodes_.str(c.containerInfo().typeName);
+  edges_.varint(ref(c.underlyingType()));
+}
+
+/*
+ * Regenerates the names which are derived from other nodes' names, after
+ * the nodes they depend on.
+ */
+class NameRegenerator : public LazyVisitor {
+ public:
+  void accept(Type& type) {
+    if (visited_.insert(&type).second)
+      type.accept(*this);
+  }
+
+  void visit(Array& a) override {
+    accept(a.elementType());
+    a.regenerateName();
+  }
+
+  void visit(Pointer& p) override {
+    accept(p.pointeeType());
+    p.regenerateName();
+  }
+
+  void visit(Reference& r) override {
+    accept(r.pointeeType());
+    r.regenerateName();
+  }
+
+  void visit(DummyAllocator& d) override {
+    accept(d.allocType());
+    d.regenerateName();
+  }
+
+  void visit(CaptureKeys& c) override {
+    accept(c.underlyingType());
+    c.regenerateName();
+  }
+
+ private:
+  std::unordered_set<Type*> visited_;
+};
+
+class Deserializer {
+ public:
+  Deserializer(std::istream& in,
+               TypeGraph& typeGraph,
+               const ContainerInfoLookup& containers)
+      : in_(std::string{std::istreambuf_iterator<char>{in}, {}}),
+        typeGraph_(typeGraph),
+        containers_(containers),
+        placeholder_(typeGraph.makeType<Primitive>(Primitive::Kind::Void)) {
+  }
+
+  void deserialize();
+
+ private:
+  void readNode();
+  void readEdges(Type& type, Tag tag);
+  std::vector<TemplateParam> readParams();
+  Type& ref();
+  const ContainerInfo& containerInfo(bool captureKeys);
+
+  Reader in_;
+  TypeGraph& typeGraph_;
+  const ContainerInfoLookup& containers_;
+  // Stands in for edges until they are read
+  Type& placeholder_;
+  std::vector<Type*> nodes_;
+  std::vector<Tag> tags_;
+};
+
+void Deserializer::deserialize() {
+  if (in_.varint() != kMagic)
+    throw TypeGraphSerializerError{"Not a serialized type graph"};
+  if (auto version = in_.varint(); version != kVersion) {
+    throw TypeGraphSerializerError{"Unsupported type graph version " +
+                                   std::to_string(version)};
+  }
+
+  uint64_t count = in_.varint();
+  for (uint64_t i = 0; i < count; i++)
+    readNode();
+  for (size_t i = 0; i < nodes_.size(); i++)
+    readEdges(*nodes_[i], tags_[i]);
+
+  NameRegenerator names;
+  for (auto* type : nodes_)
+    names.accept(*type);
+
+  uint64_t numRoots = in_.varint();
+  for (uint64_t i = 0; i < numRoots; i++)
+    typeGraph_.addRoot(ref());
+  uint64_t numFinal = in_.varint();
+  for (uint64_t i = 0; i < numFinal; i++)
+    typeGraph_.finalTypes.push_back(ref());
+
+  if (!in_.done())
+    throw TypeGraphSerializerError{"Trailing data after type graph"};
+}
+
+void Deserializer::readNode() {
+  auto tag = static_cast<Tag>(in_.u8());
+  Type* type = nullptr;
+  switch (tag) {
+    case Tag::Incomplete: {
+      auto id = static_cast<NodeId>(in_.svarint());
+      auto name = in_.str();
+      bool hasUnderlying = in_.u8();
+      auto& i = hasUnderlying
+                    ? typeGraph_.makeType<Incomplete>(id, placeholder_)
+                    : typeGraph_.makeType<Incomplete>(id, in_.str());
+      i.setName(std::move(name));
+      type = &i;
+      break;
+    }
+    case Tag::Class: {
+      auto id = static_cast<NodeId>(in_.svarint());
+      auto kind = static_cast<Class::Kind>(in_.u8());
+      auto name = in_.str();
+      auto inputName = in_.str();
+      auto size = in_.varint();
+      auto virtuality = static_cast<int>(in_.svarint());
+      auto& c = typeGraph_.makeType<Class>(
+          id, kind, std::move(name), std::move(inputName), size, virtuality);
+      c.setAlign(in_.varint());
+      if (in_.u8())
+        c.setPacked();
+      type = &c;
+      break;
+    }
+    case Tag::Container: {
+      auto id = static_cast<NodeId>(in_.svarint());
+      const auto& info = containerInfo(false);
+      auto size = in_.varint();
+      auto& c = typeGraph_.makeType<Container>(id, info, size, nullptr);
+      c.setName(in_.str());
+      c.setInputName(typeGraph_.intern(in_.str()));
+      c.setAlign(in_.varint());
+      type = &c;
+      break;
+    }
+    case Tag::Primitive: {
+      auto kind = static_cast<Primitive::Kind>(in_.u8());
+      if (kind > Primitive::Kind::Void)
+        throw TypeGraphSerializerError{"Invalid primitive in type graph"};
+      type = &typeGraph_.makeType<Primitive>(kind);
+      break;
+    }
+    case Tag::Enum: {
+      auto name = in_.str();
+      auto inputName = in_.str();
+      auto size = in_.varint();
+      std::map<int64_t, std::string> enumerators;
+      uint64_t numEnumerators = in_.varint();
+      for (uint64_t i = 0; i < numEnumerators; i++) {
+        auto value = in_.svarint();
+        enumerators.emplace(value, in_.str());
+      }
+      type = &typeGraph_.makeType<Enum>(std::move(name),
+                                        std::move(inputName),
+                                        size,
+                                        std::move(enumerators));
+      break;
+    }
+    case Tag::Array: {
+      auto id = static_cast<NodeId>(in_.svarint());
+      auto len = in_.varint();
+      auto& a = typeGraph_.makeType<Array>(id, placeholder_, len);
+      a.setInputName(typeGraph_.intern(in_.str()));
+      type = &a;
+      break;
+    }
+    case Tag::Typedef: {
+      auto id = static_cast<NodeId>(in_.svarint());
+      auto name = in_.str();
+      auto& td = typeGraph_.makeType<Typedef>(id, in_.str(), placeholder_);
+      td.setName(std::move(name));
+      type = &td;
+      break;
+    }
+    case Tag::Pointer: {
+      auto id = static_cast<NodeId>(in_.svarint());
+      auto& p = typeGraph_.makeType<Pointer>(id, placeholder_);
+      p.setInputName(typeGraph_.intern(in_.str()));
+      type = &p;
+      break;
+    }
+    case Tag::Reference: {
+      auto id = static_cast<NodeId>(in_.svarint());
+      auto& r = typeGraph_.makeType<Reference>(id, placeholder_);
+      r.setInputName(typeGraph_.intern(in_.str()));
+      type = &r;
+      break;
+    }
+    case Tag::Dummy: {
+      auto id = static_cast<NodeId>(in_.svarint());
+      auto size = in_.varint();
+      auto align = in_.varint();
+      type = &typeGraph_.makeType<Dummy>(id, size, align, in_.str());
+      break;
+    }
+    case Tag::DummyAllocator: {
+      auto id = static_cast<NodeId>(in_.svarint());
+      auto size = in_.varint();
+      auto align = in_.varint();
+      type = &typeGraph_.makeType<DummyAllocator>(
+          id, placeholder_, size, align, in_.str());
+      break;
+    }
+    case Tag::CaptureKeys: {
+      const auto& info = containerInfo(true);
+      type = &typeGraph_.makeType<CaptureKeys>(placeholder_, info);
+      break;
+    }
+    default:
+      throw TypeGraphSerializerError{"Invalid node kind in type graph"};
+  }
+
+  nodes_.push_back(type);
+  tags_.push_back(tag);
+}
+
+void Deserializer::readEdges(Type& type, Tag tag) {
+  // Every node was created by readNode() as the type its tag names
+  switch (tag) {
+    case Tag::Incomplete: {
+      auto& i = static_cast<Incomplete&>(type);
+      if (i.underlyingType())
+        i.setUnderlyingType(ref());
+      break;
+    }
+    case Tag::Class: {
+      auto& c = static_cast<Class&>(type);
+      c.templateParams = readParams();
+
+      uint64_t numParents = in_.varint();
+      c.parents.reserve(numParents);
+      for (uint64_t i = 0; i < numParents; i++) {
+        auto& parentType = ref();
+        c.parents.emplace_back(parentType, in_.varint());
+      }
+
+      uint64_t numMembers = in_.varint();
+      c.members.reserve(numMembers);
+      for (uint64_t i = 0; i < numMembers; i++) {
+        auto& memberType = ref();
+        auto name = typeGraph_.intern(in_.str());
+        auto& member = c.members.emplace_back(memberType, name, 0);
+        member.inputName = typeGraph_.intern(in_.str());
+        member.bitOffset = in_.varint();
+        member.bitsize = in_.varint();
+        member.align = in_.varint();
+      }
+
+      uint64_t numFunctions = in_.varint();
+      c.functions.reserve(numFunctions);
+      for (uint64_t i = 0; i < numFunctions; i++) {
+        auto name = typeGraph_.intern(in_.str());
+        c.functions.emplace_back(name, static_cast<int>(in_.svarint()));
+      }
+
+      uint64_t numChildren = in_.varint();
+      c.children.reserve(numChildren);
+      for (uint64_t i = 0; i < numChildren; i++) {
+        auto* child = dynamic_cast<Class*>(&ref());
+        if (!child)
+          throw TypeGraphSerializerError{"Child of a class is not a class"};
+        c.children.push_back(*child);
+      }
+      break;
+    }
+    case Tag::Container: {
+      auto& c = static_cast<Container&>(type);
+      if (uint64_t underlying = in_.varint(); underlying != 0) {
+        if (underlying > nodes_.size())
+          throw TypeGraphSerializerError{"Invalid edge in type graph"};
+        c.setUnderlying(nodes_[underlying - 1]);
+      }
+      c.templateParams = readParams();
+      break;
+    }
+    case Tag::Array:
+      static_cast<Array&>(type).setElementType(ref());
+      break;
+    case Tag::Typedef:
+      static_cast<Typedef&>(type).setUnderlyingType(ref());
+      break;
+    case Tag::Pointer:
+      static_cast<Pointer&>(type).setPointeeType(ref());
+      break;
+    case Tag::Reference:
+      static_cast<Reference&>(type).setPointeeType(ref());
+      break;
+    case Tag::DummyAllocator:
+      static_cast<DummyAllocator&>(type).setAllocType(ref());
+      break;
+    case Tag::CaptureKeys:
+      static_cast<CaptureKeys&>(type).setUnderlyingType(ref());
+      break;
+    case Tag::Primitive:
+    case Tag::Enum:
+    case Tag::Dummy:
+      break;
+  }
+}
+
+std::vector<TemplateParam> Deserializer::readParams() {
+  std::vector<TemplateParam> params;
+  uint64_t numParams = in_.varint();
+  params.reserve(numParams);
+  for (uint64_t i = 0; i < numParams; i++) {
+    auto& param = params.emplace_back(ref());
+
+    uint64_t qualifiers = in_.varint();
+    for (size_t q = 0; q < static_cast<size_t>(Qualifier::Max); q++) {
+      if (qualifiers & (uint64_t{1} << q))
+        param.qualifiers[static_cast<Qualifier>(q)] = true;
+    }
+
+    if (in_.u8())
+      param.value = typeGraph_.intern(in_.str());
+  }
+  return params;
+}
+
+Type& Deserializer::ref() {
+  uint64_t index = in_.varint();
+  if (index >= nodes_.size())
+    throw TypeGraphSerializerError{"Invalid edge in type graph"};
+  return *nodes_[index];
+}
+
+const ContainerInfo& Deserializer::containerInfo(bool captureKeys) {
+  auto typeName = in_.str();
+  const auto* info = containers_(typeName, captureKeys);
+  if (!info) {
+    throw TypeGraphSerializerError{"Unknown container in type graph: " +
+                                   typeName};
+  }
+  return *info;
+}
+
+}  // namespace
+
+void serialize(const TypeGraph& typeGraph, std::ostream& out) {
+  Serializer serializer;
+  serializer.serialize(typeGraph, out);
+}
+
+void deserialize(std::istream& in,
+                 TypeGraph& typeGraph,
+                 const ContainerInfoLookup& containers) {
+  Deserializer deserializer{in, typeGraph, containers};
+  deserializer.deserialize();
+}
+
+}  // namespace oi::detail::type_graph
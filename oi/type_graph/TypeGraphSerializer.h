@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include "TypeGraph.h"
+
+struct ContainerInfo;
+
+namespace oi::detail::type_graph {
+
+/*
+ * Finds the ContainerInfo a serialized container was identified with, by its
+ * type name. `captureKeys` is set for the copies made by KeyCapture. Returns
+ * nullptr if there is no such container.
+ */
+using ContainerInfoLookup = std::function<const ContainerInfo*(
+    const std::string& typeName, bool captureKeys)>;
+
+/*
+ * Writes the types reachable from a transformed type graph's roots and final
+ * types in a compact binary form. Only the state the passes leave behind for
+ * CodeGen::generate() is kept, not anything needed to run more passes.
+ */
+void serialize(const TypeGraph& typeGraph, std::ostream& out);
+
+/*
+ * Rebuilds a graph written by serialize() into an empty `typeGraph`. Throws
+ * TypeGraphSerializerError if the input is truncated, was written by another
+ * version or refers to an unknown container.
+ */
+void deserialize(std::istream& in,
+                 TypeGraph& typeGraph,
+                 const ContainerInfoLookup& containers);
+
+class TypeGraphSerializerError : public std::runtime_error {
+ public:
+  TypeGraphSerializerError(const std::string& msg) : std::runtime_error{msg} {
+  }
+};
+
+}  // namespace oi::detail::type_graph
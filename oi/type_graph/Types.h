@@ -27,6 +27,11 @@
  *
  * All non-leaf nodes have IDs for efficient cycle detection and to assist
  * debugging.
+ *
+ * Input names, member names and template parameter values are not owned by the
+ * nodes: they must outlive the graph, e.g. by being interned with
+ * TypeGraph::intern(). TypeGraph::makeType() interns the strings it is given.
+ * Generated names (name()) are owned, as every node's is unique.
  */
 
 #include <algorithm>
@@ -113,7 +118,7 @@ class Type {
 class Member {
  public:
   Member(Type& type,
-         const std::string& name_,
+         std::string_view name_,
          uint64_t bitOffset,
          uint64_t bitsize = 0)
       : type_(type),
@@ -143,19 +148,26 @@ class Member {
   std::reference_wrapper<Type> type_;
 
  public:
-  std::string name;
-  std::string inputName;
+  std::string_view name;
+  std::string_view inputName;
   uint64_t bitOffset;
   uint64_t bitsize;
   uint64_t align = 0;
 };
 
+/*
+ * Function
+ *
+ * A class' member function. Flattening copies these into every subclass, so
+ * the name is not owned: it must outlive the graph, e.g. by being interned
+ * with TypeGraph::intern().
+ */
 struct Function {
-  Function(const std::string& name, int virtuality = 0)
+  Function(std::string_view name, int virtuality = 0)
       : name(name), virtuality(virtuality) {
   }
 
-  std::string name;
+  std::string_view name;
   int virtuality;
 };
 
@@ -189,8 +201,8 @@ struct TemplateParam {
   TemplateParam(Type& type, QualifierSet qualifiers)
       : type_(type), qualifiers(qualifiers) {
   }
-  TemplateParam(Type& type, std::string value)
-      : type_(type), value(std::move(value)) {
+  TemplateParam(Type& type, std::string_view value)
+      : type_(type), value(value) {
   }
 
   Type& type() const {
@@ -206,7 +218,7 @@ struct TemplateParam {
 
  public:
   QualifierSet qualifiers;
-  std::optional<std::string> value;
+  std::optional<std::string_view> value;
 };
 
 /*
@@ -220,8 +232,8 @@ class Incomplete : public Type {
       : id_(id), underlyingType_(underlyingType) {
   }
 
-  Incomplete(NodeId id, std::string underlyingTypeName)
-      : id_(id), underlyingType_(std::move(underlyingTypeName)) {
+  Incomplete(NodeId id, std::string_view underlyingTypeName)
+      : id_(id), underlyingType_(underlyingTypeName) {
   }
 
   static inline constexpr bool has_node_id = true;
@@ -236,7 +248,7 @@ class Incomplete : public Type {
     return std::visit(
         [](const auto& el) -> std::string_view {
           using T = std::decay_t<decltype(el)>;
-          if constexpr (std::is_same_v<T, std::string>) {
+          if constexpr (std::is_same_v<T, std::string_view>) {
             return el;
           } else {
             return el.get().inputName();
@@ -262,16 +274,20 @@ class Incomplete : public Type {
   }
 
   std::optional<std::reference_wrapper<Type>> underlyingType() const {
-    if (std::holds_alternative<std::string>(underlyingType_)) {
+    if (std::holds_alternative<std::string_view>(underlyingType_)) {
       return std::nullopt;
     }
 
     return std::get<std::reference_wrapper<Type>>(underlyingType_);
   }
 
+  void setUnderlyingType(Type& type) {
+    underlyingType_ = type;
+  }
+
  private:
   NodeId id_ = -1;
-  std::variant<std::string, std::reference_wrapper<Type>> underlyingType_;
+  std::variant<std::string_view, std::reference_wrapper<Type>> underlyingType_;
   std::string name_ = "void";
 };
 
@@ -290,12 +306,12 @@ class Class : public Type {
 
   Class(NodeId id,
         Kind kind,
-        std::string name,
-        std::string inputName,
+        std::string_view name,
+        std::string_view inputName,
         size_t size,
         int virtuality = 0)
       : name_(name),
-        inputName_(std::move(inputName)),
+        inputName_(inputName),
         size_(size),
         kind_(kind),
         virtuality_(virtuality),
@@ -304,7 +320,7 @@ class Class : public Type {
 
   Class(NodeId id,
         Kind kind,
-        const std::string& name,
+        std::string_view name,
         size_t size,
         int virtuality = 0)
       : Class(id, kind, name, name, size, virtuality) {
@@ -326,8 +342,8 @@ class Class : public Type {
     name_ = std::move(name);
   }
 
-  void setInputName(std::string name) {
-    inputName_ = std::move(name);
+  void setInputName(std::string_view name) {
+    inputName_ = name;
   }
 
   virtual size_t size() const override {
@@ -362,7 +378,7 @@ class Class : public Type {
     packed_ = true;
   }
 
-  const std::string& fqName() const {
+  std::string_view fqName() const {
     return inputName_;
   }
 
@@ -377,7 +393,7 @@ class Class : public Type {
 
  private:
   std::string name_;
-  std::string inputName_;
+  std::string_view inputName_;
   size_t size_;
   uint64_t align_ = 0;
   Kind kind_;
@@ -433,8 +449,8 @@ class Container : public Type {
     name_ = std::move(name);
   }
 
-  void setInputName(std::string name) {
-    inputName_ = std::move(name);
+  void setInputName(std::string_view name) {
+    inputName_ = name;
   }
 
   virtual size_t size() const override {
@@ -471,7 +487,7 @@ class Container : public Type {
  private:
   Type* underlying_;
   std::string name_;
-  std::string inputName_;
+  std::string_view inputName_;
   size_t size_;
   uint64_t align_ = 0;
   NodeId id_ = -1;
@@ -479,20 +495,20 @@ class Container : public Type {
 
 class Enum : public Type {
  public:
-  explicit Enum(std::string name,
-                std::string inputName,
+  explicit Enum(std::string_view name,
+                std::string_view inputName,
                 size_t size,
                 std::map<int64_t, std::string> enumerators = {})
-      : name_(std::move(name)),
-        inputName_(std::move(inputName)),
+      : name_(name),
+        inputName_(inputName),
         size_(size),
         enumerators_(std::move(enumerators)) {
   }
 
-  explicit Enum(std::string name,
+  explicit Enum(std::string_view name,
                 size_t size,
                 std::map<int64_t, std::string> enumerators = {})
-      : Enum{name, std::move(name), size, std::move(enumerators)} {};
+      : Enum{name, name, size, std::move(enumerators)} {};
 
   static inline constexpr bool has_node_id = false;
 
@@ -506,8 +522,8 @@ class Enum : public Type {
     return inputName_;
   }
 
-  void setInputName(std::string name) {
-    inputName_ = std::move(name);
+  void setInputName(std::string_view name) {
+    inputName_ = name;
   }
 
   void setName(std::string name) {
@@ -532,7 +548,7 @@ class Enum : public Type {
 
  private:
   std::string name_;
-  std::string inputName_;
+  std::string_view inputName_;
   size_t size_;
   std::map<int64_t, std::string> enumerators_;
 };
@@ -561,8 +577,8 @@ class Array : public Type {
     return inputName_;
   }
 
-  void setInputName(std::string name) {
-    inputName_ = std::move(name);
+  void setInputName(std::string_view name) {
+    inputName_ = name;
   }
 
   virtual size_t size() const override {
@@ -591,7 +607,7 @@ class Array : public Type {
 
  private:
   std::reference_wrapper<Type> elementType_;
-  std::string inputName_;
+  std::string_view inputName_;
   size_t len_;
   NodeId id_ = -1;
 
@@ -650,9 +666,9 @@ class Primitive : public Type {
 
 class Typedef : public Type {
  public:
-  explicit Typedef(NodeId id, std::string name, Type& underlyingType)
+  explicit Typedef(NodeId id, std::string_view name, Type& underlyingType)
       : name_(name),
-        inputName_(std::move(name)),
+        inputName_(name),
         underlyingType_(underlyingType),
         id_(id) {
   }
@@ -695,7 +711,7 @@ class Typedef : public Type {
 
  private:
   std::string name_;
-  std::string inputName_;
+  std::string_view inputName_;
   std::reference_wrapper<Type> underlyingType_;
   NodeId id_ = -1;
 };
@@ -723,8 +739,8 @@ class Pointer : public Type {
     return inputName_;
   }
 
-  void setInputName(std::string name) {
-    inputName_ = std::move(name);
+  void setInputName(std::string_view name) {
+    inputName_ = name;
   }
 
   virtual size_t size() const override {
@@ -749,7 +765,7 @@ class Pointer : public Type {
 
  private:
   std::reference_wrapper<Type> pointeeType_;
-  std::string inputName_;
+  std::string_view inputName_;
   NodeId id_ = -1;
 
   std::string name_;
@@ -783,8 +799,8 @@ class Reference : public Type {
     return inputName_;
   }
 
-  void setInputName(std::string name) {
-    inputName_ = std::move(name);
+  void setInputName(std::string_view name) {
+    inputName_ = name;
   }
 
   virtual size_t size() const override {
@@ -809,7 +825,7 @@ class Reference : public Type {
 
  private:
   std::reference_wrapper<Type> pointeeType_;
-  std::string inputName_;
+  std::string_view inputName_;
   NodeId id_ = -1;
 
   std::string name_;
@@ -822,13 +838,16 @@ class Reference : public Type {
  */
 class Dummy : public Type {
  public:
-  explicit Dummy(NodeId id, size_t size, uint64_t align, std::string inputName)
+  explicit Dummy(NodeId id,
+                 size_t size,
+                 uint64_t align,
+                 std::string_view inputName)
       : size_(size),
         align_(align),
         id_(id),
         name_(std::string{"DummySizedOperator<"} + std::to_string(size) + ", " +
               std::to_string(align) + ", " + std::to_string(id_) + ">"),
-        inputName_(std::move(inputName)) {
+        inputName_(inputName) {
   }
 
   static inline constexpr bool has_node_id = true;
@@ -861,7 +880,7 @@ class Dummy : public Type {
   NodeId id_ = -1;
 
   std::string name_;
-  std::string inputName_;
+  std::string_view inputName_;
 };
 
 /*
@@ -873,12 +892,16 @@ class Dummy : public Type {
 class DummyAllocator : public Type {
  public:
   explicit DummyAllocator(
-      NodeId id, Type& type, size_t size, uint64_t align, std::string inputName)
+      NodeId id,
+      Type& type,
+      size_t size,
+      uint64_t align,
+      std::string_view inputName)
       : type_(type),
         size_(size),
         align_(align),
         id_(id),
-        inputName_(std::move(inputName)) {
+        inputName_(inputName) {
     regenerateName();
   }
 
@@ -927,7 +950,7 @@ class DummyAllocator : public Type {
   NodeId id_ = -1;
 
   std::string name_;
-  std::string inputName_;
+  std::string_view inputName_;
 };
 
 /*
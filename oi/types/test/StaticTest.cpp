@@ -102,3 +102,56 @@ TEST(StaticTypes, TestListToDynamic) {
       std::holds_alternative<std::reference_wrapper<const types::dy::VarInt>>(
           listType.element));
 }
+
+namespace {
+class DeltaDataBuffer {
+ public:
+  struct State {
+    std::vector<uint8_t> bytes;
+    uintptr_t lastPointer = 0;
+  };
+
+  DeltaDataBuffer(State& state) : state(&state) {
+  }
+
+  void write_byte(uint8_t byte) {
+    state->bytes.push_back(byte);
+  }
+  uintptr_t& last_pointer() {
+    return state->lastPointer;
+  }
+
+ private:
+  State* state;
+};
+}  // namespace
+
+TEST(StaticTypes, TestPointerToDynamic) {
+  // A Pointer is only delta encoded if the DataBuffer can track it
+  types::dy::Dynamic plain = types::st::Pointer<DummyDataBuffer>::describe;
+  types::dy::Dynamic delta = types::st::Pointer<DeltaDataBuffer>::describe;
+
+  EXPECT_TRUE(
+      std::holds_alternative<std::reference_wrapper<const types::dy::VarInt>>(
+          plain));
+  EXPECT_TRUE(
+      std::holds_alternative<std::reference_wrapper<const types::dy::Pointer>>(
+          delta));
+}
+
+TEST(StaticTypes, TestPointerWritesZigzagDeltas) {
+  // ASSIGN
+  DeltaDataBuffer::State state;
+  using ty = types::st::Pair<DeltaDataBuffer,
+                             types::st::Pointer<DeltaDataBuffer>,
+                             types::st::Pointer<DeltaDataBuffer>>;
+
+  // ACT
+  ty{DeltaDataBuffer{state}}.write(0x40).write(0x38);
+  types::st::Pointer<DeltaDataBuffer>{DeltaDataBuffer{state}}.write(0x38);
+
+  // ASSERT
+  // +0x40, -0x8 and +0
+  EXPECT_EQ(state.bytes, (std::vector<uint8_t>{0x80, 0x01, 0x0f, 0x00}));
+  EXPECT_EQ(state.lastPointer, 0x38);
+}
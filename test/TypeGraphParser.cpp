@@ -340,7 +340,7 @@ void TypeGraphParser::parseParams(T& c,
     Type& type = parseType(input, rootIndent + 2);
     TemplateParam param{type};
     if (value)
-      param.value = value;
+      param.value = typeGraph_.intern(*value);
     if (auto qualStr =
             tryParseStringValue(input, "Qualifiers: ", rootIndent + 2);
         qualStr) {
@@ -396,7 +396,8 @@ void TypeGraphParser::parseMembers(Class& c,
     auto bitsize = tryParseNumericAttribute(line, "bitsize: ");
     Type& type = parseType(input, rootIndent + 2);
 
-    Member member{type, std::string{name}, static_cast<uint64_t>(offset * 8)};
+    Member member{
+        type, typeGraph_.intern(name), static_cast<uint64_t>(offset * 8)};
     if (align)
       member.align = static_cast<uint64_t>(*align);
     if (bitsize)
@@ -423,7 +424,7 @@ void TypeGraphParser::parseFunctions(Class& c,
 
     auto name = line;
 
-    Function func{std::string{name}};
+    Function func{typeGraph_.intern(name)};
 
     c.functions.push_back(func);
   }
@@ -146,6 +146,72 @@ class OIDebuggerTestCase(unittest.TestCase):
             self.assertEqual(output[0]["dynamicSize"], 76)
             self.assertEqual(len(output[0]["members"]), 24)
 
+    def test_samples_are_all_read(self):
+        samples = 3
+        with self.spawn_oid(
+            self.script(), oid_opt=f"--samples {samples} --interval 1"
+        ) as proc:
+            self.expectReturncode(proc, ExitStatus.SUCCESS)
+
+        stdout = proc.stdout.decode("utf-8")
+        for sample in range(1, samples + 1):
+            self.assertIn(f"SAMPLE {sample} time_ms ", stdout)
+
+            # Every sample is read from the start of the data segment
+            with open(f"oid_out.{sample}.json", "r") as f:
+                output = json.loads(f.read())
+                self.assertEqual(output[0]["typeName"], "Foo")
+                self.assertEqual(output[0]["staticSize"], 2192)
+                self.assertEqual(output[0]["dynamicSize"], 76)
+                self.assertEqual(len(output[0]["members"]), 24)
+
+    def test_invalid_samples_and_interval_fail(self):
+        for oid_opt in ("--samples 2x", "--samples -1", "--interval 0", "-I 1s"):
+            proc = subprocess.run(
+                f"{self.oid} --script {self.script()} --pid 1 {oid_opt}",
+                shell=True,
+                stdout=subprocess.PIPE,
+                stderr=subprocess.PIPE,
+            )
+            self.expectReturncode(proc, ExitStatus.USAGE_ERROR)
+
+    @unittest.skipUnless(shutil.which("gcore"), "needs gcore to dump a core")
+    def test_core_global_probe(self):
+        with subprocess.Popen(
+            f"{self.binary_path} 100",
+            shell=True,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+        ) as debuggee_proc:
+            # The first line is printed from main(), after the globals are built
+            debuggee_proc.stdout.readline()
+            subprocess.run(
+                f"gcore -o core {debuggee_proc.pid}",
+                shell=True,
+                stdout=subprocess.DEVNULL,
+                stderr=subprocess.DEVNULL,
+                check=True,
+            )
+            debuggee_proc.terminate()
+            debuggee_proc.communicate()
+
+        core_path = f"core.{debuggee_proc.pid}"
+        self.assertTrue(os.path.exists(core_path))
+
+        proc = subprocess.run(
+            f"{self.oid} --dump-json --config-file {self.oid_conf} -S global:myGlobalFoo -i {self.binary_path} --core {core_path}",
+            shell=True,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE,
+        )
+        self.expectReturncode(proc, ExitStatus.SUCCESS)
+
+        with open(OUTPUT_PATH, "r") as f:
+            output = json.loads(f.read())
+            self.assertEqual(output[0]["typeName"], "Foo")
+            self.assertEqual(output[0]["staticSize"], 2192)
+            self.assertEqual(len(output[0]["members"]), 24)
+
     @unittest.skip(
         "https://github.com/facebookexperimental/object-introspection/issues/53"
     )
@@ -351,6 +417,61 @@ class OIDebuggerTestCase(unittest.TestCase):
             self.assertIn(b"processTrap: Error in waitpid", proc.stderr)
             self.assertIn(b"Interrupted system call", proc.stderr)
 
+    def test_server_serves_request(self):
+        socket_path = os.path.join(self.temp.name, "oid.sock")
+        with subprocess.Popen(
+            f"{self.binary_path} 100",
+            shell=True,
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        ) as debuggee_proc, subprocess.Popen(
+            [self.oid, "--server", socket_path],
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        ) as server_proc:
+            try:
+                for _ in range(100):
+                    if os.path.exists(socket_path):
+                        break
+                    time.sleep(0.1)
+
+                # Only the server's user may connect
+                self.assertEqual(os.stat(socket_path).st_mode & 0o777, 0o600)
+
+                # The second request reuses the session of the first
+                for i in range(2):
+                    if os.path.exists(OUTPUT_PATH):
+                        os.remove(OUTPUT_PATH)
+                    proc = subprocess.run(
+                        f"{self.oid} --connect {socket_path} --dump-json --config-file {self.oid_conf} --script {self.script()} -t60 --pid {debuggee_proc.pid}",
+                        shell=True,
+                        stdout=subprocess.PIPE,
+                        stderr=subprocess.PIPE,
+                    )
+                    self.expectReturncode(proc, ExitStatus.SUCCESS)
+
+                    with open(OUTPUT_PATH, "r") as f:
+                        output = json.loads(f.read())
+                        self.assertEqual(output[0]["typeName"], "Foo")
+            finally:
+                server_proc.terminate()
+                debuggee_proc.terminate()
+
+    def test_server_keeps_other_files(self):
+        with open("not_a_socket", "w") as f:
+            f.write("keep me")
+
+        proc = subprocess.run(
+            f"{self.oid} --server not_a_socket",
+            shell=True,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE,
+            timeout=60,
+        )
+        self.assertNotEqual(proc.returncode, ExitStatus.SUCCESS.value)
+        with open("not_a_socket", "r") as f:
+            self.assertEqual(f.read(), "keep me")
+
 
 if __name__ == "__main__":
     print("[debug] Running OI's integration tests")
@@ -145,9 +145,22 @@ def add_test_setup(f, config):
 
         oil_func_body += "    auto pr = oi::exporters::Json(std::cout);\n"
         oil_func_body += "    pr.setPretty(true);\n"
-        for i in range(len(case["param_types"])):
-            oil_func_body += f"    auto ret{i} = oi::result::SizedResult(*oi::setupAndIntrospect(a{i}, opts));\n"
-            oil_func_body += f"    pr.print(ret{i});\n"
+        if "oil_budget" in case:
+            oil_func_body += f"    oi::Budget budget{{{case['oil_budget']}}};\n"
+        if "oil_code" in case:
+            oil_func_body += case["oil_code"]
+        else:
+            for i in range(len(case["param_types"])):
+                if "oil_budget" in case:
+                    oil_func_body += (
+                        f"    using Handler{i} = oi::CodegenHandler<std::decay_t<decltype(a{i})>>;\n"
+                        f"    if (!Handler{i}::init(opts))\n"
+                        f"      return;\n"
+                        f"    auto ret{i} = oi::result::SizedResult(Handler{i}::introspect(a{i}, budget));\n"
+                    )
+                else:
+                    oil_func_body += f"    auto ret{i} = oi::result::SizedResult(*oi::setupAndIntrospect(a{i}, opts));\n"
+                oil_func_body += f"    pr.print(ret{i});\n"
 
         f.write(
             define_traceable_func(
@@ -272,8 +285,7 @@ def get_config_strings(case):
     config_prefix = case.get("config_prefix", "")
     if "features" in case:
         feature_config = "features = ["
-        for f in case.get("features", []):
-            feature_config += '"' + f + '"'
+        feature_config += ", ".join(f'"{f}"' for f in case.get("features", []))
         feature_config += "]\n"
         config_prefix = feature_config + config_prefix
     config_suffix = case.get("config_suffix", "")
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+#include <linux/futex.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include "oi/OIAgent.h"
+
+using namespace oi::detail;
+
+namespace {
+
+extern "C" void bump(uint64_t counter) {
+  reinterpret_cast<std::atomic<uint64_t>*>(counter)->fetch_add(1);
+}
+
+extern "C" void readThreadPointer(uint64_t out) {
+  uint64_t tp;
+  asm("movq %%fs:0, %0" : "=r"(tp));
+  *reinterpret_cast<uint64_t*>(out) = tp;
+}
+
+void futex(std::atomic<uint32_t>& word, int op, uint32_t val) {
+  syscall(SYS_futex, &word, op, val, nullptr, nullptr, 0);
+}
+
+// The clone trampoline stops the calling thread on an INT3 once the agent's
+// thread is started, which oid sees through ptrace. Here the SIGTRAP handler
+// takes the new TID and jumps back to the test instead.
+sigjmp_buf trampolineDone;
+volatile pid_t clonedTid = 0;
+
+void onTrap(int, siginfo_t*, void* context) {
+  auto* uc = static_cast<ucontext_t*>(context);
+  clonedTid = static_cast<pid_t>(uc->uc_mcontext.gregs[REG_RAX]);
+  siglongjmp(trampolineDone, 1);
+}
+
+pid_t runCloneTrampoline(uintptr_t trampoline,
+                         uintptr_t stackTop,
+                         uintptr_t ring) {
+  struct sigaction sa {};
+  struct sigaction oldSa {};
+  sa.sa_sigaction = onTrap;
+  sa.sa_flags = SA_SIGINFO;
+  sigaction(SIGTRAP, &sa, &oldSa);
+
+  clonedTid = 0;
+  if (sigsetjmp(trampolineDone, 1) == 0) {
+    // The arguments of the clone(2) syscall, as set up by remoteClone()
+    register uint64_t rax asm("rax") = SYS_clone;
+    register uint64_t rdi asm("rdi") = agent::cloneFlags;
+    register uint64_t rsi asm("rsi") = stackTop;
+    register uint64_t rdx asm("rdx") = 0;
+    register uint64_t r10 asm("r10") = 0;
+    register uint64_t r8 asm("r8") = 0;
+    register uint64_t r12 asm("r12") = ring;
+    asm volatile("jmp *%[trampoline]"
+                 :
+                 : "r"(rax),
+                   "r"(rdi),
+                   "r"(rsi),
+                   "r"(rdx),
+                   "r"(r10),
+                   "r"(r8),
+                   "r"(r12),
+                   [trampoline] "r"(trampoline)
+                 : "memory");
+    __builtin_unreachable();
+  }
+
+  sigaction(SIGTRAP, &oldSa, nullptr);
+  return clonedTid;
+}
+
+// The agent's thread has no CLONE_CHILD_CLEARTID to be waited on with
+bool threadExited(pid_t tid) {
+  for (int i = 0; i < 1000; i++) {
+    if (syscall(SYS_tgkill, getpid(), tid, 0) == -1 && errno == ESRCH)
+      return true;
+    usleep(1000);
+  }
+  return false;
+}
+
+class AgentTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Run a copy of the agent, as it would be in the target's text segment
+    auto code = agent::code();
+    text = mmap(nullptr,
+                code.size(),
+                PROT_READ | PROT_WRITE | PROT_EXEC,
+                MAP_PRIVATE | MAP_ANONYMOUS,
+                -1,
+                0);
+    ASSERT_NE(text, MAP_FAILED);
+    memcpy(text, code.data(), code.size());
+
+    void* page = mmap(nullptr,
+                      sizeof(agent::Ring),
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1,
+                      0);
+    ASSERT_NE(page, MAP_FAILED);
+    ring = static_cast<agent::Ring*>(page);
+
+    stack = mmap(nullptr,
+                 stackSize,
+                 PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+                 -1,
+                 0);
+    ASSERT_NE(stack, MAP_FAILED);
+
+    // Started as oid starts it in the target
+    tid = runCloneTrampoline(
+        reinterpret_cast<uintptr_t>(text) + agent::cloneOffset(),
+        reinterpret_cast<uintptr_t>(stack) + stackSize,
+        reinterpret_cast<uintptr_t>(ring));
+    ASSERT_GT(tid, 0);
+  }
+
+  void TearDown() override {
+    if (tid > 0 && !stopped) {
+      submit(0, 0);
+      stopped = threadExited(tid);
+    }
+    // A thread that didn't exit is still running on them
+    if (stopped) {
+      munmap(stack, stackSize);
+      munmap(ring, sizeof(agent::Ring));
+      munmap(text, agent::code().size());
+    }
+  }
+
+  void submit(uint64_t func, uint64_t arg) {
+    uint32_t seq = ring->cmdSeq.load();
+    ring->commands[seq % agent::ringSlots] = {func, arg};
+    ring->cmdSeq.store(seq + 1, std::memory_order_release);
+    futex(ring->cmdSeq, FUTEX_WAKE, INT_MAX);
+
+    uint32_t done = 0;
+    while ((done = ring->doneSeq.load(std::memory_order_acquire)) != seq + 1) {
+      futex(ring->doneSeq, FUTEX_WAIT, done);
+    }
+  }
+
+  static constexpr size_t stackSize = 64 << 10;
+
+  void* text = nullptr;
+  agent::Ring* ring = nullptr;
+  void* stack = nullptr;
+  pid_t tid = 0;
+  bool stopped = false;
+};
+
+}  // namespace
+
+TEST_F(AgentTest, RunsCommandsInOrder) {
+  std::atomic<uint64_t> counter = 0;
+
+  // More commands than the ring has slots, so it wraps around
+  for (size_t i = 1; i <= 3 * agent::ringSlots; i++) {
+    submit(reinterpret_cast<uint64_t>(&bump),
+           reinterpret_cast<uint64_t>(&counter));
+    EXPECT_EQ(counter, i);
+  }
+  EXPECT_EQ(ring->doneSeq, 3 * agent::ringSlots);
+}
+
+TEST_F(AgentTest, NullCommandStopsAgent) {
+  submit(0, 0);
+  stopped = threadExited(tid);
+  EXPECT_TRUE(stopped);
+  EXPECT_EQ(ring->doneSeq, 1);
+}
+
+TEST_F(AgentTest, RunsOnOwnThreadWithCallersTls) {
+  EXPECT_NE(tid, gettid());
+
+  // Without CLONE_SETTLS, so probes must not use TLS
+  uint64_t agentTp = 0;
+  submit(reinterpret_cast<uint64_t>(&readThreadPointer),
+         reinterpret_cast<uint64_t>(&agentTp));
+  uint64_t ownTp = 0;
+  readThreadPointer(reinterpret_cast<uint64_t>(&ownTp));
+  EXPECT_EQ(agentTp, ownTp);
+}
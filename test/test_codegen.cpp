@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <boost/format.hpp>
 #include <functional>
 #include <sstream>
 #include <string_view>
@@ -49,6 +50,34 @@ void testTransform(std::string_view input, std::string_view expectedAfter) {
   config.features[Feature::TreeBuilderV2] = true;
   testTransform(config, input, expectedAfter);
 }
+
+// The hash which a root's entry point symbols are named after
+std::string rootHash(const std::string& name) {
+  return (boost::format("%1$016x") % std::hash<std::string>{}(name)).str();
+}
+
+// Checks that the root named `name` has an entry point and tree builder
+// instructions, both for the type `typeName`, which has a handler
+void expectRoot(const std::string& code,
+                const std::string& name,
+                const std::string& typeName) {
+  auto hash = rootHash(name);
+  auto rootType = "__ROOT_TYPE_" + hash + "__";
+  EXPECT_NE(code.find("using " + rootType + " = " + typeName + ";\n"),
+            std::string::npos)
+      << name << " is not an alias of " << typeName;
+  EXPECT_NE(code.find("introspect_" + hash + "(\n    const OIInternal::" +
+                      rootType + "& t"),
+            std::string::npos)
+      << "missing entry point for " << name;
+  EXPECT_NE(code.find("treeBuilderInstructions" + hash +
+                      " = rootInstructions" + hash + ";"),
+            std::string::npos)
+      << "missing tree builder instructions for " << name;
+  EXPECT_NE(code.find("class TypeHandler<Ctx, " + typeName + "> {"),
+            std::string::npos)
+      << "missing handler for " << typeName;
+}
 }  // namespace
 
 TEST(CodeGenTest, TransformContainerAllocator) {
@@ -248,3 +277,261 @@ TEST(CodeGenTest, InheritFromContainerCompat) {
           Primitive: int8_t
 )");
 }
+
+TEST(CodeGenTest, GenerateMultipleRoots) {
+  std::string_view input = R"(
+[0] Struct: Foo (size: 4)
+      Member: a (offset: 0)
+        Primitive: int32_t
+[1] Struct: Bar (size: 8)
+      Member: b (offset: 0)
+        Primitive: int64_t
+)";
+  input.remove_prefix(1);  // Remove initial '\n'
+  TypeGraph typeGraph;
+  TypeGraphParser parser{typeGraph};
+  parser.parse(input);
+  ASSERT_EQ(typeGraph.rootTypes().size(), 2);
+
+  OICodeGen::Config config;
+  config.features[Feature::TreeBuilderV2] = true;
+  config.features[Feature::Library] = true;
+  MockSymbolService symbols;
+  CodeGen codegen{config, symbols};
+  codegen.transform(typeGraph);
+
+  std::string code;
+  codegen.generate(typeGraph,
+                   code,
+                   {CodeGen::HashedComponent{"Foo"},
+                    CodeGen::HashedComponent{"Bar"}});
+
+  auto count = [&code](std::string_view needle) {
+    size_t n = 0;
+    for (size_t pos = code.find(needle); pos != std::string::npos;
+         pos = code.find(needle, pos + 1))
+      n++;
+    return n;
+  };
+  // One entry point and set of tree builder instructions per root, both in the
+  // same translation unit
+  EXPECT_EQ(count("using __ROOT_TYPE_"), 2);
+  EXPECT_EQ(count("void __attribute__((used, retain)) introspect_"), 2);
+  EXPECT_EQ(count("__attribute__((used, retain)) treeBuilderInstructions"), 2);
+  expectRoot(code, "Foo", "Foo_0");
+  expectRoot(code, "Bar", "Bar_1");
+}
+
+TEST(CodeGenTest, GenerateRootsWithSameName) {
+  // Distinct types with the same name, e.g. from two anonymous namespaces
+  std::string_view input = R"(
+[0] Struct: Foo (size: 4)
+      Member: a (offset: 0)
+        Primitive: int32_t
+[1] Struct: Foo (size: 8)
+      Member: b (offset: 0)
+        Primitive: int64_t
+)";
+  input.remove_prefix(1);  // Remove initial '\n'
+  TypeGraph typeGraph;
+  TypeGraphParser parser{typeGraph};
+  parser.parse(input);
+  ASSERT_EQ(typeGraph.rootTypes().size(), 2);
+
+  OICodeGen::Config config;
+  config.features[Feature::TreeBuilderV2] = true;
+  config.features[Feature::Library] = true;
+  MockSymbolService symbols;
+  CodeGen codegen{config, symbols};
+  codegen.transform(typeGraph);
+
+  std::string code;
+  codegen.generate(typeGraph,
+                   code,
+                   {CodeGen::HashedComponent{"Foo"},
+                    CodeGen::HashedComponent{"Foo#1"}});
+
+  // Each root keeps its own handler and entry point
+  expectRoot(code, "Foo", "Foo_0");
+  expectRoot(code, "Foo#1", "Foo_1");
+}
+
+TEST(CodeGenTest, GenerateUnits) {
+  std::string_view input = R"(
+[0] Struct: Foo (size: 4)
+      Member: a (offset: 0)
+        Primitive: int32_t
+[1] Struct: Bar (size: 8)
+      Member: b (offset: 0)
+[2]     Struct: Inner (size: 8)
+          Member: c (offset: 0)
+            Primitive: int64_t
+[3] Struct: Baz (size: 8)
+      Member: d (offset: 0)
+        [2]
+)";
+  input.remove_prefix(1);  // Remove initial '\n'
+  TypeGraph typeGraph;
+  TypeGraphParser parser{typeGraph};
+  parser.parse(input);
+  ASSERT_EQ(typeGraph.rootTypes().size(), 3);
+
+  OICodeGen::Config config;
+  config.features[Feature::TreeBuilderV2] = true;
+  config.features[Feature::Library] = true;
+  MockSymbolService symbols;
+  CodeGen codegen{config, symbols};
+  codegen.setEmitOptions({.minTypesPerUnit = 1});
+  codegen.transform(typeGraph);
+  size_t numFinalTypes = typeGraph.finalTypes.size();
+
+  std::vector<std::string> units;
+  codegen.generateUnits(typeGraph,
+                        units,
+                        {CodeGen::HashedComponent{"Foo"},
+                         CodeGen::HashedComponent{"Bar"},
+                         CodeGen::HashedComponent{"Baz"}},
+                        2);
+  ASSERT_EQ(units.size(), 2);
+
+  auto count = [](const std::string& code, std::string_view needle) {
+    size_t n = 0;
+    for (size_t pos = code.find(needle); pos != std::string::npos;
+         pos = code.find(needle, pos + 1))
+      n++;
+    return n;
+  };
+  // Bar and Baz are the largest roots, so are handed out first. Baz shares
+  // Inner with Bar, so joins it rather than repeating Inner in a unit of its
+  // own. Foo shares nothing and goes to the empty unit.
+  const auto& first = units[0];
+  const auto& second = units[1];
+  EXPECT_EQ(count(first, "void __attribute__((used, retain)) introspect_"), 2);
+  EXPECT_EQ(count(second, "void __attribute__((used, retain)) introspect_"),
+            1);
+  EXPECT_EQ(count(first, "struct Foo_0 {"), 0);
+  EXPECT_EQ(count(first, "struct Bar_1 {"), 1);
+  EXPECT_EQ(count(first, "struct Baz_3 {"), 1);
+  EXPECT_EQ(count(second, "struct Foo_0 {"), 1);
+  EXPECT_EQ(count(second, "struct Bar_1 {"), 0);
+  EXPECT_EQ(count(second, "struct Baz_3 {"), 0);
+  EXPECT_EQ(count(first, "struct Inner_2 {"), 1);
+  EXPECT_EQ(count(second, "struct Inner_2 {"), 0);
+
+  // The graph is left as it was
+  EXPECT_EQ(typeGraph.rootTypes().size(), 3);
+  EXPECT_EQ(typeGraph.finalTypes.size(), numFinalTypes);
+}
+
+TEST(CodeGenTest, GenerateUnitsSmallGraph) {
+  std::string_view input = R"(
+[0] Struct: Foo (size: 4)
+      Member: a (offset: 0)
+        Primitive: int32_t
+[1] Struct: Bar (size: 8)
+      Member: b (offset: 0)
+        Primitive: int64_t
+)";
+  input.remove_prefix(1);  // Remove initial '\n'
+  TypeGraph typeGraph;
+  TypeGraphParser parser{typeGraph};
+  parser.parse(input);
+
+  OICodeGen::Config config;
+  config.features[Feature::TreeBuilderV2] = true;
+  config.features[Feature::Library] = true;
+  MockSymbolService symbols;
+  CodeGen codegen{config, symbols};
+  codegen.transform(typeGraph);
+
+  // Too few types to be worth parsing the prelude in a second unit
+  std::vector<std::string> units;
+  codegen.generateUnits(
+      typeGraph,
+      units,
+      {CodeGen::HashedComponent{"Foo"}, CodeGen::HashedComponent{"Bar"}},
+      2);
+  ASSERT_EQ(units.size(), 1);
+  expectRoot(units[0], "Foo", "Foo_0");
+  expectRoot(units[0], "Bar", "Bar_1");
+}
+
+TEST(CodeGenTest, GenerateUnitsOverlappingRoots) {
+  std::string_view input = R"(
+[0] Struct: Foo (size: 16)
+      Member: a (offset: 0)
+[1]     Struct: Inner (size: 16)
+          Member: b (offset: 0)
+[2]         Struct: Deep (size: 8)
+              Member: c (offset: 0)
+                Primitive: int64_t
+          Member: d (offset: 8)
+            Primitive: int32_t
+[3] Struct: Bar (size: 16)
+      Member: e (offset: 0)
+        [1]
+)";
+  input.remove_prefix(1);  // Remove initial '\n'
+  TypeGraph typeGraph;
+  TypeGraphParser parser{typeGraph};
+  parser.parse(input);
+
+  OICodeGen::Config config;
+  config.features[Feature::TreeBuilderV2] = true;
+  config.features[Feature::Library] = true;
+  MockSymbolService symbols;
+  CodeGen codegen{config, symbols};
+  codegen.setEmitOptions({.minTypesPerUnit = 1});
+  codegen.transform(typeGraph);
+
+  // Almost everything is reachable from both roots, so splitting them would
+  // only compile the same types twice
+  std::vector<std::string> units;
+  codegen.generateUnits(
+      typeGraph,
+      units,
+      {CodeGen::HashedComponent{"Foo"}, CodeGen::HashedComponent{"Bar"}},
+      2);
+  ASSERT_EQ(units.size(), 1);
+  expectRoot(units[0], "Foo", "Foo_0");
+  expectRoot(units[0], "Bar", "Bar_3");
+}
+
+TEST(CodeGenTest, GenerateInParallel) {
+  // A root with enough distinct member types to be split between threads
+  std::string input = "[0] Struct: Root (size: 256)\n";
+  for (int i = 0; i < 64; i++) {
+    auto n = std::to_string(i);
+    std::string id = "[" + std::to_string(i + 1) + "]";
+    id.resize(8, ' ');
+    input += "      Member: m" + n + " (offset: " + std::to_string(i * 4) +
+             ")\n";
+    input += id + "Struct: Foo" + n + " (size: 4)\n";
+    input += "          Member: a (offset: 0)\n";
+    input += "            Primitive: int32_t\n";
+  }
+
+  OICodeGen::Config config;
+  config.features[Feature::TreeBuilderV2] = true;
+  config.features[Feature::Library] = true;
+  MockSymbolService symbols;
+
+  auto generate = [&](CodeGen::EmitOptions options) {
+    TypeGraph typeGraph;
+    TypeGraphParser parser{typeGraph};
+    parser.parse(input);
+    CodeGen codegen{config, symbols};
+    codegen.setEmitOptions(options);
+    codegen.transform(typeGraph);
+    EXPECT_GE(typeGraph.finalTypes.size(), 64);
+
+    std::string code;
+    codegen.generate(typeGraph, code, CodeGen::HashedComponent{"Root"});
+    return code;
+  };
+
+  auto sequential = generate({.maxThreads = 1});
+  auto parallel = generate({.maxThreads = 4, .minTypesPerThread = 8});
+  EXPECT_EQ(parallel, sequential);
+  expectRoot(parallel, "Root", "Root_0");
+}
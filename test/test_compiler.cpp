@@ -74,8 +74,8 @@ TEST(CompilerTest, CompileAndRelocate) {
     EXPECT_LE(lastSegLimit, relocLimit);
   }
 
-  for (const auto& [Base, Reloc, Size] : segs)
-    std::memcpy((void*)Reloc, (void*)Base, Size);
+  for (const auto& seg : segs)
+    std::memcpy((void*)seg.RelocAddr, (void*)seg.BaseAddr, seg.Size);
 
   {
     auto symAddr = jitSymbols.at("constant");
@@ -155,8 +155,8 @@ TEST(CompilerTest, CompileAndRelocateMultipleObjs) {
     EXPECT_LE(lastSegLimit, relocLimit);
   }
 
-  for (const auto& [Base, Reloc, Size] : segs)
-    std::memcpy((void*)Reloc, (void*)Base, Size);
+  for (const auto& seg : segs)
+    std::memcpy((void*)seg.RelocAddr, (void*)seg.BaseAddr, seg.Size);
 
   {
     auto symAddr = jitSymbols.at("sumXs");
@@ -171,6 +171,114 @@ TEST(CompilerTest, CompileAndRelocateMultipleObjs) {
   munmap(relocSlab, relocSlabSize);
 }
 
+TEST(CompilerTest, RelocateWithSeparateWritableData) {
+  auto symbols = std::make_shared<SymbolService>(getpid());
+
+  auto code = R"(
+    extern "C" {
+    static const int xs[] = {1, 2, 3, 4, 5};
+    int counter = 0;
+    int sumXs() {
+      volatile int sum = 0;
+      for (int i = 0; i < 5; i++)
+        sum += xs[i];
+      return sum;
+    }
+    int bump() { return ++counter; }
+    }
+  )";
+
+  auto tmpdir = fs::temp_directory_path() / "test-XXXXXX";
+  EXPECT_NE(mkdtemp(const_cast<char*>(tmpdir.c_str())), nullptr);
+
+  auto sourcePath = tmpdir / "src.cpp";
+  auto objectPath = tmpdir / "obj.o";
+
+  OICompiler compiler{symbols, {}};
+  EXPECT_TRUE(compiler.compile(code, sourcePath, objectPath));
+
+  void* relocSlab = nullptr;
+  size_t relocSlabSize = 0;
+  auto relocResult = compiler.applyRelocs(
+      [&](size_t size) -> std::optional<uintptr_t> {
+        relocSlabSize = size;
+        relocSlab = mmap(nullptr,
+                         relocSlabSize,
+                         PROT_READ | PROT_WRITE,
+                         MAP_ANONYMOUS | MAP_PRIVATE,
+                         -1,
+                         0);
+        if (relocSlab == MAP_FAILED)
+          return std::nullopt;
+        return (uintptr_t)relocSlab;
+      },
+      {objectPath},
+      {});
+  ASSERT_TRUE(relocResult.has_value());
+
+  auto& [_, segs, jitSymbols] = relocResult.value();
+  ASSERT_EQ(segs.size(), 1);
+
+  const auto& seg = segs.front();
+  EXPECT_EQ(seg.RelocAddr, (uintptr_t)relocSlab);
+  EXPECT_LE(seg.Size, relocSlabSize);
+  EXPECT_EQ(seg.WritableOffset % getpagesize(), 0);
+  EXPECT_LT(seg.WritableOffset, seg.Size);
+
+  // The writable data must not share a page with the code
+  EXPECT_GE(jitSymbols.at("counter"), seg.RelocAddr + seg.WritableOffset);
+  EXPECT_LT(jitSymbols.at("sumXs"), seg.RelocAddr + seg.WritableOffset);
+
+  std::memcpy((void*)seg.RelocAddr, (void*)seg.BaseAddr, seg.Size);
+  EXPECT_EQ(
+      mprotect(relocSlab, seg.WritableOffset, PROT_READ | PROT_EXEC), 0);
+
+  EXPECT_EQ(((jitFunc)jitSymbols.at("sumXs"))(), 15);
+  EXPECT_EQ(((jitFunc)jitSymbols.at("bump"))(), 1);
+  EXPECT_EQ(((jitFunc)jitSymbols.at("bump"))(), 2);
+
+  munmap(relocSlab, relocSlabSize);
+}
+
+TEST(CompilerTest, FindThreadLocalUse) {
+  auto symbols = std::make_shared<SymbolService>(getpid());
+
+  auto tmpdir = fs::temp_directory_path() / "test-XXXXXX";
+  EXPECT_NE(mkdtemp(const_cast<char*>(tmpdir.c_str())), nullptr);
+
+  OICompiler compiler{symbols, {}};
+  auto findIn = [&](const char* code) {
+    auto sourcePath = tmpdir / "src.cpp";
+    auto objectPath = tmpdir / "obj.o";
+    EXPECT_TRUE(compiler.compile(code, sourcePath, objectPath));
+    return OICompiler::findThreadLocalUse({objectPath});
+  };
+
+  EXPECT_EQ(findIn(R"(
+    extern "C" {
+    struct Big { char bytes[4096]; };
+    void copy(Big* to, const Big* from) { *to = *from; }
+    }
+  )"),
+            std::nullopt);
+
+  EXPECT_EQ(findIn(R"(
+    extern "C" {
+    thread_local int depth = 0;
+    int enter() { return ++depth; }
+    }
+  )"),
+            "depth");
+
+  EXPECT_EQ(findIn(R"(
+    extern "C" {
+    void* malloc(unsigned long);
+    void* allocate() { return malloc(16); }
+    }
+  )"),
+            "malloc");
+}
+
 TEST(CompilerTest, LocateOpcodes) {
   const std::array retInsts = {
       std::array{0xC2_b}, /* Return from near procedure, with immediate value */
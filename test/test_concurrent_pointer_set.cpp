@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "oi/ConcurrentPointerSet.h"
+
+using oi::detail::ConcurrentPointerSet;
+
+TEST(ConcurrentPointerSetTest, AddContract) {
+  ConcurrentPointerSet set{16, 4};
+
+  EXPECT_FALSE(set.add(uintptr_t{0}));
+  EXPECT_TRUE(set.add(0x1000));
+  EXPECT_FALSE(set.add(0x1000));
+  EXPECT_TRUE(set.add(0x2000));
+  EXPECT_EQ(set.size(), 2);
+
+  int x;
+  EXPECT_TRUE(set.add(&x));
+  EXPECT_FALSE(set.add(&x));
+  EXPECT_EQ(set.size(), 3);
+}
+
+TEST(ConcurrentPointerSetTest, GrowsIntoLaterLevels) {
+  ConcurrentPointerSet set{16, 10};
+
+  // Far more than fit in the first level
+  for (uintptr_t p = 1; p <= 5000; p++)
+    EXPECT_TRUE(set.add(p * 8)) << p;
+  for (uintptr_t p = 1; p <= 5000; p++)
+    EXPECT_FALSE(set.add(p * 8)) << p;
+  EXPECT_EQ(set.size(), 5000);
+}
+
+TEST(ConcurrentPointerSetTest, MapsLevelsOnDemand) {
+  ConcurrentPointerSet set{16, 10};
+  EXPECT_EQ(set.mappedSlots(), 16);
+
+  for (uintptr_t p = 1; p <= 4; p++)
+    EXPECT_TRUE(set.add(p * 8));
+  EXPECT_EQ(set.mappedSlots(), 16);
+
+  for (uintptr_t p = 5; p <= 5000; p++)
+    EXPECT_TRUE(set.add(p * 8));
+  EXPECT_GT(set.mappedSlots(), 16);
+  EXPECT_LE(set.mappedSlots(), set.capacity());
+
+  // Emptying the set keeps the levels mapped
+  size_t mapped = set.mappedSlots();
+  set.initialize();
+  EXPECT_EQ(set.mappedSlots(), mapped);
+  EXPECT_TRUE(set.add(0x1000));
+}
+
+TEST(ConcurrentPointerSetTest, FullSetRejects) {
+  ConcurrentPointerSet set{16, 1};
+  ASSERT_EQ(set.capacity(), 16);
+
+  size_t added = 0;
+  for (uintptr_t p = 1; p <= 100; p++)
+    added += set.add(p * 8);
+  EXPECT_LE(added, set.capacity());
+  EXPECT_EQ(set.size(), added);
+}
+
+TEST(ConcurrentPointerSetTest, Initialize) {
+  ConcurrentPointerSet set{16, 4};
+  EXPECT_TRUE(set.add(0x1000));
+
+  set.initialize();
+  EXPECT_EQ(set.size(), 0);
+  EXPECT_TRUE(set.add(0x1000));
+}
+
+TEST(ConcurrentPointerSetTest, StressEachPointerAddedOnce) {
+  constexpr size_t kThreads = 32;
+  constexpr uintptr_t kPointers = 100'000;
+
+  // Start small so that the threads race to fill several levels
+  ConcurrentPointerSet set{1024, 12};
+  std::atomic<size_t> added = 0;
+  std::atomic<bool> go = false;
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t] {
+      while (!go.load())
+        std::this_thread::yield();
+
+      // Each thread visits every pointer, starting at a different offset
+      size_t mine = 0;
+      for (uintptr_t i = 0; i < kPointers; i++) {
+        uintptr_t p = ((i + t * kPointers / kThreads) % kPointers + 1) * 16;
+        mine += set.add(p);
+      }
+      added += mine;
+    });
+  }
+  go = true;
+  for (auto& thread : threads)
+    thread.join();
+
+  EXPECT_EQ(added, kPointers);
+  EXPECT_EQ(set.size(), kPointers);
+  for (uintptr_t i = 1; i <= kPointers; i++)
+    ASSERT_FALSE(set.add(i * 16)) << i;
+}
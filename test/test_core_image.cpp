@@ -0,0 +1,222 @@
+#include <elf.h>
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "oi/CoreImage.h"
+
+namespace fs = std::filesystem;
+using oi::detail::CoreImage;
+
+namespace {
+
+const size_t pageSize = getpagesize();
+
+/*
+ * Writes a core with three segments: one saved in the core, one left out but
+ * backed by a file listed in the NT_FILE note, and one left out and anonymous.
+ * Tests can write it again with the saved contents at an offset in the core
+ * which isn't page aligned, or with a vsyscall page.
+ */
+class CoreImageTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir = fs::temp_directory_path() /
+          ("test_core_image." + std::to_string(getpid()));
+    fs::create_directories(dir);
+
+    // Reserve addresses for the segments, then free them for map() to reuse
+    void* addr = mmap(nullptr,
+                      3 * pageSize,
+                      PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1,
+                      0);
+    ASSERT_NE(addr, MAP_FAILED);
+    munmap(addr, 3 * pageSize);
+    base = reinterpret_cast<uintptr_t>(addr);
+
+    mappedFile = dir / "mapped";
+    std::ofstream{mappedFile} << std::string(2 * pageSize, 'f');
+
+    writeCore();
+  }
+
+  void TearDown() override {
+    munmap(reinterpret_cast<void*>(base), 3 * pageSize);
+    fs::remove_all(dir);
+  }
+
+  void writeCore(size_t dataPadding = 0, bool vsyscall = false) {
+    std::vector<char> note;
+    auto append = [&](const void* data, size_t len) {
+      const char* bytes = static_cast<const char*>(data);
+      note.insert(note.end(), bytes, bytes + len);
+      note.resize((note.size() + 3) & ~size_t{3});
+    };
+
+    std::vector<char> desc;
+    auto word = [&](uint64_t w) {
+      const char* bytes = reinterpret_cast<const char*>(&w);
+      desc.insert(desc.end(), bytes, bytes + sizeof(w));
+    };
+    word(1);  // count
+    word(pageSize);
+    word(base + pageSize);
+    word(base + 2 * pageSize);
+    word(1);  // offset, in pages
+    std::string name = mappedFile.string();
+    desc.insert(desc.end(), name.c_str(), name.c_str() + name.size() + 1);
+
+    Elf64_Nhdr nhdr{.n_namesz = 5,
+                    .n_descsz = static_cast<Elf64_Word>(desc.size()),
+                    .n_type = NT_FILE};
+    append(&nhdr, sizeof(nhdr));
+    append("CORE", 5);
+    append(desc.data(), desc.size());
+
+    size_t phnum = vsyscall ? 5 : 4;
+    Elf64_Ehdr ehdr{};
+    memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_CORE;
+    ehdr.e_machine = EM_X86_64;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_phoff = sizeof(ehdr);
+    ehdr.e_ehsize = sizeof(ehdr);
+    ehdr.e_phentsize = sizeof(Elf64_Phdr);
+    ehdr.e_phnum = phnum;
+
+    size_t noteOff = sizeof(ehdr) + phnum * sizeof(Elf64_Phdr);
+    size_t dataOff = (noteOff + note.size() + pageSize - 1) & ~(pageSize - 1);
+    dataOff += dataPadding;
+
+    std::vector<Elf64_Phdr> phdrs = {
+        {.p_type = PT_NOTE,
+         .p_offset = noteOff,
+         .p_filesz = note.size()},
+        {.p_type = PT_LOAD,
+         .p_flags = PF_R | PF_W,
+         .p_offset = dataOff,
+         .p_vaddr = base,
+         .p_filesz = pageSize,
+         .p_memsz = pageSize},
+        {.p_type = PT_LOAD,
+         .p_flags = PF_R | PF_X,
+         .p_offset = dataOff + pageSize,
+         .p_vaddr = base + pageSize,
+         .p_memsz = pageSize},
+        {.p_type = PT_LOAD,
+         .p_flags = PF_R | PF_W,
+         .p_offset = dataOff + pageSize,
+         .p_vaddr = base + 2 * pageSize,
+         .p_memsz = pageSize},
+    };
+    if (vsyscall) {
+      phdrs.push_back({.p_type = PT_LOAD,
+                       .p_flags = PF_R | PF_X,
+                       .p_offset = dataOff,
+                       .p_vaddr = 0xffffffffff600000,
+                       .p_filesz = pageSize,
+                       .p_memsz = pageSize});
+    }
+
+    corePath = dir / "core";
+    std::ofstream core{corePath, std::ios::binary | std::ios::trunc};
+    core.write(reinterpret_cast<const char*>(&ehdr), sizeof(ehdr));
+    core.write(reinterpret_cast<const char*>(phdrs.data()),
+               phdrs.size() * sizeof(Elf64_Phdr));
+    core.write(note.data(), note.size());
+    core.seekp(dataOff);
+    core << std::string(pageSize, 'c');
+  }
+
+  fs::path dir;
+  fs::path corePath;
+  fs::path mappedFile;
+  uintptr_t base = 0;
+};
+
+}  // namespace
+
+TEST_F(CoreImageTest, ReadsSegments) {
+  auto image = CoreImage::open(corePath);
+  ASSERT_TRUE(image.has_value());
+
+  const auto& segs = image->segments();
+  ASSERT_EQ(segs.size(), 3);
+
+  EXPECT_EQ(segs[0].start, base);
+  EXPECT_EQ(segs[0].size, pageSize);
+  EXPECT_EQ(segs[0].prot, PROT_READ | PROT_WRITE);
+  EXPECT_EQ(segs[0].coreSize, pageSize);
+  EXPECT_EQ(segs[0].file, "");
+
+  EXPECT_EQ(segs[1].start, base + pageSize);
+  EXPECT_EQ(segs[1].prot, PROT_READ | PROT_EXEC);
+  EXPECT_EQ(segs[1].coreSize, 0);
+  EXPECT_EQ(segs[1].file, mappedFile.string());
+  EXPECT_EQ(segs[1].fileOffset, pageSize);
+
+  EXPECT_EQ(segs[2].start, base + 2 * pageSize);
+  EXPECT_EQ(segs[2].file, "");
+}
+
+TEST_F(CoreImageTest, MapsSegments) {
+  auto image = CoreImage::open(corePath);
+  ASSERT_TRUE(image.has_value());
+  ASSERT_TRUE(image->map());
+
+  const char* mem = reinterpret_cast<const char*>(base);
+  EXPECT_EQ(mem[0], 'c');
+  EXPECT_EQ(mem[pageSize - 1], 'c');
+  EXPECT_EQ(mem[pageSize], 'f');
+  EXPECT_EQ(mem[2 * pageSize - 1], 'f');
+  EXPECT_EQ(mem[2 * pageSize], '\0');
+
+  // Mapping again would replace the image
+  EXPECT_FALSE(image->map());
+  EXPECT_EQ(errno, EEXIST);
+}
+
+TEST_F(CoreImageTest, MapsUnalignedSegments) {
+  writeCore(16);
+  auto image = CoreImage::open(corePath);
+  ASSERT_TRUE(image.has_value());
+  ASSERT_EQ(image->segments()[0].coreOffset % pageSize, 16);
+  ASSERT_TRUE(image->map());
+
+  const char* mem = reinterpret_cast<const char*>(base);
+  EXPECT_EQ(mem[0], 'c');
+  EXPECT_EQ(mem[pageSize - 1], 'c');
+  EXPECT_EQ(mem[pageSize], 'f');
+  EXPECT_EQ(mem[2 * pageSize], '\0');
+}
+
+TEST_F(CoreImageTest, SkipsVsyscallPage) {
+  writeCore(0, true);
+  auto image = CoreImage::open(corePath);
+  ASSERT_TRUE(image.has_value());
+  ASSERT_EQ(image->segments().size(), 4);
+  EXPECT_EQ(image->segments()[3].start, 0xffffffffff600000);
+
+  // The page can't be mapped by user space, the rest of the image is
+  ASSERT_TRUE(image->map());
+  const char* mem = reinterpret_cast<const char*>(base);
+  EXPECT_EQ(mem[0], 'c');
+  EXPECT_EQ(mem[pageSize], 'f');
+}
+
+TEST_F(CoreImageTest, RejectsNonCore) {
+  std::ofstream{corePath, std::ios::trunc} << "not a core";
+  EXPECT_FALSE(CoreImage::open(corePath).has_value());
+}
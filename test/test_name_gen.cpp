@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include "oi/type_graph/NameGen.h"
+#include "oi/type_graph/TypeGraph.h"
 #include "oi/type_graph/Types.h"
 #include "test/type_graph_utils.h"
 
@@ -13,7 +14,8 @@ TEST(NameGenTest, ClassParams) {
   myclass.templateParams.push_back(myparam1);
   myclass.templateParams.push_back(myparam2);
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myclass});
 
   EXPECT_EQ(myclass.name(), "MyClass_0");
@@ -31,7 +33,8 @@ TEST(NameGenTest, ClassContainerParam) {
   auto myclass = Class{0, Class::Kind::Struct, "MyClass", 13};
   myclass.templateParams.push_back(myparam);
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myclass});
 
   EXPECT_EQ(myclass.name(), "MyClass_0");
@@ -47,7 +50,8 @@ TEST(NameGenTest, ClassParents) {
   myclass.parents.push_back(Parent{myparent1, 0});
   myclass.parents.push_back(Parent{myparent2, 0});
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myclass});
 
   EXPECT_EQ(myclass.name(), "MyClass_0");
@@ -68,7 +72,8 @@ TEST(NameGenTest, ClassMembers) {
   myclass.members.push_back(Member{mymember1, "mem", 0});
   myclass.members.push_back(Member{mymember2, "mem", 0});
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myclass});
 
   EXPECT_EQ(myclass.name(), "MyClass_0");
@@ -90,7 +95,8 @@ TEST(NameGenTest, ClassMemberInvalidChar) {
   auto myint = Primitive{Primitive::Kind::Int32};
   myclass.members.push_back(Member{myint, "mem.Nope", 0});
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myclass});
 
   EXPECT_EQ(myclass.name(), "MyClass_0");
@@ -107,7 +113,8 @@ TEST(NameGenTest, ClassChildren) {
   myclass.children.push_back(mychild1);
   myclass.children.push_back(mychild2);
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myclass});
 
   EXPECT_EQ(myclass.name(), "MyClass_0");
@@ -126,7 +133,8 @@ TEST(NameGenTest, ContainerParams) {
   mycontainer.templateParams.push_back(myparam1);
   mycontainer.templateParams.push_back(myparam2);
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({mycontainer});
 
   EXPECT_EQ(myparam1.name(), "MyParam_0");
@@ -144,7 +152,8 @@ TEST(NameGenTest, ContainerParamsDuplicates) {
   mycontainer.templateParams.push_back(myparam);
   mycontainer.templateParams.push_back(myparam);
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({mycontainer});
 
   EXPECT_EQ(myparam.name(), "MyParam_0");
@@ -164,7 +173,8 @@ TEST(NameGenTest, ContainerParamsDuplicatesDeep) {
   mycontainer2.templateParams.push_back(myparam);
   mycontainer2.templateParams.push_back(mycontainer1);
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({mycontainer2});
 
   EXPECT_EQ(myparam.name(), "MyParam_0");
@@ -191,7 +201,8 @@ TEST(NameGenTest, ContainerParamsDuplicatesAcrossContainers) {
   mycontainer2.templateParams.push_back(myparam2);
   mycontainer2.templateParams.push_back(myparam3);
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({mycontainer1, mycontainer2});
 
   EXPECT_EQ(myparam1.name(), "MyParam_0");
@@ -220,7 +231,8 @@ TEST(NameGenTest, ContainerParamsConst) {
   mycontainer.templateParams.push_back(
       TemplateParam{myparam3, {Qualifier::Const}});
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({mycontainer});
 
   EXPECT_EQ(myparam1.name(), "MyConstParam_0");
@@ -239,7 +251,8 @@ TEST(NameGenTest, ContainerParamsConst) {
 TEST(NameGenTest, ContainerNoParams) {
   auto mycontainer = getVector();
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({mycontainer});
 
   EXPECT_EQ(mycontainer.name(), "std::vector");
@@ -255,7 +268,8 @@ TEST(NameGenTest, ContainerParamsValue) {
   mycontainer.templateParams.push_back(
       TemplateParam{myenum, "MyEnum::OptionC"});
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({mycontainer});
 
   EXPECT_EQ(myint.name(), "int32_t");
@@ -271,7 +285,8 @@ TEST(NameGenTest, Enum) {
   auto myenum0 = Enum{"MyEnum", 4};
   auto myenum1 = Enum{"MyEnum", 4};
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myenum0, myenum1});
 
   EXPECT_EQ(myenum0.name(), "MyEnum_0");
@@ -291,7 +306,8 @@ TEST(NameGenTest, Array) {
 
   auto myarray = Array{2, mycontainer, 5};
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myarray});
 
   EXPECT_EQ(myparam1.name(), "MyParam_0");
@@ -315,7 +331,8 @@ TEST(NameGenTest, Typedef) {
 
   auto mytypedef = Typedef{2, "MyTypedef", mycontainer};
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({mytypedef});
 
   EXPECT_EQ(myparam1.name(), "MyParam_1");
@@ -333,7 +350,8 @@ TEST(NameGenTest, TypedefAliasTemplate) {
   auto myint = Primitive{Primitive::Kind::Int32};
   auto mytypedef = Typedef{0, "MyTypedef<ParamA, ParamB>", myint};
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({mytypedef});
 
   EXPECT_EQ(mytypedef.name(), "MyTypedef_0");
@@ -350,7 +368,8 @@ TEST(NameGenTest, Pointer) {
 
   auto mypointer = Pointer{2, mycontainer};
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({mypointer});
 
   EXPECT_EQ(myparam1.name(), "MyParam_0");
@@ -367,7 +386,8 @@ TEST(NameGenTest, Pointer) {
 TEST(NameGenTest, Dummy) {
   auto dummy = Dummy{0, 12, 34, "InputName"};
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({dummy});
 
   EXPECT_EQ(dummy.name(), "DummySizedOperator<12, 34, 0>");
@@ -384,7 +404,8 @@ TEST(NameGenTest, DummyAllocator) {
 
   auto myalloc = DummyAllocator{2, mycontainer, 12, 34, "BigAllocator"};
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myalloc});
 
   EXPECT_EQ(myparam1.name(), "MyParam_0");
@@ -409,7 +430,8 @@ TEST(NameGenTest, CaptureKeys) {
 
   auto captureKeys = CaptureKeys{mycontainer, mycontainer.containerInfo_};
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({captureKeys});
 
   EXPECT_EQ(myparam1.name(), "MyParam_0");
@@ -431,7 +453,8 @@ TEST(NameGenTest, Cycle) {
   classA.members.push_back(Member{classB, "b", 0});
   classB.members.push_back(Member{ptrA, "a", 0});
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({classA});
 
   EXPECT_EQ(classA.name(), "ClassA_0");
@@ -447,7 +470,8 @@ TEST(NameGenTest, ContainerCycle) {
   myclass.members.push_back(Member{container, "c", 0});
   container.templateParams.push_back(TemplateParam{myclass});
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myclass});
 
   EXPECT_EQ(myclass.name(), "MyClass_0");
@@ -464,7 +488,8 @@ TEST(NameGenTest, AnonymousTypes) {
   auto myenum = Enum{"", 4};
   auto mytypedef = Typedef{1, "", myint};
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myclass, myenum, mytypedef});
 
   EXPECT_EQ(myclass.name(), "__oi_anon_0");
@@ -486,7 +511,8 @@ TEST(NameGenTest, AnonymousMembers) {
   myclass.members.push_back(Member{myunion1, "", 0});
   myclass.members.push_back(Member{myunion2, "", 4});
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myclass, myunion1, myunion2});
 
   EXPECT_EQ(myclass.name(), "C_0");
@@ -508,7 +534,8 @@ TEST(NameGenTest, IncompleteTypes) {
   auto myint = Primitive{Primitive::Kind::Int32};
   auto myincompleteint = Incomplete{1, myint};
 
-  NameGen nameGen;
+  TypeGraph typeGraph;
+  NameGen nameGen{typeGraph};
   nameGen.generateNames({myincompletevector, myincompleteint});
 
   EXPECT_EQ(myincompletevector.name(), "Incomplete<struct std__vector_int_>");
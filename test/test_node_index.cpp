@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "oi/NodeIndex.h"
+#include "rocksdb/db.h"
+#include "rocksdb/options.h"
+
+namespace fs = std::filesystem;
+using namespace oi::detail;
+
+namespace {
+
+class NodeIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dbPath = fs::temp_directory_path() /
+             ("test_node_index." + std::to_string(getpid()));
+    fs::remove_all(dbPath);
+
+    rocksdb::Options options;
+    options.create_if_missing = true;
+    rocksdb::DB* db = nullptr;
+    ASSERT_TRUE(rocksdb::DB::Open(options, dbPath.string(), &db).ok());
+
+    rocksdb::ColumnFamilyHandle* family = nullptr;
+    ASSERT_TRUE(db->CreateColumnFamily(rocksdb::ColumnFamilyOptions{},
+                                       std::string{node_index::kColumnFamily},
+                                       &family)
+                    .ok());
+
+    {
+      NodeIndexWriter writer{db, family};
+      writer.add(1024, 8, "Foo", "foo");
+      writer.add(1025, 100, "std::vector<int, std::allocator<int>>", "foo/v");
+      writer.add(1026, 4, "int", "foo/v/int[]");
+      writer.add(1027, 4, "int", "foo/v/int[]");
+      writer.add(1028, 50, "std::string", "foo/vv");
+      writer.add(1029, 4, "int", "bar");
+      writer.finish();
+    }
+
+    db->DestroyColumnFamilyHandle(family);
+    ASSERT_TRUE(db->Close().ok());
+    delete db;
+  }
+
+  void TearDown() override {
+    fs::remove_all(dbPath);
+  }
+
+  static std::vector<uint64_t> ids(
+      const std::function<void(const node_index::Visitor&)>& query) {
+    std::vector<uint64_t> found;
+    query([&](const node_index::Entry& node) {
+      found.push_back(node.id);
+      return true;
+    });
+    return found;
+  }
+
+  fs::path dbPath;
+};
+
+}  // namespace
+
+TEST_F(NodeIndexTest, TopTypes) {
+  NodeIndex index{dbPath};
+  auto types = index.topTypes(2);
+  ASSERT_EQ(types.size(), 2);
+  EXPECT_EQ(types[0].first, "std::vector<int, std::allocator<int>>");
+  EXPECT_EQ(types[0].second.count, 1);
+  EXPECT_EQ(types[1].first, "std::string");
+
+  auto all = index.topTypes(100);
+  ASSERT_EQ(all.size(), 4);
+  EXPECT_EQ(all[3].first, "Foo");
+  EXPECT_EQ(all[2].first, "int");
+  EXPECT_EQ(all[2].second.count, 3);
+  EXPECT_EQ(all[2].second.exclusiveSize, 12);
+}
+
+TEST_F(NodeIndexTest, LargestNodes) {
+  NodeIndex index{dbPath};
+  std::vector<node_index::Entry> nodes;
+  index.largestNodes([&](const node_index::Entry& node) {
+    nodes.push_back(node);
+    return nodes.size() < 3;
+  });
+
+  ASSERT_EQ(nodes.size(), 3);
+  EXPECT_EQ(nodes[0].id, 1025);
+  EXPECT_EQ(nodes[0].exclusiveSize, 100);
+  EXPECT_EQ(nodes[0].typeName, "std::vector<int, std::allocator<int>>");
+  EXPECT_EQ(nodes[0].path, "foo/v");
+  EXPECT_EQ(nodes[1].id, 1028);
+  EXPECT_EQ(nodes[2].id, 1024);
+}
+
+TEST_F(NodeIndexTest, NodesOfType) {
+  NodeIndex index{dbPath};
+  EXPECT_EQ(ids([&](auto& visit) { index.nodesOfType("int", visit); }),
+            (std::vector<uint64_t>{1026, 1027, 1029}));
+  EXPECT_EQ(ids([&](auto& visit) { index.nodesOfType("in", visit); }),
+            std::vector<uint64_t>{});
+}
+
+TEST_F(NodeIndexTest, NodesUnder) {
+  NodeIndex index{dbPath};
+  EXPECT_EQ(ids([&](auto& visit) { index.nodesUnder("foo/v", visit); }),
+            (std::vector<uint64_t>{1025, 1026, 1027}));
+  EXPECT_EQ(ids([&](auto& visit) { index.nodesUnder("foo", visit); }),
+            (std::vector<uint64_t>{1024, 1025, 1026, 1027, 1028}));
+  EXPECT_EQ(ids([&](auto& visit) { index.nodesUnder("", visit); }).size(), 6);
+}
+
+TEST_F(NodeIndexTest, RequiresIndex) {
+  fs::path empty = dbPath / "empty";
+  rocksdb::Options options;
+  options.create_if_missing = true;
+  rocksdb::DB* db = nullptr;
+  ASSERT_TRUE(rocksdb::DB::Open(options, empty.string(), &db).ok());
+  ASSERT_TRUE(db->Close().ok());
+  delete db;
+
+  EXPECT_THROW(NodeIndex{empty}, std::runtime_error);
+}
@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "oi/type_graph/Flattener.h"
+#include "oi/type_graph/IdentifyContainers.h"
+#include "oi/type_graph/NodeTracker.h"
+#include "oi/type_graph/PassManager.h"
+#include "oi/type_graph/Printer.h"
+#include "oi/type_graph/TypeGraph.h"
+#include "oi/type_graph/Types.h"
+#include "oi/type_graph/Visitor.h"
+#include "test/type_graph_utils.h"
+
+using namespace oi::detail::type_graph;
+
+namespace {
+
+class Recorder : public RecursiveVisitor {
+ public:
+  Recorder(NodeTracker& tracker, std::vector<std::string>& visited)
+      : tracker_(tracker), visited_(visited) {
+  }
+
+  using RecursiveVisitor::accept;
+
+  void accept(Type& type) override {
+    if (tracker_.visit(type))
+      return;
+    visited_.push_back(type.name());
+    type.accept(*this);
+  }
+
+ private:
+  NodeTracker& tracker_;
+  std::vector<std::string>& visited_;
+};
+
+Pass recordPass(std::vector<std::string>& visited) {
+  return Pass("Record", [&visited](TypeGraph& typeGraph, NodeTracker& tracker) {
+    Recorder recorder{tracker, visited};
+    for (auto& type : typeGraph.rootTypes()) {
+      recorder.accept(type);
+    }
+  });
+}
+
+// Adds `child` as a child of the root, standing in for AddChildren
+Pass addChildPass(std::function<Class&(TypeGraph&)> makeChild) {
+  return Pass("AddChild", [makeChild](TypeGraph& typeGraph, NodeTracker&) {
+    auto& root = dynamic_cast<Class&>(typeGraph.rootTypes()[0].get());
+    root.children.push_back(makeChild(typeGraph));
+    typeGraph.markChanged(root);
+  });
+}
+
+}  // namespace
+
+TEST(PassManagerTest, IncrementalPassVisitsNewNodes) {
+  TypeGraph typeGraph;
+  auto& a = typeGraph.makeType<Class>(Class::Kind::Class, "A", 8);
+  auto& b = typeGraph.makeType<Class>(Class::Kind::Class, "B", 8);
+  a.members.push_back(Member{b, "b", 0});
+  typeGraph.addRoot(a);
+
+  std::vector<std::string> visited;
+  PassManager pm;
+  pm.addPass(recordPass(visited));
+  pm.addCheckpoint();
+  pm.addPass(addChildPass([](TypeGraph& typeGraph) -> Class& {
+    auto& c = typeGraph.makeType<Class>(Class::Kind::Class, "C", 8);
+    auto& d = typeGraph.makeType<Class>(Class::Kind::Class, "D", 8);
+    c.members.push_back(Member{d, "d", 0});
+    return c;
+  }));
+  pm.addIncrementalPass(recordPass(visited));
+  pm.run(typeGraph);
+
+  // A was changed, B is left alone
+  EXPECT_EQ(visited, (std::vector<std::string>{"A", "B", "A", "C", "D"}));
+
+  ASSERT_EQ(typeGraph.rootTypes().size(), 1);
+  EXPECT_EQ(&typeGraph.rootTypes()[0].get(), &a);
+}
+
+TEST(PassManagerTest, IncrementalFlattener) {
+  TypeGraph typeGraph;
+  auto& myint = typeGraph.makeType<Primitive>(Primitive::Kind::Int32);
+  auto& parent = typeGraph.makeType<Class>(Class::Kind::Class, "Parent", 4);
+  parent.members.push_back(Member{myint, "x", 0});
+  typeGraph.addRoot(parent);
+
+  Class* child = nullptr;
+  Class* grandchild = nullptr;
+  PassManager pm;
+  pm.addPass(Flattener::createPass());
+  pm.addCheckpoint();
+  pm.addPass(addChildPass([&](TypeGraph& typeGraph) -> Class& {
+    child = &typeGraph.makeType<Class>(Class::Kind::Class, "Child", 8);
+    child->parents.push_back(Parent{parent, 0});
+    child->members.push_back(Member{myint, "y", 32});
+
+    grandchild =
+        &typeGraph.makeType<Class>(Class::Kind::Class, "Grandchild", 12);
+    grandchild->parents.push_back(Parent{*child, 0});
+    grandchild->members.push_back(Member{myint, "z", 64});
+    child->children.push_back(*grandchild);
+    return *child;
+  }));
+  pm.addIncrementalPass(Flattener::createPass());
+  pm.run(typeGraph);
+
+  ASSERT_EQ(grandchild->members.size(), 3);
+  EXPECT_EQ(grandchild->members[0].name, "x");
+  EXPECT_EQ(grandchild->members[1].name, "y");
+  EXPECT_EQ(grandchild->members[2].name, "z");
+  EXPECT_TRUE(child->parents.empty());
+
+  // The changed parent pulls in its children's children
+  ASSERT_EQ(parent.children.size(), 2);
+  EXPECT_EQ(&parent.children[0].get(), child);
+  EXPECT_EQ(&parent.children[1].get(), grandchild);
+}
+
+namespace {
+/*
+ * Adds a child whose member is the root's std::vector Class, as parsed before
+ * the checkpoint, like a child reusing a type from DrgnParser's cache. Returns
+ * the child as printed once IdentifyContainers has run over it again.
+ */
+std::string identifyContainersInChild(bool incremental) {
+  auto containers = getContainerInfos();
+
+  TypeGraph typeGraph;
+  auto& myint = typeGraph.makeType<Primitive>(Primitive::Kind::Int32);
+  auto& vec = typeGraph.makeType<Class>(Class::Kind::Class, "std::vector", 24);
+  vec.templateParams.push_back(TemplateParam{myint});
+  auto& parent = typeGraph.makeType<Class>(Class::Kind::Class, "Parent", 24);
+  parent.members.push_back(Member{vec, "v", 0});
+  typeGraph.addRoot(parent);
+
+  Class* child = nullptr;
+  PassManager pm;
+  pm.addPass(IdentifyContainers::createPass(containers));
+  pm.addCheckpoint();
+  pm.addPass(addChildPass([&](TypeGraph& typeGraph) -> Class& {
+    child = &typeGraph.makeType<Class>(Class::Kind::Class, "Child", 48);
+    child->parents.push_back(Parent{parent, 0});
+    child->members.push_back(Member{vec, "w", 24 * 8});
+    return *child;
+  }));
+  if (incremental)
+    pm.addIncrementalPass(IdentifyContainers::createPass(containers));
+  else
+    pm.addPass(IdentifyContainers::createPass(containers));
+  pm.run(typeGraph);
+
+  std::stringstream out;
+  NodeTracker tracker;
+  Printer printer{out, tracker, typeGraph.size()};
+  printer.print(*child);
+  return out.str();
+}
+}  // namespace
+
+TEST(PassManagerTest, IncrementalIdentifyContainers) {
+  auto expected = identifyContainersInChild(false);
+  EXPECT_NE(expected.find("Member: w (offset: 24)\n[4]     Container:"),
+            std::string::npos)
+      << expected;
+
+  // The member's old Class must still be replaced, though out of scope
+  EXPECT_EQ(identifyContainersInChild(true), expected);
+}
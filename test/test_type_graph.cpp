@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "oi/type_graph/TypeGraph.h"
+
+using namespace oi::detail::type_graph;
+
+TEST(TypeGraphTest, InternSharesStorage) {
+  TypeGraph typeGraph;
+  std::string name = "allocate";
+
+  auto a = typeGraph.intern(name);
+  auto b = typeGraph.intern("allocate");
+  auto c = typeGraph.intern("deallocate");
+  name = "overwritten";
+
+  EXPECT_EQ(a, "allocate");
+  EXPECT_EQ(a.data(), b.data());
+  EXPECT_EQ(c, "deallocate");
+  EXPECT_EQ(typeGraph.intern(""), "");
+}
+
+TEST(TypeGraphTest, MovedGraphKeepsNodes) {
+  TypeGraph typeGraph;
+  auto& myint = typeGraph.makeType<Primitive>(Primitive::Kind::Int32);
+  auto& myclass = typeGraph.makeType<Class>(Class::Kind::Class, "MyClass", 4);
+  myclass.members.push_back(Member{myint, "n", 0});
+  myclass.functions.push_back(Function{typeGraph.intern("f")});
+  typeGraph.addRoot(myclass);
+
+  TypeGraph moved{std::move(typeGraph)};
+  ASSERT_EQ(moved.rootTypes().size(), 1);
+  auto& root = dynamic_cast<Class&>(moved.rootTypes()[0].get());
+  EXPECT_EQ(&root, &myclass);
+  EXPECT_EQ(root.name(), "MyClass");
+  EXPECT_EQ(root.functions[0].name, "f");
+  EXPECT_EQ(moved.size(), 1);
+
+  TypeGraph assigned;
+  assigned.makeType<Class>(Class::Kind::Class, "Replaced", 4);
+  assigned = std::move(moved);
+  ASSERT_EQ(assigned.rootTypes().size(), 1);
+  EXPECT_EQ(&assigned.rootTypes()[0].get(), &myclass);
+  EXPECT_EQ(assigned.size(), 1);
+}
+
+TEST(TypeGraphTest, MakeTypeInternsInputNames) {
+  TypeGraph typeGraph;
+  std::string name = "ns::MyClass";
+  auto& myclass1 = typeGraph.makeType<Class>(Class::Kind::Class, name, 4);
+  auto& myclass2 =
+      typeGraph.makeType<Class>(Class::Kind::Class, "ns::MyClass", 4);
+  auto& mytypedef = typeGraph.makeType<Typedef>(name, myclass1);
+  name = "overwritten";
+
+  EXPECT_EQ(myclass1.inputName(), "ns::MyClass");
+  EXPECT_EQ(myclass1.inputName().data(), myclass2.inputName().data());
+  EXPECT_EQ(mytypedef.inputName().data(), myclass1.inputName().data());
+  EXPECT_EQ(myclass1.name(), "ns::MyClass");
+}
@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "oi/ContainerInfo.h"
+#include "oi/type_graph/TypeGraphSerializer.h"
+#include "test/TypeGraphParser.h"
+#include "test/type_graph_utils.h"
+
+using namespace type_graph;
+
+namespace {
+
+const ContainerInfo* findContainer(const std::string& typeName, bool) {
+  static ContainerInfo vector{"std::vector", SEQ_TYPE, "vector"};
+  static ContainerInfo allocator{"std::allocator", DUMMY_TYPE, "memory"};
+  if (typeName == vector.typeName)
+    return &vector;
+  if (typeName == allocator.typeName)
+    return &allocator;
+  return nullptr;
+}
+
+void testRoundTrip(std::string_view input) {
+  input.remove_prefix(1);  // Remove initial '\n'
+  TypeGraph typeGraph;
+  TypeGraphParser parser{typeGraph};
+  try {
+    parser.parse(input);
+  } catch (const TypeGraphParserError& err) {
+    FAIL() << "Error parsing input graph: " << err.what();
+  }
+  typeGraph.finalTypes = typeGraph.rootTypes();
+
+  std::stringstream data;
+  serialize(typeGraph, data);
+
+  TypeGraph loaded;
+  deserialize(data, loaded, findContainer);
+  check(loaded, input, "after deserializing");
+  ASSERT_EQ(loaded.finalTypes.size(), typeGraph.finalTypes.size());
+}
+
+}  // namespace
+
+TEST(TypeGraphSerializerTest, Class) {
+  testRoundTrip(R"(
+[0] Struct: MyStruct (size: 16, align: 8)
+      Param
+        Primitive: int32_t
+      Param
+        Value: 5
+        Primitive: int32_t
+      Member: n (offset: 0, align: 4)
+        Primitive: int32_t
+      Member: e (offset: 4, bitsize: 3)
+        Enum: MyEnum (size: 4)
+      Member: p (offset: 8)
+[1]     Pointer
+          [0]
+      Function: foo
+)");
+}
+
+TEST(TypeGraphSerializerTest, Nodes) {
+  testRoundTrip(R"(
+[0] Union: MyUnion (size: 8)
+      Member: arr (offset: 0)
+[1]     Array: (length: 2)
+          Primitive: int32_t
+      Member: td (offset: 0)
+[2]     Typedef: MyTypedef
+[3]       Container: std::vector (size: 24)
+            Param
+              Primitive: int32_t
+            Param
+[4]           DummyAllocator [MyAlloc] (size: 8)
+                Primitive: int32_t
+      Member: dummy (offset: 0)
+[5]     Dummy [MyDummy] (size: 4)
+      Member: inc (offset: 0)
+[6]     Incomplete: [IncompleteType]
+)");
+}
+
+TEST(TypeGraphSerializerTest, Attributes) {
+  TypeGraph typeGraph;
+  auto& myint = typeGraph.makeType<Primitive>(Primitive::Kind::Int32);
+  auto& myenum = typeGraph.makeType<Enum>(
+      "MyEnum", "ns::MyEnum", 4, std::map<int64_t, std::string>{{-1, "A"}});
+  auto& myclass = typeGraph.makeType<Class>(
+      Class::Kind::Class, "MyClass_0", "ns::MyClass", 8, 1);
+  myclass.setPacked();
+  myclass.members.push_back(Member{myenum, "e", 0});
+  myclass.members[0].inputName = "e_in";
+  myclass.functions.push_back(Function{typeGraph.intern("f"), 2});
+  auto& incomplete = typeGraph.makeType<Incomplete>(myint);
+  incomplete.setName("Incomplete<int>");
+  myclass.members.push_back(Member{incomplete, "i", 32});
+  ContainerInfo info{"std::vector", SEQ_TYPE, "vector"};
+  auto& vec = typeGraph.makeType<Container>(info, 24, nullptr);
+  vec.templateParams.push_back(TemplateParam{myint, {Qualifier::Const}});
+  vec.setName("std::vector<int32_t const>");
+  auto& keys = typeGraph.makeType<CaptureKeys>(vec, info);
+  auto& ptr = typeGraph.makeType<Pointer>(keys);
+  myclass.members.push_back(Member{ptr, "v", 64});
+  typeGraph.addRoot(myclass);
+
+  std::stringstream data;
+  serialize(typeGraph, data);
+  TypeGraph loaded;
+  deserialize(data, loaded, findContainer);
+
+  ASSERT_EQ(loaded.rootTypes().size(), 1);
+  auto& c = dynamic_cast<Class&>(loaded.rootTypes()[0].get());
+  EXPECT_EQ(c.name(), "MyClass_0");
+  EXPECT_EQ(c.inputName(), "ns::MyClass");
+  EXPECT_EQ(c.virtuality(), 1);
+  EXPECT_TRUE(c.packed());
+  ASSERT_EQ(c.functions.size(), 1);
+  EXPECT_EQ(c.functions[0].name, "f");
+  EXPECT_EQ(c.functions[0].virtuality, 2);
+
+  ASSERT_EQ(c.members.size(), 3);
+  EXPECT_EQ(c.members[0].inputName, "e_in");
+  auto& e = dynamic_cast<Enum&>(c.members[0].type());
+  EXPECT_EQ(e.inputName(), "ns::MyEnum");
+  EXPECT_EQ(e.enumerators(), (std::map<int64_t, std::string>{{-1, "A"}}));
+
+  auto& i = dynamic_cast<Incomplete&>(c.members[1].type());
+  EXPECT_EQ(i.name(), "Incomplete<int>");
+  ASSERT_TRUE(i.underlyingType().has_value());
+  EXPECT_EQ(&i.underlyingType()->get(), &myint);
+
+  // Derived names are regenerated from the loaded nodes
+  auto& p = dynamic_cast<Pointer&>(c.members[2].type());
+  EXPECT_EQ(p.name(), "OICaptureKeys<std::vector<int32_t const>>*");
+  auto& k = dynamic_cast<CaptureKeys&>(p.pointeeType());
+  auto& v = dynamic_cast<Container&>(k.underlyingType());
+  ASSERT_EQ(v.templateParams.size(), 1);
+  EXPECT_TRUE(v.templateParams[0].qualifiers[Qualifier::Const]);
+}
+
+TEST(TypeGraphSerializerTest, Children) {
+  testRoundTrip(R"(
+[0] Class: A (size: 8)
+      Member: a (offset: 0)
+        Primitive: int32_t
+      Child
+[1]     Class: B (size: 8)
+          Member: a (offset: 0)
+            Primitive: int32_t
+      Child
+[2]     Class: C (size: 8)
+          Member: a (offset: 0)
+            Primitive: int32_t
+)");
+}
+
+TEST(TypeGraphSerializerTest, UnknownContainer) {
+  TypeGraph typeGraph;
+  auto& myint = typeGraph.makeType<Primitive>(Primitive::Kind::Int32);
+  ContainerInfo info{"std::list", LIST_TYPE, "list"};
+  auto& list = typeGraph.makeType<Container>(info, 24, nullptr);
+  list.templateParams.push_back(myint);
+  typeGraph.addRoot(list);
+
+  std::stringstream data;
+  serialize(typeGraph, data);
+
+  TypeGraph loaded;
+  EXPECT_THROW(deserialize(data, loaded, findContainer),
+               TypeGraphSerializerError);
+}
+
+TEST(TypeGraphSerializerTest, Truncated) {
+  TypeGraph typeGraph;
+  auto& myclass = typeGraph.makeType<Class>(Class::Kind::Class, "MyClass", 4);
+  typeGraph.addRoot(myclass);
+
+  std::stringstream data;
+  serialize(typeGraph, data);
+  auto str = data.str();
+  std::stringstream truncated{str.substr(0, str.size() - 1)};
+
+  TypeGraph loaded;
+  EXPECT_THROW(deserialize(truncated, loaded, findContainer),
+               TypeGraphSerializerError);
+}
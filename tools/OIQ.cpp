@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "oi/NodeIndex.h"
+#include "oi/OIOpts.h"
+
+using namespace oi::detail;
+
+constexpr static OIOpts opts{
+    OIOpt{'h', "help", no_argument, nullptr, "Print this message and exit"},
+    OIOpt{'j', "json", no_argument, nullptr, "Print JSON instead of CSV"},
+    OIOpt{'n',
+          "limit",
+          required_argument,
+          "N",
+          "Print at most N rows (default: 20 for top-*, unlimited otherwise)"},
+};
+
+static void usage(std::ostream& out) {
+  out << "Query the indexes of an OID RocksDB result store.\n";
+  out << "\nusage: oiq [opts...] [--] <db_dir> <query> [arg]\n";
+  out << "\nqueries:\n";
+  out << "  top-types        types with the largest total exclusive size\n";
+  out << "  top-nodes        nodes with the largest exclusive size\n";
+  out << "  type <name>      nodes of the given type\n";
+  out << "  under <path>     nodes at or below the given path\n";
+  out << "  subtree <path>   total exclusive size per type at or below the "
+         "given path\n";
+  out << "\nPaths are the names of the nodes from the root, joined by '/'.\n";
+  out << opts << std::endl;
+}
+
+template <typename... Args>
+[[noreturn]] static void fatal_error(Args&&... args) {
+  std::cerr << "error: ";
+  (std::cerr << ... << args);
+  std::cerr << "\n\n";
+
+  usage(std::cerr);
+  exit(EXIT_FAILURE);
+}
+
+/*
+ * Streams rows out as CSV or as a JSON array of objects. Every row must have
+ * the same columns, the CSV header is taken from the first one.
+ */
+class RowPrinter {
+ public:
+  using Value = std::variant<uint64_t, std::string_view>;
+  struct Column {
+    std::string_view name;
+    Value value;
+  };
+
+  RowPrinter(std::ostream& out, bool json) : out(out), json(json) {
+  }
+
+  ~RowPrinter() {
+    if (json)
+      out << (rows == 0 ? "[" : "\n") << "]\n";
+    out.flush();
+  }
+
+  void print(std::initializer_list<Column> columns) {
+    if (json) {
+      out << (rows == 0 ? "[\n" : ",\n") << "  {";
+      bool first = true;
+      for (const auto& column : columns) {
+        out << (first ? "" : ", ") << '"' << column.name << "\": ";
+        printJson(column.value);
+        first = false;
+      }
+      out << '}';
+    } else {
+      if (rows == 0) {
+        bool first = true;
+        for (const auto& column : columns) {
+          out << (first ? "" : ",") << column.name;
+          first = false;
+        }
+        out << "\r\n";
+      }
+      bool first = true;
+      for (const auto& column : columns) {
+        out << (first ? "" : ",");
+        printCsv(column.value);
+        first = false;
+      }
+      out << "\r\n";
+    }
+    rows++;
+  }
+
+ private:
+  void printCsv(const Value& value) {
+    if (const auto* n = std::get_if<uint64_t>(&value)) {
+      out << *n;
+      return;
+    }
+
+    // Type names are full of commas, always quote
+    out << '"';
+    for (char c : std::get<std::string_view>(value)) {
+      if (c == '"')
+        out << '"';
+      out << c;
+    }
+    out << '"';
+  }
+
+  void printJson(const Value& value) {
+    if (const auto* n = std::get_if<uint64_t>(&value)) {
+      out << *n;
+      return;
+    }
+
+    out << '"';
+    for (char c : std::get<std::string_view>(value)) {
+      if (c == '"' || c == '\\') {
+        out << '\\' << c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        constexpr std::string_view hex = "0123456789abcdef";
+        out << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+      } else {
+        out << c;
+      }
+    }
+    out << '"';
+  }
+
+  std::ostream& out;
+  bool json;
+  size_t rows = 0;
+};
+
+int main(int argc, char* argv[]) {
+  bool json = false;
+  std::optional<size_t> limit;
+
+  int c = '\0';
+  while ((c = getopt_long(
+              argc, argv, opts.shortOpts(), opts.longOpts(), nullptr)) != -1) {
+    switch (c) {
+      case 'h':
+        usage(std::cout);
+        exit(EXIT_SUCCESS);
+      case 'j':
+        json = true;
+        break;
+      case 'n':
+        limit = std::strtoul(optarg, nullptr, 10);
+        break;
+      case ':':
+        fatal_error("missing option argument");
+      case '?':
+        fatal_error("invalid option");
+      default:
+        fatal_error("invalid option");
+    }
+  }
+
+  if (argc - optind < 2)
+    fatal_error("missing arguments");
+
+  std::string_view query = argv[optind + 1];
+  bool needsArg = query == "type" || query == "under" || query == "subtree";
+  if (!needsArg && query != "top-types" && query != "top-nodes")
+    fatal_error("unknown query ", query);
+  if (argc - optind != (needsArg ? 3 : 2))
+    fatal_error("wrong number of arguments for ", query);
+  std::string_view arg = needsArg ? argv[optind + 2] : "";
+
+  try {
+    NodeIndex index{argv[optind]};
+    RowPrinter printer{std::cout, json};
+
+    size_t remaining = limit.value_or(query.starts_with("top-")
+                                          ? 20
+                                          : std::numeric_limits<size_t>::max());
+    auto printNode = [&](const node_index::Entry& node) {
+      if (remaining == 0)
+        return false;
+      remaining--;
+      printer.print({{"id", node.id},
+                     {"path", node.path},
+                     {"typeName", node.typeName},
+                     {"exclusiveSize", node.exclusiveSize}});
+      return true;
+    };
+    auto printTypes = [&](const auto& types) {
+      for (const auto& [typeName, stats] : types) {
+        printer.print({{"typeName", typeName},
+                       {"count", stats.count},
+                       {"exclusiveSize", stats.exclusiveSize}});
+      }
+    };
+
+    if (query == "top-types") {
+      printTypes(index.topTypes(remaining));
+    } else if (query == "top-nodes") {
+      index.largestNodes(printNode);
+    } else if (query == "type") {
+      index.nodesOfType(arg, printNode);
+    } else if (query == "under") {
+      index.nodesUnder(arg, printNode);
+    } else if (query == "subtree") {
+      std::map<std::string, node_index::TypeStats> totals;
+      index.nodesUnder(arg, [&](const node_index::Entry& node) {
+        auto& stats = totals[node.typeName];
+        stats.count++;
+        stats.exclusiveSize += node.exclusiveSize;
+        return true;
+      });
+
+      std::vector<std::pair<std::string, node_index::TypeStats>> types(
+          totals.begin(), totals.end());
+      std::sort(types.begin(), types.end(), [](const auto& l, const auto& r) {
+        return l.second.exclusiveSize > r.second.exclusiveSize;
+      });
+      types.resize(std::min(types.size(), remaining));
+      printTypes(types);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
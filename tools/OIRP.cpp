@@ -137,6 +137,8 @@ struct Node {
    */
   size_t exclusiveSize{};
 
+  bool truncated{};
+
   MSGPACK_DEFINE_ARRAY(id,
                        name,
                        typeName,
@@ -149,7 +151,8 @@ struct Node {
                        pointer,
                        children,
                        isset,
-                       exclusiveSize)
+                       exclusiveSize,
+                       truncated)
 };
 
 std::ostream& operator<<(std::ostream& os, const Node& node) {
@@ -191,6 +194,9 @@ std::ostream& operator<<(std::ostream& os, const Node& node) {
     os << "  Is set not available\n";
   }
   os << "  Exclusive size: " << node.exclusiveSize << "\n";
+  if (node.truncated) {
+    os << "  Truncated\n";
+  }
   return os;
 }
 
@@ -223,9 +229,11 @@ int main(int argc, const char** argv) {
   auto db = std::unique_ptr<rocksdb::DB, decltype(close_db)>{nullptr};
 
   {  // Open the database, then safely store its pointer in a unique_ptr for
-     // lifetime management.
+     // lifetime management. Opening read only allows skipping the index
+     // column family.
     rocksdb::DB* _db = nullptr;
-    if (auto status = rocksdb::DB::Open(options, dbpath.string(), &_db);
+    if (auto status =
+            rocksdb::DB::OpenForReadOnly(options, dbpath.string(), &_db);
         !status.ok()) {
       fprintf(stderr,
               "Failed to open DB '%s' with error %s\n",